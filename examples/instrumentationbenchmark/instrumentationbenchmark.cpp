@@ -0,0 +1,257 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/GraphicsContext>
+#include <osg/MatrixTransform>
+#include <osg/ShapeDrawable>
+#include <osg/Stats>
+#include <osg/Timer>
+#include <osgGA/GUIEventAdapter>
+#include <osgViewer/GraphicsWindow>
+
+#include <opeViewer/AllocationCounters.h>
+#include <opeViewer/Instrumentation.h>
+#include <opeViewer/Stats.h>
+#include <opeViewer/Viewport.h>
+#include <opeViewer/Window.h>
+
+// 静态链接时也注册窗口系统，用于创建pbuffer
+USE_GRAPHICSWINDOW()
+
+/// 比较各统计级别下事件、更新遍历、渲染遍历（剔除和绘制）和advance的开销
+///
+/// 渲染遍历使用离屏的pbuffer上下文，不能创建时只测量事件、更新遍历和advance；用 -DOPEVIEWER_INSTRUMENTATION=OFF 构建可测量编译去除时的开销
+///
+/// 用 -DOPEVIEWER_ALLOCATION_COUNTERS=ON 构建时同时报告每帧的堆分配次数，给出--max-allocations时超过该值即视为退化，返回1；没有编译分配计数时给出--max-allocations是错误，返回2
+///
+/// 用法：instrumentationbenchmark [每组的帧数] [--max-allocations 每帧分配次数]
+
+namespace
+{
+
+class BenchmarkWindow : public opeViewer::Window
+{
+  public:
+    void requestRedraw() override
+    {
+    }
+
+    /// 创建pbuffer作为上下文并初始化视口，失败时返回false，之后不能渲染
+    bool createPbuffer(int width, int height)
+    {
+        osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+        traits->width = width;
+        traits->height = height;
+        traits->pbuffer = true;
+        traits->doubleBuffer = false;
+        traits->windowDecoration = false;
+
+        osg::ref_ptr<osg::GraphicsContext> graphicsContext = osg::GraphicsContext::createGraphicsContext(traits.get());
+        if (!graphicsContext || !graphicsContext->realize())
+        {
+            return false;
+        }
+
+        _graphicsContext = graphicsContext;
+        init();
+        return true;
+    }
+
+    bool canRender() const
+    {
+        return _graphicsContext.valid();
+    }
+
+    /// 一帧：一个FRAME事件、更新遍历、渲染遍历（render为true时）、advance
+    void step(osgGA::GUIEventAdapter &ea, bool render)
+    {
+        event(ea);
+        updateTraversal();
+        if (render)
+        {
+            renderingTraversals();
+        }
+        advance();
+    }
+};
+
+/// 16x16个立方体，每个有自己的变换
+osg::Node *createScene()
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(new osg::ShapeDrawable(new osg::Box(osg::Vec3(), 0.8f)));
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int j = 0; j < 16; ++j)
+        {
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrix::translate(i - 7.5, j - 7.5, 0.0));
+            transform->addChild(geode);
+            root->addChild(transform);
+        }
+    }
+    return root.release();
+}
+
+void setCollectStats(BenchmarkWindow *window, bool collect)
+{
+    for (const char *key : {"frame_rate", "event", "update", "scene", "memory", "perf", "allocations"})
+    {
+        opeViewer::Stats::setCollectStats(window->getStats(), key, collect);
+    }
+
+    for (auto viewport : window->getViewports())
+    {
+        osg::Stats *stats = viewport->getCamera()->getStats();
+        if (!stats)
+        {
+            continue;
+        }
+        for (const char *key : {"rendering", "gpu", "scene", "pipeline", "gpu_passes", "perf", "allocations"})
+        {
+            opeViewer::Stats::setCollectStats(stats, key, collect);
+        }
+    }
+}
+
+struct Result
+{
+    /// 每帧的耗时（纳秒）
+    double nanoseconds{};
+    /// 每帧的堆分配次数，没有编译分配计数时为0
+    double allocations{};
+};
+
+Result run(BenchmarkWindow *window, osgGA::GUIEventAdapter &ea, unsigned int numFrames, bool render)
+{
+    // 预热
+    for (unsigned int i = 0; i < numFrames / 10; ++i)
+    {
+        window->step(ea, render);
+    }
+
+    opeViewer::AllocationCounters beginAllocations = opeViewer::AllocationCounters::getThreadCounters();
+    osg::Timer_t begin = osg::Timer::instance()->tick();
+    for (unsigned int i = 0; i < numFrames; ++i)
+    {
+        window->step(ea, render);
+    }
+    osg::Timer_t end = osg::Timer::instance()->tick();
+    opeViewer::AllocationCounters endAllocations = opeViewer::AllocationCounters::getThreadCounters();
+
+    Result result;
+    result.nanoseconds = osg::Timer::instance()->delta_n(begin, end) / numFrames;
+    result.allocations = static_cast<double>(endAllocations.numAllocations - beginAllocations.numAllocations) / numFrames;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int numFrames = 200000;
+    double maxAllocations = -1.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--max-allocations") == 0 && i + 1 < argc)
+        {
+            maxAllocations = std::strtod(argv[++i], nullptr);
+        }
+        else
+        {
+            numFrames = static_cast<unsigned int>(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+    if (numFrames == 0)
+    {
+        numFrames = 1;
+    }
+
+    bool countAllocations = opeViewer::AllocationCounters::isAvailable();
+    if (maxAllocations >= 0.0 && !countAllocations)
+    {
+        std::fprintf(stderr, "--max-allocations requires a build with -DOPEVIEWER_ALLOCATION_COUNTERS=ON\n");
+        return 2;
+    }
+
+    // 渲染的帧慢得多
+    unsigned int numRenderFrames = std::max(numFrames / 100, 1u);
+
+    osg::ref_ptr<BenchmarkWindow> window = new BenchmarkWindow;
+
+    osg::ref_ptr<opeViewer::Viewport> viewport = new opeViewer::Viewport;
+    window->addViewport(viewport);
+    viewport->setSceneData(createScene());
+    viewport->getCamera()->setViewMatrixAsLookAt(osg::Vec3d(0.0, -20.0, 20.0), osg::Vec3d(), osg::Vec3d(0.0, 0.0, 1.0));
+    viewport->getCamera()->setProjectionMatrixAsPerspective(45.0, 1.0, 1.0, 100.0);
+
+    if (!window->createPbuffer(256, 256))
+    {
+        std::printf("cannot create a pbuffer, skipping rendering traversals\n");
+    }
+
+    osg::ref_ptr<osgGA::GUIEventAdapter> ea = new osgGA::GUIEventAdapter;
+    ea->setEventType(osgGA::GUIEventAdapter::FRAME);
+
+    std::printf("instrumentation compiled %s, allocation counters compiled %s, %u frames per run, %u with rendering\n", opeViewer::Instrumentation::isCompiledIn() ? "in" : "out", countAllocations ? "in" : "out", numFrames,
+                numRenderFrames);
+    std::printf("%-8s %-10s %-8s %12s %14s\n", "level", "stats", "frame", "ns/frame", "allocs/frame");
+
+    bool regressed = false;
+
+    const std::pair<opeViewer::Instrumentation::Level, const char *> levels[] = {
+        {opeViewer::Instrumentation::OFF, "off"},
+        {opeViewer::Instrumentation::BASIC, "basic"},
+        {opeViewer::Instrumentation::FULL, "full"},
+    };
+
+    for (const auto &level : levels)
+    {
+        opeViewer::Instrumentation::setLevel(level.first);
+
+        for (bool collect : {false, true})
+        {
+            setCollectStats(window, collect);
+            window->setCollectFrameTimeHistograms(collect);
+
+            for (bool render : {false, true})
+            {
+                if (render && !window->canRender())
+                {
+                    continue;
+                }
+
+                const char *collectName = collect ? "collected" : "idle";
+                const char *frameName = render ? "render" : "update";
+
+                Result result = run(window, *ea, render ? numRenderFrames : numFrames, render);
+                if (countAllocations)
+                {
+                    std::printf("%-8s %-10s %-8s %12.1f %14.2f\n", level.second, collectName, frameName, result.nanoseconds, result.allocations);
+                }
+                else
+                {
+                    std::printf("%-8s %-10s %-8s %12.1f %14s\n", level.second, collectName, frameName, result.nanoseconds, "-");
+                }
+
+                if (maxAllocations >= 0.0 && result.allocations > maxAllocations)
+                {
+                    std::printf("regression: %s/%s/%s allocates %.2f times per frame, limit %.2f\n", level.second, collectName, frameName, result.allocations, maxAllocations);
+                    regressed = true;
+                }
+            }
+        }
+    }
+
+    return regressed ? 1 : 0;
+}
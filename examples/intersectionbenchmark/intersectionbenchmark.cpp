@@ -0,0 +1,524 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <osg/FrameStamp>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/NodeCallback>
+#include <osg/Timer>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/UpdateVisitor>
+
+#include <opeViewer/AsyncPicker.h>
+#include <opeViewer/ComputeIntersection.h>
+#include <opeViewer/LineSegmentIntersector.h>
+#include <opeViewer/RayKernels.h>
+#include <opeViewer/Scene.h>
+#include <opeViewer/ThreadPool.h>
+#include <opeViewer/Viewport.h>
+
+/// 比较opeViewer::LineSegmentIntersector与osgUtil::LineSegmentIntersector的结果，并测量RayKernels、两种求交器和批量求交的耗时
+///
+/// 场景包含三角形、三角形带、三角形扇，部分位于远离原点的大坐标处；射线一部分随机，一部分指向随机三角形的内部，每种指令集各求交一次
+///
+/// 命中的几何体、图元序号、索引必须相同，比例、法线、重心坐标在容差内相同，否则返回1；场景有更新回调时异步拾取也必须回调，否则返回1
+///
+/// 用法：intersectionbenchmark [--verify] [射线数量]，--verify时只比较结果，不测量耗时
+
+namespace
+{
+
+using Intersections = osgUtil::LineSegmentIntersector::Intersections;
+
+const opeViewer::RayKernels::InstructionSet instructionSets[] = {
+    opeViewer::RayKernels::SCALAR,
+    opeViewer::RayKernels::SSE,
+    opeViewer::RayKernels::AVX2,
+    opeViewer::RayKernels::AVX512,
+};
+
+osg::Vec3 randomPoint(std::mt19937 &random, const osg::Vec3 &center, float size)
+{
+    std::uniform_real_distribution<float> distribution(-size, size);
+    return center + osg::Vec3(distribution(random), distribution(random), distribution(random));
+}
+
+/// 随机三角形
+osg::Geometry *createTriangles(std::mt19937 &random, const osg::Vec3 &center, unsigned int numTriangles)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for (unsigned int i = 0; i < numTriangles; ++i)
+    {
+        osg::Vec3 v0 = randomPoint(random, center, 10.0f);
+        vertices->push_back(v0);
+        vertices->push_back(randomPoint(random, v0, 1.0f));
+        vertices->push_back(randomPoint(random, v0, 1.0f));
+    }
+
+    osg::Geometry *geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices->size())));
+    return geometry;
+}
+
+/// 起伏的网格，每行一个三角形带，另加一个索引三角形扇
+osg::Geometry *createGrid(std::mt19937 &random, const osg::Vec3 &center, unsigned int size)
+{
+    std::uniform_real_distribution<float> height(-0.5f, 0.5f);
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for (unsigned int y = 0; y <= size; ++y)
+    {
+        for (unsigned int x = 0; x <= size; ++x)
+        {
+            vertices->push_back(center + osg::Vec3(static_cast<float>(x) - size * 0.5f, static_cast<float>(y) - size * 0.5f, height(random)));
+        }
+    }
+
+    osg::Geometry *geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+
+    for (unsigned int y = 0; y < size; ++y)
+    {
+        osg::ref_ptr<osg::DrawElementsUInt> strip = new osg::DrawElementsUInt(GL_TRIANGLE_STRIP);
+        for (unsigned int x = 0; x <= size; ++x)
+        {
+            strip->push_back((y + 1) * (size + 1) + x);
+            strip->push_back(y * (size + 1) + x);
+        }
+        geometry->addPrimitiveSet(strip.get());
+    }
+
+    osg::ref_ptr<osg::DrawElementsUShort> fan = new osg::DrawElementsUShort(GL_TRIANGLE_FAN);
+    fan->push_back(0);
+    for (unsigned int x = 1; x <= std::min(size, 64u); ++x)
+    {
+        fan->push_back(static_cast<unsigned short>(size + 1 + x));
+    }
+    geometry->addPrimitiveSet(fan.get());
+
+    return geometry;
+}
+
+osg::Node *createScene(std::mt19937 &random)
+{
+    osg::Group *root = new osg::Group;
+
+    // 原点附近和大坐标处各一组，大坐标检验打包时的中心化
+    for (const osg::Vec3d &offset : {osg::Vec3d(), osg::Vec3d(1.0e5, -6.0e4, 1.0e3)})
+    {
+        root->addChild(createTriangles(random, offset, 2000));
+        root->addChild(createGrid(random, offset + osg::Vec3d(0.0, 0.0, -5.0), 64));
+
+        osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrixd::rotate(0.7, osg::Vec3d(1.0, 2.0, 3.0)) * osg::Matrixd::translate(offset + osg::Vec3d(3.0, 1.0, 2.0)));
+        transform->addChild(createTriangles(random, osg::Vec3(), 500));
+        transform->addChild(createGrid(random, osg::Vec3(0.0f, 0.0f, 5.0f), 16));
+        root->addChild(transform.get());
+    }
+
+    return root;
+}
+
+using Ray = opeViewer::Ray;
+
+/// 一半随机穿过场景，一半指向随机三角形的内部
+std::vector<Ray> createRays(std::mt19937 &random, osg::Node *scene, unsigned int numRays)
+{
+    std::vector<Ray> rays;
+
+    osg::Group *root = scene->asGroup();
+    std::uniform_int_distribution<unsigned int> child(0, root->getNumChildren() - 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_real_distribution<double> barycentric(0.02, 0.48);
+
+    while (rays.size() < numRays)
+    {
+        // 每个子节点的包围球内随机取两点
+        const osg::BoundingSphere &childBound = root->getChild(child(random))->getBound();
+        osg::Vec3d a = osg::Vec3d(randomPoint(random, osg::Vec3(), 1.0f)) * childBound.radius() * 2.0 + childBound.center();
+
+        if (rays.size() % 2 == 0)
+        {
+            osg::Vec3d b = osg::Vec3d(randomPoint(random, osg::Vec3(), 1.0f)) * childBound.radius() * 2.0 + childBound.center();
+            rays.push_back({a, b});
+            continue;
+        }
+
+        // 指向随机三角形内部，避开边和顶点，两种实现在边上的取舍可以不同
+        osg::Node *node = root->getChild(child(random));
+        osg::Matrixd matrix;
+        if (osg::MatrixTransform *transform = dynamic_cast<osg::MatrixTransform *>(node))
+        {
+            matrix = transform->getMatrix();
+            node = transform->getChild(0);
+        }
+        osg::Geometry *geometry = node->asGeometry();
+        if (!geometry || geometry->getPrimitiveSet(0)->getMode() != GL_TRIANGLES)
+        {
+            continue;
+        }
+
+        const osg::Vec3Array &vertices = *static_cast<const osg::Vec3Array *>(geometry->getVertexArray());
+        unsigned int triangle = std::uniform_int_distribution<unsigned int>(0, static_cast<unsigned int>(vertices.size() / 3) - 1)(random);
+        double u = barycentric(random);
+        double v = barycentric(random);
+        osg::Vec3d target = (osg::Vec3d(vertices[triangle * 3]) * (1.0 - u - v) + osg::Vec3d(vertices[triangle * 3 + 1]) * u + osg::Vec3d(vertices[triangle * 3 + 2]) * v) * matrix;
+
+        osg::Vec3d direction = target - a;
+        rays.push_back({a, target + direction * unit(random)});
+    }
+
+    return rays;
+}
+
+void intersect(osgUtil::LineSegmentIntersector *picker, osg::Node *scene, Intersections &intersections)
+{
+    osgUtil::IntersectionVisitor iv(picker);
+    scene->accept(iv);
+    intersections = picker->getIntersections();
+}
+
+bool isEquivalent(const Intersections &expected, const Intersections &actual, const char *name, unsigned int rayIndex)
+{
+    auto report = [&](const char *reason) {
+        std::printf("mismatch: %s, ray %u: %s (expected %u hits, got %u)\n", name, rayIndex, reason, static_cast<unsigned int>(expected.size()), static_cast<unsigned int>(actual.size()));
+        return false;
+    };
+
+    if (expected.size() != actual.size())
+    {
+        return report("hit count");
+    }
+
+    // 比例相同的命中顺序可以不同，按几何体和图元排序后比较
+    auto sorted = [](const Intersections &intersections) {
+        std::vector<const osgUtil::LineSegmentIntersector::Intersection *> result;
+        for (auto &intersection : intersections)
+        {
+            result.push_back(&intersection);
+        }
+        std::sort(result.begin(), result.end(), [](auto lhs, auto rhs) { return lhs->drawable != rhs->drawable ? lhs->drawable < rhs->drawable : lhs->primitiveIndex < rhs->primitiveIndex; });
+        return result;
+    };
+
+    std::vector<const osgUtil::LineSegmentIntersector::Intersection *> lhs = sorted(expected);
+    std::vector<const osgUtil::LineSegmentIntersector::Intersection *> rhs = sorted(actual);
+
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+    {
+        const auto &e = *lhs[i];
+        const auto &a = *rhs[i];
+
+        if (e.drawable != a.drawable || e.primitiveIndex != a.primitiveIndex)
+        {
+            return report("drawable or primitive index");
+        }
+        if (e.nodePath != a.nodePath || e.indexList != a.indexList)
+        {
+            return report("node path or index list");
+        }
+        if (std::abs(e.ratio - a.ratio) > 1e-9)
+        {
+            return report("ratio");
+        }
+        osg::Vec3d normal = e.getWorldIntersectNormal();
+        if ((normal - a.getWorldIntersectNormal()).length() > 1e-6)
+        {
+            return report("normal");
+        }
+        if ((e.getWorldIntersectPoint() - a.getWorldIntersectPoint()).length() > 1e-6 * std::max(1.0, e.getWorldIntersectPoint().length()))
+        {
+            return report("point");
+        }
+        if (e.ratioList.size() != a.ratioList.size())
+        {
+            return report("barycentric ratios");
+        }
+        for (std::size_t j = 0; j < e.ratioList.size(); ++j)
+        {
+            if (std::abs(e.ratioList[j] - a.ratioList[j]) > 1e-6)
+            {
+                return report("barycentric ratios");
+            }
+        }
+    }
+
+    return true;
+}
+
+/// 每种指令集的结果都与osgUtil一致时返回true
+bool verify(osg::Node *scene, const std::vector<Ray> &rays)
+{
+    bool equivalent = true;
+    unsigned int numHits = 0;
+
+    for (unsigned int i = 0; i < rays.size(); ++i)
+    {
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> reference = new osgUtil::LineSegmentIntersector(osgUtil::Intersector::MODEL, rays[i].start, rays[i].end);
+
+        Intersections expected;
+        intersect(reference.get(), scene, expected);
+        numHits += static_cast<unsigned int>(expected.size());
+
+        for (auto instructionSet : instructionSets)
+        {
+            if (instructionSet > opeViewer::RayKernels::getSupportedInstructionSet())
+            {
+                continue;
+            }
+
+            osg::ref_ptr<opeViewer::LineSegmentIntersector> picker = new opeViewer::LineSegmentIntersector(osgUtil::Intersector::MODEL, rays[i].start, rays[i].end);
+            picker->setInstructionSet(instructionSet);
+
+            Intersections actual;
+            intersect(picker.get(), scene, actual);
+            equivalent = isEquivalent(expected, actual, opeViewer::RayKernels::getInstructionSetName(instructionSet), i) && equivalent;
+        }
+    }
+
+    std::printf("verified %u rays, %u hits: %s\n", static_cast<unsigned int>(rays.size()), numHits, equivalent ? "equivalent" : "MISMATCH");
+    return equivalent;
+}
+
+struct CountingPickCallback : opeViewer::AsyncPicker::PickCallback
+{
+    unsigned int numCalls{};
+    unsigned int numHits{};
+
+    void pickedImplementation(osg::Camera *, float, float, const Intersections &intersections) override
+    {
+        ++numCalls;
+        numHits += static_cast<unsigned int>(intersections.size());
+    }
+};
+
+/// 场景有更新回调（每帧都执行更新遍历）时，异步拾取不能被当作过期而丢弃
+bool verifyAsyncPick(osg::Node *scene)
+{
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    root->addChild(scene);
+    root->setUpdateCallback(new osg::NodeCallback);
+
+    osg::ref_ptr<opeViewer::Viewport> viewport = new opeViewer::Viewport;
+    viewport->setSceneData(root.get());
+    osg::Camera *camera = viewport->getCamera();
+    // 俯视原点附近的网格，中心的射线必然命中
+    camera->setViewMatrixAsLookAt(osg::Vec3d(0.0, 0.0, 100.0), osg::Vec3d(), osg::Vec3d(0.0, 1.0, 0.0));
+    camera->setProjectionMatrixAsPerspective(30.0, 1.0, 1.0, 1000.0);
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::ref_ptr<osgUtil::UpdateVisitor> updateVisitor = new osgUtil::UpdateVisitor;
+    updateVisitor->setFrameStamp(frameStamp.get());
+
+    osg::ref_ptr<opeViewer::AsyncPicker> picker = new opeViewer::AsyncPicker;
+    osg::ref_ptr<CountingPickCallback> callback = new CountingPickCallback;
+    picker->requestPick(camera, 0.0f, 0.0f, ~0u, callback.get(), callback.get());
+
+    // 同Window：渲染遍历开始时派发，下一帧更新遍历开始时回调；求交在下一帧的更新遍历之后才完成，最坏情况
+    for (unsigned int frame = 0; frame < opeViewer::AsyncPicker::MAXIMUM_NUM_REISSUES + 2 && callback->numCalls == 0; ++frame)
+    {
+        picker->dispatch();
+        frameStamp->setFrameNumber(frame);
+        updateVisitor->reset();
+        updateVisitor->setTraversalNumber(frame);
+        viewport->getScene()->updateSceneGraph(*updateVisitor);
+        picker->wait();
+        picker->deliver(nullptr, frame);
+    }
+
+    bool delivered = callback->numCalls == 1 && callback->numHits > 0;
+    std::printf("async pick with update callback: %u callbacks, %u hits: %s\n", callback->numCalls, callback->numHits, delivered ? "delivered" : "NOT DELIVERED");
+    return delivered;
+}
+
+/// 每个三角形或包围盒的耗时（纳秒）
+void benchmarkKernels(std::mt19937 &random)
+{
+    const unsigned int N = opeViewer::RayKernels::NUM_LANES;
+    const unsigned int numBlocks = 4096;
+
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> triangles(numBlocks * opeViewer::RayKernels::TRIANGLE_BLOCK_SIZE);
+    std::vector<float> boxes(numBlocks * opeViewer::RayKernels::BOX_BLOCK_SIZE);
+    for (float &value : triangles)
+    {
+        value = distribution(random);
+    }
+    for (unsigned int block = 0; block < numBlocks; ++block)
+    {
+        float *box = boxes.data() + block * opeViewer::RayKernels::BOX_BLOCK_SIZE;
+        for (unsigned int i = 0; i < 3 * N; ++i)
+        {
+            float a = distribution(random);
+            float b = distribution(random);
+            box[i] = std::min(a, b);
+            box[i + 3 * N] = std::max(a, b);
+        }
+    }
+
+    float origin[3] = {0.0f, 0.0f, -2.0f};
+    float direction[3] = {0.1f, 0.2f, 1.0f};
+    opeViewer::RayKernels::Ray ray(origin, direction, 0.0f, 10.0f);
+
+    std::printf("%-8s %14s %14s\n", "kernel", "ns/triangle", "ns/box");
+    for (auto instructionSet : instructionSets)
+    {
+        if (instructionSet > opeViewer::RayKernels::getSupportedInstructionSet())
+        {
+            continue;
+        }
+        const opeViewer::RayKernels &kernels = opeViewer::RayKernels::get(instructionSet);
+
+        const unsigned int numRepeats = 200;
+        float t[N];
+        unsigned int hits = 0;
+
+        osg::Timer_t begin = osg::Timer::instance()->tick();
+        for (unsigned int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            for (unsigned int block = 0; block < numBlocks; ++block)
+            {
+                hits += kernels.intersectTriangles(ray, triangles.data() + block * opeViewer::RayKernels::TRIANGLE_BLOCK_SIZE, t);
+            }
+        }
+        osg::Timer_t middle = osg::Timer::instance()->tick();
+        for (unsigned int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            for (unsigned int block = 0; block < numBlocks; ++block)
+            {
+                hits += kernels.intersectBoxes(ray, boxes.data() + block * opeViewer::RayKernels::BOX_BLOCK_SIZE);
+            }
+        }
+        osg::Timer_t end = osg::Timer::instance()->tick();
+
+        double count = static_cast<double>(numRepeats) * numBlocks * N;
+        std::printf("%-8s %14.3f %14.3f\n", opeViewer::RayKernels::getInstructionSetName(instructionSet), osg::Timer::instance()->delta_n(begin, middle) / count, osg::Timer::instance()->delta_n(middle, end) / count);
+
+        // 避免循环被优化掉
+        static volatile unsigned int sink;
+        sink = hits;
+    }
+}
+
+/// 每条射线的耗时（微秒），打包在预热时完成
+void benchmarkIntersectors(osg::Node *scene, const std::vector<Ray> &rays)
+{
+    auto run = [&](auto createPicker) {
+        Intersections intersections;
+        for (const Ray &ray : rays)
+        {
+            intersect(createPicker(ray).get(), scene, intersections);
+        }
+
+        osg::Timer_t begin = osg::Timer::instance()->tick();
+        for (const Ray &ray : rays)
+        {
+            intersect(createPicker(ray).get(), scene, intersections);
+        }
+        return osg::Timer::instance()->delta_u(begin, osg::Timer::instance()->tick()) / rays.size();
+    };
+
+    std::printf("%-8s %14s\n", "picker", "us/ray");
+
+    double reference = run([](const Ray &ray) { return osg::ref_ptr<osgUtil::LineSegmentIntersector>(new osgUtil::LineSegmentIntersector(osgUtil::Intersector::MODEL, ray.start, ray.end)); });
+    std::printf("%-8s %14.3f\n", "osgUtil", reference);
+
+    for (auto instructionSet : instructionSets)
+    {
+        if (instructionSet > opeViewer::RayKernels::getSupportedInstructionSet())
+        {
+            continue;
+        }
+
+        double time = run([instructionSet](const Ray &ray) {
+            osg::ref_ptr<opeViewer::LineSegmentIntersector> picker = new opeViewer::LineSegmentIntersector(osgUtil::Intersector::MODEL, ray.start, ray.end);
+            picker->setInstructionSet(instructionSet);
+            return osg::ref_ptr<osgUtil::LineSegmentIntersector>(picker.get());
+        });
+        std::printf("%-8s %14.3f\n", opeViewer::RayKernels::getInstructionSetName(instructionSet), time);
+    }
+}
+
+/// 批量求交在不同线程数的线程池中每秒求交的射线数量，第一次运行完成打包
+void benchmarkBatched(osg::Node *scene, const std::vector<Ray> &rays)
+{
+    const unsigned int numRepeats = 20;
+    std::vector<opeViewer::RayHit> hits(rays.size());
+
+    std::printf("%-8s %14s %14s\n", "threads", "rays/s", "hits");
+
+    unsigned int maximumNumThreads = osg::ref_ptr<opeViewer::ThreadPool>(new opeViewer::ThreadPool)->getNumThreads();
+    for (unsigned int numThreads = 1;; numThreads = std::min(numThreads * 2, maximumNumThreads))
+    {
+        osg::ref_ptr<opeViewer::ThreadPool> threadPool = new opeViewer::ThreadPool(numThreads);
+        unsigned int numHits = opeViewer::computeIntersections(scene, rays.data(), rays.size(), hits.data(), ~0u, threadPool.get());
+
+        osg::Timer_t begin = osg::Timer::instance()->tick();
+        for (unsigned int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            opeViewer::computeIntersections(scene, rays.data(), rays.size(), hits.data(), ~0u, threadPool.get());
+        }
+        double seconds = osg::Timer::instance()->delta_s(begin, osg::Timer::instance()->tick());
+
+        // 调用线程也参与求交
+        std::printf("%-8u %14.0f %14u\n", threadPool->getNumThreads() + 1, static_cast<double>(numRepeats) * rays.size() / seconds, numHits);
+
+        if (numThreads >= maximumNumThreads)
+        {
+            break;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int numRays = 2000;
+    bool verifyOnly = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--verify") == 0)
+        {
+            verifyOnly = true;
+        }
+        else
+        {
+            numRays = static_cast<unsigned int>(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+    if (numRays == 0)
+    {
+        numRays = 1;
+    }
+
+    // 固定种子，结果可以复现
+    std::mt19937 random(20261018);
+
+    osg::ref_ptr<osg::Node> scene = createScene(random);
+    std::vector<Ray> rays = createRays(random, scene.get(), numRays);
+
+    std::printf("supported instruction set %s\n", opeViewer::RayKernels::getInstructionSetName(opeViewer::RayKernels::getSupportedInstructionSet()));
+
+    bool equivalent = verify(scene.get(), rays);
+    equivalent = verifyAsyncPick(scene.get()) && equivalent;
+
+    if (!verifyOnly)
+    {
+        benchmarkKernels(random);
+        benchmarkIntersectors(scene.get(), rays);
+        benchmarkBatched(scene.get(), rays);
+    }
+
+    return equivalent ? 0 : 1;
+}
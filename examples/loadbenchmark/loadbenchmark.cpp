@@ -0,0 +1,195 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <osg/FrameStamp>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+#include <osgDB/WriteFile>
+#include <osgUtil/UpdateVisitor>
+
+#include <opeViewer/Scene.h>
+#include <opeViewer/SceneCache.h>
+#include <opeViewer/Viewport.h>
+
+/// 测量Viewport::loadSceneData冷、热两次加载的耗时
+///
+/// 生成文本格式（osgt）的场景文件，依次不使用缓存加载、使用空的SceneCache加载（未命中，写入缓存）、再次使用SceneCache加载（命中），从调用loadSceneData到完成回调计时，期间同Window执行更新遍历
+///
+/// 冷加载必须未命中、热加载必须命中，且每次都加载成功，否则返回1
+///
+/// 用法：loadbenchmark [--verify] [三角形数量]，--verify时使用小场景只检查缓存
+
+namespace
+{
+
+struct CompletedCallback : opeViewer::Viewport::LoadSceneDataCallback
+{
+    bool completed{};
+    unsigned int numLoaded{};
+
+    void loadedImplementation(opeViewer::Viewport *, const std::string &, osg::Node *node) override
+    {
+        numLoaded += node ? 1 : 0;
+    }
+
+    void completedImplementation(opeViewer::Viewport *, osg::Group *) override
+    {
+        completed = true;
+    }
+};
+
+/// 随机三角形，每个几何体最多65536个三角形
+osg::Node *createScene(unsigned int numTriangles)
+{
+    std::mt19937 random(20261018);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+    osg::Geode *geode = new osg::Geode;
+    for (unsigned int first = 0; first < numTriangles; first += 65536)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+        for (unsigned int i = first; i < std::min(numTriangles, first + 65536); ++i)
+        {
+            osg::Vec3 v0(distribution(random), distribution(random), distribution(random));
+            osg::Vec3 v1 = v0 + osg::Vec3(1.0f, 0.0f, distribution(random) * 0.01f);
+            osg::Vec3 v2 = v0 + osg::Vec3(0.0f, 1.0f, distribution(random) * 0.01f);
+            osg::Vec3 normal = (v1 - v0) ^ (v2 - v0);
+            normal.normalize();
+
+            vertices->push_back(v0);
+            vertices->push_back(v1);
+            vertices->push_back(v2);
+            normals->insert(normals->end(), 3, normal);
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices->size())));
+        geode->addDrawable(geometry.get());
+    }
+    return geode;
+}
+
+/// 加载完成的耗时（毫秒），超时返回负数
+double load(opeViewer::Viewport *viewport, const std::string &file, unsigned int &numLoaded)
+{
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::ref_ptr<osgUtil::UpdateVisitor> updateVisitor = new osgUtil::UpdateVisitor;
+    updateVisitor->setFrameStamp(frameStamp.get());
+
+    osg::ref_ptr<CompletedCallback> callback = new CompletedCallback;
+
+    osg::Timer_t begin = osg::Timer::instance()->tick();
+    viewport->loadSceneData({file}, nullptr, callback.get());
+
+    // 合并操作在更新遍历中执行
+    for (unsigned int frame = 0; !callback->completed; ++frame)
+    {
+        if (osg::Timer::instance()->delta_s(begin, osg::Timer::instance()->tick()) > 120.0)
+        {
+            return -1.0;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        frameStamp->setFrameNumber(frame);
+        updateVisitor->reset();
+        updateVisitor->setTraversalNumber(frame);
+        viewport->getScene()->updateSceneGraph(*updateVisitor);
+    }
+
+    numLoaded = callback->numLoaded;
+    return osg::Timer::instance()->delta_m(begin, osg::Timer::instance()->tick());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned int numTriangles = 500000;
+    bool verifyOnly = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--verify") == 0)
+        {
+            verifyOnly = true;
+        }
+        else
+        {
+            numTriangles = static_cast<unsigned int>(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+    if (verifyOnly)
+    {
+        numTriangles = 1000;
+    }
+    if (numTriangles == 0)
+    {
+        numTriangles = 1;
+    }
+
+    // 每次运行使用空目录，第一次使用缓存时必然未命中
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "opeViewer_loadbenchmark";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory, ec);
+
+    std::string file = (directory / "scene.osgt").string();
+    {
+        osg::ref_ptr<osg::Node> scene = createScene(numTriangles);
+        if (!osgDB::writeNodeFile(*scene, file))
+        {
+            std::printf("failed to write %s\n", file.c_str());
+            return 1;
+        }
+    }
+
+    osg::ref_ptr<opeViewer::Viewport> viewport = new opeViewer::Viewport;
+    osg::ref_ptr<opeViewer::SceneCache> cache = new opeViewer::SceneCache((directory / "cache").string());
+
+    bool valid = true;
+    std::printf("%u triangles, %llu bytes\n", numTriangles, static_cast<unsigned long long>(std::filesystem::file_size(file, ec)));
+    std::printf("%-10s %14s %8s %8s\n", "load", "ms", "hits", "misses");
+
+    auto run = [&](const char *name, opeViewer::SceneCache *sceneCache, unsigned int expectedHits, unsigned int expectedMisses) {
+        viewport->setSceneCache(sceneCache);
+
+        unsigned int numLoaded = 0;
+        double time = load(viewport.get(), file, numLoaded);
+        unsigned int numHits = cache->getNumHits();
+        unsigned int numMisses = cache->getNumMisses();
+        std::printf("%-10s %14.3f %8u %8u\n", name, time, numHits, numMisses);
+
+        if (time < 0.0 || numLoaded != 1 || numHits != expectedHits || numMisses != expectedMisses)
+        {
+            std::printf("unexpected result: %s\n", name);
+            valid = false;
+        }
+    };
+
+    if (!verifyOnly)
+    {
+        run("uncached", nullptr, 0, 0);
+    }
+    run("cold", cache.get(), 0, 1);
+    run("warm", cache.get(), 1, 1);
+
+    viewport = nullptr;
+    cache = nullptr;
+    std::filesystem::remove_all(directory, ec);
+
+    return valid ? 0 : 1;
+}
@@ -4,7 +4,6 @@
 
 #include <QApplication>
 
-#include <osgDB/ReadFile>
 #include <osgGA/TrackballManipulator>
 
 #define USE_WIDGET 1
@@ -36,7 +35,7 @@ int main(int argc, char *argv[])
         viewport->getCamera()->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         viewport->getCamera()->setProjectionResizePolicy(osg::Camera::FIXED);
         viewport->getCamera()->setViewport(0, 0, 400, 400);
-        viewport->setSceneData(osgDB::readNodeFile("avatar.osg"));
+        viewport->loadSceneData({"avatar.osg"});
         viewport->setCameraManipulator(new osgGA::TrackballManipulator);
     }
 
@@ -48,7 +47,7 @@ int main(int argc, char *argv[])
         viewport->getCamera()->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         viewport->getCamera()->setProjectionResizePolicy(osg::Camera::FIXED);
         viewport->getCamera()->setViewport(400, 0, 400, 400);
-        viewport->setSceneData(osgDB::readNodeFile("cow.osg"));
+        viewport->loadSceneData({"cow.osg"});
         viewport->setCameraManipulator(new osgGA::TrackballManipulator);
     }
 
@@ -60,7 +59,7 @@ int main(int argc, char *argv[])
         viewport->getCamera()->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         viewport->getCamera()->setProjectionResizePolicy(osg::Camera::FIXED);
         viewport->getCamera()->setViewport(0, 400, 400, 400);
-        viewport->setSceneData(osgDB::readNodeFile("glider.osg"));
+        viewport->loadSceneData({"glider.osg"});
         viewport->setCameraManipulator(new osgGA::TrackballManipulator);
     }
 
@@ -0,0 +1,268 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "AllocationCounters.h"
+
+#include <osg/Stats>
+
+#if OPEVIEWER_ALLOCATION_COUNTERS
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#endif
+
+namespace opeViewer
+{
+
+namespace
+{
+
+#if OPEVIEWER_ALLOCATION_COUNTERS
+/// 平凡类型的thread_local不需要动态初始化，operator new在线程启动早期调用也安全
+thread_local AllocationCounters threadCounters;
+/// ExcludeScope的嵌套深度
+thread_local unsigned int threadExcludeDepth;
+
+void count(std::size_t size)
+{
+    if (threadExcludeDepth == 0)
+    {
+        ++threadCounters.numAllocations;
+        threadCounters.numBytes += size;
+    }
+}
+
+void *countedAllocate(std::size_t size)
+{
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p)
+    {
+        count(size);
+    }
+    return p;
+}
+
+void *countedAllocate(std::size_t size, std::align_val_t alignment)
+{
+    auto align = static_cast<std::size_t>(alignment);
+    if (align < sizeof(void *))
+    {
+        align = sizeof(void *);
+    }
+#ifdef _WIN32
+    // MSVC没有aligned_alloc，需要用_aligned_free释放
+    void *p = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc要求大小是对齐的整数倍
+    std::size_t alignedSize = (size + align - 1) / align * align;
+    void *p = std::aligned_alloc(align, alignedSize == 0 ? align : alignedSize);
+#endif
+    if (p)
+    {
+        count(size);
+    }
+    return p;
+}
+
+void alignedFree(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+/// 同标准的operator new：失败时调用new_handler后重试，没有new_handler时抛出bad_alloc
+template <typename... Args>
+void *allocateOrThrow(Args... args)
+{
+    for (;;)
+    {
+        void *p = countedAllocate(args...);
+        if (p)
+        {
+            return p;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+/// nothrow版本，new_handler抛出的bad_alloc转为返回空
+template <typename... Args>
+void *allocateOrNull(Args... args) noexcept
+{
+    try
+    {
+        return allocateOrThrow(args...);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return nullptr;
+    }
+}
+#endif
+
+void setAttribute(osg::Stats *stats, unsigned int frameNumber, const std::string &name, uint64_t delta, bool accumulate)
+{
+    double value = static_cast<double>(delta);
+    double previousValue = 0.0;
+    if (accumulate && stats->getAttribute(frameNumber, name, previousValue))
+    {
+        value += previousValue;
+    }
+    stats->setAttribute(frameNumber, name, value);
+}
+
+} // namespace
+
+AllocationCounters AllocationCounters::getThreadCounters()
+{
+#if OPEVIEWER_ALLOCATION_COUNTERS
+    return threadCounters;
+#else
+    return {};
+#endif
+}
+
+AllocationCounters::AttributeNames::AttributeNames(const char *phase) : allocations(std::string(phase) + " allocations"), bytes(std::string(phase) + " allocated bytes")
+{
+}
+
+void AllocationCounters::setAttributes(osg::Stats *stats, unsigned int frameNumber, const AttributeNames &names, const AllocationCounters &begin, const AllocationCounters &end, bool accumulate)
+{
+    setAttribute(stats, frameNumber, names.allocations, end.numAllocations - begin.numAllocations, accumulate);
+    setAttribute(stats, frameNumber, names.bytes, end.numBytes - begin.numBytes, accumulate);
+}
+
+void AllocationCounters::exclude(bool begin)
+{
+#if OPEVIEWER_ALLOCATION_COUNTERS
+    if (begin)
+    {
+        ++threadExcludeDepth;
+    }
+    else
+    {
+        --threadExcludeDepth;
+    }
+#else
+    (void)begin;
+#endif
+}
+
+} // namespace opeViewer
+
+#if OPEVIEWER_ALLOCATION_COUNTERS
+// 替换全局的分配函数，与getThreadCounters在同一编译单元，链接静态库时随之引入
+
+void *operator new(std::size_t size)
+{
+    return opeViewer::allocateOrThrow(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return opeViewer::allocateOrNull(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return opeViewer::allocateOrNull(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return opeViewer::allocateOrThrow(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return opeViewer::allocateOrNull(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return opeViewer::allocateOrNull(size, alignment);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    opeViewer::alignedFree(p);
+}
+#endif
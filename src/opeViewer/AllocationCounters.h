@@ -0,0 +1,78 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_C8E00CE74C3648859A2760EE587337EF_H_
+#define INC_2026_10_18_C8E00CE74C3648859A2760EE587337EF_H_
+
+#include <cstdint>
+#include <string>
+
+/// 为1时替换全局operator new和operator delete，统计每个线程的堆分配，由CMake选项OPEVIEWER_ALLOCATION_COUNTERS定义
+#ifndef OPEVIEWER_ALLOCATION_COUNTERS
+#define OPEVIEWER_ALLOCATION_COUNTERS 0
+#endif
+
+namespace osg
+{
+class Stats;
+} // namespace osg
+
+namespace opeViewer
+{
+
+/// 调用线程至今经operator new的分配次数和字节数，不包含直接调用malloc的分配
+///
+/// 计数器为thread_local的整数，不加锁；没有开启OPEVIEWER_ALLOCATION_COUNTERS时总是0
+struct AllocationCounters
+{
+    uint64_t numAllocations{};
+    uint64_t numBytes{};
+
+    static constexpr bool isAvailable()
+    {
+        return OPEVIEWER_ALLOCATION_COUNTERS != 0;
+    }
+
+    static AllocationCounters getThreadCounters();
+
+    /// 一个阶段的属性名，构造时生成，之后每帧复用，如 static const AllocationCounters::AttributeNames names("Cull");
+    struct AttributeNames
+    {
+        explicit AttributeNames(const char *phase);
+
+        /// "<phase> allocations"
+        std::string allocations;
+        /// "<phase> allocated bytes"
+        std::string bytes;
+    };
+
+    /// 将end - begin写入"<phase> allocations"和"<phase> allocated bytes"属性，accumulate时加到已有的值上（用于一帧中的多个事件）
+    static void setAttributes(osg::Stats *stats, unsigned int frameNumber, const AttributeNames &names, const AllocationCounters &begin, const AllocationCounters &end, bool accumulate = false);
+
+    /// 作用域内调用线程的分配不计数，用于排除统计自身的分配（如写入osg::Stats），可以嵌套
+    class ExcludeScope
+    {
+      public:
+        ExcludeScope()
+        {
+            exclude(true);
+        }
+
+        ~ExcludeScope()
+        {
+            exclude(false);
+        }
+
+        ExcludeScope(const ExcludeScope &) = delete;
+
+        ExcludeScope &operator=(const ExcludeScope &) = delete;
+    };
+
+  private:
+    static void exclude(bool begin);
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_C8E00CE74C3648859A2760EE587337EF_H_
@@ -0,0 +1,322 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "AsyncPicker.h"
+
+#include <algorithm>
+
+#include <osg/Stats>
+#include <osgUtil/IntersectionVisitor>
+
+#include "AllocationCounters.h"
+#include "Instrumentation.h"
+#include "LineSegmentIntersector.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+namespace opeViewer
+{
+
+/// 只用包围盒筛选，记录可能相交的绘制对象
+class AsyncPicker::SnapshotIntersector : public osgUtil::LineSegmentIntersector
+{
+    std::vector<SnapshotItem> *_snapshot{};
+
+  public:
+    SnapshotIntersector(const osg::Vec3d &start, const osg::Vec3d &end, std::vector<SnapshotItem> *snapshot, osgUtil::LineSegmentIntersector *parent = nullptr)
+        : osgUtil::LineSegmentIntersector(MODEL, start, end, parent), _snapshot(snapshot)
+    {
+    }
+
+    osgUtil::Intersector *clone(osgUtil::IntersectionVisitor &iv) override
+    {
+        // 由基类计算变换后的线段
+        osg::ref_ptr<osgUtil::Intersector> intersector = osgUtil::LineSegmentIntersector::clone(iv);
+        auto lineSegmentIntersector = static_cast<osgUtil::LineSegmentIntersector *>(intersector.get());
+
+        return new SnapshotIntersector(lineSegmentIntersector->getStart(), lineSegmentIntersector->getEnd(), _snapshot, this);
+    }
+
+    void intersect(osgUtil::IntersectionVisitor &iv, osg::Drawable *drawable) override
+    {
+        osg::Vec3d s(_start), e(_end);
+        if (!intersectAndClip(s, e, drawable->getBoundingBox()))
+        {
+            return;
+        }
+
+        SnapshotItem item;
+        item.drawable = drawable;
+        item.matrix = iv.getModelMatrix();
+        item.nodePath.assign(iv.getNodePath().begin(), iv.getNodePath().end());
+
+        // 动态几何体可能在求交期间被修改，求交使用副本
+        osg::Geometry *geometry = drawable->asGeometry();
+        if (geometry && geometry->getDataVariance() == osg::Object::DYNAMIC)
+        {
+            item.original = drawable;
+            item.drawable = new osg::Geometry(*geometry, osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES);
+            item.drawable->getBoundingBox();
+        }
+
+        _snapshot->push_back(std::move(item));
+    }
+};
+
+/// 对快照中的绘制对象求交，节点路径和模型矩阵取自快照
+class AsyncPicker::SnapshotIntersectionVisitor : public osgUtil::IntersectionVisitor
+{
+  public:
+    explicit SnapshotIntersectionVisitor(osgUtil::Intersector *intersector) : osgUtil::IntersectionVisitor(intersector)
+    {
+    }
+
+    void intersect(const SnapshotItem &item)
+    {
+        _nodePath.clear();
+        for (auto &node : item.nodePath)
+        {
+            _nodePath.push_back(node.get());
+        }
+
+        if (item.matrix)
+        {
+            pushModelMatrix(item.matrix.get());
+            push_clone();
+        }
+
+        osgUtil::IntersectionVisitor::intersect(item.drawable.get());
+
+        if (item.matrix)
+        {
+            pop_clone();
+            popModelMatrix();
+        }
+    }
+};
+
+AsyncPicker::AsyncPicker() : _threadPool(new ThreadPool(2))
+{
+}
+
+AsyncPicker::~AsyncPicker()
+{
+    wait();
+}
+
+void AsyncPicker::requestPick(osg::Camera *camera, float x, float y, osg::Node::NodeMask traversalMask, PickCallback *callback, const void *key)
+{
+    if (!camera || !callback)
+    {
+        return;
+    }
+
+    osg::ref_ptr<Request> request = new Request;
+    request->camera = camera;
+    request->x = x;
+    request->y = y;
+    request->traversalMask = traversalMask;
+    request->callback = callback;
+    request->key = key;
+    request->requestTick = osg::Timer::instance()->tick();
+
+    if (key)
+    {
+        // 还未派发的旧请求直接移除，已派发的旧请求在回调前丢弃
+        auto sameKey = [key](const osg::ref_ptr<Request> &other) { return other->key == key; };
+
+        auto itr = std::remove_if(_queuedRequests.begin(), _queuedRequests.end(), sameKey);
+        _numSuperseded += static_cast<unsigned int>(_queuedRequests.end() - itr);
+        _queuedRequests.erase(itr, _queuedRequests.end());
+
+        for (auto &dispatched : _dispatchedRequests)
+        {
+            if (sameKey(dispatched) && !dispatched->superseded)
+            {
+                dispatched->superseded = true;
+                ++_numSuperseded;
+            }
+        }
+    }
+
+    _queuedRequests.push_back(request);
+}
+
+bool AsyncPicker::requestPick(const osgGA::GUIEventAdapter &ea, osg::Node::NodeMask traversalMask, PickCallback *callback, const void *key)
+{
+    /// \see computeIntersections(const osgGA::GUIEventAdapter &, ...)
+
+    if (ea.getNumPointerData() >= 1)
+    {
+        const osgGA::PointerData *pd = ea.getPointerData(ea.getNumPointerData() - 1);
+        osg::Camera *camera = pd->object.valid() ? const_cast<osg::Object *>(pd->object.get())->asCamera() : nullptr;
+        if (camera)
+        {
+            requestPick(camera, pd->getXnormalized(), pd->getYnormalized(), traversalMask, callback, key);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AsyncPicker::hasPendingPicks() const
+{
+    return !_queuedRequests.empty() || !_dispatchedRequests.empty();
+}
+
+void AsyncPicker::dispatch()
+{
+    for (auto &request : _queuedRequests)
+    {
+        /// \see computeIntersections(const osg::Camera *, ...)
+        osg::Matrixd inverse;
+        if (!inverse.invert(request->camera->getViewMatrix() * request->camera->getProjectionMatrix()))
+        {
+            continue;
+        }
+
+        request->start = osg::Vec3d(request->x, request->y, -1.0) * inverse;
+        request->end = osg::Vec3d(request->x, request->y, 1.0) * inverse;
+        request->trackModifications = computeModifiedCount(request->camera.get(), request->modifiedCount);
+        request->intersections.clear();
+        request->completed = false;
+        takeSnapshot(*request);
+
+        _dispatchedRequests.push_back(request);
+
+        osg::ref_ptr<Request> pending = request;
+        _threadPool->add([pending] {
+            // 派发后又被取代的请求不再求交
+            if (!pending->superseded && !pending->snapshot.empty())
+            {
+                osg::ref_ptr<LineSegmentIntersector> picker = new LineSegmentIntersector(osgUtil::Intersector::MODEL, pending->start, pending->end);
+                SnapshotIntersectionVisitor iv(picker.get());
+
+                for (auto &item : pending->snapshot)
+                {
+                    iv.intersect(item);
+                }
+
+                // 副本的交点换回原几何体
+                for (auto intersection : picker->getIntersections())
+                {
+                    for (auto &item : pending->snapshot)
+                    {
+                        if (item.original && intersection.drawable == item.drawable)
+                        {
+                            intersection.drawable = item.original;
+                            break;
+                        }
+                    }
+                    pending->intersections.insert(intersection);
+                }
+            }
+
+            pending->completed = true;
+        });
+    }
+
+    _queuedRequests.clear();
+}
+
+void AsyncPicker::takeSnapshot(Request &request)
+{
+    request.snapshot.clear();
+
+    osg::ref_ptr<SnapshotIntersector> intersector = new SnapshotIntersector(request.start, request.end, &request.snapshot);
+    osgUtil::IntersectionVisitor iv(intersector.get());
+    iv.setTraversalMask(request.traversalMask);
+
+    for (unsigned int i = 0; i < request.camera->getNumChildren(); ++i)
+    {
+        request.camera->getChild(i)->accept(iv);
+    }
+}
+
+bool AsyncPicker::computeModifiedCount(const osg::Camera *camera, unsigned int &modifiedCount)
+{
+    /// \see PickCache
+    modifiedCount = 0;
+    for (unsigned int i = 0; i < camera->getNumChildren(); ++i)
+    {
+        Scene *scene = Scene::getScene(const_cast<osg::Node *>(camera->getChild(i)));
+        if (!scene)
+        {
+            return false;
+        }
+        modifiedCount += scene->getModifiedCount();
+    }
+    return true;
+}
+
+void AsyncPicker::wait()
+{
+    if (!_dispatchedRequests.empty())
+    {
+        _threadPool->wait();
+    }
+}
+
+void AsyncPicker::deliver(osg::Stats *stats, unsigned int frameNumber)
+{
+    // 只取出已经完成的请求，回调中可能发起新的请求
+    auto itr = std::stable_partition(_dispatchedRequests.begin(), _dispatchedRequests.end(), [](const osg::ref_ptr<Request> &request) { return !request->completed; });
+    std::vector<osg::ref_ptr<Request>> requests(itr, _dispatchedRequests.end());
+    _dispatchedRequests.erase(itr, _dispatchedRequests.end());
+
+    osg::Timer_t tick = osg::Timer::instance()->tick();
+    double maximumLatency{};
+    unsigned int numDelivered{};
+
+    for (auto &request : requests)
+    {
+        if (request->superseded)
+        {
+            continue;
+        }
+
+        // 快照之后场景被修改，结果可能引用已经移除的节点
+        unsigned int modifiedCount{};
+        if (request->trackModifications && computeModifiedCount(request->camera.get(), modifiedCount) && modifiedCount != request->modifiedCount)
+        {
+            request->snapshot.clear();
+            request->intersections.clear();
+
+            if (request->numReissues < MAXIMUM_NUM_REISSUES)
+            {
+                ++request->numReissues;
+                ++_numReissued;
+                _queuedRequests.push_back(request);
+            }
+            else
+            {
+                ++_numDropped;
+            }
+            continue;
+        }
+
+        maximumLatency = std::max(maximumLatency, osg::Timer::instance()->delta_s(request->requestTick, tick));
+        ++numDelivered;
+
+        request->callback->pickedImplementation(request->camera.get(), request->x, request->y, request->intersections);
+    }
+
+    if (OPEVIEWER_COLLECT_STATS(stats, FULL, EVENT) && (numDelivered > 0 || _numSuperseded > 0 || _numReissued > 0 || _numDropped > 0))
+    {
+        AllocationCounters::ExcludeScope excludeAllocations;
+
+        stats->setAttribute(frameNumber, "Pick latency", maximumLatency);
+        stats->setAttribute(frameNumber, "Picks delivered", static_cast<double>(numDelivered));
+        stats->setAttribute(frameNumber, "Picks superseded", static_cast<double>(_numSuperseded));
+        stats->setAttribute(frameNumber, "Picks reissued", static_cast<double>(_numReissued));
+        stats->setAttribute(frameNumber, "Picks dropped", static_cast<double>(_numDropped));
+    }
+
+    _numSuperseded = 0;
+    _numReissued = 0;
+    _numDropped = 0;
+}
+
+} // namespace opeViewer
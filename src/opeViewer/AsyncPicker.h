@@ -0,0 +1,131 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_59EFA180047843EA92313B03B913EAD2_H_
+#define INC_2026_10_18_59EFA180047843EA92313B03B913EAD2_H_
+
+#include <atomic>
+#include <vector>
+
+#include <osg/Camera>
+#include <osg/Timer>
+#include <osgGA/GUIEventAdapter>
+#include <osgUtil/LineSegmentIntersector>
+
+namespace osg
+{
+class Stats;
+} // namespace osg
+
+namespace opeViewer
+{
+
+class ThreadPool;
+
+/// 异步拾取
+///
+/// 由Window持有，请求在更新遍历之后、渲染遍历开始时派发
+///
+/// 派发时在调用线程中用线段的包围体筛选出可能相交的绘制对象，记录它们的模型矩阵和节点路径（持有引用），DYNAMIC的几何体复制顶点和图元；
+/// 工作线程只对这份快照进行三角形求交，不访问场景，事件处理和更新遍历不需要等待
+///
+/// 更新遍历开始时回调已经完成的请求，不等待未完成的请求；期间场景被修改（见Scene::getModifiedCount）的请求重新派发，多次过期后丢弃
+class AsyncPicker : public osg::Referenced
+{
+  public:
+    using Intersections = osgUtil::LineSegmentIntersector::Intersections;
+
+    /// 在更新遍历中调用
+    struct PickCallback : osg::Referenced
+    {
+        virtual void pickedImplementation(osg::Camera *camera, float x, float y, const Intersections &intersections) = 0;
+    };
+
+    AsyncPicker();
+
+    /// 请求在相机的投影坐标(x, y)处拾取
+    ///
+    /// \param key 非空时，相同key的旧请求被新请求取代，不再回调，用于鼠标悬停等只关心最新结果的场合
+    void requestPick(osg::Camera *camera, float x, float y, osg::Node::NodeMask traversalMask, PickCallback *callback, const void *key = nullptr);
+
+    /// 在鼠标位置拾取
+    bool requestPick(const osgGA::GUIEventAdapter &ea, osg::Node::NodeMask traversalMask, PickCallback *callback, const void *key = nullptr);
+
+    /// 是否有未完成或未回调的请求
+    bool hasPendingPicks() const;
+
+    /// 为等待中的请求建立快照并派发，在场景不被修改的时候调用
+    void dispatch();
+
+    /// 等待已派发的请求完成
+    void wait();
+
+    /// 回调已完成的请求，不等待未完成的请求，拾取延迟记录在stats中
+    void deliver(osg::Stats *stats, unsigned int frameNumber);
+
+    /// 场景过期后重新派发的最多次数，超过后丢弃
+    static const unsigned int MAXIMUM_NUM_REISSUES = 2;
+
+  protected:
+    ~AsyncPicker() override;
+
+    /// 快照中的一个绘制对象
+    struct SnapshotItem
+    {
+        /// DYNAMIC的几何体为副本
+        osg::ref_ptr<osg::Drawable> drawable;
+        /// 副本对应的原几何体，否则为空
+        osg::ref_ptr<osg::Drawable> original;
+        /// 为空表示单位矩阵
+        osg::ref_ptr<osg::RefMatrix> matrix;
+        /// 以绘制对象结尾
+        std::vector<osg::ref_ptr<osg::Node>> nodePath;
+    };
+
+    class SnapshotIntersector;
+    class SnapshotIntersectionVisitor;
+
+    struct Request : osg::Referenced
+    {
+        osg::ref_ptr<osg::Camera> camera;
+        float x{};
+        float y{};
+        osg::Node::NodeMask traversalMask{};
+        osg::ref_ptr<PickCallback> callback;
+        const void *key{};
+        osg::Timer_t requestTick{};
+        std::atomic<bool> superseded{};
+        unsigned int numReissues{};
+
+        // 派发时记录的世界坐标射线和快照，求交时不再访问相机和场景
+        osg::Vec3d start;
+        osg::Vec3d end;
+        std::vector<SnapshotItem> snapshot;
+        /// 派发时相机子节点所属场景的修改计数之和
+        unsigned int modifiedCount{};
+        bool trackModifications{};
+
+        Intersections intersections;
+        /// 工作线程写入intersections后置位
+        std::atomic<bool> completed{};
+    };
+
+    /// 线段与包围体相交的绘制对象
+    void takeSnapshot(Request &request);
+
+    static bool computeModifiedCount(const osg::Camera *camera, unsigned int &modifiedCount);
+
+    osg::ref_ptr<ThreadPool> _threadPool;
+
+    std::vector<osg::ref_ptr<Request>> _queuedRequests;
+    std::vector<osg::ref_ptr<Request>> _dispatchedRequests;
+
+    unsigned int _numSuperseded{};
+    unsigned int _numReissued{};
+    unsigned int _numDropped{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_59EFA180047843EA92313B03B913EAD2_H_
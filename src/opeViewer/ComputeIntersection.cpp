@@ -4,9 +4,215 @@
 
 #include "ComputeIntersection.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <typeinfo>
+#include <vector>
+
+#include <osg/Polytope>
+#include <osg/Transform>
+
+#include "LineSegmentIntersector.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "Viewport.h"
+
 namespace opeViewer
 {
 
+namespace
+{
+
+ThreadPool *getIntersectionThreadPool()
+{
+    static osg::ref_ptr<ThreadPool> s_threadPool = new ThreadPool;
+    return s_threadPool.get();
+}
+
+/// 批量求交，射线先经过matrix变换到nodes的坐标系
+unsigned int computeIntersections(const std::vector<osg::Node *> &nodes, const osg::Matrixd &matrix, const Ray *rays, std::size_t count, RayHit *hits, osg::Node::NodeMask traversalMask, ThreadPool *threadPool)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // 包围体是延迟计算的，先在当前线程中计算，避免多个线程同时写入
+    for (auto node : nodes)
+    {
+        node->getBound();
+    }
+
+    bool identity = matrix.isIdentity();
+    std::atomic<unsigned int> numHits{0};
+
+    auto task = [&](std::size_t begin, std::size_t end) {
+        osg::ref_ptr<LineSegmentIntersector> picker = new LineSegmentIntersector(osgUtil::Intersector::MODEL, osg::Vec3d(), osg::Vec3d());
+        picker->setIntersectionLimit(osgUtil::Intersector::LIMIT_NEAREST);
+
+        osgUtil::IntersectionVisitor iv;
+        iv.setTraversalMask(traversalMask);
+
+        unsigned int numChunkHits = 0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            picker->reset();
+            picker->setStart(identity ? rays[i].start : rays[i].start * matrix);
+            picker->setEnd(identity ? rays[i].end : rays[i].end * matrix);
+            iv.setIntersector(picker.get());
+
+            for (auto node : nodes)
+            {
+                node->accept(iv);
+            }
+
+            RayHit &hit = hits[i];
+            if (picker->containsIntersections())
+            {
+                const osgUtil::LineSegmentIntersector::Intersection &intersection = picker->getFirstIntersection();
+                hit.drawable = intersection.drawable.get();
+                hit.ratio = intersection.ratio;
+                hit.point = intersection.getWorldIntersectPoint();
+                hit.normal = intersection.getWorldIntersectNormal();
+                hit.primitiveIndex = intersection.primitiveIndex;
+                ++numChunkHits;
+            }
+            else
+            {
+                hit = RayHit();
+            }
+        }
+
+        numHits += numChunkHits;
+    };
+
+    (threadPool ? threadPool : getIntersectionThreadPool())->parallelFor(count, task);
+
+    return numHits;
+}
+
+/// 框选遍历
+///
+/// 视锥随Transform变换到局部坐标系，完全在视锥内的子树不再测试
+class SelectionVisitor : public osg::NodeVisitor
+{
+    /// 每层Transform一个视锥，重复使用避免分配
+    std::vector<osg::Polytope> _polytopes;
+    std::size_t _depth{};
+    bool _inside{};
+    Selection *_selection{};
+
+    /// 返回是否需要继续遍历
+    bool test(const osg::BoundingSphere &bound)
+    {
+        if (_inside)
+        {
+            return true;
+        }
+        if (!bound.valid() || !_polytopes[_depth].contains(bound))
+        {
+            return false;
+        }
+        _inside = _polytopes[_depth].containsAllOf(bound);
+        return true;
+    }
+
+  public:
+    /// 类型为INTERSECTION_VISITOR，实例化的节点遍历原来的MatrixTransform，见GeometryInstancer::InstancedGroup
+    explicit SelectionVisitor(osg::Node::NodeMask traversalMask) : osg::NodeVisitor(osg::NodeVisitor::INTERSECTION_VISITOR, osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN)
+    {
+        setTraversalMask(traversalMask);
+    }
+
+    void reset(const osg::NodePath &nodePath, const osg::Polytope &polytope, Selection *selection)
+    {
+        _nodePath = nodePath;
+        _polytopes.resize(std::max<std::size_t>(_polytopes.size(), 1));
+        _polytopes[0] = polytope;
+        _depth = 0;
+        _inside = false;
+        _selection = selection;
+    }
+
+    void apply(osg::Node &node) override
+    {
+        bool inside = _inside;
+        if (test(node.getBound()))
+        {
+            traverse(node);
+        }
+        _inside = inside;
+    }
+
+    void apply(osg::Transform &transform) override
+    {
+        bool inside = _inside;
+        if (test(transform.getBound()))
+        {
+            osg::Matrixd matrix;
+            transform.computeLocalToWorldMatrix(matrix, this);
+
+            if (_polytopes.size() <= _depth + 1)
+            {
+                _polytopes.resize(_depth + 2);
+            }
+            _polytopes[_depth + 1].setAndTransformProvidingInverse(_polytopes[_depth], matrix);
+
+            ++_depth;
+            traverse(transform);
+            --_depth;
+        }
+        _inside = inside;
+    }
+
+    void apply(osg::Camera &camera) override
+    {
+        // 使用绝对坐标系的相机（如HUD）不在当前视锥中
+        if (camera.getReferenceFrame() == osg::Transform::RELATIVE_RF)
+        {
+            apply(static_cast<osg::Transform &>(camera));
+        }
+    }
+
+    void apply(osg::Drawable &drawable) override
+    {
+        if (!_inside && (!drawable.getBoundingBox().valid() || !_polytopes[_depth].contains(drawable.getBoundingBox())))
+        {
+            return;
+        }
+
+        _selection->nodes.insert(_selection->nodes.end(), _nodePath.begin(), _nodePath.end());
+        _selection->offsets.push_back(_selection->nodes.size());
+    }
+};
+
+/// 待并行遍历的子树
+struct SelectionTask
+{
+    osg::Node *node{};
+    /// 不包含node
+    osg::NodePath nodePath;
+};
+
+/// 相机子节点所属场景的修改计数之和，计数只增不减，任一场景修改后和都会变化
+bool computeModifiedCount(const osg::Camera *camera, unsigned int &modifiedCount)
+{
+    modifiedCount = 0;
+    for (unsigned int i = 0; i < camera->getNumChildren(); ++i)
+    {
+        Scene *scene = Scene::getScene(const_cast<osg::Node *>(camera->getChild(i)));
+        if (!scene)
+        {
+            return false;
+        }
+        modifiedCount += scene->getModifiedCount();
+    }
+    return true;
+}
+
+} // namespace
+
 bool computeIntersections(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, float x, float y, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask)
 {
     /// \see osgViewer::View::computeIntersections
@@ -14,7 +220,7 @@ bool computeIntersections(const osg::Camera *camera, osgUtil::Intersector::Coord
     if (!camera)
         return false;
 
-    osg::ref_ptr<osgUtil::LineSegmentIntersector> picker = new osgUtil::LineSegmentIntersector(cf, x, y);
+    osg::ref_ptr<LineSegmentIntersector> picker = new LineSegmentIntersector(cf, x, y);
     osgUtil::IntersectionVisitor iv(picker.get());
     iv.setTraversalMask(traversalMask);
 
@@ -65,7 +271,7 @@ bool computeIntersections(const osg::Camera *camera, osgUtil::Intersector::Coord
     osg::Vec3d startVertex = osg::Vec3d(x, y, zNear) * inverse;
     osg::Vec3d endVertex = osg::Vec3d(x, y, zFar) * inverse;
 
-    osg::ref_ptr<osgUtil::LineSegmentIntersector> picker = new osgUtil::LineSegmentIntersector(osgUtil::Intersector::MODEL, startVertex, endVertex);
+    osg::ref_ptr<LineSegmentIntersector> picker = new LineSegmentIntersector(osgUtil::Intersector::MODEL, startVertex, endVertex);
 
     osgUtil::IntersectionVisitor iv(picker.get());
     iv.setTraversalMask(traversalMask);
@@ -117,4 +323,402 @@ bool opeViewer::computeIntersections(const osgGA::GUIEventAdapter &ea, const osg
     return false;
 }
 
-} // namespace opeViewer
\ No newline at end of file
+bool computePointerPixel(const osgGA::GUIEventAdapter &ea, const osg::Camera *camera, int &x, int &y)
+{
+    if (!camera || ea.getNumPointerData() < 1)
+    {
+        return false;
+    }
+
+    const osgGA::PointerData *pd = ea.getPointerData(ea.getNumPointerData() - 1);
+    const osg::Viewport *viewport = camera->getViewport();
+    if (pd->object.get() != camera || !viewport || viewport->width() < 2 || viewport->height() < 2)
+    {
+        return false;
+    }
+
+    // 与Window中generatePointerData的归一化相反
+    x = static_cast<int>(std::floor((pd->getXnormalized() + 1.0) * 0.5 * (viewport->width() - 1) + 0.5));
+    y = static_cast<int>(std::floor((pd->getYnormalized() + 1.0) * 0.5 * (viewport->height() - 1) + 0.5));
+
+    return x >= 0 && y >= 0 && x < viewport->width() && y < viewport->height();
+}
+
+bool computeSurfacePoint(osgGA::GUIActionAdapter &aa, const osgGA::GUIEventAdapter &ea, osg::Vec3d &point, osg::Node::NodeMask traversalMask)
+{
+    if (Viewport *viewport = dynamic_cast<Viewport *>(&aa))
+    {
+        return viewport->computeSurfacePoint(ea, point, traversalMask);
+    }
+
+    osgUtil::LineSegmentIntersector::Intersections intersections;
+    if (aa.computeIntersections(ea, intersections, traversalMask))
+    {
+        point = intersections.begin()->getWorldIntersectPoint();
+        return true;
+    }
+
+    return false;
+}
+
+unsigned int computeIntersections(osg::Node *node, const Ray *rays, std::size_t count, RayHit *hits, osg::Node::NodeMask traversalMask, ThreadPool *threadPool)
+{
+    if (!node)
+    {
+        return 0;
+    }
+
+    return computeIntersections(std::vector<osg::Node *>{node}, osg::Matrixd(), rays, count, hits, traversalMask, threadPool);
+}
+
+unsigned int computeIntersections(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, const Ray *rays, std::size_t count, RayHit *hits, osg::Node::NodeMask traversalMask, ThreadPool *threadPool)
+{
+    /// \see computeIntersections(const osg::Camera *, osgUtil::Intersector::CoordinateFrame, float, float, const osg::NodePath &, ...)
+
+    if (!camera)
+    {
+        return 0;
+    }
+
+    osg::Matrixd matrix;
+    switch (cf)
+    {
+    case osgUtil::Intersector::WINDOW:
+        if (camera->getViewport())
+        {
+            matrix.preMult(camera->getViewport()->computeWindowMatrix());
+        }
+        // fallthrough
+    case osgUtil::Intersector::PROJECTION:
+        matrix.preMult(camera->getProjectionMatrix());
+        // fallthrough
+    case osgUtil::Intersector::VIEW:
+        matrix.preMult(camera->getViewMatrix());
+        break;
+    default:
+        break;
+    }
+
+    osg::Matrixd inverse;
+    inverse.invert(matrix);
+
+    // 直接遍历子节点，相机的子节点在世界坐标系中
+    std::vector<osg::Node *> nodes;
+    for (unsigned int i = 0; i < camera->getNumChildren(); ++i)
+    {
+        nodes.push_back(const_cast<osg::Node *>(camera->getChild(i)));
+    }
+
+    return computeIntersections(nodes, inverse, rays, count, hits, traversalMask, threadPool);
+}
+
+PickCache::PickCache(unsigned int maximumNumEntries) : _maximumNumEntries(maximumNumEntries)
+{
+}
+
+PickCache::~PickCache()
+{
+}
+
+bool PickCache::computeIntersections(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, float x, float y, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask)
+{
+    if (!camera)
+    {
+        return false;
+    }
+
+    unsigned int modifiedCount{};
+    if (_maximumNumEntries == 0 || !computeModifiedCount(camera, modifiedCount))
+    {
+        ++_numMisses;
+        return opeViewer::computeIntersections(camera, cf, x, y, intersections, traversalMask);
+    }
+
+    osg::Matrixd windowMatrix;
+    if (cf == osgUtil::Intersector::WINDOW && camera->getViewport())
+    {
+        windowMatrix = camera->getViewport()->computeWindowMatrix();
+    }
+
+    for (auto itr = _entries.begin(); itr != _entries.end(); ++itr)
+    {
+        Entry &entry = *itr;
+        if (!entry.camera.valid() || entry.camera != camera || entry.cf != cf || entry.x != x || entry.y != y || entry.traversalMask != traversalMask || entry.modifiedCount != modifiedCount)
+        {
+            continue;
+        }
+        if (entry.viewMatrix != camera->getViewMatrix() || entry.projectionMatrix != camera->getProjectionMatrix() || entry.windowMatrix != windowMatrix)
+        {
+            continue;
+        }
+
+        ++_numHits;
+        _entries.splice(_entries.begin(), _entries, itr);
+        intersections = _entries.front().intersections;
+        return !intersections.empty();
+    }
+
+    ++_numMisses;
+    bool result = opeViewer::computeIntersections(camera, cf, x, y, intersections, traversalMask);
+
+    Entry entry;
+    entry.camera = camera;
+    entry.viewMatrix = camera->getViewMatrix();
+    entry.projectionMatrix = camera->getProjectionMatrix();
+    entry.windowMatrix = windowMatrix;
+    entry.cf = cf;
+    entry.x = x;
+    entry.y = y;
+    entry.traversalMask = traversalMask;
+    entry.modifiedCount = modifiedCount;
+    entry.intersections = intersections;
+    _entries.push_front(std::move(entry));
+
+    while (_entries.size() > _maximumNumEntries)
+    {
+        _entries.pop_back();
+    }
+
+    return result;
+}
+
+bool PickCache::computeIntersections(const osgGA::GUIEventAdapter &ea, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask)
+{
+    /// \see opeViewer::computeIntersections(const osgGA::GUIEventAdapter &, ...)
+
+    if (ea.getNumPointerData() >= 1)
+    {
+        const osgGA::PointerData *pd = ea.getPointerData(ea.getNumPointerData() - 1);
+        const osg::Camera *camera = pd->object.valid() ? pd->object->asCamera() : nullptr;
+        if (camera)
+        {
+            return computeIntersections(camera, osgUtil::Intersector::PROJECTION, pd->getXnormalized(), pd->getYnormalized(), intersections, traversalMask);
+        }
+    }
+
+    return false;
+}
+
+void PickCache::setMaximumNumEntries(unsigned int num)
+{
+    _maximumNumEntries = num;
+    while (_entries.size() > _maximumNumEntries)
+    {
+        _entries.pop_back();
+    }
+}
+
+unsigned int PickCache::getMaximumNumEntries() const
+{
+    return _maximumNumEntries;
+}
+
+void PickCache::clear()
+{
+    _entries.clear();
+}
+
+unsigned int PickCache::getNumHits() const
+{
+    return _numHits;
+}
+
+unsigned int PickCache::getNumMisses() const
+{
+    return _numMisses;
+}
+
+double PickCache::getHitRate() const
+{
+    unsigned int total = _numHits + _numMisses;
+    return total > 0 ? static_cast<double>(_numHits) / total : 0.0;
+}
+
+void PickCache::resetStatistics()
+{
+    _numHits = 0;
+    _numMisses = 0;
+}
+
+std::size_t Selection::size() const
+{
+    return offsets.size() - 1;
+}
+
+bool Selection::empty() const
+{
+    return size() == 0;
+}
+
+void Selection::clear()
+{
+    nodes.clear();
+    offsets.assign(1, 0);
+}
+
+osg::Node *const *Selection::getNodePathBegin(std::size_t i) const
+{
+    return nodes.data() + offsets[i];
+}
+
+osg::Node *const *Selection::getNodePathEnd(std::size_t i) const
+{
+    return nodes.data() + offsets[i + 1];
+}
+
+osg::NodePath Selection::getNodePath(std::size_t i) const
+{
+    return osg::NodePath(getNodePathBegin(i), getNodePathEnd(i));
+}
+
+osg::Drawable *Selection::getDrawable(std::size_t i) const
+{
+    return offsets[i + 1] > offsets[i] ? nodes[offsets[i + 1] - 1]->asDrawable() : nullptr;
+}
+
+unsigned int computeSelection(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, float xMin, float yMin, float xMax, float yMax, Selection &selection, osg::Node::NodeMask traversalMask, ThreadPool *threadPool)
+{
+    /// \see computeIntersections(const osg::Camera *, osgUtil::Intersector::CoordinateFrame, float, float, const osg::NodePath &, ...)
+
+    if (!camera || camera->getNumChildren() == 0)
+    {
+        return 0;
+    }
+
+    if (xMin > xMax)
+    {
+        std::swap(xMin, xMax);
+    }
+    if (yMin > yMax)
+    {
+        std::swap(yMin, yMax);
+    }
+
+    osg::Matrixd matrix;
+    double zNear = -1.0;
+    double zFar = 1.0;
+    switch (cf)
+    {
+    case osgUtil::Intersector::WINDOW:
+        if (camera->getViewport())
+        {
+            matrix.preMult(camera->getViewport()->computeWindowMatrix());
+            zNear = 0.0;
+        }
+        // fallthrough
+    case osgUtil::Intersector::PROJECTION:
+        matrix.preMult(camera->getProjectionMatrix());
+        // fallthrough
+    case osgUtil::Intersector::VIEW:
+        matrix.preMult(camera->getViewMatrix());
+        break;
+    default:
+        break;
+    }
+
+    // cf坐标系中的矩形视锥，变换到世界坐标系
+    osg::Polytope polytope;
+    polytope.add(osg::Plane(1.0, 0.0, 0.0, -xMin));
+    polytope.add(osg::Plane(-1.0, 0.0, 0.0, xMax));
+    polytope.add(osg::Plane(0.0, 1.0, 0.0, -yMin));
+    polytope.add(osg::Plane(0.0, -1.0, 0.0, yMax));
+    if (cf == osgUtil::Intersector::WINDOW || cf == osgUtil::Intersector::PROJECTION)
+    {
+        polytope.add(osg::Plane(0.0, 0.0, 1.0, -zNear));
+        polytope.add(osg::Plane(0.0, 0.0, -1.0, zFar));
+    }
+    polytope.transformProvidingInverse(matrix);
+
+    ThreadPool *pool = threadPool ? threadPool : getIntersectionThreadPool();
+
+    // 将上层的组节点展开为足够多的子树，包围体在当前线程中计算
+    std::vector<SelectionTask> tasks;
+    for (unsigned int i = 0; i < camera->getNumChildren(); ++i)
+    {
+        osg::Node *child = const_cast<osg::Node *>(camera->getChild(i));
+        child->getBound();
+        tasks.push_back({child, osg::NodePath{const_cast<osg::Camera *>(camera)}});
+    }
+
+    const std::size_t targetNumTasks = (pool->getNumThreads() + 1) * 4;
+    for (unsigned int level = 0; level < 8 && tasks.size() < targetNumTasks; ++level)
+    {
+        bool expanded = false;
+        std::vector<SelectionTask> nextTasks;
+        for (auto &task : tasks)
+        {
+            osg::Node *node = task.node;
+            // 只展开普通的组节点，Transform、LOD等由遍历处理
+            if (typeid(*node) != typeid(osg::Group))
+            {
+                nextTasks.push_back(std::move(task));
+                continue;
+            }
+
+            expanded = true;
+            if ((node->getNodeMask() & traversalMask) == 0 || !node->getBound().valid() || !polytope.contains(node->getBound()))
+            {
+                continue;
+            }
+
+            osg::Group *group = node->asGroup();
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i)
+            {
+                SelectionTask child{group->getChild(i), task.nodePath};
+                child.nodePath.push_back(node);
+                nextTasks.push_back(std::move(child));
+            }
+        }
+        tasks.swap(nextTasks);
+
+        if (!expanded)
+        {
+            break;
+        }
+    }
+
+    std::size_t numSelected = selection.size();
+
+    // 每个子树写入自己的结果，按顺序合并，结果与单线程遍历一致
+    std::vector<Selection> partialSelections(tasks.size());
+    pool->parallelFor(tasks.size(), [&](std::size_t begin, std::size_t end) {
+        SelectionVisitor visitor(traversalMask);
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            visitor.reset(tasks[i].nodePath, polytope, &partialSelections[i]);
+            tasks[i].node->accept(visitor);
+        }
+    });
+
+    for (auto &partialSelection : partialSelections)
+    {
+        std::size_t base = selection.nodes.size();
+        selection.nodes.insert(selection.nodes.end(), partialSelection.nodes.begin(), partialSelection.nodes.end());
+        for (std::size_t i = 1; i < partialSelection.offsets.size(); ++i)
+        {
+            selection.offsets.push_back(base + partialSelection.offsets[i]);
+        }
+    }
+
+    return static_cast<unsigned int>(selection.size() - numSelected);
+}
+
+unsigned int computeSelection(const osgGA::GUIEventAdapter &ea0, const osgGA::GUIEventAdapter &ea1, Selection &selection, osg::Node::NodeMask traversalMask, ThreadPool *threadPool)
+{
+    if (ea0.getNumPointerData() < 1 || ea1.getNumPointerData() < 1)
+    {
+        return 0;
+    }
+
+    const osgGA::PointerData *pd0 = ea0.getPointerData(ea0.getNumPointerData() - 1);
+    const osgGA::PointerData *pd1 = ea1.getPointerData(ea1.getNumPointerData() - 1);
+    const osg::Camera *camera = pd0->object.valid() ? pd0->object->asCamera() : nullptr;
+    if (!camera || pd1->object.get() != pd0->object.get())
+    {
+        return 0;
+    }
+
+    return computeSelection(camera, osgUtil::Intersector::PROJECTION, pd0->getXnormalized(), pd0->getYnormalized(), pd1->getXnormalized(), pd1->getYnormalized(), selection, traversalMask, threadPool);
+}
+
+} // namespace opeViewer
@@ -5,13 +5,64 @@
 #ifndef INC_2024_1_15_1AD1C82F53EC4FE2A3EF296CAE1B9DFD_H_
 #define INC_2024_1_15_1AD1C82F53EC4FE2A3EF296CAE1B9DFD_H_
 
+#include <list>
+#include <vector>
+
 #include <osg/Camera>
+#include <osg/observer_ptr>
+#include <osgGA/GUIActionAdapter>
 #include <osgGA/GUIEventAdapter>
 #include <osgUtil/LineSegmentIntersector>
 
 namespace opeViewer
 {
 
+class ThreadPool;
+
+/// 批量求交的射线
+struct Ray
+{
+    osg::Vec3d start;
+    osg::Vec3d end;
+};
+
+/// 批量求交的结果，只记录最近的命中
+struct RayHit
+{
+    /// 未命中时为空
+    osg::Drawable *drawable{};
+    double ratio{};
+    /// 世界坐标（遍历起点的坐标系）
+    osg::Vec3d point;
+    osg::Vec3 normal;
+    unsigned int primitiveIndex{};
+};
+
+/// 框选结果
+///
+/// 节点路径依次拼接存放，重复使用时不释放内存，节点在场景修改前有效
+struct Selection
+{
+    /// 所有节点路径，从相机开始，到绘制对象结束
+    std::vector<osg::Node *> nodes;
+    /// 第i个节点路径为nodes[offsets[i], offsets[i + 1])
+    std::vector<std::size_t> offsets{0};
+
+    std::size_t size() const;
+
+    bool empty() const;
+
+    void clear();
+
+    osg::Node *const *getNodePathBegin(std::size_t i) const;
+
+    osg::Node *const *getNodePathEnd(std::size_t i) const;
+
+    osg::NodePath getNodePath(std::size_t i) const;
+
+    osg::Drawable *getDrawable(std::size_t i) const;
+};
+
 /// 计算射线命中
 bool computeIntersections(const osg::Camera *, osgUtil::Intersector::CoordinateFrame cf, float x, float y, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask);
 /// 计算射线命中
@@ -21,6 +72,86 @@ bool computeIntersections(const osgGA::GUIEventAdapter &ea, osgUtil::LineSegment
 /// 在鼠标位置选择
 bool computeIntersections(const osgGA::GUIEventAdapter &ea, const osg::NodePath &nodePath, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask);
 
+/// 事件中鼠标在相机视口中的像素坐标，原点在视口左下角，鼠标不在该相机的视口中时返回false
+bool computePointerPixel(const osgGA::GUIEventAdapter &ea, const osg::Camera *camera, int &x, int &y);
+
+/// 鼠标下的表面点（世界坐标），用于以鼠标为中心缩放、旋转
+///
+/// aa为Viewport时使用Viewport::computeSurfacePoint（开启深度拾取时使用上一帧的深度），否则使用aa.computeIntersections
+bool computeSurfacePoint(osgGA::GUIActionAdapter &aa, const osgGA::GUIEventAdapter &ea, osg::Vec3d &point, osg::Node::NodeMask traversalMask);
+
+/// 批量计算射线命中，射线在node的坐标系中
+///
+/// 射线分块后在线程池中并行求交，每个线程复用同一个求交器，结果写入与rays等长的hits中，返回命中数量
+///
+/// 求交期间场景不能被修改，threadPool为空时使用默认线程池
+unsigned int computeIntersections(osg::Node *node, const Ray *rays, std::size_t count, RayHit *hits, osg::Node::NodeMask traversalMask, ThreadPool *threadPool = nullptr);
+/// 批量计算射线命中，射线在相机的cf坐标系中，命中点在世界坐标系中
+unsigned int computeIntersections(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, const Ray *rays, std::size_t count, RayHit *hits, osg::Node::NodeMask traversalMask, ThreadPool *threadPool = nullptr);
+
+/// 框选，选中包围盒与相机cf坐标系中矩形对应的视锥相交的绘制对象，结果追加到selection中，返回选中数量
+///
+/// 上层的组节点展开为多个子树后在线程池中并行遍历，完全在视锥内的子树不再逐个测试，求交期间场景不能被修改
+unsigned int computeSelection(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, float xMin, float yMin, float xMax, float yMax, Selection &selection, osg::Node::NodeMask traversalMask, ThreadPool *threadPool = nullptr);
+/// 框选两个事件的鼠标位置之间的矩形，两个位置需要在同一个相机中
+unsigned int computeSelection(const osgGA::GUIEventAdapter &ea0, const osgGA::GUIEventAdapter &ea1, Selection &selection, osg::Node::NodeMask traversalMask, ThreadPool *threadPool = nullptr);
+
+/// 拾取缓存
+///
+/// 相机矩阵、视口、指针位置、遍历掩码和场景的修改计数都不变时直接返回上次的结果，用于鼠标停留时的提示和高亮
+///
+/// 场景通过Scene::getModifiedCount判断是否变化，更新回调和事件处理器中修改场景需要调用Scene::dirtySceneData或clear，相机的子节点不属于Scene时不缓存
+class PickCache : public osg::Referenced
+{
+  public:
+    explicit PickCache(unsigned int maximumNumEntries = 16);
+
+    /// 同computeIntersections，优先使用缓存
+    bool computeIntersections(const osg::Camera *camera, osgUtil::Intersector::CoordinateFrame cf, float x, float y, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask);
+
+    /// 同computeIntersections，优先使用缓存
+    bool computeIntersections(const osgGA::GUIEventAdapter &ea, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask traversalMask);
+
+    void setMaximumNumEntries(unsigned int num);
+
+    unsigned int getMaximumNumEntries() const;
+
+    void clear();
+
+    unsigned int getNumHits() const;
+
+    unsigned int getNumMisses() const;
+
+    /// 命中率，没有查询时为0
+    double getHitRate() const;
+
+    void resetStatistics();
+
+  protected:
+    ~PickCache() override;
+
+    struct Entry
+    {
+        osg::observer_ptr<const osg::Camera> camera;
+        osg::Matrixd viewMatrix;
+        osg::Matrixd projectionMatrix;
+        osg::Matrixd windowMatrix;
+        osgUtil::Intersector::CoordinateFrame cf{};
+        float x{};
+        float y{};
+        osg::Node::NodeMask traversalMask{};
+        unsigned int modifiedCount{};
+        osgUtil::LineSegmentIntersector::Intersections intersections;
+    };
+
+    unsigned int _maximumNumEntries{};
+    /// 最近使用的在前
+    std::list<Entry> _entries;
+
+    unsigned int _numHits{};
+    unsigned int _numMisses{};
+};
+
 } // namespace opeViewer
 
 #endif // INC_2024_1_15_1AD1C82F53EC4FE2A3EF296CAE1B9DFD_H_
@@ -0,0 +1,280 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "DatabasePager.h"
+
+#include <set>
+
+#include <osg/Geometry>
+#include <osg/Texture>
+#include <osg/Timer>
+#include <osgDB/Registry>
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 估算子图中顶点、索引和图片的数据量
+class EstimateDataSizeVisitor : public osg::NodeVisitor
+{
+    std::set<const osg::Object *> _visited;
+
+  public:
+    unsigned int _bytes{};
+
+    EstimateDataSizeVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    void apply(osg::Node &node) override
+    {
+        applyStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    void apply(osg::Geometry &geometry) override
+    {
+        applyStateSet(geometry.getStateSet());
+
+        osg::Geometry::ArrayList arrays;
+        geometry.getArrayList(arrays);
+        for (auto &array : arrays)
+        {
+            if (array.valid() && _visited.insert(array.get()).second)
+            {
+                _bytes += array->getTotalDataSize();
+            }
+        }
+
+        for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i)
+        {
+            osg::PrimitiveSet *primitiveSet = geometry.getPrimitiveSet(i);
+            if (primitiveSet && _visited.insert(primitiveSet).second)
+            {
+                _bytes += primitiveSet->getTotalDataSize();
+            }
+        }
+    }
+
+    void applyStateSet(osg::StateSet *stateSet)
+    {
+        if (!stateSet || !_visited.insert(stateSet).second)
+        {
+            return;
+        }
+
+        for (unsigned int unit = 0; unit < stateSet->getTextureAttributeList().size(); ++unit)
+        {
+            auto texture = dynamic_cast<osg::Texture *>(stateSet->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+            if (!texture)
+            {
+                continue;
+            }
+
+            for (unsigned int i = 0; i < texture->getNumImages(); ++i)
+            {
+                osg::Image *image = texture->getImage(i);
+                if (image && _visited.insert(image).second)
+                {
+                    _bytes += image->getTotalSizeInBytesIncludingMipmaps();
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+DatabasePager::DatabasePager()
+{
+}
+
+DatabasePager::DatabasePager(const DatabasePager &rhs)
+    : osgDB::DatabasePager(rhs), _maximumMergeTimePerFrame(rhs._maximumMergeTimePerFrame), _maximumMergeBytesPerFrame(rhs._maximumMergeBytesPerFrame), _loadKdTreeBuilder(rhs._loadKdTreeBuilder), _kdTreeOptions(rhs._kdTreeOptions)
+{
+}
+
+DatabasePager::~DatabasePager()
+{
+}
+
+osgDB::DatabasePager *DatabasePager::clone() const
+{
+    return new DatabasePager(*this);
+}
+
+void DatabasePager::setMaximumMergeTimePerFrame(double time)
+{
+    _maximumMergeTimePerFrame = time;
+}
+
+double DatabasePager::getMaximumMergeTimePerFrame() const
+{
+    return _maximumMergeTimePerFrame;
+}
+
+void DatabasePager::setMaximumMergeBytesPerFrame(unsigned int bytes)
+{
+    _maximumMergeBytesPerFrame = bytes;
+}
+
+unsigned int DatabasePager::getMaximumMergeBytesPerFrame() const
+{
+    return _maximumMergeBytesPerFrame;
+}
+
+unsigned int DatabasePager::getMergeBacklogSize() const
+{
+    return static_cast<unsigned int>(_mergeBacklog.size()) + _dataToMergeList->size();
+}
+
+unsigned int DatabasePager::getMergeBacklogBytes() const
+{
+    return _mergeBacklogBytes;
+}
+
+unsigned int DatabasePager::getNumMergedLastFrame() const
+{
+    return _numMergedLastFrame;
+}
+
+unsigned int DatabasePager::getMergedBytesLastFrame() const
+{
+    return _mergedBytesLastFrame;
+}
+
+void DatabasePager::setKdTreeBuilder(KdTreeBuilder *builder)
+{
+    osg::ref_ptr<osgDB::Options> kdTreeOptions;
+    if (builder)
+    {
+        // osgDB读入节点后按Options的提示使用Registry的构建器
+        osgDB::Registry::instance()->setKdTreeBuilder(builder);
+
+        const osgDB::Options *registryOptions = osgDB::Registry::instance()->getOptions();
+        kdTreeOptions = registryOptions ? registryOptions->cloneOptions() : new osgDB::Options;
+        kdTreeOptions->setBuildKdTreesHint(osgDB::Options::BUILD_KDTREES);
+    }
+
+    std::lock_guard<std::mutex> lock(_kdTreeOptionsMutex);
+    _loadKdTreeBuilder = builder;
+    _kdTreeOptions = kdTreeOptions;
+}
+
+KdTreeBuilder *DatabasePager::getKdTreeBuilder()
+{
+    return _loadKdTreeBuilder.get();
+}
+
+const KdTreeBuilder *DatabasePager::getKdTreeBuilder() const
+{
+    return _loadKdTreeBuilder.get();
+}
+
+void DatabasePager::requestNodeFile(const std::string &fileName, osg::NodePath &nodePath, float priority, const osg::FrameStamp *framestamp, osg::ref_ptr<osg::Referenced> &databaseRequest,
+                                    const osg::Referenced *options)
+{
+    osg::ref_ptr<osgDB::Options> kdTreeOptions;
+    if (!options)
+    {
+        std::lock_guard<std::mutex> lock(_kdTreeOptionsMutex);
+        kdTreeOptions = _kdTreeOptions;
+    }
+
+    osgDB::DatabasePager::requestNodeFile(fileName, nodePath, priority, framestamp, databaseRequest, kdTreeOptions ? kdTreeOptions.get() : options);
+}
+
+bool DatabasePager::requiresUpdateSceneGraph() const
+{
+    return !_mergeBacklog.empty() || osgDB::DatabasePager::requiresUpdateSceneGraph();
+}
+
+void DatabasePager::updateSceneGraph(const osg::FrameStamp &frameStamp)
+{
+    _numMergedLastFrame = 0;
+    _mergedBytesLastFrame = 0;
+
+    // 不限制时直接使用osgDB::DatabasePager的实现
+    if (_maximumMergeTimePerFrame <= 0.0 && _maximumMergeBytesPerFrame == 0 && _mergeBacklog.empty())
+    {
+        _numMergedLastFrame = _dataToMergeList->size();
+        osgDB::DatabasePager::updateSceneGraph(frameStamp);
+        return;
+    }
+
+    /// \see osgDB::DatabasePager::updateSceneGraph
+    removeExpiredSubgraphs(frameStamp);
+
+    osg::ElapsedTime elapsedTime;
+
+    for (;;)
+    {
+        // 合并过程中加载线程可能还在提交新的数据
+        takeLoadedRequests();
+
+        if (_mergeBacklog.empty())
+        {
+            break;
+        }
+
+        // 每帧至少合并一个请求，保证积压的数据最终都能合并
+        if (_numMergedLastFrame > 0)
+        {
+            if (_maximumMergeTimePerFrame > 0.0 && elapsedTime.elapsedTime() >= _maximumMergeTimePerFrame)
+            {
+                break;
+            }
+
+            if (_maximumMergeBytesPerFrame > 0 && _mergedBytesLastFrame + _mergeBacklog.front().bytes > _maximumMergeBytesPerFrame)
+            {
+                break;
+            }
+        }
+
+        PendingMerge pending = _mergeBacklog.front();
+        _mergeBacklog.pop_front();
+        _mergeBacklogBytes -= pending.bytes;
+
+        // 每次只放一个请求回合并队列，由osgDB::DatabasePager完成实际的合并
+        _dataToMergeList->add(pending.request.get());
+        addLoadedDataToSceneGraph(frameStamp);
+
+        ++_numMergedLastFrame;
+        _mergedBytesLastFrame += pending.bytes;
+    }
+}
+
+void DatabasePager::clear()
+{
+    osgDB::DatabasePager::clear();
+
+    _mergeBacklog.clear();
+    _mergeBacklogBytes = 0;
+}
+
+void DatabasePager::takeLoadedRequests()
+{
+    RequestQueue::RequestList loadedRequests;
+    _dataToMergeList->swap(loadedRequests);
+
+    for (auto &request : loadedRequests)
+    {
+        PendingMerge pending;
+        pending.request = request;
+
+        if (_maximumMergeBytesPerFrame > 0 && request->_loadedModel.valid())
+        {
+            EstimateDataSizeVisitor visitor;
+            request->_loadedModel->accept(visitor);
+            pending.bytes = visitor._bytes;
+        }
+
+        _mergeBacklogBytes += pending.bytes;
+        _mergeBacklog.push_back(pending);
+    }
+}
+
+} // namespace opeViewer
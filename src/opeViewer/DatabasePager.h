@@ -0,0 +1,103 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_868FCA08838145279126BDCE657163DF_H_
+#define INC_2026_10_18_868FCA08838145279126BDCE657163DF_H_
+
+#include <list>
+#include <mutex>
+
+#include <osgDB/DatabasePager>
+
+#include "KdTreeBuilder.h"
+
+namespace opeViewer
+{
+
+/// 分页器
+///
+/// 在osgDB::DatabasePager的基础上限制每帧合并的数据量，超出预算的部分留到下一帧合并
+///
+/// 设置KdTreeBuilder后，由osgDB在加载线程中为读入的几何体构建KdTree：没有Options的请求使用带有BUILD_KDTREES提示的Options，构建器设置到Registry
+class DatabasePager : public osgDB::DatabasePager
+{
+  public:
+    DatabasePager();
+
+    DatabasePager(const DatabasePager &rhs);
+
+    osgDB::DatabasePager *clone() const override;
+
+    /// 每帧合并的最长时间（秒），0表示不限制
+    void setMaximumMergeTimePerFrame(double time);
+
+    double getMaximumMergeTimePerFrame() const;
+
+    /// 每帧合并的最大数据量（字节），0表示不限制
+    void setMaximumMergeBytesPerFrame(unsigned int bytes);
+
+    unsigned int getMaximumMergeBytesPerFrame() const;
+
+    /// 等待合并的请求数量（包括还在合并队列中的请求）
+    unsigned int getMergeBacklogSize() const;
+
+    /// 等待合并的数据量（字节），仅在设置了字节预算时统计
+    unsigned int getMergeBacklogBytes() const;
+
+    /// 上一帧合并的请求数量
+    unsigned int getNumMergedLastFrame() const;
+
+    /// 上一帧合并的数据量（字节），仅在设置了字节预算时统计
+    unsigned int getMergedBytesLastFrame() const;
+
+    /// 在加载线程中构建KdTree，为空时不构建
+    ///
+    /// 构建器同时设置为Registry的KdTreeBuilder；请求自带的Options（如PagedLOD的DatabaseOptions）按其BuildKdTreesHint决定是否构建
+    void setKdTreeBuilder(KdTreeBuilder *builder);
+
+    KdTreeBuilder *getKdTreeBuilder();
+
+    const KdTreeBuilder *getKdTreeBuilder() const;
+
+    void requestNodeFile(const std::string &fileName, osg::NodePath &nodePath, float priority, const osg::FrameStamp *framestamp, osg::ref_ptr<osg::Referenced> &databaseRequest, const osg::Referenced *options) override;
+
+    bool requiresUpdateSceneGraph() const override;
+
+    void updateSceneGraph(const osg::FrameStamp &frameStamp) override;
+
+    void clear() override;
+
+  protected:
+    ~DatabasePager() override;
+
+    struct PendingMerge
+    {
+        osg::ref_ptr<DatabaseRequest> request;
+        unsigned int bytes{};
+    };
+
+    using MergeBacklog = std::list<PendingMerge>;
+
+    void takeLoadedRequests();
+
+    double _maximumMergeTimePerFrame{};
+    unsigned int _maximumMergeBytesPerFrame{};
+
+    MergeBacklog _mergeBacklog;
+    unsigned int _mergeBacklogBytes{};
+
+    unsigned int _numMergedLastFrame{};
+    unsigned int _mergedBytesLastFrame{};
+
+    osg::ref_ptr<KdTreeBuilder> _loadKdTreeBuilder;
+
+    /// 请求可能来自多个裁剪线程
+    std::mutex _kdTreeOptionsMutex;
+    /// 没有Options的请求使用，不构建KdTree时为空
+    osg::ref_ptr<osgDB::Options> _kdTreeOptions;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_868FCA08838145279126BDCE657163DF_H_
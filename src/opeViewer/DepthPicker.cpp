@@ -0,0 +1,368 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "DepthPicker.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <osg/BufferObject>
+#include <osg/GraphicsContext>
+
+#include "ComputeIntersection.h"
+#include "Viewport.h"
+
+#ifndef GL_READ_FRAMEBUFFER_BINDING
+#define GL_READ_FRAMEBUFFER_BINDING 0x8CAA
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+
+namespace opeViewer
+{
+
+/// 主相机绘制后读回
+struct DepthPicker::ReadbackCallback : Renderer::DrawCallback
+{
+    osg::observer_ptr<DepthPicker> picker;
+
+    explicit ReadbackCallback(DepthPicker *picker) : picker(picker)
+    {
+    }
+
+    void drawImplementation(Renderer *renderer, osg::State *state) override
+    {
+        osg::ref_ptr<DepthPicker> picker;
+        if (this->picker.lock(picker))
+        {
+            picker->readback(renderer, state);
+        }
+    }
+
+    void releaseGLObjects(osg::State *state) const override
+    {
+        osg::ref_ptr<DepthPicker> picker;
+        if (!state || !this->picker.lock(picker))
+        {
+            return;
+        }
+
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+        osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+        for (Readback &readback : picker->_readbacks)
+        {
+            if (readback.fence)
+            {
+                ext->glDeleteSync(readback.fence);
+                readback.fence = nullptr;
+            }
+            if (readback.buffer)
+            {
+                ext->glDeleteBuffers(1, &readback.buffer);
+                readback.buffer = 0;
+            }
+        }
+#endif
+        picker->_issuedRegion = Region();
+    }
+};
+
+/// 析构或更换Renderer时留下的缓冲和同步对象，在图形线程中删除
+struct DepthPicker::ReleaseReadbacksOperation : osg::GraphicsOperation
+{
+    std::vector<GLuint> buffers;
+    std::vector<GLsync> fences;
+
+    ReleaseReadbacksOperation() : osg::GraphicsOperation("DepthPicker::ReleaseReadbacksOperation", false)
+    {
+    }
+
+    void operator()(osg::GraphicsContext *context) override
+    {
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+        osg::GLExtensions *ext = context->getState()->get<osg::GLExtensions>();
+        for (GLsync fence : fences)
+        {
+            ext->glDeleteSync(fence);
+        }
+        if (!buffers.empty())
+        {
+            ext->glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+        }
+#endif
+    }
+};
+
+bool DepthPicker::Region::isSame(const Region &other) const
+{
+    return x == other.x && y == other.y && width == other.width && height == other.height && viewportWidth == other.viewportWidth && viewportHeight == other.viewportHeight && viewMatrix == other.viewMatrix && projectionMatrix == other.projectionMatrix;
+}
+
+DepthPicker::DepthPicker(Viewport *viewport, unsigned int radius) : _viewport(viewport), _radius(radius)
+{
+    _readbackCallback = new ReadbackCallback(this);
+    attach();
+}
+
+DepthPicker::~DepthPicker()
+{
+    osg::ref_ptr<Renderer> renderer;
+    if (_renderer.lock(renderer))
+    {
+        renderer->removePostDrawCallback(_readbackCallback);
+        releaseReadbacks(renderer);
+    }
+}
+
+unsigned int DepthPicker::getRadius() const
+{
+    return _radius;
+}
+
+void DepthPicker::attach()
+{
+    osg::ref_ptr<Viewport> viewport;
+    if (!_viewport.lock(viewport))
+    {
+        return;
+    }
+
+    Renderer *renderer = dynamic_cast<Renderer *>(viewport->getCamera()->getRenderer());
+
+    osg::ref_ptr<Renderer> attachedRenderer;
+    if (_renderer.lock(attachedRenderer))
+    {
+        if (attachedRenderer == renderer)
+        {
+            return;
+        }
+        attachedRenderer->removePostDrawCallback(_readbackCallback);
+        releaseReadbacks(attachedRenderer);
+    }
+
+    _renderer = renderer;
+    if (renderer)
+    {
+        renderer->addPostDrawCallback(_readbackCallback);
+    }
+}
+
+void DepthPicker::setPointer(const osgGA::GUIEventAdapter &ea)
+{
+    osg::ref_ptr<Viewport> viewport;
+    _pointerValid = _viewport.lock(viewport) && computePointerPixel(ea, viewport->getCamera(), _pointerX, _pointerY);
+}
+
+DepthPicker::Status DepthPicker::pick(const osgGA::GUIEventAdapter &ea, osg::Vec3d &point) const
+{
+    osg::ref_ptr<Viewport> viewport;
+    if (!_resolvedRegion.valid || !_viewport.lock(viewport))
+    {
+        return UNAVAILABLE;
+    }
+
+    osg::Camera *camera = viewport->getCamera();
+    int x{}, y{};
+    if (!computePointerPixel(ea, camera, x, y))
+    {
+        return UNAVAILABLE;
+    }
+
+    const osg::Viewport *cameraViewport = camera->getViewport();
+    if (cameraViewport->width() != _resolvedRegion.viewportWidth || cameraViewport->height() != _resolvedRegion.viewportHeight)
+    {
+        return UNAVAILABLE;
+    }
+
+    int column = x - _resolvedRegion.x;
+    int row = y - _resolvedRegion.y;
+    if (column < 0 || row < 0 || column >= _resolvedRegion.width || row >= _resolvedRegion.height)
+    {
+        return UNAVAILABLE;
+    }
+
+    float depth = _resolvedDepths[row * _resolvedRegion.width + column];
+    if (depth >= 1.0f)
+    {
+        return BACKGROUND;
+    }
+
+    // 像素中心
+    point = osg::Vec3d(cameraViewport->x() + x + 0.5, cameraViewport->y() + y + 0.5, depth) * _resolvedRegion.inverseVPW;
+    return SURFACE;
+}
+
+bool DepthPicker::hasPendingReadbacks() const
+{
+    for (const Readback &readback : _readbacks)
+    {
+        if (readback.fence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DepthPicker::readback(Renderer *renderer, osg::State *state)
+{
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+    osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+    if (_unsupported || !ext->isPBOSupported || !ext->glFenceSync || !ext->glClientWaitSync)
+    {
+        return;
+    }
+
+    resolveReadbacks(state);
+
+    osg::Camera *camera = renderer->getCamera();
+    const osg::Viewport *viewport = camera ? camera->getViewport() : nullptr;
+    if (!_pointerValid || !viewport)
+    {
+        return;
+    }
+
+    int radius = static_cast<int>(_radius);
+
+    Region region;
+    region.valid = true;
+    region.x = std::max(_pointerX - radius, 0);
+    region.y = std::max(_pointerY - radius, 0);
+    region.width = std::min(_pointerX + radius, static_cast<int>(viewport->width()) - 1) - region.x + 1;
+    region.height = std::min(_pointerY + radius, static_cast<int>(viewport->height()) - 1) - region.y + 1;
+    region.viewportWidth = static_cast<int>(viewport->width());
+    region.viewportHeight = static_cast<int>(viewport->height());
+    // 剔除时已将计算的近远平面写入相机，与本帧绘制使用的投影矩阵相同
+    region.viewMatrix = camera->getViewMatrix();
+    region.projectionMatrix = camera->getProjectionMatrix();
+    if (region.width <= 0 || region.height <= 0)
+    {
+        return;
+    }
+
+    // 与上次读回的相同时不再读回，否则按需绘制时每次读回都会请求新的一帧
+    if (_issuedRegion.valid && region.isSame(_issuedRegion))
+    {
+        return;
+    }
+
+    // 多重采样的FBO需要先解析才能读取
+    GLint readFramebuffer = 0;
+    GLint sampleBuffers = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+    if (readFramebuffer && sampleBuffers)
+    {
+        OSG_INFO << "DepthPicker::readback() Multisampled framebuffer object, depth picking disabled" << std::endl;
+        _unsupported = true;
+        return;
+    }
+
+    region.inverseVPW.invert(region.viewMatrix * region.projectionMatrix * viewport->computeWindowMatrix());
+
+    // 最旧的读回三帧后仍未完成，丢弃
+    Readback &readback = _readbacks[_nextReadback];
+    _nextReadback = (_nextReadback + 1) % NUM_READBACKS;
+    if (readback.fence)
+    {
+        ext->glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+    }
+
+    if (!readback.buffer)
+    {
+        int size = 2 * radius + 1;
+        ext->glGenBuffers(1, &readback.buffer);
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+        ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size * size * sizeof(GLfloat), nullptr, GL_STREAM_READ_ARB);
+    }
+    else
+    {
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(static_cast<GLint>(viewport->x()) + region.x, static_cast<GLint>(viewport->y()) + region.y, region.width, region.height, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+    readback.fence = ext->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.region = region;
+    _issuedRegion = region;
+#endif
+}
+
+void DepthPicker::resolveReadbacks(osg::State *state)
+{
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+    osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+
+    // 从最旧的开始，遇到未完成的停止
+    for (unsigned int i = 0; i < NUM_READBACKS; ++i)
+    {
+        Readback &readback = _readbacks[(_nextReadback + i) % NUM_READBACKS];
+        if (!readback.fence)
+        {
+            continue;
+        }
+
+        GLenum result = ext->glClientWaitSync(readback.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+
+        ext->glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+        const void *data = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+        if (data)
+        {
+            _resolvedDepths.resize(readback.region.width * readback.region.height);
+            std::memcpy(_resolvedDepths.data(), data, _resolvedDepths.size() * sizeof(GLfloat));
+            ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+
+            _resolvedRegion = readback.region;
+        }
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    }
+#endif
+}
+
+void DepthPicker::releaseReadbacks(Renderer *renderer)
+{
+    osg::ref_ptr<ReleaseReadbacksOperation> operation = new ReleaseReadbacksOperation;
+    for (Readback &readback : _readbacks)
+    {
+        if (readback.fence)
+        {
+            operation->fences.push_back(readback.fence);
+        }
+        if (readback.buffer)
+        {
+            operation->buffers.push_back(readback.buffer);
+        }
+        readback = Readback();
+    }
+    _issuedRegion = Region();
+
+    // 上下文已经销毁时GL对象随之释放
+    osg::GraphicsContext *context = renderer->getCamera() ? renderer->getCamera()->getGraphicsContext() : nullptr;
+    if (context && (!operation->fences.empty() || !operation->buffers.empty()))
+    {
+        context->add(operation.get());
+    }
+}
+
+} // namespace opeViewer
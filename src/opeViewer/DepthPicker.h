@@ -0,0 +1,126 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_8F9F667C9890438D8F5E3B8CC5C56C34_H_
+#define INC_2026_10_18_8F9F667C9890438D8F5E3B8CC5C56C34_H_
+
+#include <vector>
+
+#include <osg/GLExtensions>
+#include <osg/Matrixd>
+#include <osg/observer_ptr>
+#include <osgGA/GUIEventAdapter>
+
+#include "Renderer.h"
+
+namespace opeViewer
+{
+
+class Viewport;
+
+/// 深度拾取
+///
+/// 主相机绘制后将鼠标周围(2 * radius + 1)²个像素的深度异步读回到PBO，之后的帧中读取完成的结果，用绘制该帧时的相机矩阵反投影为世界坐标
+///
+/// 用于以鼠标为中心缩放、旋转等导航，结果来自上一帧，相机移动或场景修改后仍然使用，不考虑遍历掩码
+///
+/// 需要PBO和同步对象，OpenGL ES和多重采样的FBO（如Qt的QOpenGLWidget）中不可用，见Viewport::computeSurfacePoint
+class DepthPicker : public osg::Referenced
+{
+  public:
+    enum Status
+    {
+        /// 鼠标下有表面
+        SURFACE,
+        /// 鼠标下是背景
+        BACKGROUND,
+        /// 没有该位置的深度，需要求交
+        UNAVAILABLE,
+    };
+
+    explicit DepthPicker(Viewport *viewport, unsigned int radius = 2);
+
+    unsigned int getRadius() const;
+
+    /// 加入到主相机的Renderer，Renderer创建后需要再次调用
+    void attach();
+
+    /// 在事件遍历中调用，记录鼠标位置，下一帧在该位置读回深度
+    void setPointer(const osgGA::GUIEventAdapter &ea);
+
+    /// 鼠标下的表面点（世界坐标）
+    Status pick(const osgGA::GUIEventAdapter &ea, osg::Vec3d &point) const;
+
+    /// 有还未读取的读回，需要再绘制一帧
+    bool hasPendingReadbacks() const;
+
+  protected:
+    ~DepthPicker() override;
+
+    struct ReadbackCallback;
+    struct ReleaseReadbacksOperation;
+
+    /// 一次读回的像素范围和相机
+    struct Region
+    {
+        bool valid{};
+        /// 读回的矩形在视口中的像素坐标，已裁剪到视口内
+        int x{};
+        int y{};
+        int width{};
+        int height{};
+        /// 视口大小
+        int viewportWidth{};
+        int viewportHeight{};
+        osg::Matrixd viewMatrix;
+        osg::Matrixd projectionMatrix;
+        /// 窗口坐标到世界坐标
+        osg::Matrixd inverseVPW;
+
+        /// 读回的像素和相机矩阵相同
+        bool isSame(const Region &other) const;
+    };
+
+    struct Readback
+    {
+        GLuint buffer{};
+        /// 非空表示读回还未读取
+        GLsync fence{};
+        Region region;
+    };
+
+    static const unsigned int NUM_READBACKS = 3;
+
+    void readback(Renderer *renderer, osg::State *state);
+
+    void resolveReadbacks(osg::State *state);
+
+    /// 在renderer的图形线程中删除读回的缓冲和同步对象，之后的读回重新创建
+    void releaseReadbacks(Renderer *renderer);
+
+    osg::observer_ptr<Viewport> _viewport;
+    osg::observer_ptr<Renderer> _renderer;
+    osg::ref_ptr<ReadbackCallback> _readbackCallback;
+    unsigned int _radius{};
+
+    bool _pointerValid{};
+    int _pointerX{};
+    int _pointerY{};
+
+    /// 当前的绘制缓冲是多重采样的FBO，不能直接读取深度
+    bool _unsupported{};
+
+    Readback _readbacks[NUM_READBACKS];
+    unsigned int _nextReadback{};
+    /// 最近一次开始读回的区域
+    Region _issuedRegion;
+
+    /// 最近一次读取完成的结果
+    Region _resolvedRegion;
+    std::vector<float> _resolvedDepths;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_8F9F667C9890438D8F5E3B8CC5C56C34_H_
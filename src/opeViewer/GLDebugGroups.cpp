@@ -0,0 +1,46 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "GLDebugGroups.h"
+
+#include <osg/GLExtensions>
+
+#ifndef GL_DEBUG_SOURCE_APPLICATION
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#endif
+
+namespace opeViewer
+{
+
+GLDebugGroups::GLDebugGroups(unsigned int contextID)
+{
+    if (osg::isGLExtensionOrVersionSupported(contextID, "GL_KHR_debug", 4.3f))
+    {
+        osg::setGLExtensionFuncPtr(_glPushDebugGroup, "glPushDebugGroup", "glPushDebugGroupKHR");
+        osg::setGLExtensionFuncPtr(_glPopDebugGroup, "glPopDebugGroup", "glPopDebugGroupKHR");
+    }
+}
+
+bool GLDebugGroups::isSupported() const
+{
+    return _glPushDebugGroup && _glPopDebugGroup;
+}
+
+void GLDebugGroups::push(const std::string &name)
+{
+    if (isSupported())
+    {
+        _glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, static_cast<GLsizei>(name.size()), name.c_str());
+    }
+}
+
+void GLDebugGroups::pop()
+{
+    if (isSupported())
+    {
+        _glPopDebugGroup();
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,40 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_9BA62FAC1C70437489140988590D1DAE_H_
+#define INC_2026_10_18_9BA62FAC1C70437489140988590D1DAE_H_
+
+#include <string>
+
+#include <osg/GL>
+#include <osg/Referenced>
+
+namespace opeViewer
+{
+
+/// KHR_debug的调试组，使apitrace、RenderDoc等工具捕获的命令流按窗口、视口、相机、渲染阶段和渲染箱分组
+///
+/// 每个上下文一个，用state->get<GLDebugGroups>()获取，在该上下文当前时调用；不支持GL 4.3或GL_KHR_debug时push和pop不做任何事
+class GLDebugGroups : public osg::Referenced
+{
+  public:
+    explicit GLDebugGroups(unsigned int contextID);
+
+    bool isSupported() const;
+
+    void push(const std::string &name);
+
+    void pop();
+
+  protected:
+    typedef void(GL_APIENTRY *PushDebugGroupProc)(GLenum source, GLuint id, GLsizei length, const GLchar *message);
+    typedef void(GL_APIENTRY *PopDebugGroupProc)();
+
+    PushDebugGroupProc _glPushDebugGroup{};
+    PopDebugGroupProc _glPopDebugGroup{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_9BA62FAC1C70437489140988590D1DAE_H_
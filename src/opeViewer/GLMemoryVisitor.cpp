@@ -0,0 +1,171 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "GLMemoryVisitor.h"
+
+#include <osg/BufferObject>
+#include <osg/Camera>
+#include <osg/Geometry>
+#include <osg/Program>
+#include <osg/Stats>
+#include <osg/Texture>
+
+namespace opeViewer
+{
+
+void GLMemoryStatistics::setAttributes(osg::Stats *stats, unsigned int frameNumber) const
+{
+    stats->setAttribute(frameNumber, "GL textures", static_cast<double>(numTextures));
+    stats->setAttribute(frameNumber, "GL texture memory", static_cast<double>(textureBytes));
+    stats->setAttribute(frameNumber, "GL vertex buffers", static_cast<double>(numVertexBuffers));
+    stats->setAttribute(frameNumber, "GL vertex buffer memory", static_cast<double>(vertexBufferBytes));
+    stats->setAttribute(frameNumber, "GL element buffers", static_cast<double>(numElementBuffers));
+    stats->setAttribute(frameNumber, "GL element buffer memory", static_cast<double>(elementBufferBytes));
+    stats->setAttribute(frameNumber, "GL programs", static_cast<double>(numPrograms));
+    stats->setAttribute(frameNumber, "GL framebuffers", static_cast<double>(numFramebuffers));
+}
+
+GLMemoryVisitor::GLMemoryVisitor(unsigned int contextID) : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _contextID(contextID)
+{
+}
+
+void GLMemoryVisitor::reset()
+{
+    _statistics = GLMemoryStatistics();
+    _visited.clear();
+}
+
+const GLMemoryStatistics &GLMemoryVisitor::getStatistics() const
+{
+    return _statistics;
+}
+
+void GLMemoryVisitor::apply(osg::Node &node)
+{
+    applyStateSet(node.getStateSet());
+    traverse(node);
+}
+
+void GLMemoryVisitor::apply(osg::Drawable &drawable)
+{
+    if (!_visited.insert(&drawable).second)
+    {
+        return;
+    }
+
+    applyStateSet(drawable.getStateSet());
+
+    osg::Geometry *geometry = drawable.asGeometry();
+    if (!geometry)
+    {
+        return;
+    }
+
+    osg::Geometry::ArrayList arrays;
+    geometry->getArrayList(arrays);
+    for (auto &array : arrays)
+    {
+        applyBufferObject(array->getBufferObject());
+    }
+
+    osg::Geometry::DrawElementsList drawElementsList;
+    geometry->getDrawElementsList(drawElementsList);
+    for (auto drawElements : drawElementsList)
+    {
+        applyBufferObject(drawElements->getBufferObject());
+    }
+}
+
+void GLMemoryVisitor::apply(osg::Camera &camera)
+{
+    applyCamera(camera, nullptr);
+}
+
+void GLMemoryVisitor::applyCamera(osg::Camera &camera, const osg::Node *excludedChild)
+{
+    applyStateSet(camera.getStateSet());
+
+    if (camera.getRenderTargetImplementation() == osg::Camera::FRAME_BUFFER_OBJECT && _visited.insert(&camera).second)
+    {
+        ++_statistics.numFramebuffers;
+        for (auto &attachment : camera.getBufferAttachmentMap())
+        {
+            applyTexture(attachment.second._texture.get());
+        }
+    }
+
+    for (unsigned int i = 0; i < camera.getNumChildren(); ++i)
+    {
+        if (camera.getChild(i) != excludedChild)
+        {
+            camera.getChild(i)->accept(*this);
+        }
+    }
+}
+
+void GLMemoryVisitor::applyStateSet(osg::StateSet *stateSet)
+{
+    if (!stateSet || !_visited.insert(stateSet).second)
+    {
+        return;
+    }
+
+    for (auto &attributes : stateSet->getTextureAttributeList())
+    {
+        for (auto &attribute : attributes)
+        {
+            applyTexture(attribute.second.first->asTexture());
+        }
+    }
+
+    for (auto &attribute : stateSet->getAttributeList())
+    {
+        if (attribute.first.first == osg::StateAttribute::PROGRAM && _visited.insert(attribute.second.first.get()).second)
+        {
+            ++_statistics.numPrograms;
+        }
+    }
+}
+
+void GLMemoryVisitor::applyTexture(osg::Texture *texture)
+{
+    if (!texture || !_visited.insert(texture).second)
+    {
+        return;
+    }
+
+    osg::Texture::TextureObject *textureObject = texture->getTextureObject(_contextID);
+    if (textureObject)
+    {
+        ++_statistics.numTextures;
+        _statistics.textureBytes += textureObject->size();
+    }
+}
+
+void GLMemoryVisitor::applyBufferObject(osg::BufferObject *bufferObject)
+{
+    if (!bufferObject || !_visited.insert(bufferObject).second)
+    {
+        return;
+    }
+
+    osg::GLBufferObject *glBufferObject = bufferObject->getGLBufferObject(_contextID);
+    if (!glBufferObject)
+    {
+        return;
+    }
+
+    if (bufferObject->getTarget() == GL_ELEMENT_ARRAY_BUFFER_ARB)
+    {
+        ++_statistics.numElementBuffers;
+        _statistics.elementBufferBytes += glBufferObject->getProfile()._size;
+    }
+    else
+    {
+        ++_statistics.numVertexBuffers;
+        _statistics.vertexBufferBytes += glBufferObject->getProfile()._size;
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,76 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_A1220EB8CE11487BAF17DB731AAD17B9_H_
+#define INC_2026_10_18_A1220EB8CE11487BAF17DB731AAD17B9_H_
+
+#include <cstdint>
+#include <set>
+
+#include <osg/NodeVisitor>
+
+namespace osg
+{
+class BufferObject;
+class Stats;
+class Texture;
+} // namespace osg
+
+namespace opeViewer
+{
+
+/// GL对象的数量和显存（字节）
+struct GLMemoryStatistics
+{
+    unsigned int numTextures{};
+    uint64_t textureBytes{};
+    unsigned int numVertexBuffers{};
+    uint64_t vertexBufferBytes{};
+    unsigned int numElementBuffers{};
+    uint64_t elementBufferBytes{};
+    unsigned int numPrograms{};
+    unsigned int numFramebuffers{};
+
+    /// 写入"GL textures"、"GL texture memory"等属性
+    void setAttributes(osg::Stats *stats, unsigned int frameNumber) const;
+};
+
+/// 统计子图在一个上下文中持有的GL对象
+///
+/// 纹理和缓冲对象只统计已在该上下文中创建的，大小取自TextureObject和GLBufferObject；程序统计引用的数量；帧缓冲统计渲染到FBO的相机数量
+///
+/// 同一对象只统计一次，多次accept时累加，得到多个子图的并集
+class GLMemoryVisitor : public osg::NodeVisitor
+{
+  public:
+    explicit GLMemoryVisitor(unsigned int contextID);
+
+    void reset() override;
+
+    const GLMemoryStatistics &getStatistics() const;
+
+    void apply(osg::Node &node) override;
+
+    void apply(osg::Drawable &drawable) override;
+
+    void apply(osg::Camera &camera) override;
+
+    /// 统计相机本身（状态集和渲染目标），遍历除excludedChild以外的子节点，用于不计入视口相机下的场景
+    void applyCamera(osg::Camera &camera, const osg::Node *excludedChild);
+
+  protected:
+    void applyStateSet(osg::StateSet *stateSet);
+
+    void applyTexture(osg::Texture *texture);
+
+    void applyBufferObject(osg::BufferObject *bufferObject);
+
+    unsigned int _contextID{};
+    GLMemoryStatistics _statistics;
+    std::set<const osg::Referenced *> _visited;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_A1220EB8CE11487BAF17DB731AAD17B9_H_
@@ -0,0 +1,1005 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "GeometryInstancer.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Light>
+#include <osg/Material>
+#include <osg/MatrixTransform>
+#include <osg/PolygonOffset>
+#include <osg/Program>
+#include <osg/ShadeModel>
+#include <osg/TexEnv>
+#include <osg/Texture2D>
+#include <osg/VertexAttribDivisor>
+#include <osg/observer_ptr>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/IntersectionVisitor>
+
+#ifndef GL_LIGHTING
+#define GL_LIGHTING 0x0B50
+#endif
+
+#ifndef GL_LIGHT0
+#define GL_LIGHT0 0x4000
+#endif
+
+#ifndef GL_COLOR_MATERIAL
+#define GL_COLOR_MATERIAL 0x0B57
+#endif
+
+#ifndef GL_NORMALIZE
+#define GL_NORMALIZE 0x0BA1
+#endif
+
+#ifndef GL_RESCALE_NORMAL
+#define GL_RESCALE_NORMAL 0x803A
+#endif
+
+#ifndef GL_ALPHA_TEST
+#define GL_ALPHA_TEST 0x0BC0
+#endif
+
+#ifndef GL_POINT_SMOOTH
+#define GL_POINT_SMOOTH 0x0B10
+#endif
+
+namespace opeViewer
+{
+
+// 固定管线的逐顶点光照（只计算GL_LIGHT0，非本地观察者，单面），材质颜色模式的取值见getColorMode
+static const char *gl2_InstancingVertexShader = {"#version 120\n"
+                                                 "// gl2_InstancingVertexShader\n"
+                                                 "const int AMBIENT = 1;\n"
+                                                 "const int DIFFUSE = 2;\n"
+                                                 "const int SPECULAR = 3;\n"
+                                                 "const int EMISSION = 4;\n"
+                                                 "const int AMBIENT_AND_DIFFUSE = 5;\n"
+                                                 "attribute mat4 opeViewer_InstanceMatrix;\n"
+                                                 "uniform bool opeViewer_Lighting;\n"
+                                                 "uniform int opeViewer_ColorMode;\n"
+                                                 "varying vec4 vertexColor;\n"
+                                                 "varying vec4 texCoord;\n"
+                                                 "void main(void)\n"
+                                                 "{\n"
+                                                 "    vec4 vertex = opeViewer_InstanceMatrix * gl_Vertex;\n"
+                                                 "    vec4 eyeVertex = gl_ModelViewMatrix * vertex;\n"
+                                                 "    gl_Position = gl_ModelViewProjectionMatrix * vertex;\n"
+                                                 "    gl_ClipVertex = eyeVertex;\n"
+                                                 "    texCoord = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+                                                 "    if (!opeViewer_Lighting)\n"
+                                                 "    {\n"
+                                                 "        vertexColor = gl_Color;\n"
+                                                 "        return;\n"
+                                                 "    }\n"
+                                                 "    // 余子式矩阵为逆转置乘以行列式，非均匀缩放时法线仍垂直于表面，镜像时用行列式的符号保持方向\n"
+                                                 "    mat3 m = mat3(opeViewer_InstanceMatrix);\n"
+                                                 "    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));\n"
+                                                 "    float handedness = dot(m[0], cross(m[1], m[2])) < 0.0 ? -1.0 : 1.0;\n"
+                                                 "    vec3 normal = normalize(gl_NormalMatrix * (cofactor * gl_Normal) * handedness);\n"
+                                                 "    vec4 ambient = opeViewer_ColorMode == AMBIENT || opeViewer_ColorMode == AMBIENT_AND_DIFFUSE ? gl_Color : gl_FrontMaterial.ambient;\n"
+                                                 "    vec4 diffuse = opeViewer_ColorMode == DIFFUSE || opeViewer_ColorMode == AMBIENT_AND_DIFFUSE ? gl_Color : gl_FrontMaterial.diffuse;\n"
+                                                 "    vec4 specular = opeViewer_ColorMode == SPECULAR ? gl_Color : gl_FrontMaterial.specular;\n"
+                                                 "    vec4 emission = opeViewer_ColorMode == EMISSION ? gl_Color : gl_FrontMaterial.emission;\n"
+                                                 "    vec3 lightDirection;\n"
+                                                 "    float attenuation = 1.0;\n"
+                                                 "    if (gl_LightSource[0].position.w == 0.0)\n"
+                                                 "    {\n"
+                                                 "        lightDirection = normalize(gl_LightSource[0].position.xyz);\n"
+                                                 "    }\n"
+                                                 "    else\n"
+                                                 "    {\n"
+                                                 "        vec3 toLight = gl_LightSource[0].position.xyz / gl_LightSource[0].position.w - eyeVertex.xyz / eyeVertex.w;\n"
+                                                 "        float distance = length(toLight);\n"
+                                                 "        lightDirection = toLight / distance;\n"
+                                                 "        attenuation = 1.0 / (gl_LightSource[0].constantAttenuation + gl_LightSource[0].linearAttenuation * distance + gl_LightSource[0].quadraticAttenuation * distance * distance);\n"
+                                                 "        if (gl_LightSource[0].spotCutoff != 180.0)\n"
+                                                 "        {\n"
+                                                 "            float spot = dot(-lightDirection, normalize(gl_LightSource[0].spotDirection));\n"
+                                                 "            attenuation *= spot < gl_LightSource[0].spotCosCutoff ? 0.0 : pow(spot, gl_LightSource[0].spotExponent);\n"
+                                                 "        }\n"
+                                                 "    }\n"
+                                                 "    float diffuseFactor = max(dot(normal, lightDirection), 0.0);\n"
+                                                 "    vec4 color = emission + ambient * gl_LightModel.ambient + attenuation * (ambient * gl_LightSource[0].ambient + diffuseFactor * diffuse * gl_LightSource[0].diffuse);\n"
+                                                 "    if (diffuseFactor > 0.0)\n"
+                                                 "    {\n"
+                                                 "        float specularBase = max(dot(normal, normalize(lightDirection + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+                                                 "        float specularFactor = gl_FrontMaterial.shininess == 0.0 ? 1.0 : pow(specularBase, gl_FrontMaterial.shininess);\n"
+                                                 "        color += attenuation * specularFactor * specular * gl_LightSource[0].specular;\n"
+                                                 "    }\n"
+                                                 "    vertexColor = vec4(clamp(color.rgb, 0.0, 1.0), diffuse.a);\n"
+                                                 "}\n"};
+
+// 纹理环境为MODULATE
+static const char *gl2_InstancingFragmentShader = {"#version 120\n"
+                                                   "// gl2_InstancingFragmentShader\n"
+                                                   "uniform sampler2D opeViewer_Texture;\n"
+                                                   "uniform bool opeViewer_Textured;\n"
+                                                   "varying vec4 vertexColor;\n"
+                                                   "varying vec4 texCoord;\n"
+                                                   "void main(void)\n"
+                                                   "{\n"
+                                                   "    gl_FragColor = vertexColor;\n"
+                                                   "    if (opeViewer_Textured) gl_FragColor *= texture2DProj(opeViewer_Texture, texCoord);\n"
+                                                   "}\n"};
+
+namespace
+{
+
+const unsigned int NUM_RING_GEOMETRIES = 3;
+
+struct Instance
+{
+    osg::Matrixf matrix;
+    osg::BoundingBox boundingBox;
+};
+
+using Instances = std::vector<Instance>;
+
+/// 实例化几何体的包围盒为所有实例包围盒的并集
+class InstancesBoundingBoxCallback : public osg::Drawable::ComputeBoundingBoxCallback
+{
+  public:
+    osg::BoundingBox _boundingBox;
+
+    InstancesBoundingBoxCallback()
+    {
+    }
+
+    explicit InstancesBoundingBoxCallback(const osg::BoundingBox &boundingBox) : _boundingBox(boundingBox)
+    {
+    }
+
+    InstancesBoundingBoxCallback(const InstancesBoundingBoxCallback &rhs, const osg::CopyOp &copyop) : osg::Drawable::ComputeBoundingBoxCallback(rhs, copyop), _boundingBox(rhs._boundingBox)
+    {
+    }
+
+    META_Object(opeViewer, InstancesBoundingBoxCallback);
+
+    osg::BoundingBox computeBound(const osg::Drawable &) const override
+    {
+        return _boundingBox;
+    }
+};
+
+/// 设置实例矩阵，矩阵的每一行作为一个顶点属性，着色器中组成mat4
+void setInstanceMatrices(osg::Geometry *geometry, const std::vector<osg::Matrixf> &matrices)
+{
+    osg::ref_ptr<osg::VertexBufferObject> vbo;
+
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        unsigned int location = GeometryInstancer::INSTANCE_MATRIX_ATTRIBUTE_LOCATION + row;
+
+        auto array = dynamic_cast<osg::Vec4Array *>(geometry->getVertexAttribArray(location));
+        if (!array)
+        {
+            // 实例矩阵单独使用一个VBO，更新时不影响共享的顶点数据
+            if (!vbo)
+            {
+                vbo = new osg::VertexBufferObject;
+            }
+
+            array = new osg::Vec4Array;
+            array->setVertexBufferObject(vbo);
+            geometry->setVertexAttribArray(location, array, osg::Array::BIND_PER_VERTEX);
+        }
+
+        array->resize(matrices.size());
+        for (std::size_t i = 0; i < matrices.size(); ++i)
+        {
+            const osg::Matrixf &matrix = matrices[i];
+            (*array)[i].set(matrix(row, 0), matrix(row, 1), matrix(row, 2), matrix(row, 3));
+        }
+        array->dirty();
+    }
+
+    for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i)
+    {
+        geometry->getPrimitiveSet(i)->setNumInstances(static_cast<int>(matrices.size()));
+    }
+}
+
+/// 复制出的图元没有EBO，需要单独分配
+void assignElementBufferObjects(osg::Geometry *geometry)
+{
+    osg::ref_ptr<osg::ElementBufferObject> ebo;
+    for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i)
+    {
+        osg::DrawElements *elements = geometry->getPrimitiveSet(i)->getDrawElements();
+        if (elements && !elements->getElementBufferObject())
+        {
+            if (!ebo)
+            {
+                ebo = new osg::ElementBufferObject;
+            }
+            elements->setElementBufferObject(ebo);
+        }
+    }
+}
+
+/// 逐实例视锥裁剪
+///
+/// 可见比例较低时，将可见实例压缩到按相机和帧号轮换的几何体中绘制，避免修改正在被绘制线程使用的数据
+class InstanceCullCallback : public osg::DrawableCullCallback
+{
+    std::vector<osg::Matrixf> _matrices;
+    std::vector<osg::BoundingSphere> _bounds;
+    float _compactionThreshold{};
+
+    using RingGeometries = std::array<osg::ref_ptr<osg::Geometry>, NUM_RING_GEOMETRIES>;
+
+    mutable std::mutex _mutex;
+    /// 每个相机一组，相机销毁后在下次加入相机时移除
+    mutable std::map<osg::observer_ptr<const osg::Camera>, RingGeometries> _ringGeometries;
+
+  public:
+    InstanceCullCallback()
+    {
+    }
+
+    InstanceCullCallback(const Instances &instances, float compactionThreshold) : _compactionThreshold(compactionThreshold)
+    {
+        _matrices.reserve(instances.size());
+        _bounds.reserve(instances.size());
+        for (auto &instance : instances)
+        {
+            _matrices.push_back(instance.matrix);
+            _bounds.emplace_back(instance.boundingBox);
+        }
+    }
+
+    InstanceCullCallback(const InstanceCullCallback &rhs, const osg::CopyOp &copyop)
+        : osg::Object(rhs, copyop), osg::Callback(rhs, copyop), osg::DrawableCullCallback(rhs, copyop), _matrices(rhs._matrices), _bounds(rhs._bounds), _compactionThreshold(rhs._compactionThreshold)
+    {
+    }
+
+    META_Object(opeViewer, InstanceCullCallback);
+
+    bool cull(osg::NodeVisitor *nv, osg::Drawable *drawable, osg::RenderInfo *renderInfo) const override
+    {
+        auto cv = dynamic_cast<osgUtil::CullVisitor *>(nv);
+        auto geometry = drawable->asGeometry();
+        if (!cv || !geometry)
+        {
+            return false;
+        }
+
+        const osg::BoundingBox &boundingBox = drawable->getBoundingBox();
+        if (drawable->isCullingActive() && cv->isCulled(boundingBox))
+        {
+            return true;
+        }
+
+        static thread_local std::vector<osg::Matrixf> visible;
+        visible.clear();
+
+        osg::CullingSet &cullingSet = cv->getCurrentCullingSet();
+        for (std::size_t i = 0; i < _bounds.size(); ++i)
+        {
+            if (!cullingSet.isCulled(_bounds[i]))
+            {
+                visible.push_back(_matrices[i]);
+            }
+        }
+
+        if (visible.empty())
+        {
+            return true;
+        }
+
+        // 大部分可见时直接绘制全部实例
+        if (visible.size() >= _compactionThreshold * _matrices.size())
+        {
+            return false;
+        }
+
+        osg::Geometry *compacted = getRingGeometry(cv, geometry);
+        setInstanceMatrices(compacted, visible);
+
+        /// \see osgUtil::CullVisitor::apply(osg::Drawable &)
+        osg::RefMatrix &matrix = *cv->getModelViewMatrix();
+        if (cv->getComputeNearFarMode() && boundingBox.valid())
+        {
+            if (!cv->updateCalculatedNearFar(matrix, *compacted, false))
+            {
+                return true;
+            }
+        }
+
+        float depth = boundingBox.valid() ? -(boundingBox.center().x() * matrix(0, 2) + boundingBox.center().y() * matrix(1, 2) + boundingBox.center().z() * matrix(2, 2) + matrix(3, 2)) : 0.f;
+
+        osg::StateSet *stateSet = compacted->getStateSet();
+        if (stateSet)
+        {
+            cv->pushStateSet(stateSet);
+        }
+
+        cv->addDrawableAndDepth(compacted, &matrix, depth);
+
+        if (stateSet)
+        {
+            cv->popStateSet();
+        }
+
+        // 已经添加了压缩后的几何体，原几何体不再绘制
+        return true;
+    }
+
+    void resizeGLObjectBuffers(unsigned int maxSize) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto &item : _ringGeometries)
+        {
+            for (auto &compacted : item.second)
+            {
+                if (compacted)
+                {
+                    compacted->resizeGLObjectBuffers(maxSize);
+                }
+            }
+        }
+    }
+
+    void releaseGLObjects(osg::State *state) const override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto &item : _ringGeometries)
+        {
+            for (auto &compacted : item.second)
+            {
+                if (compacted)
+                {
+                    compacted->releaseGLObjects(state);
+                }
+            }
+        }
+    }
+
+  protected:
+    osg::Geometry *getRingGeometry(osgUtil::CullVisitor *cv, osg::Geometry *geometry) const
+    {
+        unsigned int frameNumber = cv->getFrameStamp() ? cv->getFrameStamp()->getFrameNumber() : 0;
+        const osg::Camera *camera = cv->getCurrentCamera();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto itr = _ringGeometries.find(camera);
+        if (itr == _ringGeometries.end() || !itr->first.valid())
+        {
+            // 移除已销毁的相机，包括地址被当前相机复用的
+            for (auto dead = _ringGeometries.begin(); dead != _ringGeometries.end();)
+            {
+                dead = dead->first.valid() ? std::next(dead) : _ringGeometries.erase(dead);
+            }
+            itr = _ringGeometries.emplace(camera, RingGeometries()).first;
+        }
+
+        osg::ref_ptr<osg::Geometry> &compacted = itr->second[frameNumber % NUM_RING_GEOMETRIES];
+        if (!compacted)
+        {
+            compacted = new osg::Geometry(*geometry, osg::CopyOp::DEEP_COPY_PRIMITIVES);
+            compacted->setCullCallback(nullptr);
+            for (unsigned int row = 0; row < 4; ++row)
+            {
+                compacted->setVertexAttribArray(GeometryInstancer::INSTANCE_MATRIX_ATTRIBUTE_LOCATION + row, nullptr);
+            }
+            assignElementBufferObjects(compacted);
+            compacted->resizeGLObjectBuffers(osg::DisplaySettings::instance()->getMaxNumberOfGraphicsContexts());
+        }
+        return compacted.get();
+    }
+};
+
+/// 着色器能够复现的状态，其他状态会被实例化着色器忽略或覆盖
+bool isReproducible(const osg::StateSet *stateSet)
+{
+    if (!stateSet)
+    {
+        return true;
+    }
+
+    // 着色器程序会覆盖实例化程序，雾、纹理生成、光源、双面光照等着色器不计算
+    for (auto &item : stateSet->getAttributeList())
+    {
+        switch (item.first.first)
+        {
+        case osg::StateAttribute::MATERIAL:
+        case osg::StateAttribute::ALPHAFUNC:
+        case osg::StateAttribute::BLENDFUNC:
+        case osg::StateAttribute::BLENDEQUATION:
+        case osg::StateAttribute::BLENDCOLOR:
+        case osg::StateAttribute::COLORMASK:
+        case osg::StateAttribute::CULLFACE:
+        case osg::StateAttribute::DEPTH:
+        case osg::StateAttribute::FRONTFACE:
+        case osg::StateAttribute::LINESTIPPLE:
+        case osg::StateAttribute::LINEWIDTH:
+        case osg::StateAttribute::LOGICOP:
+        case osg::StateAttribute::POINT:
+        case osg::StateAttribute::POLYGONMODE:
+        case osg::StateAttribute::POLYGONOFFSET:
+        case osg::StateAttribute::STENCIL:
+            break;
+        case osg::StateAttribute::SHADEMODEL:
+            // 着色器的输出总是插值
+            if (static_cast<const osg::ShadeModel *>(item.second.first.get())->getMode() != osg::ShadeModel::SMOOTH)
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    for (auto &item : stateSet->getModeList())
+    {
+        switch (item.first)
+        {
+        case GL_LIGHTING:
+        case GL_LIGHT0:
+        case GL_COLOR_MATERIAL:
+        case GL_NORMALIZE:
+        case GL_RESCALE_NORMAL:
+        case GL_ALPHA_TEST:
+        case GL_BLEND:
+        case GL_CULL_FACE:
+        case GL_DEPTH_TEST:
+        case GL_STENCIL_TEST:
+        case GL_POLYGON_OFFSET_FILL:
+        case GL_POLYGON_OFFSET_LINE:
+        case GL_POLYGON_OFFSET_POINT:
+        case GL_LINE_SMOOTH:
+        case GL_POINT_SMOOTH:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    const osg::StateSet::TextureAttributeList &textureAttributes = stateSet->getTextureAttributeList();
+    for (std::size_t unit = 0; unit < textureAttributes.size(); ++unit)
+    {
+        for (auto &item : textureAttributes[unit])
+        {
+            if (unit > 0)
+            {
+                return false;
+            }
+
+            const osg::StateAttribute *attribute = item.second.first.get();
+            if (item.first.first == osg::StateAttribute::TEXTURE)
+            {
+                if (!dynamic_cast<const osg::Texture2D *>(attribute))
+                {
+                    return false;
+                }
+            }
+            else if (item.first.first == osg::StateAttribute::TEXENV)
+            {
+                if (static_cast<const osg::TexEnv *>(attribute)->getMode() != osg::TexEnv::MODULATE)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+
+    const osg::StateSet::TextureModeList &textureModes = stateSet->getTextureModeList();
+    for (std::size_t unit = 0; unit < textureModes.size(); ++unit)
+    {
+        for (auto &item : textureModes[unit])
+        {
+            if (unit > 0 || item.first != GL_TEXTURE_2D)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// 按osg::State的继承规则取模式：下级覆盖上级，除非上级为OVERRIDE且下级不是PROTECTED
+bool isModeOn(const std::vector<const osg::StateSet *> &stateSets, osg::StateAttribute::GLMode mode, bool texture, bool defaultValue)
+{
+    bool on = defaultValue;
+    bool overridden = false;
+    for (auto stateSet : stateSets)
+    {
+        osg::StateAttribute::GLModeValue value = stateSet ? (texture ? stateSet->getTextureMode(0, mode) : stateSet->getMode(mode)) : osg::StateAttribute::INHERIT;
+        if (value == osg::StateAttribute::INHERIT || (overridden && !(value & osg::StateAttribute::PROTECTED)))
+        {
+            continue;
+        }
+        on = (value & osg::StateAttribute::ON) != 0;
+        overridden = (value & osg::StateAttribute::OVERRIDE) != 0;
+    }
+    return on;
+}
+
+/// 继承规则同isModeOn
+const osg::StateAttribute *getAttribute(const std::vector<const osg::StateSet *> &stateSets, osg::StateAttribute::Type type, bool texture)
+{
+    const osg::StateAttribute *attribute = nullptr;
+    bool overridden = false;
+    for (auto stateSet : stateSets)
+    {
+        const osg::StateSet::RefAttributePair *pair = stateSet ? (texture ? stateSet->getTextureAttributePair(0, type) : stateSet->getAttributePair(type)) : nullptr;
+        if (!pair || (overridden && !(pair->second & osg::StateAttribute::PROTECTED)))
+        {
+            continue;
+        }
+        attribute = pair->first.get();
+        overridden = (pair->second & osg::StateAttribute::OVERRIDE) != 0;
+    }
+    return attribute;
+}
+
+/// 着色器中材质颜色模式的取值，没有材质时为osg::StateSet::setGlobalDefaults设置的AMBIENT_AND_DIFFUSE
+int getColorMode(const osg::Material *material)
+{
+    switch (material ? material->getColorMode() : osg::Material::AMBIENT_AND_DIFFUSE)
+    {
+    case osg::Material::AMBIENT:
+        return 1;
+    case osg::Material::DIFFUSE:
+        return 2;
+    case osg::Material::SPECULAR:
+        return 3;
+    case osg::Material::EMISSION:
+        return 4;
+    case osg::Material::AMBIENT_AND_DIFFUSE:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+/// 判断子节点能否实例化，并取得其中的几何体
+bool getTemplateGeometries(osg::Node *child, osg::StateSet *&stateSet, std::vector<osg::Geometry *> &geometries)
+{
+    auto isInstanceableGeometry = [&stateSet](osg::Geometry *geometry) {
+        if (!geometry || !geometry->getVertexArray() || geometry->getNumPrimitiveSets() == 0)
+        {
+            return false;
+        }
+
+        if (geometry->getUpdateCallback() || geometry->getEventCallback() || geometry->getCullCallback() || geometry->getDrawCallback() || geometry->getComputeBoundingBoxCallback())
+        {
+            return false;
+        }
+
+        // 实例矩阵占用的顶点属性位置不能被使用
+        if (!geometry->getVertexAttribArrayList().empty())
+        {
+            return false;
+        }
+
+        if (!isReproducible(geometry->getStateSet()))
+        {
+            return false;
+        }
+
+        // 着色器只使用0号纹理单元；纹理来自上层节点时无法判断是否启用
+        for (unsigned int unit = 1; unit < geometry->getNumTexCoordArrays(); ++unit)
+        {
+            if (geometry->getTexCoordArray(unit))
+            {
+                return false;
+            }
+        }
+        if (geometry->getTexCoordArray(0) && !getAttribute({stateSet, geometry->getStateSet()}, osg::StateAttribute::TEXTURE, true))
+        {
+            return false;
+        }
+
+        return geometry->getDataVariance() != osg::Object::DYNAMIC;
+    };
+
+    if (child->getUpdateCallback() || child->getEventCallback() || child->getCullCallback() || child->getDataVariance() == osg::Object::DYNAMIC)
+    {
+        return false;
+    }
+
+    if (auto geometry = child->asGeometry())
+    {
+        stateSet = nullptr;
+        geometries.push_back(geometry);
+        return isInstanceableGeometry(geometry);
+    }
+
+    auto geode = child->asGeode();
+    if (!geode || geode->getNumDrawables() == 0)
+    {
+        return false;
+    }
+
+    stateSet = geode->getStateSet();
+    if (!isReproducible(stateSet))
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < geode->getNumDrawables(); ++i)
+    {
+        auto geometry = geode->getDrawable(i)->asGeometry();
+        if (!isInstanceableGeometry(geometry))
+        {
+            return false;
+        }
+        geometries.push_back(geometry);
+    }
+    return true;
+}
+
+bool isInstanceable(osg::MatrixTransform *transform)
+{
+    return transform->getNumChildren() == 1 && transform->getReferenceFrame() == osg::Transform::RELATIVE_RF && transform->getDataVariance() != osg::Object::DYNAMIC && !transform->getStateSet() &&
+           !transform->getUpdateCallback() && !transform->getEventCallback() && !transform->getCullCallback() && transform->getNodeMask() == ~0u;
+}
+
+/// 按实例中心沿最长轴递归二分，使每个分块在空间上尽量紧凑
+void buildClusters(Instances::iterator begin, Instances::iterator end, unsigned int maximumSize, std::vector<Instances> &clusters)
+{
+    auto size = static_cast<unsigned int>(end - begin);
+    if (size <= maximumSize)
+    {
+        clusters.emplace_back(begin, end);
+        return;
+    }
+
+    osg::BoundingBox centers;
+    for (auto itr = begin; itr != end; ++itr)
+    {
+        centers.expandBy(itr->boundingBox.center());
+    }
+
+    int axis = 0;
+    osg::Vec3 extent = centers._max - centers._min;
+    if (extent.y() > extent[axis])
+    {
+        axis = 1;
+    }
+    if (extent.z() > extent[axis])
+    {
+        axis = 2;
+    }
+
+    auto middle = begin + size / 2;
+    std::nth_element(begin, middle, end, [axis](const Instance &lhs, const Instance &rhs) { return lhs.boundingBox.center()[axis] < rhs.boundingBox.center()[axis]; });
+
+    buildClusters(begin, middle, maximumSize, clusters);
+    buildClusters(middle, end, maximumSize, clusters);
+}
+
+/// 收集同一父节点下共享同一子节点的MatrixTransform
+class CollectRepeatedTransformsVisitor : public osg::NodeVisitor
+{
+  public:
+    struct Repeated
+    {
+        osg::ref_ptr<osg::Group> parent;
+        osg::ref_ptr<osg::Node> child;
+        std::vector<osg::ref_ptr<osg::MatrixTransform>> transforms;
+    };
+
+    std::vector<Repeated> _repeated;
+    unsigned int _minimumNumInstances{};
+
+    CollectRepeatedTransformsVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    void apply(osg::Group &group) override
+    {
+        std::map<osg::Node *, std::vector<osg::ref_ptr<osg::MatrixTransform>>> transformsByChild;
+
+        for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+        {
+            auto transform = dynamic_cast<osg::MatrixTransform *>(group.getChild(i));
+            if (transform && isInstanceable(transform))
+            {
+                transformsByChild[transform->getChild(0)].push_back(transform);
+            }
+        }
+
+        for (auto &item : transformsByChild)
+        {
+            if (item.second.size() >= _minimumNumInstances)
+            {
+                _repeated.push_back({&group, item.first, item.second});
+            }
+        }
+
+        traverse(group);
+    }
+};
+
+} // namespace
+
+GeometryInstancer::InstancedGroup::InstancedGroup()
+{
+}
+
+GeometryInstancer::InstancedGroup::InstancedGroup(const InstancedGroup &rhs, const osg::CopyOp &copyop) : osg::Group(rhs, copyop)
+{
+    for (auto &instance : rhs._instances)
+    {
+        _instances.push_back(copyop(instance.get()));
+    }
+}
+
+GeometryInstancer::InstancedGroup::~InstancedGroup()
+{
+}
+
+void GeometryInstancer::InstancedGroup::addInstance(osg::Node *transform)
+{
+    _instances.push_back(transform);
+}
+
+unsigned int GeometryInstancer::InstancedGroup::getNumInstances() const
+{
+    return static_cast<unsigned int>(_instances.size());
+}
+
+void GeometryInstancer::InstancedGroup::traverseInstances(osg::NodeVisitor &nv)
+{
+    for (auto &instance : _instances)
+    {
+        instance->accept(nv);
+    }
+}
+
+void GeometryInstancer::InstancedGroup::traverse(osg::NodeVisitor &nv)
+{
+    if (nv.getVisitorType() == osg::NodeVisitor::INTERSECTION_VISITOR || dynamic_cast<osgUtil::IntersectionVisitor *>(&nv))
+    {
+        traverseInstances(nv);
+        return;
+    }
+
+    osg::Group::traverse(nv);
+}
+
+GeometryInstancer::GeometryInstancer()
+{
+    createInstancingStateSet();
+}
+
+GeometryInstancer::~GeometryInstancer()
+{
+}
+
+void GeometryInstancer::setMinimumNumInstances(unsigned int num)
+{
+    _minimumNumInstances = std::max(2u, num);
+}
+
+unsigned int GeometryInstancer::getMinimumNumInstances() const
+{
+    return _minimumNumInstances;
+}
+
+void GeometryInstancer::setMaximumNumInstancesPerCluster(unsigned int num)
+{
+    _maximumNumInstancesPerCluster = std::max(1u, num);
+}
+
+unsigned int GeometryInstancer::getMaximumNumInstancesPerCluster() const
+{
+    return _maximumNumInstancesPerCluster;
+}
+
+void GeometryInstancer::setCompactionThreshold(float threshold)
+{
+    _compactionThreshold = threshold;
+}
+
+float GeometryInstancer::getCompactionThreshold() const
+{
+    return _compactionThreshold;
+}
+
+void GeometryInstancer::setProgram(osg::Program *program)
+{
+    _program = program;
+    createInstancingStateSet();
+}
+
+osg::Program *GeometryInstancer::getProgram()
+{
+    return _program.get();
+}
+
+GeometryInstancer::Result GeometryInstancer::apply(osg::Node *node)
+{
+    Result result;
+    if (!node)
+    {
+        return result;
+    }
+
+    if (!_instancingStateSet->getAttribute(osg::StateAttribute::PROGRAM))
+    {
+        OSG_INFO << "GeometryInstancer::apply() no instancing program for the GL3/GLES3 shader hint, skipped" << std::endl;
+        return result;
+    }
+
+    CollectRepeatedTransformsVisitor visitor;
+    visitor._minimumNumInstances = _minimumNumInstances;
+    node->accept(visitor);
+
+    // 各几何体的状态按取值共享
+    osg::ref_ptr<osg::Uniform> lightingUniforms[2];
+    osg::ref_ptr<osg::Uniform> colorModeUniforms[6];
+    osg::ref_ptr<osg::Uniform> texturedUniforms[2];
+
+    for (auto &repeated : visitor._repeated)
+    {
+        osg::StateSet *templateStateSet{};
+        std::vector<osg::Geometry *> templateGeometries;
+        if (!getTemplateGeometries(repeated.child, templateStateSet, templateGeometries))
+        {
+            continue;
+        }
+
+        osg::BoundingBox templateBoundingBox;
+        unsigned int numPrimitiveSets{};
+        for (auto geometry : templateGeometries)
+        {
+            templateBoundingBox.expandBy(geometry->getBoundingBox());
+            numPrimitiveSets += geometry->getNumPrimitiveSets();
+        }
+
+        Instances instances;
+        instances.reserve(repeated.transforms.size());
+        for (auto &transform : repeated.transforms)
+        {
+            Instance instance;
+            instance.matrix = transform->getMatrix();
+            for (unsigned int i = 0; i < 8; ++i)
+            {
+                instance.boundingBox.expandBy(templateBoundingBox.corner(i) * instance.matrix);
+            }
+            instances.push_back(instance);
+        }
+
+        std::vector<Instances> clusters;
+        buildClusters(instances.begin(), instances.end(), _maximumNumInstancesPerCluster, clusters);
+
+        osg::ref_ptr<InstancedGroup> instancedGroup = new InstancedGroup;
+        instancedGroup->setName(repeated.child->getName());
+        instancedGroup->setStateSet(_instancingStateSet);
+
+        osg::ref_ptr<osg::Geode> instancedGeode = new osg::Geode;
+        instancedGeode->setStateSet(templateStateSet);
+        instancedGroup->addChild(instancedGeode);
+
+        for (auto &cluster : clusters)
+        {
+            osg::BoundingBox clusterBoundingBox;
+            std::vector<osg::Matrixf> matrices;
+            matrices.reserve(cluster.size());
+            for (auto &instance : cluster)
+            {
+                clusterBoundingBox.expandBy(instance.boundingBox);
+                matrices.push_back(instance.matrix);
+            }
+
+            for (auto templateGeometry : templateGeometries)
+            {
+                // 共享顶点数据，复制图元以设置实例数量
+                osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry(*templateGeometry, osg::CopyOp::DEEP_COPY_PRIMITIVES);
+                geometry->setUseDisplayList(false);
+                geometry->setUseVertexBufferObjects(true);
+                assignElementBufferObjects(geometry);
+                setInstanceMatrices(geometry, matrices);
+
+                geometry->setComputeBoundingBoxCallback(new InstancesBoundingBoxCallback(clusterBoundingBox));
+                geometry->dirtyBound();
+
+                if (_compactionThreshold > 0.f)
+                {
+                    geometry->setCullCallback(new InstanceCullCallback(cluster, _compactionThreshold));
+                }
+
+                // 固定管线由模式和材质决定的部分通过uniform告诉着色器，材质本身仍由原状态集设置
+                std::vector<const osg::StateSet *> stateSets{templateStateSet, templateGeometry->getStateSet()};
+                bool lighting = isModeOn(stateSets, GL_LIGHTING, false, true);
+                int colorMode = getColorMode(static_cast<const osg::Material *>(getAttribute(stateSets, osg::StateAttribute::MATERIAL, false)));
+                bool textured = isModeOn(stateSets, GL_TEXTURE_2D, true, false) && getAttribute(stateSets, osg::StateAttribute::TEXTURE, true);
+
+                osg::ref_ptr<osg::Uniform> &lightingUniform = lightingUniforms[lighting];
+                if (!lightingUniform)
+                {
+                    lightingUniform = new osg::Uniform("opeViewer_Lighting", lighting);
+                }
+                osg::ref_ptr<osg::Uniform> &colorModeUniform = colorModeUniforms[colorMode];
+                if (!colorModeUniform)
+                {
+                    colorModeUniform = new osg::Uniform("opeViewer_ColorMode", colorMode);
+                }
+                osg::ref_ptr<osg::Uniform> &texturedUniform = texturedUniforms[textured];
+                if (!texturedUniform)
+                {
+                    texturedUniform = new osg::Uniform("opeViewer_Textured", textured);
+                }
+
+                osg::ref_ptr<osg::StateSet> stateSet = geometry->getStateSet() ? new osg::StateSet(*geometry->getStateSet(), osg::CopyOp::SHALLOW_COPY) : new osg::StateSet;
+                stateSet->addUniform(lightingUniform);
+                stateSet->addUniform(colorModeUniform);
+                stateSet->addUniform(texturedUniform);
+                geometry->setStateSet(stateSet);
+
+                instancedGeode->addDrawable(geometry);
+                ++result.instancedDrawables;
+            }
+        }
+
+        // 原来的MatrixTransform留作求交使用
+        for (auto &transform : repeated.transforms)
+        {
+            instancedGroup->addInstance(transform);
+            repeated.parent->removeChild(transform);
+        }
+        repeated.parent->addChild(instancedGroup);
+
+        ++result.groups;
+        result.instances += static_cast<unsigned int>(repeated.transforms.size());
+        result.drawCallsSaved += static_cast<unsigned int>(repeated.transforms.size() - clusters.size()) * numPrimitiveSets;
+    }
+
+    return result;
+}
+
+void GeometryInstancer::createInstancingStateSet()
+{
+    _instancingStateSet = new osg::StateSet;
+
+    osg::ref_ptr<osg::Program> program = _program;
+    if (!program)
+    {
+        // GL3和GLES3的绘制依赖应用的着色器，没有可以复现的固定管线状态
+        osg::DisplaySettings::ShaderHint shaderHint = osg::DisplaySettings::instance()->getShaderHint();
+        if (shaderHint == osg::DisplaySettings::SHADER_GL3 || shaderHint == osg::DisplaySettings::SHADER_GLES3)
+        {
+            return;
+        }
+
+        program = new osg::Program;
+        program->setName("Instancing");
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl2_InstancingVertexShader));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl2_InstancingFragmentShader));
+    }
+    program->addBindAttribLocation("opeViewer_InstanceMatrix", INSTANCE_MATRIX_ATTRIBUTE_LOCATION);
+
+    _instancingStateSet->setAttributeAndModes(program);
+    _instancingStateSet->addUniform(new osg::Uniform("opeViewer_Lighting", true));
+    _instancingStateSet->addUniform(new osg::Uniform("opeViewer_ColorMode", getColorMode(nullptr)));
+    _instancingStateSet->addUniform(new osg::Uniform("opeViewer_Textured", false));
+    _instancingStateSet->addUniform(new osg::Uniform("opeViewer_Texture", 0));
+
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        _instancingStateSet->setAttribute(new osg::VertexAttribDivisor(INSTANCE_MATRIX_ATTRIBUTE_LOCATION + row, 1));
+    }
+}
+
+} // namespace opeViewer
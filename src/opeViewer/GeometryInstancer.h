@@ -0,0 +1,123 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_D1C8885A5D4D4640A70D54E5CE253F3D_H_
+#define INC_2026_10_18_D1C8885A5D4D4640A70D54E5CE253F3D_H_
+
+#include <osg/Group>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+namespace osg
+{
+class Node;
+class Program;
+class StateSet;
+} // namespace osg
+
+namespace opeViewer
+{
+
+/// 自动实例化
+///
+/// 查找同一父节点下共享同一子节点的静态MatrixTransform，替换为按空间分块的实例化绘制，实例矩阵通过顶点属性传入着色器
+///
+/// 每个分块在裁剪时逐实例进行视锥裁剪，可见比例较低时绘制压缩后的实例列表
+///
+/// 只实例化着色器能够复现的子图：子图自身的状态集中只能有材质、0号纹理单元的二维纹理（TexEnv为MODULATE）和不参与着色的状态（混合、深度、面剔除等），
+/// 不能有其他纹理单元、着色器程序、雾、纹理生成、光源等。着色器按固定管线的公式计算GL_LIGHT0的逐顶点光照，
+/// 子图没有设置GL_LIGHTING和材质时按osg::View的默认状态（开启光照，材质颜色模式为AMBIENT_AND_DIFFUSE）处理
+///
+/// GL3和GLES3没有固定管线状态可供复现，只有通过setProgram提供着色器程序时才实例化
+///
+/// 原来的MatrixTransform保留在InstancedGroup中，求交和框选遍历它们，拾取结果与实例化之前相同
+class GeometryInstancer : public osg::Referenced
+{
+  public:
+    /// 替换重复子图的节点
+    ///
+    /// 裁剪等遍历绘制实例化几何体，osgUtil::IntersectionVisitor和类型为INTERSECTION_VISITOR的遍历改为遍历原来的MatrixTransform
+    class InstancedGroup : public osg::Group
+    {
+      public:
+        InstancedGroup();
+
+        InstancedGroup(const InstancedGroup &rhs, const osg::CopyOp &copyop = osg::CopyOp::SHALLOW_COPY);
+
+        META_Node(opeViewer, InstancedGroup);
+
+        /// 被替换的MatrixTransform，不是子节点
+        void addInstance(osg::Node *transform);
+
+        unsigned int getNumInstances() const;
+
+        /// 依次遍历被替换的MatrixTransform，节点路径中它们直接位于本节点之下
+        void traverseInstances(osg::NodeVisitor &nv);
+
+        void traverse(osg::NodeVisitor &nv) override;
+
+      protected:
+        ~InstancedGroup() override;
+
+        osg::NodeList _instances;
+    };
+
+    struct Result
+    {
+        /// 被替换的MatrixTransform组数
+        unsigned int groups{};
+        /// 被替换的MatrixTransform数量
+        unsigned int instances{};
+        /// 生成的实例化几何体数量
+        unsigned int instancedDrawables{};
+        /// 节省的绘制调用
+        unsigned int drawCallsSaved{};
+    };
+
+    /// 实例矩阵使用的顶点属性位置，占用连续4个位置
+    static const unsigned int INSTANCE_MATRIX_ATTRIBUTE_LOCATION = 12;
+
+    GeometryInstancer();
+
+    /// 少于该数量的重复子图不实例化
+    void setMinimumNumInstances(unsigned int num);
+
+    unsigned int getMinimumNumInstances() const;
+
+    /// 每个分块的最大实例数量
+    void setMaximumNumInstancesPerCluster(unsigned int num);
+
+    unsigned int getMaximumNumInstancesPerCluster() const;
+
+    /// 可见实例比例低于该值时绘制压缩后的实例列表，0表示不进行逐实例裁剪
+    void setCompactionThreshold(float threshold);
+
+    float getCompactionThreshold() const;
+
+    /// 实例化使用的着色器程序，为空时使用内置的GL2着色器（GL3和GLES3下不实例化）
+    ///
+    /// 程序需要将属性opeViewer_InstanceMatrix作用于顶点，法线使用其逆转置；可以使用opeViewer_Lighting、opeViewer_ColorMode、opeViewer_Textured和opeViewer_Texture，含义见内置着色器
+    void setProgram(osg::Program *program);
+
+    osg::Program *getProgram();
+
+    /// 节点不能正在被其他线程使用，不同的节点可以在多个线程中同时处理
+    Result apply(osg::Node *node);
+
+  protected:
+    ~GeometryInstancer() override;
+
+    void createInstancingStateSet();
+
+    unsigned int _minimumNumInstances{8};
+    unsigned int _maximumNumInstancesPerCluster{256};
+    float _compactionThreshold{0.75f};
+
+    osg::ref_ptr<osg::Program> _program;
+    osg::ref_ptr<osg::StateSet> _instancingStateSet;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_D1C8885A5D4D4640A70D54E5CE253F3D_H_
@@ -0,0 +1,177 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "Histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 每个2的幂区间的桶数为SUB_BUCKET_COUNT / 2
+const unsigned int SUB_BUCKET_BITS = 8;
+const uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+const uint64_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT / 2;
+
+const uint64_t MAX_UNITS = (uint64_t(1) << 32) - 1;
+const unsigned int MAX_SHIFT = 32 - SUB_BUCKET_BITS;
+const unsigned int NUM_BUCKETS = static_cast<unsigned int>(SUB_BUCKET_COUNT + MAX_SHIFT * SUB_BUCKET_HALF_COUNT);
+
+/// 秒到微秒
+const double UNITS_PER_SECOND = 1e6;
+
+} // namespace
+
+Histogram::Histogram() : _counts(NUM_BUCKETS)
+{
+}
+
+void Histogram::record(double value)
+{
+    if (!(value >= 0.0))
+    {
+        value = 0.0;
+    }
+
+    uint64_t units = static_cast<uint64_t>(std::min(value * UNITS_PER_SECOND + 0.5, double(MAX_UNITS)));
+    ++_counts[getBucketIndex(units)];
+
+    _min = _totalCount ? std::min(_min, value) : value;
+    _max = _totalCount ? std::max(_max, value) : value;
+    _sum += value;
+    ++_totalCount;
+}
+
+void Histogram::add(const Histogram &other)
+{
+    if (!other._totalCount)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+    {
+        _counts[i] += other._counts[i];
+    }
+
+    _min = _totalCount ? std::min(_min, other._min) : other._min;
+    _max = _totalCount ? std::max(_max, other._max) : other._max;
+    _sum += other._sum;
+    _totalCount += other._totalCount;
+}
+
+void Histogram::reset()
+{
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _totalCount = 0;
+    _min = 0.0;
+    _max = 0.0;
+    _sum = 0.0;
+}
+
+uint64_t Histogram::getTotalCount() const
+{
+    return _totalCount;
+}
+
+double Histogram::getMin() const
+{
+    return _min;
+}
+
+double Histogram::getMax() const
+{
+    return _max;
+}
+
+double Histogram::getMean() const
+{
+    return _totalCount ? _sum / double(_totalCount) : 0.0;
+}
+
+double Histogram::getValueAtPercentile(double percentile) const
+{
+    if (!_totalCount)
+    {
+        return 0.0;
+    }
+
+    double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+    uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * double(_totalCount))), 1);
+
+    uint64_t count = 0;
+    for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+    {
+        count += _counts[i];
+        if (count >= target)
+        {
+            return std::min(double(getBucketUpperBound(i)) / UNITS_PER_SECOND, _max);
+        }
+    }
+    return _max;
+}
+
+unsigned int Histogram::getBucketIndex(uint64_t units)
+{
+    if (units < SUB_BUCKET_COUNT)
+    {
+        return static_cast<unsigned int>(units);
+    }
+
+    // 右移到[SUB_BUCKET_HALF_COUNT, SUB_BUCKET_COUNT)
+    unsigned int shift = 1;
+    while ((units >> shift) >= SUB_BUCKET_COUNT)
+    {
+        ++shift;
+    }
+    return static_cast<unsigned int>(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF_COUNT + ((units >> shift) - SUB_BUCKET_HALF_COUNT));
+}
+
+uint64_t Histogram::getBucketUpperBound(unsigned int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    unsigned int offset = static_cast<unsigned int>(index - SUB_BUCKET_COUNT);
+    unsigned int shift = static_cast<unsigned int>(offset / SUB_BUCKET_HALF_COUNT) + 1;
+    uint64_t subBucket = offset % SUB_BUCKET_HALF_COUNT + SUB_BUCKET_HALF_COUNT;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+const char *FrameTimeHistograms::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case FRAME:
+        return "Frame";
+    case EVENT:
+        return "Event";
+    case UPDATE:
+        return "Update";
+    case CULL:
+        return "Cull";
+    case DRAW:
+        return "Draw";
+    case GPU:
+        return "GPU";
+    default:
+        return "";
+    }
+}
+
+void FrameTimeHistograms::reset()
+{
+    for (Histogram &histogram : histograms)
+    {
+        histogram.reset();
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,93 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_D3765BA8F9724FBA962A4103BCF7993E_H_
+#define INC_2026_10_18_D3765BA8F9724FBA962A4103BCF7993E_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace opeViewer
+{
+
+/// 高动态范围直方图
+///
+/// 以1微秒为单位记录0到约71分钟的时间（秒），更长的按最大值记录；小于256微秒的每微秒一个桶，之后每个2的幂区间分为128个桶，相对误差不超过1/128
+///
+/// 桶在构造时分配（约26KB），记录和查询不分配内存，可以在生产环境中一直开启；不是线程安全的
+class Histogram
+{
+  public:
+    Histogram();
+
+    void record(double value);
+
+    /// 合并另一个直方图的记录
+    void add(const Histogram &other);
+
+    void reset();
+
+    uint64_t getTotalCount() const;
+
+    double getMin() const;
+
+    double getMax() const;
+
+    double getMean() const;
+
+    /// percentile为0到100，返回值不小于该百分位的实际值，不大于最大值，没有记录时返回0
+    double getValueAtPercentile(double percentile) const;
+
+  protected:
+    static unsigned int getBucketIndex(uint64_t units);
+
+    /// 桶中的最大值（微秒）
+    static uint64_t getBucketUpperBound(unsigned int index);
+
+    std::vector<uint64_t> _counts;
+    uint64_t _totalCount{};
+    double _min{};
+    double _max{};
+    double _sum{};
+};
+
+/// 帧的各阶段耗时的分布
+///
+/// Window记录FRAME、EVENT和UPDATE，每个Renderer记录自己相机的CULL、DRAW和GPU，见Window::getFrameTimeHistograms
+struct FrameTimeHistograms
+{
+    enum Stage
+    {
+        /// Window::frame，从更新遍历开始到渲染遍历结束（包含交换缓冲）
+        FRAME,
+        /// 两帧之间所有事件的处理时间之和
+        EVENT,
+        UPDATE,
+        CULL,
+        DRAW,
+        /// 需要计时查询，结果晚几帧得到，相机的Stats收集"gpu"时才记录
+        GPU,
+        NUM_STAGES,
+    };
+
+    Histogram histograms[NUM_STAGES];
+
+    static const char *getStageName(Stage stage);
+
+    Histogram &operator[](Stage stage)
+    {
+        return histograms[stage];
+    }
+
+    const Histogram &operator[](Stage stage) const
+    {
+        return histograms[stage];
+    }
+
+    void reset();
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_D3765BA8F9724FBA962A4103BCF7993E_H_
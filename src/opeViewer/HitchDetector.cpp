@@ -0,0 +1,326 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "HitchDetector.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <osg/FrameStamp>
+#include <osg/Notify>
+#include <osg/Stats>
+#include <osgUtil/IncrementalCompileOperation>
+
+#include "DatabasePager.h"
+#include "Scene.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "Viewport.h"
+#include "Window.h"
+
+namespace opeViewer
+{
+
+namespace
+{
+
+void reportStats(std::ostream &out, osg::Stats *stats, unsigned int frameNumber)
+{
+    if (stats && frameNumber >= stats->getEarliestFrameNumber() && frameNumber <= stats->getLatestFrameNumber())
+    {
+        stats->report(out, frameNumber, "    ");
+    }
+}
+
+} // namespace
+
+HitchDetector::HitchDetector(const std::string &logFile) : _logFile(logFile)
+{
+}
+
+HitchDetector::~HitchDetector()
+{
+    flush();
+}
+
+const std::string &HitchDetector::getLogFile() const
+{
+    return _logFile;
+}
+
+void HitchDetector::setThreshold(double threshold)
+{
+    _threshold = threshold;
+}
+
+double HitchDetector::getThreshold() const
+{
+    return _threshold;
+}
+
+void HitchDetector::setMedianMultiplier(double multiplier)
+{
+    _medianMultiplier = multiplier;
+}
+
+double HitchDetector::getMedianMultiplier() const
+{
+    return _medianMultiplier;
+}
+
+void HitchDetector::setMedianWindowSize(unsigned int size)
+{
+    _medianWindowSize = std::max(size, 1u);
+    _recentFrameTimes.clear();
+    _nextRecentFrameTime = 0;
+}
+
+unsigned int HitchDetector::getMedianWindowSize() const
+{
+    return _medianWindowSize;
+}
+
+void HitchDetector::setMaximumLogFileSize(uint64_t size)
+{
+    _maximumLogFileSize = size;
+}
+
+uint64_t HitchDetector::getMaximumLogFileSize() const
+{
+    return _maximumLogFileSize;
+}
+
+void HitchDetector::setMaximumNumLogFiles(unsigned int num)
+{
+    _maximumNumLogFiles = num;
+}
+
+unsigned int HitchDetector::getMaximumNumLogFiles() const
+{
+    return _maximumNumLogFiles;
+}
+
+unsigned int HitchDetector::getNumHitches() const
+{
+    return _numHitches;
+}
+
+unsigned int HitchDetector::getNumDroppedSnapshots() const
+{
+    return _numDroppedSnapshots;
+}
+
+void HitchDetector::attach(Window *window)
+{
+    osg::Stats *stats = window->getStats();
+    enableStats(stats, "frame_rate");
+    enableStats(stats, "event");
+    enableStats(stats, "update");
+
+    for (auto viewport : window->getViewports())
+    {
+        enableStats(viewport->getCamera()->getStats(), "rendering");
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+        {
+            enableStats(viewport->getSlave(i)._camera->getStats(), "rendering");
+        }
+    }
+}
+
+void HitchDetector::detach(Window *window)
+{
+    for (auto &enabled : _enabledStats)
+    {
+        osg::ref_ptr<osg::Stats> stats;
+        if (enabled.first.lock(stats))
+        {
+            Stats::setCollectStats(stats, enabled.second, false);
+        }
+    }
+    _enabledStats.clear();
+}
+
+void HitchDetector::flush()
+{
+    if (_writeThreadPool)
+    {
+        _writeThreadPool->wait();
+    }
+}
+
+void HitchDetector::check(Window *window)
+{
+    double frameTimeTaken = window->getFrameTimeTaken();
+    double median = computeMedian();
+    recordFrameTime(frameTimeTaken);
+
+    bool overThreshold = _threshold > 0.0 && frameTimeTaken > _threshold;
+    bool overMedian = _medianMultiplier > 0.0 && median > 0.0 && frameTimeTaken > median * _medianMultiplier;
+    if (overThreshold || overMedian)
+    {
+        ++_numHitches;
+
+        OSG_INFO << "HitchDetector::check() Frame " << window->getFrameStamp()->getFrameNumber() << " took " << frameTimeTaken * 1000.0 << " ms" << std::endl;
+
+        if (_numPendingSnapshots >= MAXIMUM_NUM_PENDING_SNAPSHOTS)
+        {
+            ++_numDroppedSnapshots;
+            return;
+        }
+
+        // 只在帧线程中读取Stats，文件操作交给后台线程
+        std::ostringstream out;
+        writeSnapshot(out, window, frameTimeTaken, median);
+
+        if (!_writeThreadPool)
+        {
+            _writeThreadPool = new ThreadPool(1);
+        }
+
+        ++_numPendingSnapshots;
+        _writeThreadPool->add([this, snapshot = out.str(), logFile = _logFile, maximumLogFileSize = _maximumLogFileSize, maximumNumLogFiles = _maximumNumLogFiles] {
+            rotateLogFiles(logFile, maximumLogFileSize, maximumNumLogFiles);
+            std::ofstream file(logFile, std::ios::out | std::ios::app);
+            if (file)
+            {
+                file << snapshot;
+            }
+            else
+            {
+                OSG_WARN << "HitchDetector::check() Failed to open " << logFile << std::endl;
+            }
+            --_numPendingSnapshots;
+        });
+    }
+}
+
+void HitchDetector::enableStats(osg::Stats *stats, const char *name)
+{
+    if (stats && !stats->collectStats(name))
+    {
+        Stats::setCollectStats(stats, name, true);
+        _enabledStats.emplace_back(stats, name);
+    }
+}
+
+double HitchDetector::computeMedian()
+{
+    if (_recentFrameTimes.size() < std::max(_medianWindowSize / 2, 1u))
+    {
+        return 0.0;
+    }
+
+    _sortedFrameTimes.assign(_recentFrameTimes.begin(), _recentFrameTimes.end());
+    auto middle = _sortedFrameTimes.begin() + _sortedFrameTimes.size() / 2;
+    std::nth_element(_sortedFrameTimes.begin(), middle, _sortedFrameTimes.end());
+    return *middle;
+}
+
+void HitchDetector::recordFrameTime(double frameTimeTaken)
+{
+    if (_recentFrameTimes.size() < _medianWindowSize)
+    {
+        _recentFrameTimes.push_back(frameTimeTaken);
+    }
+    else
+    {
+        _recentFrameTimes[_nextRecentFrameTime] = frameTimeTaken;
+        _nextRecentFrameTime = (_nextRecentFrameTime + 1) % _medianWindowSize;
+    }
+}
+
+void HitchDetector::writeSnapshot(std::ostream &out, Window *window, double frameTimeTaken, double median)
+{
+    unsigned int frameNumber = window->getFrameStamp()->getFrameNumber();
+
+    out << std::fixed << std::setprecision(3);
+    out << "Hitch at frame " << frameNumber << ", reference time " << window->getFrameStamp()->getReferenceTime() << " s" << std::endl;
+    out << "  Frame time taken " << frameTimeTaken * 1000.0 << " ms, median " << median * 1000.0 << " ms, threshold " << _threshold * 1000.0 << " ms" << std::endl;
+
+    out << "  Window" << std::endl;
+    reportStats(out, window->getStats(), frameNumber);
+    out << "    Pending update operations " << window->getNumPendingUpdateOperations() << std::endl;
+
+    osgUtil::IncrementalCompileOperation *ico = window->getIncrementalCompileOperation();
+    if (ico)
+    {
+        size_t numToCompile{}, numCompiled{};
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(*ico->getToCompiledMutex());
+            numToCompile = ico->getToCompile().size();
+        }
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(*ico->getCompiledMutex());
+            numCompiled = ico->getCompiled().size();
+        }
+        out << "    Incremental compile sets to compile " << numToCompile << ", compiled " << numCompiled << std::endl;
+    }
+
+    unsigned int cameraNumber = 0;
+    for (auto viewport : window->getViewports())
+    {
+        std::vector<osg::Camera *> cameras{viewport->getCamera()};
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+        {
+            cameras.push_back(viewport->getSlave(i)._camera.get());
+        }
+
+        for (auto camera : cameras)
+        {
+            out << "  Camera #" << cameraNumber++ << " " << camera->getName() << std::endl;
+            reportStats(out, camera->getStats(), frameNumber);
+        }
+    }
+
+    unsigned int sceneNumber = 0;
+    for (auto scene : window->getScenes())
+    {
+        out << "  Scene #" << sceneNumber++ << " " << scene->getName() << std::endl;
+        reportStats(out, scene->getStats(), frameNumber);
+
+        osgDB::DatabasePager *dp = scene->getDatabasePager();
+        if (dp)
+        {
+            out << "    Database pager file requests " << dp->getFileRequestListSize() << ", in progress " << dp->getRequestsInProgress() << ", to compile " << dp->getDataToCompileListSize() << ", to merge "
+                << dp->getDataToMergeListSize();
+            if (auto pager = dynamic_cast<DatabasePager *>(dp))
+            {
+                out << ", merge backlog " << pager->getMergeBacklogSize();
+            }
+            out << std::endl;
+        }
+    }
+
+    out << std::endl;
+}
+
+void HitchDetector::rotateLogFiles(const std::string &logFile, uint64_t maximumLogFileSize, unsigned int maximumNumLogFiles)
+{
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(logFile, ec);
+    if (ec || size < maximumLogFileSize)
+    {
+        return;
+    }
+
+    auto rotatedFile = [&logFile](unsigned int i) { return logFile + '.' + std::to_string(i); };
+
+    if (maximumNumLogFiles == 0)
+    {
+        std::filesystem::remove(logFile, ec);
+        return;
+    }
+
+    std::filesystem::remove(rotatedFile(maximumNumLogFiles), ec);
+    for (unsigned int i = maximumNumLogFiles - 1; i > 0; --i)
+    {
+        std::filesystem::rename(rotatedFile(i), rotatedFile(i + 1), ec);
+    }
+    std::filesystem::rename(logFile, rotatedFile(1), ec);
+}
+
+} // namespace opeViewer
@@ -0,0 +1,128 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_987C9061F24244B8A2EF1B804BF073EB_H_
+#define INC_2026_10_18_987C9061F24244B8A2EF1B804BF073EB_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <osg/Stats>
+#include <osg/observer_ptr>
+
+namespace opeViewer
+{
+
+class ThreadPool;
+class Window;
+
+/// 卡顿检测
+///
+/// 由Window::advance在每帧结束时调用，frame()的耗时超过阈值或最近若干帧中位数的倍数时，将该帧的现场写入日志：
+/// 窗口、各相机和各场景在该帧的Stats，分页器和增量编译的队列长度，以及待执行的更新操作数量
+///
+/// 设置到窗口时打开窗口的"frame_rate"、"event"、"update"和各相机的"rendering"收集，移除时恢复由它打开的收集；之后新增的视口需要重新设置，
+/// 期间其他处理器（如StatsHandler）关闭的收集不再打开
+///
+/// 现场在帧线程中格式化，文件的写入和轮转在后台线程中进行，来不及写入的现场丢弃
+///
+/// 日志超过最大大小时轮转：log -> log.1 -> log.2 ...，最旧的删除
+class HitchDetector : public osg::Referenced
+{
+  public:
+    explicit HitchDetector(const std::string &logFile);
+
+    const std::string &getLogFile() const;
+
+    /// frame()耗时的阈值（秒），0表示不使用
+    void setThreshold(double threshold);
+
+    double getThreshold() const;
+
+    /// 超过中位数的该倍数时触发，0表示不使用
+    void setMedianMultiplier(double multiplier);
+
+    double getMedianMultiplier() const;
+
+    /// 计算中位数的帧数，记录不足一半时不与中位数比较
+    void setMedianWindowSize(unsigned int size);
+
+    unsigned int getMedianWindowSize() const;
+
+    /// 单个日志文件的最大大小（字节）
+    void setMaximumLogFileSize(uint64_t size);
+
+    uint64_t getMaximumLogFileSize() const;
+
+    /// 轮转保留的旧日志数量
+    void setMaximumNumLogFiles(unsigned int num);
+
+    unsigned int getMaximumNumLogFiles() const;
+
+    /// 已检测到的卡顿次数
+    unsigned int getNumHitches() const;
+
+    /// 等待写入的现场过多而丢弃的次数
+    unsigned int getNumDroppedSnapshots() const;
+
+    /// 由Window::setHitchDetector调用，打开需要的Stats收集
+    virtual void attach(Window *window);
+
+    /// 由Window::setHitchDetector调用，恢复attach打开的收集
+    virtual void detach(Window *window);
+
+    /// 检查刚结束的一帧，在帧号递增前调用
+    virtual void check(Window *window);
+
+    /// 等待后台线程写完已检测到的现场
+    void flush();
+
+    /// 等待写入的现场的最大数量
+    static const unsigned int MAXIMUM_NUM_PENDING_SNAPSHOTS = 16;
+
+  protected:
+    ~HitchDetector() override;
+
+    /// 打开一个Stats收集，原来没有打开时记录下来，detach时关闭
+    void enableStats(osg::Stats *stats, const char *name);
+
+    /// 最近的帧的中位数，记录不足时返回0
+    double computeMedian();
+
+    void recordFrameTime(double frameTimeTaken);
+
+    virtual void writeSnapshot(std::ostream &out, Window *window, double frameTimeTaken, double median);
+
+    static void rotateLogFiles(const std::string &logFile, uint64_t maximumLogFileSize, unsigned int maximumNumLogFiles);
+
+    std::string _logFile;
+    double _threshold{0.05};
+    double _medianMultiplier{3.0};
+    unsigned int _medianWindowSize{120};
+    uint64_t _maximumLogFileSize{4 * 1024 * 1024};
+    unsigned int _maximumNumLogFiles{3};
+
+    unsigned int _numHitches{};
+
+    /// attach打开的收集
+    std::vector<std::pair<osg::observer_ptr<osg::Stats>, const char *>> _enabledStats;
+
+    /// 单个线程，保证现场按顺序写入
+    osg::ref_ptr<ThreadPool> _writeThreadPool;
+    std::atomic<unsigned int> _numPendingSnapshots{};
+    unsigned int _numDroppedSnapshots{};
+
+    /// 最近的帧的耗时，环形缓冲
+    std::vector<double> _recentFrameTimes;
+    unsigned int _nextRecentFrameTime{};
+    /// 计算中位数用，各帧复用
+    std::vector<double> _sortedFrameTimes;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_987C9061F24244B8A2EF1B804BF073EB_H_
@@ -0,0 +1,32 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "Instrumentation.h"
+
+namespace opeViewer
+{
+
+#if OPEVIEWER_INSTRUMENTATION
+std::atomic<Instrumentation::Level> Instrumentation::_level{Instrumentation::BASIC};
+#endif
+
+void Instrumentation::setLevel(Level level)
+{
+#if OPEVIEWER_INSTRUMENTATION
+    _level.store(level, std::memory_order_relaxed);
+#else
+    (void)level;
+#endif
+}
+
+Instrumentation::Level Instrumentation::getLevel()
+{
+#if OPEVIEWER_INSTRUMENTATION
+    return _level.load(std::memory_order_relaxed);
+#else
+    return OFF;
+#endif
+}
+
+} // namespace opeViewer
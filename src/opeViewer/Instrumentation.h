@@ -0,0 +1,82 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_F2E662CAE78D44E18534DE303AB4E8CB_H_
+#define INC_2026_10_18_F2E662CAE78D44E18534DE303AB4E8CB_H_
+
+#include <atomic>
+
+#include <osg/Timer>
+
+#include "Stats.h"
+
+/// 为0时编译去除所有统计和性能分析代码，由CMake选项OPEVIEWER_INSTRUMENTATION定义
+#ifndef OPEVIEWER_INSTRUMENTATION
+#define OPEVIEWER_INSTRUMENTATION 1
+#endif
+
+namespace opeViewer
+{
+
+/// 统计和性能分析的开关
+///
+/// 热路径先检查级别，级别不够时不查询osg::Stats的统计键、不读取时间；编译去除时isEnabled为常量false，相关代码被编译器删除
+///
+/// 统计键仍用于选择StatsHandler显示的统计，缓存为Stats的位标志，只在级别满足后测试
+class Instrumentation
+{
+  public:
+    enum Level
+    {
+        /// 不收集
+        OFF,
+        /// 各阶段时间、帧率、帧时间分布、GPU时间，卡顿检测和统计导出需要该级别
+        BASIC,
+        /// 另外收集场景、显存、分页、拾取缓存统计和子图性能分析
+        FULL,
+    };
+
+    static constexpr bool isCompiledIn()
+    {
+        return OPEVIEWER_INSTRUMENTATION != 0;
+    }
+
+    /// 默认为BASIC，是否收集仍由各统计键决定；StatsHandler显示需要FULL的统计时临时提高
+    static void setLevel(Level level);
+
+    static Level getLevel();
+
+    static bool isEnabled(Level level)
+    {
+#if OPEVIEWER_INSTRUMENTATION
+        return level != OFF && level <= _level.load(std::memory_order_relaxed);
+#else
+        (void)level;
+        return false;
+#endif
+    }
+
+    /// 级别不满足时返回0，不读取时间
+    static osg::Timer_t tick(Level level)
+    {
+        return isEnabled(level) ? osg::Timer::instance()->tick() : 0;
+    }
+
+  private:
+#if OPEVIEWER_INSTRUMENTATION
+    static std::atomic<Level> _level;
+#endif
+};
+
+} // namespace opeViewer
+
+/// 级别满足时为true，如 if (OPEVIEWER_INSTRUMENTED(BASIC))
+#define OPEVIEWER_INSTRUMENTED(LEVEL) (::opeViewer::Instrumentation::isCompiledIn() && ::opeViewer::Instrumentation::isEnabled(::opeViewer::Instrumentation::LEVEL))
+
+/// 级别满足且stats收集KEY（Stats::Key）时为true，如 if (OPEVIEWER_COLLECT_STATS(_stats, BASIC, UPDATE))
+///
+/// stats为opeViewer::Stats时只测试位标志；为osg::Stats*时查询一次类型，其他osg::Stats逐个查询统计键
+#define OPEVIEWER_COLLECT_STATS(STATS, LEVEL, KEY) (OPEVIEWER_INSTRUMENTED(LEVEL) && ::opeViewer::Stats::isCollected(STATS, ::opeViewer::Stats::KEY))
+
+#endif // INC_2026_10_18_F2E662CAE78D44E18534DE303AB4E8CB_H_
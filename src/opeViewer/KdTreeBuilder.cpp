@@ -0,0 +1,60 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "KdTreeBuilder.h"
+
+#include <osg/Geometry>
+#include <osg/Timer>
+
+namespace opeViewer
+{
+
+KdTreeBuilder::KdTreeBuilder() : _statistics(new Statistics)
+{
+}
+
+KdTreeBuilder::KdTreeBuilder(const KdTreeBuilder &rhs) : osg::KdTreeBuilder(rhs), _statistics(rhs._statistics)
+{
+}
+
+osg::KdTreeBuilder *KdTreeBuilder::clone()
+{
+    return new KdTreeBuilder(*this);
+}
+
+void KdTreeBuilder::apply(osg::Geometry &geometry)
+{
+    // 已经构建过
+    if (dynamic_cast<osg::KdTree *>(geometry.getShape()))
+    {
+        return;
+    }
+
+    osg::ElapsedTime elapsedTime;
+
+    osg::KdTreeBuilder::apply(geometry);
+
+    auto kdTree = dynamic_cast<osg::KdTree *>(geometry.getShape());
+    if (!kdTree)
+    {
+        return;
+    }
+
+    ++_statistics->numKdTrees;
+    _statistics->numPrimitives += kdTree->getPrimitiveIndices().size();
+    _statistics->memory += kdTree->getNodes().size() * sizeof(osg::KdTree::KdNode) + (kdTree->getVertexIndices().size() + kdTree->getPrimitiveIndices().size()) * sizeof(unsigned int);
+    _statistics->buildTime += static_cast<std::uint64_t>(elapsedTime.elapsedTime_u());
+}
+
+KdTreeBuilder::Statistics *KdTreeBuilder::getStatistics()
+{
+    return _statistics.get();
+}
+
+const KdTreeBuilder::Statistics *KdTreeBuilder::getStatistics() const
+{
+    return _statistics.get();
+}
+
+} // namespace opeViewer
@@ -0,0 +1,52 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_B871FFA10621400D8EA89F04F36F6127_H_
+#define INC_2026_10_18_B871FFA10621400D8EA89F04F36F6127_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <osg/KdTree>
+
+namespace opeViewer
+{
+
+/// KdTree构建器
+///
+/// 在osg::KdTreeBuilder的基础上统计构建数量、耗时和内存，可以在多个线程中使用clone()得到的副本同时构建
+class KdTreeBuilder : public osg::KdTreeBuilder
+{
+  public:
+    /// 构建统计，所有副本共享
+    struct Statistics : osg::Referenced
+    {
+        std::atomic<unsigned int> numKdTrees{};
+        std::atomic<std::uint64_t> numPrimitives{};
+        std::atomic<std::uint64_t> memory{};
+        /// 微秒
+        std::atomic<std::uint64_t> buildTime{};
+    };
+
+    KdTreeBuilder();
+
+    KdTreeBuilder(const KdTreeBuilder &rhs);
+
+    META_NodeVisitor(opeViewer, KdTreeBuilder);
+
+    osg::KdTreeBuilder *clone() override;
+
+    void apply(osg::Geometry &geometry) override;
+
+    Statistics *getStatistics();
+
+    const Statistics *getStatistics() const;
+
+  protected:
+    osg::ref_ptr<Statistics> _statistics;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_B871FFA10621400D8EA89F04F36F6127_H_
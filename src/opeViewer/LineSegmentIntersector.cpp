@@ -0,0 +1,588 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "LineSegmentIntersector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/TriangleIndexFunctor>
+#include <osg/observer_ptr>
+#include <osgUtil/IntersectionVisitor>
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 打包后的三角形
+struct PackedTriangles : osg::Referenced
+{
+    /// 打包时顶点减去的中心，避免大坐标损失单精度
+    osg::Vec3d center;
+    /// 包围球半径
+    double radius{};
+    unsigned int numTriangles{};
+    unsigned int numBlocks{};
+    /// RayKernels的三角形块
+    std::vector<float> triangles;
+    /// RayKernels的包围盒块，每个包围盒对应一个三角形块
+    std::vector<float> boxes;
+    /// 每个三角形的顶点索引
+    std::vector<unsigned int> indices;
+    /// 双精度确认时使用原始顶点
+    osg::ref_ptr<const osg::Vec3Array> vertices;
+
+    std::size_t getMemory() const
+    {
+        return (triangles.size() + boxes.size()) * sizeof(float) + indices.size() * sizeof(unsigned int);
+    }
+};
+
+struct TriangleCollector
+{
+    std::vector<unsigned int> *indices{};
+
+    void operator()(unsigned int i0, unsigned int i1, unsigned int i2)
+    {
+        indices->push_back(i0);
+        indices->push_back(i1);
+        indices->push_back(i2);
+    }
+};
+
+/// 只处理三角形图元，图元序号与osgUtil::LineSegmentIntersector一致
+bool isPackable(const osg::Geometry &geometry)
+{
+    if (!dynamic_cast<const osg::Vec3Array *>(geometry.getVertexArray()) || geometry.getNumPrimitiveSets() == 0)
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet *primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getNumInstances() != 0)
+        {
+            return false;
+        }
+
+        switch (primitiveSet->getMode())
+        {
+        case osg::PrimitiveSet::TRIANGLES:
+        case osg::PrimitiveSet::TRIANGLE_STRIP:
+        case osg::PrimitiveSet::TRIANGLE_FAN:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// 顶点或图元变化后签名随之变化
+std::size_t computeSignature(const osg::Geometry &geometry)
+{
+    std::size_t signature = std::hash<const void *>()(geometry.getVertexArray());
+    auto combine = [&signature](std::size_t value) { signature ^= value + 0x9e3779b97f4a7c15ull + (signature << 6) + (signature >> 2); };
+
+    combine(geometry.getVertexArray()->getModifiedCount());
+    for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i)
+    {
+        combine(std::hash<const void *>()(geometry.getPrimitiveSet(i)));
+        combine(geometry.getPrimitiveSet(i)->getModifiedCount());
+    }
+    return signature;
+}
+
+osg::ref_ptr<PackedTriangles> packTriangles(const osg::Geometry &geometry)
+{
+    const unsigned int N = RayKernels::NUM_LANES;
+
+    osg::ref_ptr<PackedTriangles> packed = new PackedTriangles;
+    packed->vertices = static_cast<const osg::Vec3Array *>(geometry.getVertexArray());
+
+    osg::TriangleIndexFunctor<TriangleCollector> functor;
+    functor.indices = &packed->indices;
+    const_cast<osg::Geometry &>(geometry).accept(functor);
+
+    const osg::Vec3Array &vertices = *packed->vertices;
+    for (unsigned int index : packed->indices)
+    {
+        if (index >= vertices.size())
+        {
+            return nullptr;
+        }
+    }
+
+    osg::BoundingBox bound;
+    for (unsigned int index : packed->indices)
+    {
+        bound.expandBy(vertices[index]);
+    }
+    packed->center = bound.center();
+    packed->radius = bound.radius();
+
+    packed->numTriangles = static_cast<unsigned int>(packed->indices.size() / 3);
+    packed->numBlocks = (packed->numTriangles + N - 1) / N;
+    unsigned int numBoxBlocks = (packed->numBlocks + N - 1) / N;
+
+    // 填充的三角形各分量为0，行列式为0，不会命中
+    packed->triangles.assign(static_cast<std::size_t>(packed->numBlocks) * RayKernels::TRIANGLE_BLOCK_SIZE, 0.0f);
+    packed->boxes.assign(static_cast<std::size_t>(numBoxBlocks) * RayKernels::BOX_BLOCK_SIZE, 0.0f);
+
+    // 包围盒稍微放大，保证单精度测试不漏报
+    float padding = static_cast<float>(packed->radius * 1e-4) + std::numeric_limits<float>::min();
+
+    for (unsigned int block = 0; block < packed->numBlocks; ++block)
+    {
+        float *triangles = packed->triangles.data() + static_cast<std::size_t>(block) * RayKernels::TRIANGLE_BLOCK_SIZE;
+        osg::BoundingBoxd blockBound;
+
+        for (unsigned int lane = 0; lane < N; ++lane)
+        {
+            unsigned int triangle = block * N + lane;
+            if (triangle >= packed->numTriangles)
+            {
+                break;
+            }
+
+            osg::Vec3d v0 = osg::Vec3d(vertices[packed->indices[triangle * 3 + 0]]) - packed->center;
+            osg::Vec3d v1 = osg::Vec3d(vertices[packed->indices[triangle * 3 + 1]]) - packed->center;
+            osg::Vec3d v2 = osg::Vec3d(vertices[packed->indices[triangle * 3 + 2]]) - packed->center;
+            osg::Vec3d e1 = v1 - v0;
+            osg::Vec3d e2 = v2 - v0;
+
+            for (unsigned int axis = 0; axis < 3; ++axis)
+            {
+                triangles[axis * N + lane] = static_cast<float>(v0[axis]);
+                triangles[(axis + 3) * N + lane] = static_cast<float>(e1[axis]);
+                triangles[(axis + 6) * N + lane] = static_cast<float>(e2[axis]);
+            }
+
+            blockBound.expandBy(v0);
+            blockBound.expandBy(v1);
+            blockBound.expandBy(v2);
+        }
+
+        float *boxes = packed->boxes.data() + static_cast<std::size_t>(block / N) * RayKernels::BOX_BLOCK_SIZE;
+        unsigned int lane = block % N;
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            boxes[axis * N + lane] = static_cast<float>(blockBound._min[axis]) - padding;
+            boxes[(axis + 3) * N + lane] = static_cast<float>(blockBound._max[axis]) + padding;
+        }
+    }
+
+    return packed;
+}
+
+/// 按几何体缓存打包结果，超过内存上限时淘汰最久未使用的结果
+class PackedTrianglesCache
+{
+    struct Entry
+    {
+        osg::observer_ptr<const osg::Geometry> geometry;
+        std::size_t signature{};
+        osg::ref_ptr<PackedTriangles> packed;
+        uint64_t lastUse{};
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<const osg::Geometry *, Entry> _entries;
+    std::size_t _pruneSize{256};
+    std::atomic<std::size_t> _memory{};
+    std::atomic<std::size_t> _maximumMemory{64u << 20};
+    uint64_t _useCount{};
+
+    /// 淘汰最久未使用的结果直到不超过上限
+    void evict()
+    {
+        std::vector<std::unordered_map<const osg::Geometry *, Entry>::iterator> entries;
+        entries.reserve(_entries.size());
+        for (auto itr = _entries.begin(); itr != _entries.end(); ++itr)
+        {
+            entries.push_back(itr);
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) { return lhs->second.lastUse < rhs->second.lastUse; });
+
+        for (auto itr : entries)
+        {
+            if (_memory <= _maximumMemory)
+            {
+                break;
+            }
+            _memory -= itr->second.packed ? itr->second.packed->getMemory() : 0;
+            _entries.erase(itr);
+        }
+    }
+
+    void prune()
+    {
+        for (auto itr = _entries.begin(); itr != _entries.end();)
+        {
+            if (!itr->second.geometry.valid())
+            {
+                _memory -= itr->second.packed ? itr->second.packed->getMemory() : 0;
+                itr = _entries.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+        _pruneSize = std::max<std::size_t>(256, _entries.size() * 2);
+    }
+
+  public:
+    /// 不能打包时返回空
+    osg::ref_ptr<PackedTriangles> get(const osg::Geometry &geometry)
+    {
+        if (!isPackable(geometry))
+        {
+            return nullptr;
+        }
+
+        std::size_t signature = computeSignature(geometry);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto itr = _entries.find(&geometry);
+            // 地址可能被新的几何体复用，需要检查observer
+            if (itr != _entries.end() && itr->second.geometry.valid() && itr->second.geometry == &geometry && itr->second.signature == signature)
+            {
+                itr->second.lastUse = ++_useCount;
+                return itr->second.packed;
+            }
+        }
+
+        // 在锁外打包，多个线程同时打包同一个几何体时保留最后一个结果
+        osg::ref_ptr<PackedTriangles> packed = packTriangles(geometry);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        Entry &entry = _entries[&geometry];
+        _memory -= entry.packed ? entry.packed->getMemory() : 0;
+        entry.geometry = &geometry;
+        entry.signature = signature;
+        entry.packed = packed;
+        entry.lastUse = ++_useCount;
+        _memory += packed ? packed->getMemory() : 0;
+
+        if (_entries.size() > _pruneSize)
+        {
+            prune();
+        }
+        if (_memory > _maximumMemory)
+        {
+            evict();
+        }
+
+        return packed;
+    }
+
+    std::size_t getMemory() const
+    {
+        return _memory;
+    }
+
+    void setMaximumMemory(std::size_t memory)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maximumMemory = memory;
+        if (_memory > _maximumMemory)
+        {
+            evict();
+        }
+    }
+
+    std::size_t getMaximumMemory() const
+    {
+        return _maximumMemory;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+        _memory = 0;
+    }
+};
+
+PackedTrianglesCache &getPackedTrianglesCache()
+{
+    static PackedTrianglesCache s_cache;
+    return s_cache;
+}
+
+unsigned int countTrailingZeros(unsigned int mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+/// 单精度筛选后的双精度确认
+struct TriangleHit
+{
+    unsigned int triangle{};
+    double ratio{};
+    double u{};
+    double v{};
+    osg::Vec3d normal;
+};
+
+bool intersectTriangle(const osg::Vec3d &start, const osg::Vec3d &direction, const osg::Vec3d &v0, const osg::Vec3d &v1, const osg::Vec3d &v2, TriangleHit &hit)
+{
+    // Möller–Trumbore
+    osg::Vec3d e1 = v1 - v0;
+    osg::Vec3d e2 = v2 - v0;
+    osg::Vec3d p = direction ^ e2;
+    double det = e1 * p;
+    if (det == 0.0)
+    {
+        return false;
+    }
+    double inverseDet = 1.0 / det;
+
+    osg::Vec3d s = start - v0;
+    double u = (s * p) * inverseDet;
+    if (u < 0.0 || u > 1.0)
+    {
+        return false;
+    }
+
+    osg::Vec3d q = s ^ e1;
+    double v = (direction * q) * inverseDet;
+    if (v < 0.0 || u + v > 1.0)
+    {
+        return false;
+    }
+
+    double t = (e2 * q) * inverseDet;
+    if (t < 0.0 || t > 1.0)
+    {
+        return false;
+    }
+
+    hit.ratio = t;
+    hit.u = u;
+    hit.v = v;
+    hit.normal = e1 ^ e2;
+    hit.normal.normalize();
+    return true;
+}
+
+} // namespace
+
+LineSegmentIntersector::LineSegmentIntersector(const osg::Vec3d &start, const osg::Vec3d &end) : osgUtil::LineSegmentIntersector(start, end), _instructionSet(RayKernels::getSupportedInstructionSet())
+{
+}
+
+LineSegmentIntersector::LineSegmentIntersector(CoordinateFrame cf, const osg::Vec3d &start, const osg::Vec3d &end, osgUtil::LineSegmentIntersector *parent, osgUtil::Intersector::IntersectionLimit intersectionLimit)
+    : osgUtil::LineSegmentIntersector(cf, start, end, parent, intersectionLimit), _instructionSet(RayKernels::getSupportedInstructionSet())
+{
+}
+
+LineSegmentIntersector::LineSegmentIntersector(CoordinateFrame cf, double x, double y) : osgUtil::LineSegmentIntersector(cf, x, y), _instructionSet(RayKernels::getSupportedInstructionSet())
+{
+}
+
+LineSegmentIntersector::~LineSegmentIntersector()
+{
+}
+
+void LineSegmentIntersector::setInstructionSet(RayKernels::InstructionSet instructionSet)
+{
+    _instructionSet = instructionSet;
+}
+
+RayKernels::InstructionSet LineSegmentIntersector::getInstructionSet() const
+{
+    return _instructionSet;
+}
+
+osgUtil::Intersector *LineSegmentIntersector::clone(osgUtil::IntersectionVisitor &iv)
+{
+    // 由基类计算变换后的线段
+    osg::ref_ptr<osgUtil::Intersector> intersector = osgUtil::LineSegmentIntersector::clone(iv);
+    auto lineSegmentIntersector = static_cast<osgUtil::LineSegmentIntersector *>(intersector.get());
+
+    osg::ref_ptr<LineSegmentIntersector> cloned = new LineSegmentIntersector(MODEL, lineSegmentIntersector->getStart(), lineSegmentIntersector->getEnd(), this, getIntersectionLimit());
+    cloned->setPrecisionHint(getPrecisionHint());
+    cloned->_instructionSet = _instructionSet;
+    return cloned.release();
+}
+
+void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor &iv, osg::Drawable *drawable)
+{
+    if (reachedLimit())
+    {
+        return;
+    }
+
+    osg::Vec3d s(_start), e(_end);
+    if (!intersectAndClip(s, e, drawable->getBoundingBox()))
+    {
+        return;
+    }
+
+    if (iv.getDoDummyTraversal())
+    {
+        return;
+    }
+
+    osg::Geometry *geometry = drawable->asGeometry();
+    bool useKdTree = iv.getUseKdTreeWhenAvailable() && dynamic_cast<osg::KdTree *>(drawable->getShape());
+    osg::ref_ptr<PackedTriangles> packed = geometry && !useKdTree ? getPackedTrianglesCache().get(*geometry) : nullptr;
+    if (!packed || packed->numTriangles == 0)
+    {
+        osgUtil::LineSegmentIntersector::intersect(iv, drawable);
+        return;
+    }
+
+    osg::Vec3d direction = _end - _start;
+    double length2 = direction.length2();
+    if (length2 == 0.0)
+    {
+        return;
+    }
+
+    // 射线原点取离打包中心最近的点，保证单精度计算的原点和顶点在同一量级
+    double tCenter = ((packed->center - _start) * direction) / length2;
+    osg::Vec3d origin = _start + direction * tCenter - packed->center;
+
+    // 裁剪后的线段范围，放大后用于筛选
+    double tBegin = ((s - _start) * direction) / length2;
+    double tEnd = ((e - _start) * direction) / length2;
+    double tEpsilon = (tEnd - tBegin) * 1e-3 + packed->radius * 1e-4 / std::sqrt(length2);
+
+    bool nearestOnly = getIntersectionLimit() != NO_LIMIT;
+    if (getIntersectionLimit() == LIMIT_NEAREST && !getIntersections().empty())
+    {
+        tEnd = std::min(tEnd, getIntersections().begin()->ratio);
+    }
+
+    float rayOrigin[3] = {static_cast<float>(origin.x()), static_cast<float>(origin.y()), static_cast<float>(origin.z())};
+    float rayDirection[3] = {static_cast<float>(direction.x()), static_cast<float>(direction.y()), static_cast<float>(direction.z())};
+    RayKernels::Ray ray(rayOrigin, rayDirection, static_cast<float>(tBegin - tCenter - tEpsilon), static_cast<float>(tEnd - tCenter + tEpsilon));
+
+    const RayKernels &kernels = RayKernels::get(_instructionSet);
+    const unsigned int N = RayKernels::NUM_LANES;
+    const osg::Vec3Array &vertices = *packed->vertices;
+    const std::vector<unsigned int> &indices = packed->indices;
+
+    std::vector<TriangleHit> hits;
+    float t[RayKernels::NUM_LANES];
+
+    unsigned int numBoxBlocks = (packed->numBlocks + N - 1) / N;
+    for (unsigned int boxBlock = 0; boxBlock < numBoxBlocks; ++boxBlock)
+    {
+        unsigned int boxMask = kernels.intersectBoxes(ray, packed->boxes.data() + static_cast<std::size_t>(boxBlock) * RayKernels::BOX_BLOCK_SIZE);
+
+        // 最后一组中多余的包围盒
+        unsigned int numBoxes = std::min(N, packed->numBlocks - boxBlock * N);
+        if (numBoxes < N)
+        {
+            boxMask &= (1u << numBoxes) - 1;
+        }
+
+        while (boxMask)
+        {
+            unsigned int block = boxBlock * N + countTrailingZeros(boxMask);
+            boxMask &= boxMask - 1;
+
+            unsigned int triangleMask = kernels.intersectTriangles(ray, packed->triangles.data() + static_cast<std::size_t>(block) * RayKernels::TRIANGLE_BLOCK_SIZE, t);
+            while (triangleMask)
+            {
+                unsigned int lane = countTrailingZeros(triangleMask);
+                triangleMask &= triangleMask - 1;
+
+                TriangleHit hit;
+                hit.triangle = block * N + lane;
+                const osg::Vec3d v0(vertices[indices[hit.triangle * 3 + 0]]);
+                const osg::Vec3d v1(vertices[indices[hit.triangle * 3 + 1]]);
+                const osg::Vec3d v2(vertices[indices[hit.triangle * 3 + 2]]);
+                if (!intersectTriangle(_start, direction, v0, v1, v2, hit) || hit.ratio < tBegin || hit.ratio > tEnd)
+                {
+                    continue;
+                }
+
+                if (nearestOnly)
+                {
+                    // 只保留最近的命中，后续的筛选范围随之缩小
+                    if (hits.empty())
+                    {
+                        hits.push_back(hit);
+                    }
+                    else if (hit.ratio < hits.front().ratio)
+                    {
+                        hits.front() = hit;
+                    }
+                    tEnd = hits.front().ratio;
+                    ray.tMax = static_cast<float>(tEnd - tCenter + tEpsilon);
+                }
+                else
+                {
+                    hits.push_back(hit);
+                }
+            }
+        }
+    }
+
+    for (const TriangleHit &hit : hits)
+    {
+        osgUtil::LineSegmentIntersector::Intersection intersection;
+        intersection.ratio = hit.ratio;
+        intersection.nodePath = iv.getNodePath();
+        intersection.drawable = drawable;
+        intersection.matrix = iv.getModelMatrix();
+        intersection.localIntersectionPoint = _start + direction * hit.ratio;
+        intersection.localIntersectionNormal = hit.normal;
+        intersection.indexList = {indices[hit.triangle * 3 + 0], indices[hit.triangle * 3 + 1], indices[hit.triangle * 3 + 2]};
+        intersection.ratioList = {1.0 - hit.u - hit.v, hit.u, hit.v};
+        intersection.primitiveIndex = hit.triangle;
+        insertIntersection(intersection);
+    }
+}
+
+std::size_t LineSegmentIntersector::getPackedTrianglesMemory()
+{
+    return getPackedTrianglesCache().getMemory();
+}
+
+void LineSegmentIntersector::setMaximumPackedTrianglesMemory(std::size_t memory)
+{
+    getPackedTrianglesCache().setMaximumMemory(memory);
+}
+
+std::size_t LineSegmentIntersector::getMaximumPackedTrianglesMemory()
+{
+    return getPackedTrianglesCache().getMaximumMemory();
+}
+
+void LineSegmentIntersector::clearPackedTriangles()
+{
+    getPackedTrianglesCache().clear();
+}
+
+} // namespace opeViewer
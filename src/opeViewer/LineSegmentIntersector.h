@@ -0,0 +1,61 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_35A015ECA79A4963BE43B1DCF42A86DA_H_
+#define INC_2026_10_18_35A015ECA79A4963BE43B1DCF42A86DA_H_
+
+#include <osgUtil/LineSegmentIntersector>
+
+#include "RayKernels.h"
+
+namespace opeViewer
+{
+
+/// 线段求交器
+///
+/// 只包含三角形（GL_TRIANGLES、GL_TRIANGLE_STRIP、GL_TRIANGLE_FAN）的几何体第一次求交时打包为RayKernels的三角形块和包围盒块，
+/// 之后使用SIMD批量测试，命中的三角形再用双精度确认，结果与osgUtil::LineSegmentIntersector一致
+///
+/// 有KdTree（IntersectionVisitor默认使用）或包含其他图元的几何体仍使用osgUtil::LineSegmentIntersector
+///
+/// 打包结果按几何体缓存，几何体的顶点或图元修改后重新打包，可以在多个线程中同时求交；
+/// 缓存大小约为三角形数 * 50字节，超过上限时淘汰最久未使用的结果
+class LineSegmentIntersector : public osgUtil::LineSegmentIntersector
+{
+  public:
+    LineSegmentIntersector(const osg::Vec3d &start, const osg::Vec3d &end);
+
+    LineSegmentIntersector(CoordinateFrame cf, const osg::Vec3d &start, const osg::Vec3d &end, osgUtil::LineSegmentIntersector *parent = nullptr, osgUtil::Intersector::IntersectionLimit intersectionLimit = osgUtil::Intersector::NO_LIMIT);
+
+    LineSegmentIntersector(CoordinateFrame cf, double x, double y);
+
+    /// 默认使用CPU支持的最高指令集
+    void setInstructionSet(RayKernels::InstructionSet instructionSet);
+
+    RayKernels::InstructionSet getInstructionSet() const;
+
+    osgUtil::Intersector *clone(osgUtil::IntersectionVisitor &iv) override;
+
+    void intersect(osgUtil::IntersectionVisitor &iv, osg::Drawable *drawable) override;
+
+    /// 打包缓存占用的内存
+    static std::size_t getPackedTrianglesMemory();
+
+    /// 打包缓存的内存上限（字节），默认64MB，超过后淘汰最久未使用的结果
+    static void setMaximumPackedTrianglesMemory(std::size_t memory);
+
+    static std::size_t getMaximumPackedTrianglesMemory();
+
+    /// 清空打包缓存
+    static void clearPackedTriangles();
+
+  protected:
+    ~LineSegmentIntersector() override;
+
+    RayKernels::InstructionSet _instructionSet{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_35A015ECA79A4963BE43B1DCF42A86DA_H_
@@ -0,0 +1,589 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "ObjectIdPicker.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <osg/BufferObject>
+#include <osg/Program>
+#include <osg/Timer>
+#include <osgUtil/CullVisitor>
+
+#include "GeometryInstancer.h"
+#include "Instrumentation.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Stats.h"
+#include "Viewport.h"
+
+#ifndef GL_R32UI
+#define GL_R32UI 0x8236
+#endif
+
+#ifndef GL_RED_INTEGER
+#define GL_RED_INTEGER 0x8D94
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+
+namespace opeViewer
+{
+
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+#define GLSL_VERSION_STR "330 core"
+#else
+#define GLSL_VERSION_STR "300 es"
+#endif
+
+static const char *gl3_ObjectIdVertexShader = {"#version " GLSL_VERSION_STR "\n"
+                                               "// gl3_ObjectIdVertexShader\n"
+                                               "#ifdef GL_ES\n"
+                                               "    precision highp float;\n"
+                                               "#endif\n"
+                                               "in vec4 osg_Vertex;\n"
+                                               "uniform mat4 osg_ModelViewProjectionMatrix;\n"
+                                               "void main(void)\n"
+                                               "{\n"
+                                               "    gl_Position = osg_ModelViewProjectionMatrix * osg_Vertex;\n"
+                                               "}\n"};
+
+static const char *gl3_ObjectIdFragmentShader = {"#version " GLSL_VERSION_STR "\n"
+                                                 "// gl3_ObjectIdFragmentShader\n"
+                                                 "#ifdef GL_ES\n"
+                                                 "    precision highp int;\n"
+                                                 "#endif\n"
+                                                 "uniform uint opeViewer_ObjectId;\n"
+                                                 "out uint objectId;\n"
+                                                 "void main(void)\n"
+                                                 "{\n"
+                                                 "    objectId = opeViewer_ObjectId;\n"
+                                                 "}\n"};
+
+// 整数输出至少需要GLSL 1.30，仍然使用兼容模式的内置变量
+static const char *gl2_ObjectIdVertexShader = {"#version 130\n"
+                                               "// gl2_ObjectIdVertexShader\n"
+                                               "void main(void)\n"
+                                               "{\n"
+                                               "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+                                               "}\n"};
+
+static const char *gl2_ObjectIdFragmentShader = {"#version 130\n"
+                                                 "// gl2_ObjectIdFragmentShader\n"
+                                                 "uniform uint opeViewer_ObjectId;\n"
+                                                 "out uint objectId;\n"
+                                                 "void main(void)\n"
+                                                 "{\n"
+                                                 "    objectId = opeViewer_ObjectId;\n"
+                                                 "}\n"};
+
+namespace
+{
+
+/// 两个投影矩阵的x、y、w分量相同
+///
+/// 剔除时计算近远平面只修改z分量（osgUtil::CullVisitor::clampProjectionMatrix），不影响像素和物体的对应关系
+bool isSameScreenMapping(const osg::Matrixd &lhs, const osg::Matrixd &rhs)
+{
+    for (int row = 0; row < 4; ++row)
+    {
+        if (lhs(row, 0) != rhs(row, 0) || lhs(row, 1) != rhs(row, 1) || lhs(row, 3) != rhs(row, 3))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/// 为每个绘制对象压入带有ID的状态集，并记录节点路径
+struct ObjectIdPicker::CullVisitor : osgUtil::CullVisitor
+{
+    osg::observer_ptr<ObjectIdPicker> picker;
+
+    explicit CullVisitor(ObjectIdPicker *picker) : picker(picker)
+    {
+    }
+
+    CullVisitor(const CullVisitor &) = default;
+
+    osgUtil::CullVisitor *clone() const override
+    {
+        return new CullVisitor(*this);
+    }
+
+    void reset() override
+    {
+        osgUtil::CullVisitor::reset();
+
+        osg::ref_ptr<ObjectIdPicker> picker;
+        if (this->picker.lock(picker))
+        {
+            picker->_objects.clear();
+        }
+    }
+
+    void apply(osg::Camera &camera) override
+    {
+        // 绝对坐标系的相机（HUD）和嵌套的渲染到纹理相机不对应鼠标位置
+        if (camera.getReferenceFrame() != osg::Transform::RELATIVE_RF || camera.getRenderOrder() != osg::Camera::NESTED_RENDER)
+        {
+            return;
+        }
+
+        osgUtil::CullVisitor::apply(camera);
+    }
+
+    void apply(osg::Group &group) override
+    {
+        // ID着色器不处理实例矩阵，绘制被实例化替换的MatrixTransform
+        if (auto instancedGroup = dynamic_cast<GeometryInstancer::InstancedGroup *>(&group))
+        {
+            if (!isCulled(group))
+            {
+                instancedGroup->traverseInstances(*this);
+            }
+            return;
+        }
+
+        osgUtil::CullVisitor::apply(group);
+    }
+
+    void apply(osg::Drawable &drawable) override
+    {
+        // 与osgUtil::CullVisitor::apply(osg::Drawable &)相同的剔除，不为看不到的绘制对象分配ID
+        if (drawable.isCullingActive() && isCulled(drawable.getBoundingBox()))
+        {
+            return;
+        }
+
+        osg::ref_ptr<ObjectIdPicker> picker;
+        if (!this->picker.lock(picker))
+        {
+            osgUtil::CullVisitor::apply(drawable);
+            return;
+        }
+
+        Selection &objects = picker->_objects;
+        objects.nodes.insert(objects.nodes.end(), getNodePath().begin(), getNodePath().end());
+        objects.offsets.push_back(objects.nodes.size());
+
+        pushStateSet(picker->getObjectIdStateSet(static_cast<unsigned int>(objects.size())));
+        osgUtil::CullVisitor::apply(drawable);
+        popStateSet();
+    }
+};
+
+/// 每帧让ID相机的投影跟随鼠标
+struct ObjectIdPicker::UpdateSlaveCallback : osg::View::Slave::UpdateSlaveCallback
+{
+    osg::observer_ptr<ObjectIdPicker> picker;
+
+    explicit UpdateSlaveCallback(ObjectIdPicker *picker) : picker(picker)
+    {
+    }
+
+    void updateSlave(osg::View &view, osg::View::Slave &slave) override
+    {
+        osg::ref_ptr<ObjectIdPicker> picker;
+        if (this->picker.lock(picker))
+        {
+            picker->updateSlave(view, slave);
+        }
+        else
+        {
+            slave.updateSlaveImplementation(view);
+        }
+    }
+};
+
+/// ID相机绘制结束后读回
+struct ObjectIdPicker::ReadbackCallback : osg::Camera::DrawCallback
+{
+    osg::observer_ptr<ObjectIdPicker> picker;
+
+    explicit ReadbackCallback(ObjectIdPicker *picker) : picker(picker)
+    {
+    }
+
+    void operator()(osg::RenderInfo &renderInfo) const override
+    {
+        osg::ref_ptr<ObjectIdPicker> picker;
+        if (this->picker.lock(picker))
+        {
+            picker->readback(renderInfo);
+        }
+    }
+
+    void releaseGLObjects(osg::State *state) const override
+    {
+        osg::ref_ptr<ObjectIdPicker> picker;
+        if (!state || !this->picker.lock(picker))
+        {
+            return;
+        }
+
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+        osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+        for (Readback &readback : picker->_readbacks)
+        {
+            if (readback.fence)
+            {
+                ext->glDeleteSync(readback.fence);
+                readback.fence = nullptr;
+            }
+            if (readback.buffer)
+            {
+                ext->glDeleteBuffers(1, &readback.buffer);
+                readback.buffer = 0;
+            }
+        }
+#endif
+    }
+};
+
+ObjectIdPicker::ObjectIdPicker(Viewport *viewport, unsigned int radius) : _viewport(viewport), _radius(radius)
+{
+    int size = static_cast<int>(2 * _radius + 1);
+
+    _texture = new osg::Texture2D;
+    _texture->setTextureSize(size, size);
+    _texture->setInternalFormat(GL_R32UI);
+    _texture->setSourceFormat(GL_RED_INTEGER);
+    _texture->setSourceType(GL_UNSIGNED_INT);
+    _texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    _texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+
+    _camera = new osg::Camera;
+    _camera->setName("Object ID");
+    _camera->setStats(new Stats("Object ID"));
+    _camera->setAllowEventFocus(false);
+    _camera->setRenderOrder(osg::Camera::PRE_RENDER);
+    _camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    _camera->setViewport(0, 0, size, size);
+    _camera->attach(osg::Camera::COLOR_BUFFER0, _texture.get());
+    _camera->attach(osg::Camera::DEPTH_BUFFER, GL_DEPTH_COMPONENT24);
+    _camera->setImplicitBufferAttachmentMask(0, 0);
+    // 整数缓冲的glClear结果在规范中未定义，清除为0时各实现（包括llvmpipe）都得到0
+    _camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+    _camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _camera->setFinalDrawCallback(new ReadbackCallback(this));
+
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->setName("ObjectId");
+
+    osg::DisplaySettings::ShaderHint shaderHint = osg::DisplaySettings::instance()->getShaderHint();
+    if (shaderHint == osg::DisplaySettings::SHADER_GL3 || shaderHint == osg::DisplaySettings::SHADER_GLES3)
+    {
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl3_ObjectIdVertexShader));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl3_ObjectIdFragmentShader));
+    }
+    else
+    {
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl2_ObjectIdVertexShader));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl2_ObjectIdFragmentShader));
+    }
+
+    osg::StateSet *stateSet = _camera->getOrCreateStateSet();
+    stateSet->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE | osg::StateAttribute::PROTECTED);
+    stateSet->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE | osg::StateAttribute::PROTECTED);
+    stateSet->addUniform(new osg::Uniform("opeViewer_ObjectId", 0u));
+
+    // 先设置Renderer，osg::View::addSlave中不再创建
+    osg::ref_ptr<Renderer> renderer = new Renderer(_camera);
+    renderer->setCullVisitor(new CullVisitor(this));
+    _camera->setRenderer(renderer);
+
+    if (viewport)
+    {
+        viewport->addSlave(_camera, true);
+        if (osg::View::Slave *slave = viewport->findSlaveForCamera(_camera))
+        {
+            slave->_updateSlaveCallback = new UpdateSlaveCallback(this);
+        }
+    }
+}
+
+ObjectIdPicker::~ObjectIdPicker()
+{
+    osg::ref_ptr<Viewport> viewport;
+    if (_viewport.lock(viewport))
+    {
+        unsigned int i = viewport->findSlaveIndexForCamera(_camera);
+        if (i < viewport->getNumSlaves())
+        {
+            viewport->removeSlave(i);
+        }
+    }
+}
+
+osg::Camera *ObjectIdPicker::getCamera() const
+{
+    return _camera.get();
+}
+
+unsigned int ObjectIdPicker::getRadius() const
+{
+    return _radius;
+}
+
+bool ObjectIdPicker::setPointer(const osgGA::GUIEventAdapter &ea)
+{
+    osg::ref_ptr<Viewport> viewport;
+    if (!_viewport.lock(viewport))
+    {
+        return false;
+    }
+
+    _pointerValid = computePointerPixel(ea, viewport->getCamera(), _pointerX, _pointerY);
+    if (!_pointerValid)
+    {
+        return false;
+    }
+
+    int radius = static_cast<int>(_radius);
+    return !_resolvedRegion.valid || std::abs(_pointerX - _resolvedRegion.x) > radius || std::abs(_pointerY - _resolvedRegion.y) > radius;
+}
+
+bool ObjectIdPicker::pick(const osgGA::GUIEventAdapter &ea, Result &result) const
+{
+    osg::ref_ptr<Viewport> viewport;
+    if (!_resolvedRegion.valid || !_viewport.lock(viewport))
+    {
+        return false;
+    }
+
+    osg::Camera *camera = viewport->getCamera();
+    const osg::Viewport *cameraViewport = camera->getViewport();
+    int x{}, y{};
+    if (!computePointerPixel(ea, camera, x, y) || cameraViewport->width() != _resolvedRegion.width || cameraViewport->height() != _resolvedRegion.height)
+    {
+        return false;
+    }
+
+    int radius = static_cast<int>(_radius);
+    int size = 2 * radius + 1;
+    int column = x - _resolvedRegion.x + radius;
+    int row = y - _resolvedRegion.y + radius;
+    if (column < 0 || row < 0 || column >= size || row >= size)
+    {
+        return false;
+    }
+
+    if (camera->getViewMatrix() != _resolvedRegion.viewMatrix || !isSameScreenMapping(camera->getProjectionMatrix(), _resolvedRegion.projectionMatrix))
+    {
+        return false;
+    }
+
+    Scene *scene = viewport->getScene();
+    if ((scene ? scene->getModifiedCount() : 0) != _resolvedRegion.modifiedCount)
+    {
+        return false;
+    }
+
+    unsigned int objectId = _resolvedIds[row * size + column];
+    if (objectId > _resolvedObjects.size())
+    {
+        return false;
+    }
+
+    result.objectId = objectId;
+    result.frameNumber = _resolvedRegion.frameNumber;
+    if (objectId)
+    {
+        result.nodePath = _resolvedObjects.getNodePath(objectId - 1);
+        result.drawable = _resolvedObjects.getDrawable(objectId - 1);
+    }
+    else
+    {
+        result.nodePath.clear();
+        result.drawable = nullptr;
+    }
+
+    return true;
+}
+
+bool ObjectIdPicker::hasPendingReadbacks() const
+{
+    for (const Readback &readback : _readbacks)
+    {
+        if (readback.fence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ObjectIdPicker::Region::isSame(const Region &other) const
+{
+    return x == other.x && y == other.y && width == other.width && height == other.height && viewMatrix == other.viewMatrix && isSameScreenMapping(projectionMatrix, other.projectionMatrix) && modifiedCount == other.modifiedCount;
+}
+
+void ObjectIdPicker::updateSlave(osg::View &view, osg::View::Slave &slave)
+{
+    osg::Camera *masterCamera = view.getCamera();
+    const osg::Viewport *masterViewport = masterCamera->getViewport();
+
+    _region.valid = _pointerValid && masterViewport && masterViewport->width() > 0 && masterViewport->height() > 0;
+    if (_region.valid)
+    {
+        // 将鼠标周围size * size个像素放大到整个投影范围
+        double size = 2 * _radius + 1;
+        double centerX = 2.0 * (_pointerX + 0.5) / masterViewport->width() - 1.0;
+        double centerY = 2.0 * (_pointerY + 0.5) / masterViewport->height() - 1.0;
+        slave._projectionOffset = osg::Matrixd::translate(-centerX, -centerY, 0.0) * osg::Matrixd::scale(masterViewport->width() / size, masterViewport->height() / size, 1.0);
+
+        Scene *scene = _viewport.valid() ? _viewport->getScene() : nullptr;
+
+        _region.x = _pointerX;
+        _region.y = _pointerY;
+        _region.width = static_cast<int>(masterViewport->width());
+        _region.height = static_cast<int>(masterViewport->height());
+        _region.viewMatrix = masterCamera->getViewMatrix();
+        _region.projectionMatrix = masterCamera->getProjectionMatrix();
+        _region.modifiedCount = scene ? scene->getModifiedCount() : 0;
+
+        // 与上次读回的相同时不再绘制，否则按需绘制时每次读回都会请求新的一帧
+        if (_issuedRegion.valid && _region.isSame(_issuedRegion))
+        {
+            _region.valid = false;
+        }
+    }
+
+    slave.updateSlaveImplementation(view);
+
+    // 鼠标不在视口中或区域没有变化时不遍历场景
+    _camera->setCullMask(_region.valid ? masterCamera->getCullMask() : 0);
+}
+
+osg::StateSet *ObjectIdPicker::getObjectIdStateSet(unsigned int objectId)
+{
+    while (_objectIdStateSets.size() < objectId)
+    {
+        osg::ref_ptr<osg::StateSet> stateSet = new osg::StateSet;
+        stateSet->addUniform(new osg::Uniform("opeViewer_ObjectId", static_cast<unsigned int>(_objectIdStateSets.size() + 1)));
+        _objectIdStateSets.push_back(stateSet);
+    }
+    return _objectIdStateSets[objectId - 1].get();
+}
+
+void ObjectIdPicker::readback(osg::RenderInfo &renderInfo)
+{
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+    osg::State *state = renderInfo.getState();
+    osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+    if (!ext->isPBOSupported || !ext->glFenceSync || !ext->glClientWaitSync)
+    {
+        return;
+    }
+
+    osg::ElapsedTime elapsedTime;
+
+    resolveReadbacks(renderInfo);
+
+    const osg::FrameStamp *fs = state->getFrameStamp();
+    unsigned int frameNumber = fs ? fs->getFrameNumber() : 0;
+    std::size_t numObjects = _objects.size();
+
+    if (_region.valid)
+    {
+        int size = static_cast<int>(2 * _radius + 1);
+        GLsizeiptr bufferSize = size * size * sizeof(GLuint);
+
+        // 最旧的读回三帧后仍未完成，丢弃
+        Readback &readback = _readbacks[_nextReadback];
+        _nextReadback = (_nextReadback + 1) % NUM_READBACKS;
+        if (readback.fence)
+        {
+            ext->glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+        }
+
+        if (!readback.buffer)
+        {
+            ext->glGenBuffers(1, &readback.buffer);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+            ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, bufferSize, nullptr, GL_STREAM_READ_ARB);
+        }
+        else
+        {
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+        }
+
+        state->applyTextureAttribute(0, _texture.get());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+        readback.fence = ext->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.region = _region;
+        readback.region.frameNumber = frameNumber;
+        _issuedRegion = _region;
+        // 剔除遍历在下一帧开始时清空_objects
+        std::swap(readback.objects, _objects);
+    }
+
+    osg::Stats *stats = _camera->getStats();
+    if (OPEVIEWER_COLLECT_STATS(stats, FULL, RENDERING))
+    {
+        stats->setAttribute(frameNumber, "Object ID drawables", static_cast<double>(numObjects));
+        stats->setAttribute(frameNumber, "Object ID readback time taken", elapsedTime.elapsedTime());
+    }
+#endif
+}
+
+void ObjectIdPicker::resolveReadbacks(osg::RenderInfo &renderInfo)
+{
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+    osg::GLExtensions *ext = renderInfo.getState()->get<osg::GLExtensions>();
+    int size = static_cast<int>(2 * _radius + 1);
+
+    // 从最旧的开始，遇到未完成的停止
+    for (unsigned int i = 0; i < NUM_READBACKS; ++i)
+    {
+        Readback &readback = _readbacks[(_nextReadback + i) % NUM_READBACKS];
+        if (!readback.fence)
+        {
+            continue;
+        }
+
+        GLenum result = ext->glClientWaitSync(readback.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+
+        ext->glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, readback.buffer);
+        const void *data = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+        if (data)
+        {
+            _resolvedIds.resize(size * size);
+            std::memcpy(_resolvedIds.data(), data, _resolvedIds.size() * sizeof(GLuint));
+            ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+
+            _resolvedRegion = readback.region;
+            std::swap(_resolvedObjects, readback.objects);
+        }
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    }
+#endif
+}
+
+} // namespace opeViewer
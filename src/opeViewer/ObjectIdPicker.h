@@ -0,0 +1,141 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_9957EDBFD3974005A0B3D3F547514B23_H_
+#define INC_2026_10_18_9957EDBFD3974005A0B3D3F547514B23_H_
+
+#include <vector>
+
+#include <osg/Camera>
+#include <osg/GLExtensions>
+#include <osg/Texture2D>
+#include <osg/View>
+#include <osg/observer_ptr>
+#include <osgGA/GUIEventAdapter>
+
+#include "ComputeIntersection.h"
+
+namespace opeViewer
+{
+
+class Viewport;
+
+/// 对象ID拾取
+///
+/// 在视口中加入一个渲染到R32UI纹理的从相机，只绘制鼠标周围(2 * radius + 1)²个像素，每个绘制对象写入自己的ID（从1开始，0为背景）
+///
+/// ID纹理在绘制结束后异步读回到PBO，之后的帧中读取完成的结果，鼠标停留在已读回的区域内并且相机和场景没有变化时，pick直接查表返回，不需要求交
+///
+/// 需要OpenGL 3.0（整数纹理）、PBO和同步对象，llvmpipe等软件渲染器同样支持，OpenGL ES中不可用
+///
+/// ID相机有自己的osg::Stats，剔除、绘制和GPU时间在统计中单独显示为一行，"Object ID drawables"为写入ID的绘制对象数量
+///
+/// \note 所有绘制对象使用同一个着色器，使用自定义顶点着色器的几何体（如GeometryInstancer的实例）按原始顶点位置绘制
+class ObjectIdPicker : public osg::Referenced
+{
+  public:
+    struct Result
+    {
+        /// 0表示鼠标下没有绘制对象
+        unsigned int objectId{};
+        /// 从场景根节点开始，到绘制对象结束，节点在场景修改前有效
+        osg::NodePath nodePath;
+        osg::Drawable *drawable{};
+        /// ID缓冲绘制时的帧号
+        unsigned int frameNumber{};
+    };
+
+    explicit ObjectIdPicker(Viewport *viewport, unsigned int radius = 3);
+
+    /// ID相机，已作为从相机加入视口
+    osg::Camera *getCamera() const;
+
+    unsigned int getRadius() const;
+
+    /// 在事件遍历中调用，记录鼠标位置，下一帧在该位置绘制ID缓冲
+    ///
+    /// \return 鼠标不在已读回的区域内，需要重绘
+    bool setPointer(const osgGA::GUIEventAdapter &ea);
+
+    /// 查找鼠标下的绘制对象
+    ///
+    /// \return false表示最近一次读回的结果不能用于该位置（鼠标离开了读回的区域、相机移动或场景修改），需要改用computeIntersections
+    bool pick(const osgGA::GUIEventAdapter &ea, Result &result) const;
+
+    /// 有还未读取的读回，需要再绘制一帧
+    bool hasPendingReadbacks() const;
+
+  protected:
+    ~ObjectIdPicker() override;
+
+    struct CullVisitor;
+    struct UpdateSlaveCallback;
+    struct ReadbackCallback;
+
+    /// 一帧ID缓冲对应的区域和状态
+    struct Region
+    {
+        bool valid{};
+        /// 区域中心在视口中的像素坐标
+        int x{};
+        int y{};
+        int width{};
+        int height{};
+        osg::Matrixd viewMatrix;
+        osg::Matrixd projectionMatrix;
+        unsigned int modifiedCount{};
+        unsigned int frameNumber{};
+
+        /// 位置、视口、相机矩阵和场景修改计数相同
+        bool isSame(const Region &other) const;
+    };
+
+    struct Readback
+    {
+        GLuint buffer{};
+        /// 非空表示读回还未读取
+        GLsync fence{};
+        Region region;
+        Selection objects;
+    };
+
+    static const unsigned int NUM_READBACKS = 3;
+
+    void updateSlave(osg::View &view, osg::View::Slave &slave);
+
+    osg::StateSet *getObjectIdStateSet(unsigned int objectId);
+
+    void readback(osg::RenderInfo &renderInfo);
+
+    void resolveReadbacks(osg::RenderInfo &renderInfo);
+
+    osg::observer_ptr<Viewport> _viewport;
+    osg::ref_ptr<osg::Camera> _camera;
+    osg::ref_ptr<osg::Texture2D> _texture;
+    unsigned int _radius{};
+
+    bool _pointerValid{};
+    int _pointerX{};
+    int _pointerY{};
+
+    /// 当前帧的区域和剔除时写入ID的绘制对象，第i个绘制对象的ID为i + 1
+    Region _region;
+    Selection _objects;
+    /// 最近一次开始读回的区域
+    Region _issuedRegion;
+    /// 第i个状态集设置ID i + 1，各帧复用
+    std::vector<osg::ref_ptr<osg::StateSet>> _objectIdStateSets;
+
+    Readback _readbacks[NUM_READBACKS];
+    unsigned int _nextReadback{};
+
+    /// 最近一次读取完成的结果
+    Region _resolvedRegion;
+    Selection _resolvedObjects;
+    std::vector<unsigned int> _resolvedIds;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_9957EDBFD3974005A0B3D3F547514B23_H_
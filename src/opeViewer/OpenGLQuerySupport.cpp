@@ -6,9 +6,39 @@
 
 #include <osg/Drawable>
 
+#include "Histogram.h"
+
+#ifndef GL_VERTICES_SUBMITTED_ARB
+#define GL_VERTICES_SUBMITTED_ARB 0x82EE
+#define GL_PRIMITIVES_SUBMITTED_ARB 0x82EF
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#define GL_CLIPPING_INPUT_PRIMITIVES_ARB 0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES_ARB 0x82F7
+#endif
+
 namespace opeViewer
 {
 
+namespace
+{
+
+/// 查询目标和写入Stats的属性名，顺序与PipelineStatisticsQuerySupport::Frame::queries相同
+struct PipelineStatisticsCounter
+{
+    GLenum target;
+    const char *attributeName;
+};
+
+const PipelineStatisticsCounter PIPELINE_STATISTICS_COUNTERS[] = {
+    {GL_VERTICES_SUBMITTED_ARB, "Vertices submitted"},
+    {GL_PRIMITIVES_SUBMITTED_ARB, "Primitives submitted"},
+    {GL_CLIPPING_INPUT_PRIMITIVES_ARB, "Clipping input primitives"},
+    {GL_CLIPPING_OUTPUT_PRIMITIVES_ARB, "Clipping output primitives"},
+    {GL_FRAGMENT_SHADER_INVOCATIONS_ARB, "Fragment shader invocations"},
+};
+
+} // namespace
+
 OpenGLQuerySupport::OpenGLQuerySupport() : _extensions(0)
 {
 }
@@ -18,68 +48,85 @@ void OpenGLQuerySupport::initialize(osg::State *state, osg::Timer_t /*startTick*
     _extensions = state->get<osg::GLExtensions>();
 }
 
+const std::vector<GPUPass> &OpenGLQuerySupport::getPasses() const
+{
+    return _passes;
+}
+
+int OpenGLQuerySupport::beginPass(const std::string & /*name*/, osg::State * /*state*/)
+{
+    return -1;
+}
+
+void OpenGLQuerySupport::endPass(int /*pass*/, osg::State * /*state*/)
+{
+}
+
 EXTQuerySupport::EXTQuerySupport() : _previousQueryTime(0.0)
 {
 }
 
-void EXTQuerySupport::checkQuery(osg::Stats *stats, osg::State * /*state*/, osg::Timer_t startTick)
+void EXTQuerySupport::checkQuery(osg::Stats *stats, osg::State * /*state*/, osg::Timer_t startTick, Histogram *gpuTimeHistogram)
 {
-    for (QueryFrameNumberList::iterator itr = _queryFrameNumberList.begin(); itr != _queryFrameNumberList.end();)
+    // 从最旧的开始，遇到未完成的停止
+    for (unsigned int i = 0; i < NUM_FRAMES; ++i)
     {
-        GLuint query = itr->first;
+        Frame &frame = _frames[(_nextFrame + i) % NUM_FRAMES];
+        if (!frame.pending)
+        {
+            continue;
+        }
+
         GLint available = 0;
-        _extensions->glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
-        if (available)
+        _extensions->glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
         {
-            GLuint64 timeElapsed = 0;
-            _extensions->glGetQueryObjectui64v(query, GL_QUERY_RESULT, &timeElapsed);
+            break;
+        }
 
-            double timeElapsedSeconds = double(timeElapsed) * 1e-9;
-            double currentTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
-            double estimatedEndTime = (_previousQueryTime + currentTime) * 0.5;
-            double estimatedBeginTime = estimatedEndTime - timeElapsedSeconds;
+        GLuint64 timeElapsed = 0;
+        _extensions->glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &timeElapsed);
 
-            stats->setAttribute(itr->second, "GPU draw begin time", estimatedBeginTime);
-            stats->setAttribute(itr->second, "GPU draw end time", estimatedEndTime);
-            stats->setAttribute(itr->second, "GPU draw time taken", timeElapsedSeconds);
+        double timeElapsedSeconds = double(timeElapsed) * 1e-9;
+        double currentTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        double estimatedEndTime = (_previousQueryTime + currentTime) * 0.5;
+        double estimatedBeginTime = estimatedEndTime - timeElapsedSeconds;
 
-            itr = _queryFrameNumberList.erase(itr);
-            _availableQueryObjects.push_back(query);
+        if (stats)
+        {
+            stats->setAttribute(frame.frameNumber, "GPU draw begin time", estimatedBeginTime);
+            stats->setAttribute(frame.frameNumber, "GPU draw end time", estimatedEndTime);
+            stats->setAttribute(frame.frameNumber, "GPU draw time taken", timeElapsedSeconds);
         }
-        else
+        if (gpuTimeHistogram)
         {
-            ++itr;
+            gpuTimeHistogram->record(timeElapsedSeconds);
         }
+
+        frame.pending = false;
     }
     _previousQueryTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
 }
 
-GLuint EXTQuerySupport::createQueryObject()
+void EXTQuerySupport::beginQuery(unsigned int frameNumber, osg::State * /*state*/)
 {
-    if (_availableQueryObjects.empty())
-    {
-        GLuint query;
-        _extensions->glGenQueries(1, &query);
-        return query;
-    }
-    else
+    Frame &frame = _frames[_nextFrame];
+    _nextFrame = (_nextFrame + 1) % NUM_FRAMES;
+
+    if (!frame.query)
     {
-        GLuint query = _availableQueryObjects.back();
-        _availableQueryObjects.pop_back();
-        return query;
+        _extensions->glGenQueries(1, &frame.query);
     }
-}
 
-void EXTQuerySupport::beginQuery(unsigned int frameNumber, osg::State * /*state*/)
-{
-    GLuint query = createQueryObject();
-    _extensions->glBeginQuery(GL_TIME_ELAPSED, query);
-    _queryFrameNumberList.push_back(QueryFrameNumberPair(query, frameNumber));
+    _extensions->glBeginQuery(GL_TIME_ELAPSED, frame.query);
+    frame.frameNumber = frameNumber;
+    frame.pending = false;
 }
 
 void EXTQuerySupport::endQuery(osg::State * /*state*/)
 {
     _extensions->glEndQuery(GL_TIME_ELAPSED);
+    _frames[(_nextFrame + NUM_FRAMES - 1) % NUM_FRAMES].pending = true;
 }
 
 void EXTQuerySupport::initialize(osg::State *state, osg::Timer_t startTick)
@@ -91,98 +138,223 @@ void EXTQuerySupport::initialize(osg::State *state, osg::Timer_t startTick)
 void ARBQuerySupport::initialize(osg::State *state, osg::Timer_t startTick)
 {
     OpenGLQuerySupport::initialize(state, startTick);
+    _timestampBits = state->getTimestampBits();
 }
 
 void ARBQuerySupport::beginQuery(unsigned int frameNumber, osg::State * /*state*/)
 {
-    QueryPair query;
-    if (_availableQueryObjects.empty())
+    Frame &frame = _frames[_nextFrame];
+    _nextFrame = (_nextFrame + 1) % NUM_FRAMES;
+
+    if (!frame.queries[0])
     {
-        _extensions->glGenQueries(1, &query.first);
-        _extensions->glGenQueries(1, &query.second);
+        _extensions->glGenQueries(NUM_QUERIES, frame.queries);
     }
-    else
+
+    // GPU当前时间戳，不等待之前的命令完成
+    GLint64 timestamp = 0;
+    _extensions->glGetInteger64v(GL_TIMESTAMP, &timestamp);
+    frame.referenceTick = osg::Timer::instance()->tick();
+    frame.referenceTimestamp = static_cast<GLuint64>(timestamp);
+
+    _extensions->glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+    frame.frameNumber = frameNumber;
+    frame.numPasses = 0;
+    frame.pending = false;
+    _currentFrame = &frame;
+    _passDepth = 0;
+}
+
+void ARBQuerySupport::endQuery(osg::State * /*state*/)
+{
+    if (!_currentFrame)
     {
-        query = _availableQueryObjects.back();
-        _availableQueryObjects.pop_back();
+        return;
     }
-    _extensions->glQueryCounter(query.first, GL_TIMESTAMP);
-    _queryFrameList.push_back(ActiveQuery(query, frameNumber));
+
+    _extensions->glQueryCounter(_currentFrame->queries[1], GL_TIMESTAMP);
+    _currentFrame->pending = true;
+    _currentFrame = nullptr;
 }
 
-void ARBQuerySupport::endQuery(osg::State * /*state*/)
+int ARBQuerySupport::beginPass(const std::string &name, osg::State * /*state*/)
 {
-    _extensions->glQueryCounter(_queryFrameList.back().queries.second, GL_TIMESTAMP);
+    if (!_currentFrame || _currentFrame->numPasses >= MAX_PASSES)
+    {
+        return -1;
+    }
+
+    unsigned int pass = _currentFrame->numPasses++;
+    // 字符串复用之前的容量
+    _currentFrame->passes[pass].name = name;
+    _currentFrame->passes[pass].depth = _passDepth++;
+    _extensions->glQueryCounter(_currentFrame->queries[2 + 2 * pass], GL_TIMESTAMP);
+    return static_cast<int>(pass);
 }
 
-void ARBQuerySupport::checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t /*startTick*/)
+void ARBQuerySupport::endPass(int pass, osg::State * /*state*/)
 {
-    for (QueryFrameList::iterator itr = _queryFrameList.begin(); itr != _queryFrameList.end();)
+    if (pass < 0 || !_currentFrame)
     {
+        return;
+    }
+
+    --_passDepth;
+    _extensions->glQueryCounter(_currentFrame->queries[3 + 2 * pass], GL_TIMESTAMP);
+}
+
+GLint64 ARBQuerySupport::timestampDelta(GLuint64 from, GLuint64 to) const
+{
+    if (_timestampBits <= 0 || _timestampBits >= 64)
+    {
+        return static_cast<GLint64>(to - from);
+    }
+
+    // 按位数取模，超过半个周期的视为负数
+    const GLuint64 one = 1;
+    GLuint64 delta = (to - from) & ((one << _timestampBits) - 1);
+    if (delta >= (one << (_timestampBits - 1)))
+    {
+        return static_cast<GLint64>(delta) - static_cast<GLint64>(one << _timestampBits);
+    }
+    return static_cast<GLint64>(delta);
+}
+
+void ARBQuerySupport::checkQuery(osg::Stats *stats, osg::State * /*state*/, osg::Timer_t startTick, Histogram *gpuTimeHistogram)
+{
+    // 从最旧的开始，遇到未完成的停止
+    for (unsigned int i = 0; i < NUM_FRAMES; ++i)
+    {
+        Frame &frame = _frames[(_nextFrame + i) % NUM_FRAMES];
+        if (!frame.pending)
+        {
+            continue;
+        }
+
+        // 绘制结束的时间戳最后写入，可用时其它的也可用
         GLint available = 0;
-        // If the end query is available, the begin query must be too.
-        _extensions->glGetQueryObjectiv(itr->queries.second, GL_QUERY_RESULT_AVAILABLE, &available);
-        if (available)
+        _extensions->glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        double referenceTime = osg::Timer::instance()->delta_s(startTick, frame.referenceTick);
+        auto toTime = [&](GLuint query) {
+            GLuint64 timestamp = 0;
+            _extensions->glGetQueryObjectui64v(query, GL_QUERY_RESULT, &timestamp);
+            return referenceTime + double(timestampDelta(frame.referenceTimestamp, timestamp)) * 1e-9;
+        };
+
+        double beginTime = toTime(frame.queries[0]);
+        double endTime = toTime(frame.queries[1]);
+        double timeElapsedSeconds = endTime - beginTime;
+
+        if (stats)
+        {
+            stats->setAttribute(frame.frameNumber, "GPU draw begin time", beginTime);
+            stats->setAttribute(frame.frameNumber, "GPU draw end time", endTime);
+            stats->setAttribute(frame.frameNumber, "GPU draw time taken", timeElapsedSeconds);
+        }
+        if (gpuTimeHistogram)
+        {
+            gpuTimeHistogram->record(timeElapsedSeconds);
+        }
+
+        if (frame.numPasses > 0)
         {
-            QueryPair queries = itr->queries;
-            GLuint64 beginTimestamp = 0;
-            GLuint64 endTimestamp = 0;
-            _extensions->glGetQueryObjectui64v(queries.first, GL_QUERY_RESULT, &beginTimestamp);
-            _extensions->glGetQueryObjectui64v(queries.second, GL_QUERY_RESULT, &endTimestamp);
-            GLuint64 gpuTimestamp = state->getGpuTimestamp();
-            // Have any of the timestamps wrapped around?
-            int tbits = state->getTimestampBits();
-            if (tbits < 64)
+            // 复用之前的容量
+            _passes.resize(frame.numPasses);
+            for (unsigned int j = 0; j < frame.numPasses; ++j)
             {
-                // If the high bits on any of the timestamp bits are
-                // different then the counters may have wrapped.
-                const int hiShift = (tbits - 1);
-                const GLuint64 one = 1;
-                const GLuint64 hiMask = one << hiShift;
-                const GLuint64 sum = (beginTimestamp >> hiShift) + (endTimestamp >> hiShift) + (gpuTimestamp >> hiShift);
-                if (sum == 1 || sum == 2)
-                {
-                    const GLuint64 wrapAdd = one << tbits;
-                    // Counter wrapped between begin and end?
-                    if (beginTimestamp > endTimestamp)
-                    {
-                        endTimestamp += wrapAdd;
-                    }
-                    else if (gpuTimestamp < beginTimestamp && beginTimestamp - gpuTimestamp > (hiMask >> 1))
-                    {
-                        gpuTimestamp += wrapAdd;
-                    }
-                    else if (endTimestamp < gpuTimestamp && gpuTimestamp - endTimestamp > (hiMask >> 1))
-                    {
-                        beginTimestamp += wrapAdd;
-                        endTimestamp += wrapAdd;
-                    }
-                }
+                GPUPass &pass = _passes[j];
+                pass.name = frame.passes[j].name;
+                pass.depth = frame.passes[j].depth;
+                pass.beginTime = toTime(frame.queries[2 + 2 * j]);
+                pass.endTime = toTime(frame.queries[3 + 2 * j]);
             }
-            GLuint64 timeElapsed = endTimestamp - beginTimestamp;
-            double timeElapsedSeconds = double(timeElapsed) * 1e-9;
-            double gpuTick = state->getGpuTime();
-            double beginTime = 0.0;
-            double endTime = 0.0;
-            if (beginTimestamp > gpuTimestamp)
-                beginTime = gpuTick + double(beginTimestamp - gpuTimestamp) * 1e-9;
-            else
-                beginTime = gpuTick - double(gpuTimestamp - beginTimestamp) * 1e-9;
-            if (endTimestamp > gpuTimestamp)
-                endTime = gpuTick + double(endTimestamp - gpuTimestamp) * 1e-9;
-            else
-                endTime = gpuTick - double(gpuTimestamp - endTimestamp) * 1e-9;
-            stats->setAttribute(itr->frameNumber, "GPU draw begin time", beginTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw end time", endTime);
-            stats->setAttribute(itr->frameNumber, "GPU draw time taken", timeElapsedSeconds);
-            itr = _queryFrameList.erase(itr);
-            _availableQueryObjects.push_back(queries);
         }
-        else
+
+        frame.pending = false;
+    }
+}
+
+bool PipelineStatisticsQuerySupport::isSupported(osg::State *state)
+{
+    return osg::isGLExtensionOrVersionSupported(state->getContextID(), "GL_ARB_pipeline_statistics_query", 4.6f);
+}
+
+void PipelineStatisticsQuerySupport::initialize(osg::State *state)
+{
+    _extensions = state->get<osg::GLExtensions>();
+}
+
+void PipelineStatisticsQuerySupport::checkQuery(osg::Stats *stats, osg::State * /*state*/)
+{
+    static_assert(sizeof(PIPELINE_STATISTICS_COUNTERS) / sizeof(PIPELINE_STATISTICS_COUNTERS[0]) == NUM_COUNTERS, "");
+
+    // 从最旧的开始，遇到未完成的停止
+    for (unsigned int i = 0; i < NUM_FRAMES; ++i)
+    {
+        Frame &frame = _frames[(_nextFrame + i) % NUM_FRAMES];
+        if (!frame.pending)
+        {
+            continue;
+        }
+
+        // 同时结束，最后一个可用时其它的也可用
+        GLint available = 0;
+        _extensions->glGetQueryObjectiv(frame.queries[NUM_COUNTERS - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        for (unsigned int j = 0; j < NUM_COUNTERS; ++j)
         {
-            ++itr;
+            GLuint64 value = 0;
+            _extensions->glGetQueryObjectui64v(frame.queries[j], GL_QUERY_RESULT, &value);
+            if (stats)
+            {
+                stats->setAttribute(frame.frameNumber, PIPELINE_STATISTICS_COUNTERS[j].attributeName, static_cast<double>(value));
+            }
         }
+        frame.pending = false;
+    }
+}
+
+void PipelineStatisticsQuerySupport::beginQuery(unsigned int frameNumber, osg::State * /*state*/)
+{
+    Frame &frame = _frames[_nextFrame];
+    _nextFrame = (_nextFrame + 1) % NUM_FRAMES;
+
+    if (!frame.queries[0])
+    {
+        _extensions->glGenQueries(NUM_COUNTERS, frame.queries);
+    }
+
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        _extensions->glBeginQuery(PIPELINE_STATISTICS_COUNTERS[i].target, frame.queries[i]);
+    }
+    frame.frameNumber = frameNumber;
+    frame.pending = false;
+    _active = true;
+}
+
+void PipelineStatisticsQuerySupport::endQuery(osg::State * /*state*/)
+{
+    if (!_active)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        _extensions->glEndQuery(PIPELINE_STATISTICS_COUNTERS[i].target);
     }
+    _frames[(_nextFrame + NUM_FRAMES - 1) % NUM_FRAMES].pending = true;
+    _active = false;
 }
 
 } // namespace opeViewer
@@ -5,7 +5,8 @@
 #ifndef INC_2023_12_18_F357EA5F504C4C77ACF0EDAA255961FD_H_
 #define INC_2023_12_18_F357EA5F504C4C77ACF0EDAA255961FD_H_
 
-#include <list>
+#include <string>
+#include <vector>
 
 #include <osg/GLExtensions>
 #include <osg/Referenced>
@@ -15,76 +16,157 @@
 namespace opeViewer
 {
 
-/// 从osgViewer拷贝
+class Histogram;
+
+/// GPU上一个绘制过程的时间，时间相对窗口的startTick
+struct GPUPass
+{
+    std::string name;
+    /// 嵌套深度，渲染阶段为0，其中的渲染箱为1，以此类推
+    unsigned int depth{};
+    double beginTime{};
+    double endTime{};
+};
+
+/// GPU时间查询，改自osgViewer
+///
+/// 每帧一组查询，NUM_FRAMES组循环使用，不在每帧分配内存；checkQuery不等待，复用时仍未可用的一组丢弃
 class OpenGLQuerySupport : public osg::Referenced
 {
   public:
     OpenGLQuerySupport();
 
-    virtual void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick) = 0;
+    /// stats或gpuTimeHistogram为空时不记录到其中
+    virtual void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick, Histogram *gpuTimeHistogram) = 0;
 
     virtual void beginQuery(unsigned int frameNumber, osg::State *state) = 0;
     virtual void endQuery(osg::State *state) = 0;
     virtual void initialize(osg::State *state, osg::Timer_t startTick);
 
+    /// 在beginQuery和endQuery之间开始一个绘制过程（渲染阶段、渲染箱），可以嵌套，返回过程的序号，不支持或已满时返回-1
+    virtual int beginPass(const std::string &name, osg::State *state);
+    virtual void endPass(int pass, osg::State *state);
+
+    /// 最近一次读取完成的帧的各绘制过程，在图形线程中写入，需要在两帧之间读取
+    const std::vector<GPUPass> &getPasses() const;
+
   protected:
+    static const unsigned int NUM_FRAMES = 4;
+
     const osg::GLExtensions *_extensions;
+
+    /// 当前嵌套深度
+    unsigned int _passDepth{};
+    std::vector<GPUPass> _passes;
 };
 
+/// GL_EXT_timer_query，只能测量整个绘制的耗时，不记录各绘制过程
 class EXTQuerySupport : public OpenGLQuerySupport
 {
   public:
     EXTQuerySupport();
-    void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick);
-    virtual void beginQuery(unsigned int frameNumber, osg::State *state);
-    virtual void endQuery(osg::State *state);
-    virtual void initialize(osg::State *state, osg::Timer_t startTick);
+    void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick, Histogram *gpuTimeHistogram) override;
+    void beginQuery(unsigned int frameNumber, osg::State *state) override;
+    void endQuery(osg::State *state) override;
+    void initialize(osg::State *state, osg::Timer_t startTick) override;
 
   protected:
-    GLuint createQueryObject();
-    typedef std::pair<GLuint, unsigned int> QueryFrameNumberPair;
-    typedef std::list<QueryFrameNumberPair> QueryFrameNumberList;
-    typedef std::vector<GLuint> QueryList;
+    struct Frame
+    {
+        GLuint query{};
+        unsigned int frameNumber{};
+        /// 已结束、还未读取
+        bool pending{};
+    };
 
-    QueryFrameNumberList _queryFrameNumberList;
-    QueryList _availableQueryObjects;
+    Frame _frames[NUM_FRAMES];
+    unsigned int _nextFrame{};
     double _previousQueryTime;
 };
 
+/// GL_ARB_timer_query，用时间戳测量整个绘制和各绘制过程
+///
+/// 每帧开始时读取一次GPU当前时间戳，与CPU时间对应，将时间戳换算到CPU时间线
 class ARBQuerySupport : public OpenGLQuerySupport
 {
   public:
-    virtual void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick);
+    void checkQuery(osg::Stats *stats, osg::State *state, osg::Timer_t startTick, Histogram *gpuTimeHistogram) override;
 
-    virtual void beginQuery(unsigned int frameNumber, osg::State *state);
-    virtual void endQuery(osg::State *state);
-    virtual void initialize(osg::State *state, osg::Timer_t startTick);
+    void beginQuery(unsigned int frameNumber, osg::State *state) override;
+    void endQuery(osg::State *state) override;
+    void initialize(osg::State *state, osg::Timer_t startTick) override;
+
+    int beginPass(const std::string &name, osg::State *state) override;
+    void endPass(int pass, osg::State *state) override;
 
   protected:
-    typedef std::pair<GLuint, GLuint> QueryPair;
+    /// 每帧最多记录的绘制过程，超出的不记录
+    static const unsigned int MAX_PASSES = 63;
+    /// 整个绘制的开始和结束，以及各过程的开始和结束
+    static const unsigned int NUM_QUERIES = 2 + 2 * MAX_PASSES;
 
-    struct ActiveQuery
+    struct Pass
     {
-        ActiveQuery() : queries(0, 0), frameNumber(0)
-        {
-        }
+        std::string name;
+        unsigned int depth{};
+    };
 
-        ActiveQuery(GLuint start_, GLuint end_, int frameNumber_) : queries(start_, end_), frameNumber(frameNumber_)
-        {
-        }
+    struct Frame
+    {
+        GLuint queries[NUM_QUERIES]{};
+        Pass passes[MAX_PASSES];
+        unsigned int numPasses{};
+        unsigned int frameNumber{};
+        /// 已结束、还未读取
+        bool pending{};
+        /// beginQuery时的CPU时间和GPU时间戳
+        osg::Timer_t referenceTick{};
+        GLuint64 referenceTimestamp{};
+    };
 
-        ActiveQuery(const QueryPair &queries_, unsigned int frameNumber_) : queries(queries_), frameNumber(frameNumber_)
-        {
-        }
+    /// 计时器位数不足64时处理回绕
+    GLint64 timestampDelta(GLuint64 from, GLuint64 to) const;
+
+    Frame _frames[NUM_FRAMES];
+    unsigned int _nextFrame{};
+    /// beginQuery后、endQuery前为正在记录的帧
+    Frame *_currentFrame{};
+    int _timestampBits{64};
+};
+
+/// GL_ARB_pipeline_statistics_query，统计相机每帧绘制提交的顶点和图元、裁剪前后的图元以及片元着色器调用次数
+///
+/// 每帧一组查询，NUM_FRAMES组循环使用，不分配内存；checkQuery不等待，结果可用的帧写入stats，复用时仍未可用的一组丢弃
+class PipelineStatisticsQuerySupport : public osg::Referenced
+{
+  public:
+    /// GL 4.6或有GL_ARB_pipeline_statistics_query
+    static bool isSupported(osg::State *state);
 
-        QueryPair queries;
-        unsigned int frameNumber;
+    void initialize(osg::State *state);
+
+    void checkQuery(osg::Stats *stats, osg::State *state);
+
+    void beginQuery(unsigned int frameNumber, osg::State *state);
+    void endQuery(osg::State *state);
+
+  protected:
+    static const unsigned int NUM_COUNTERS = 5;
+    static const unsigned int NUM_FRAMES = 4;
+
+    struct Frame
+    {
+        GLuint queries[NUM_COUNTERS]{};
+        unsigned int frameNumber{};
+        /// 已结束、还未读取
+        bool pending{};
     };
 
-    typedef std::list<ActiveQuery> QueryFrameList;
-    typedef std::vector<QueryPair> QueryList;
-    QueryFrameList _queryFrameList;
-    QueryList _availableQueryObjects;
+    const osg::GLExtensions *_extensions{};
+    Frame _frames[NUM_FRAMES];
+    unsigned int _nextFrame{};
+    /// beginQuery后、endQuery前
+    bool _active{};
 };
 
 } // namespace opeViewer
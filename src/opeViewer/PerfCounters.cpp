@@ -0,0 +1,193 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "PerfCounters.h"
+
+#include <algorithm>
+
+#include <osg/Notify>
+#include <osg/Stats>
+#include <osg/ref_ptr>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace opeViewer
+{
+
+namespace
+{
+
+#ifdef __linux__
+const uint64_t PERF_CONFIGS[PerfCounters::NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+int openPerfEvent(uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // 当前线程，任意CPU；子进程不继承
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+} // namespace
+
+PerfCounters *PerfCounters::getThreadInstance()
+{
+    thread_local osg::ref_ptr<PerfCounters> instance = new PerfCounters;
+    return instance.get();
+}
+
+const char *PerfCounters::getCounterName(Counter counter)
+{
+    switch (counter)
+    {
+    case CYCLES:
+        return "cycles";
+    case INSTRUCTIONS:
+        return "instructions";
+    case LLC_MISSES:
+        return "LLC misses";
+    case BRANCH_MISSES:
+        return "branch misses";
+    default:
+        return "";
+    }
+}
+
+PerfCounters::PerfCounters()
+{
+    for (int &fd : _fds)
+    {
+        fd = -1;
+    }
+
+#ifdef __linux__
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        _fds[i] = openPerfEvent(PERF_CONFIGS[i], _fds[CYCLES]);
+        if (_fds[i] < 0)
+        {
+            OSG_INFO << "PerfCounters::PerfCounters() perf_event_open failed for " << getCounterName(static_cast<Counter>(i)) << ": " << std::strerror(errno) << std::endl;
+
+            for (int &fd : _fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            return;
+        }
+    }
+
+    ioctl(_fds[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : _fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::isValid() const
+{
+    return _fds[CYCLES] >= 0;
+}
+
+bool PerfCounters::read(Sample &sample) const
+{
+#ifdef __linux__
+    if (!isValid())
+    {
+        return false;
+    }
+
+    // 数量、启用时间、计数时间，之后按打开顺序的各个值
+    uint64_t buffer[3 + NUM_COUNTERS];
+    if (::read(_fds[CYCLES], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) || buffer[0] != NUM_COUNTERS)
+    {
+        return false;
+    }
+
+    sample.timeEnabled = buffer[1];
+    sample.timeRunning = buffer[2];
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        sample.values[i] = buffer[3 + i];
+    }
+    return true;
+#else
+    (void)sample;
+    return false;
+#endif
+}
+
+PerfCounters::AttributeNames::AttributeNames(const char *phase)
+{
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        counters[i] = std::string(phase) + " " + getCounterName(static_cast<Counter>(i));
+    }
+    runningRatio = std::string(phase) + " perf running ratio";
+}
+
+void PerfCounters::setAttributes(osg::Stats *stats, unsigned int frameNumber, const AttributeNames &names, const Sample &begin, const Sample &end, bool accumulate)
+{
+    uint64_t timeEnabled = end.timeEnabled - begin.timeEnabled;
+    uint64_t timeRunning = end.timeRunning - begin.timeRunning;
+    double ratio = timeEnabled > 0 ? static_cast<double>(timeRunning) / static_cast<double>(timeEnabled) : 1.0;
+
+    double previousRatio = 0.0;
+    if (accumulate && stats->getAttribute(frameNumber, names.runningRatio, previousRatio))
+    {
+        ratio = std::min(ratio, previousRatio);
+    }
+    stats->setAttribute(frameNumber, names.runningRatio, ratio);
+
+    // 没有计数，无法估计
+    if (timeRunning == 0)
+    {
+        return;
+    }
+
+    double scale = timeEnabled > timeRunning ? static_cast<double>(timeEnabled) / static_cast<double>(timeRunning) : 1.0;
+    for (unsigned int i = 0; i < NUM_COUNTERS; ++i)
+    {
+        double value = static_cast<double>(end.values[i] - begin.values[i]) * scale;
+        double previousValue = 0.0;
+        if (accumulate && stats->getAttribute(frameNumber, names.counters[i], previousValue))
+        {
+            value += previousValue;
+        }
+        stats->setAttribute(frameNumber, names.counters[i], value);
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,84 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_A368F97CA77B4D0AB7C79DA4039CD589_H_
+#define INC_2026_10_18_A368F97CA77B4D0AB7C79DA4039CD589_H_
+
+#include <cstdint>
+#include <string>
+
+#include <osg/Referenced>
+
+namespace osg
+{
+class Stats;
+} // namespace osg
+
+namespace opeViewer
+{
+
+/// CPU硬件性能计数器，用Linux的perf_event_open统计调用线程的周期、指令、LLC未命中和分支预测失败
+///
+/// 四个计数器为一组，同时启停、一次读取，只计用户态；非Linux、没有PMU（如部分虚拟机）或perf_event_paranoid不允许时不可用
+///
+/// 计数器不足时内核会复用，读数按组实际计数的时间比例放大，比例写入"<phase> perf running ratio"
+class PerfCounters : public osg::Referenced
+{
+  public:
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        NUM_COUNTERS,
+    };
+
+    struct Sample
+    {
+        uint64_t values[NUM_COUNTERS]{};
+        /// 组启用的时间和实际计数的时间（纳秒），复用时后者较小
+        uint64_t timeEnabled{};
+        uint64_t timeRunning{};
+    };
+
+    /// 一个阶段的属性名，构造时生成，之后每帧复用，如 static const PerfCounters::AttributeNames names("Cull");
+    struct AttributeNames
+    {
+        explicit AttributeNames(const char *phase);
+
+        /// "<phase> cycles"等
+        std::string counters[NUM_COUNTERS];
+        /// "<phase> perf running ratio"
+        std::string runningRatio;
+    };
+
+    /// 调用线程的计数器，第一次调用时打开
+    static PerfCounters *getThreadInstance();
+
+    /// 属性名中的计数器名，如"cycles"
+    static const char *getCounterName(Counter counter);
+
+    /// 打开调用线程的计数器
+    PerfCounters();
+
+    bool isValid() const;
+
+    /// 读取当前计数，不可用时返回false
+    bool read(Sample &sample) const;
+
+    /// 将end - begin按计数时间的比例放大后写入"<phase> cycles"、"<phase> instructions"等属性，比例写入"<phase> perf running ratio"（1为没有复用）；
+    /// 其间完全没有计数时只写入比例0；accumulate时加到已有的值上，比例取最小值（用于一帧中的多个事件）
+    static void setAttributes(osg::Stats *stats, unsigned int frameNumber, const AttributeNames &names, const Sample &begin, const Sample &end, bool accumulate = false);
+
+  protected:
+    ~PerfCounters() override;
+
+    /// 组长为CYCLES
+    int _fds[NUM_COUNTERS];
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_A368F97CA77B4D0AB7C79DA4039CD589_H_
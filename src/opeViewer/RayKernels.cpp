@@ -0,0 +1,415 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "RayKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OPEVIEWER_RAY_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OPEVIEWER_TARGET(isa)
+#else
+#define OPEVIEWER_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace opeViewer
+{
+
+namespace
+{
+
+const unsigned int N = RayKernels::NUM_LANES;
+
+/// 重心坐标的容差，保证筛选不漏报
+const float BARYCENTRIC_EPSILON = 1e-4f;
+
+/// 避免0 * inf
+const float LARGE_INVERSE = 1e30f;
+
+unsigned int intersectTrianglesScalar(const RayKernels::Ray &ray, const float *triangles, float *t)
+{
+    const float *o = ray.origin;
+    const float *d = ray.direction;
+
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; ++i)
+    {
+        float v0[3] = {triangles[0 * N + i], triangles[1 * N + i], triangles[2 * N + i]};
+        float e1[3] = {triangles[3 * N + i], triangles[4 * N + i], triangles[5 * N + i]};
+        float e2[3] = {triangles[6 * N + i], triangles[7 * N + i], triangles[8 * N + i]};
+
+        // Möller–Trumbore
+        float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det == 0.0f)
+        {
+            continue;
+        }
+        float inverseDet = 1.0f / det;
+
+        float s[3] = {o[0] - v0[0], o[1] - v0[1], o[2] - v0[2]};
+        float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDet;
+
+        float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+        float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverseDet;
+        float tt = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDet;
+
+        if (u >= -BARYCENTRIC_EPSILON && v >= -BARYCENTRIC_EPSILON && u + v <= 1.0f + BARYCENTRIC_EPSILON && tt >= ray.tMin && tt <= ray.tMax)
+        {
+            mask |= 1u << i;
+            t[i] = tt;
+        }
+    }
+    return mask;
+}
+
+unsigned int intersectBoxesScalar(const RayKernels::Ray &ray, const float *boxes)
+{
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; ++i)
+    {
+        float tNear = ray.tMin;
+        float tFar = ray.tMax;
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (boxes[axis * N + i] - ray.origin[axis]) * ray.inverseDirection[axis];
+            float t1 = (boxes[(axis + 3) * N + i] - ray.origin[axis]) * ray.inverseDirection[axis];
+            tNear = std::max(tNear, std::min(t0, t1));
+            tFar = std::min(tFar, std::max(t0, t1));
+        }
+        if (tNear <= tFar)
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+#ifdef OPEVIEWER_RAY_KERNELS_X86
+
+OPEVIEWER_TARGET("sse2")
+unsigned int intersectTrianglesSSE(const RayKernels::Ray &ray, const float *triangles, float *t)
+{
+    const __m128 ox = _mm_set1_ps(ray.origin[0]), oy = _mm_set1_ps(ray.origin[1]), oz = _mm_set1_ps(ray.origin[2]);
+    const __m128 dx = _mm_set1_ps(ray.direction[0]), dy = _mm_set1_ps(ray.direction[1]), dz = _mm_set1_ps(ray.direction[2]);
+    const __m128 tMin = _mm_set1_ps(ray.tMin), tMax = _mm_set1_ps(ray.tMax);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 minusEpsilon = _mm_set1_ps(-BARYCENTRIC_EPSILON), onePlusEpsilon = _mm_set1_ps(1.0f + BARYCENTRIC_EPSILON);
+
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; i += 4)
+    {
+        __m128 v0x = _mm_loadu_ps(triangles + 0 * N + i), v0y = _mm_loadu_ps(triangles + 1 * N + i), v0z = _mm_loadu_ps(triangles + 2 * N + i);
+        __m128 e1x = _mm_loadu_ps(triangles + 3 * N + i), e1y = _mm_loadu_ps(triangles + 4 * N + i), e1z = _mm_loadu_ps(triangles + 5 * N + i);
+        __m128 e2x = _mm_loadu_ps(triangles + 6 * N + i), e2y = _mm_loadu_ps(triangles + 7 * N + i), e2z = _mm_loadu_ps(triangles + 8 * N + i);
+
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 valid = _mm_cmpneq_ps(det, zero);
+        __m128 inverseDet = _mm_div_ps(one, det);
+
+        __m128 sx = _mm_sub_ps(ox, v0x), sy = _mm_sub_ps(oy, v0y), sz = _mm_sub_ps(oz, v0z);
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+        __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(u, minusEpsilon));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(v, minusEpsilon));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), onePlusEpsilon));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(tt, tMin));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(tt, tMax));
+
+        _mm_storeu_ps(t + i, tt);
+        mask |= static_cast<unsigned int>(_mm_movemask_ps(valid)) << i;
+    }
+    return mask;
+}
+
+OPEVIEWER_TARGET("sse2")
+unsigned int intersectBoxesSSE(const RayKernels::Ray &ray, const float *boxes)
+{
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; i += 4)
+    {
+        __m128 tNear = _mm_set1_ps(ray.tMin);
+        __m128 tFar = _mm_set1_ps(ray.tMax);
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            __m128 o = _mm_set1_ps(ray.origin[axis]);
+            __m128 inverseDirection = _mm_set1_ps(ray.inverseDirection[axis]);
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes + axis * N + i), o), inverseDirection);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes + (axis + 3) * N + i), o), inverseDirection);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+        }
+        mask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar))) << i;
+    }
+    return mask;
+}
+
+OPEVIEWER_TARGET("avx2")
+unsigned int intersectTrianglesAVX2(const RayKernels::Ray &ray, const float *triangles, float *t)
+{
+    const __m256 ox = _mm256_set1_ps(ray.origin[0]), oy = _mm256_set1_ps(ray.origin[1]), oz = _mm256_set1_ps(ray.origin[2]);
+    const __m256 dx = _mm256_set1_ps(ray.direction[0]), dy = _mm256_set1_ps(ray.direction[1]), dz = _mm256_set1_ps(ray.direction[2]);
+    const __m256 tMin = _mm256_set1_ps(ray.tMin), tMax = _mm256_set1_ps(ray.tMax);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 minusEpsilon = _mm256_set1_ps(-BARYCENTRIC_EPSILON), onePlusEpsilon = _mm256_set1_ps(1.0f + BARYCENTRIC_EPSILON);
+
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; i += 8)
+    {
+        __m256 v0x = _mm256_loadu_ps(triangles + 0 * N + i), v0y = _mm256_loadu_ps(triangles + 1 * N + i), v0z = _mm256_loadu_ps(triangles + 2 * N + i);
+        __m256 e1x = _mm256_loadu_ps(triangles + 3 * N + i), e1y = _mm256_loadu_ps(triangles + 4 * N + i), e1z = _mm256_loadu_ps(triangles + 5 * N + i);
+        __m256 e2x = _mm256_loadu_ps(triangles + 6 * N + i), e2y = _mm256_loadu_ps(triangles + 7 * N + i), e2z = _mm256_loadu_ps(triangles + 8 * N + i);
+
+        __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+        __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+        __m256 valid = _mm256_cmp_ps(det, zero, _CMP_NEQ_UQ);
+        __m256 inverseDet = _mm256_div_ps(one, det);
+
+        __m256 sx = _mm256_sub_ps(ox, v0x), sy = _mm256_sub_ps(oy, v0y), sz = _mm256_sub_ps(oz, v0z);
+        __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), inverseDet);
+
+        __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+        __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+        __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverseDet);
+        __m256 tt = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverseDet);
+
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, minusEpsilon, _CMP_GE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(v, minusEpsilon, _CMP_GE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_add_ps(u, v), onePlusEpsilon, _CMP_LE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(tt, tMin, _CMP_GE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(tt, tMax, _CMP_LE_OQ));
+
+        _mm256_storeu_ps(t + i, tt);
+        mask |= static_cast<unsigned int>(_mm256_movemask_ps(valid)) << i;
+    }
+    return mask;
+}
+
+OPEVIEWER_TARGET("avx2")
+unsigned int intersectBoxesAVX2(const RayKernels::Ray &ray, const float *boxes)
+{
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < N; i += 8)
+    {
+        __m256 tNear = _mm256_set1_ps(ray.tMin);
+        __m256 tFar = _mm256_set1_ps(ray.tMax);
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            __m256 o = _mm256_set1_ps(ray.origin[axis]);
+            __m256 inverseDirection = _mm256_set1_ps(ray.inverseDirection[axis]);
+            __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(boxes + axis * N + i), o), inverseDirection);
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(boxes + (axis + 3) * N + i), o), inverseDirection);
+            tNear = _mm256_max_ps(tNear, _mm256_min_ps(t0, t1));
+            tFar = _mm256_min_ps(tFar, _mm256_max_ps(t0, t1));
+        }
+        mask |= static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ))) << i;
+    }
+    return mask;
+}
+
+OPEVIEWER_TARGET("avx512f")
+unsigned int intersectTrianglesAVX512(const RayKernels::Ray &ray, const float *triangles, float *t)
+{
+    const __m512 dx = _mm512_set1_ps(ray.direction[0]), dy = _mm512_set1_ps(ray.direction[1]), dz = _mm512_set1_ps(ray.direction[2]);
+
+    __m512 v0x = _mm512_loadu_ps(triangles + 0 * N), v0y = _mm512_loadu_ps(triangles + 1 * N), v0z = _mm512_loadu_ps(triangles + 2 * N);
+    __m512 e1x = _mm512_loadu_ps(triangles + 3 * N), e1y = _mm512_loadu_ps(triangles + 4 * N), e1z = _mm512_loadu_ps(triangles + 5 * N);
+    __m512 e2x = _mm512_loadu_ps(triangles + 6 * N), e2y = _mm512_loadu_ps(triangles + 7 * N), e2z = _mm512_loadu_ps(triangles + 8 * N);
+
+    __m512 px = _mm512_sub_ps(_mm512_mul_ps(dy, e2z), _mm512_mul_ps(dz, e2y));
+    __m512 py = _mm512_sub_ps(_mm512_mul_ps(dz, e2x), _mm512_mul_ps(dx, e2z));
+    __m512 pz = _mm512_sub_ps(_mm512_mul_ps(dx, e2y), _mm512_mul_ps(dy, e2x));
+    __m512 det = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(e1x, px), _mm512_mul_ps(e1y, py)), _mm512_mul_ps(e1z, pz));
+    __mmask16 valid = _mm512_cmp_ps_mask(det, _mm512_setzero_ps(), _CMP_NEQ_UQ);
+    __m512 inverseDet = _mm512_div_ps(_mm512_set1_ps(1.0f), det);
+
+    __m512 sx = _mm512_sub_ps(_mm512_set1_ps(ray.origin[0]), v0x);
+    __m512 sy = _mm512_sub_ps(_mm512_set1_ps(ray.origin[1]), v0y);
+    __m512 sz = _mm512_sub_ps(_mm512_set1_ps(ray.origin[2]), v0z);
+    __m512 u = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sx, px), _mm512_mul_ps(sy, py)), _mm512_mul_ps(sz, pz)), inverseDet);
+
+    __m512 qx = _mm512_sub_ps(_mm512_mul_ps(sy, e1z), _mm512_mul_ps(sz, e1y));
+    __m512 qy = _mm512_sub_ps(_mm512_mul_ps(sz, e1x), _mm512_mul_ps(sx, e1z));
+    __m512 qz = _mm512_sub_ps(_mm512_mul_ps(sx, e1y), _mm512_mul_ps(sy, e1x));
+    __m512 v = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, qx), _mm512_mul_ps(dy, qy)), _mm512_mul_ps(dz, qz)), inverseDet);
+    __m512 tt = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(e2x, qx), _mm512_mul_ps(e2y, qy)), _mm512_mul_ps(e2z, qz)), inverseDet);
+
+    const __m512 minusEpsilon = _mm512_set1_ps(-BARYCENTRIC_EPSILON);
+    valid = _mm512_mask_cmp_ps_mask(valid, u, minusEpsilon, _CMP_GE_OQ);
+    valid = _mm512_mask_cmp_ps_mask(valid, v, minusEpsilon, _CMP_GE_OQ);
+    valid = _mm512_mask_cmp_ps_mask(valid, _mm512_add_ps(u, v), _mm512_set1_ps(1.0f + BARYCENTRIC_EPSILON), _CMP_LE_OQ);
+    valid = _mm512_mask_cmp_ps_mask(valid, tt, _mm512_set1_ps(ray.tMin), _CMP_GE_OQ);
+    valid = _mm512_mask_cmp_ps_mask(valid, tt, _mm512_set1_ps(ray.tMax), _CMP_LE_OQ);
+
+    _mm512_storeu_ps(t, tt);
+    return valid;
+}
+
+OPEVIEWER_TARGET("avx512f")
+unsigned int intersectBoxesAVX512(const RayKernels::Ray &ray, const float *boxes)
+{
+    __m512 tNear = _mm512_set1_ps(ray.tMin);
+    __m512 tFar = _mm512_set1_ps(ray.tMax);
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        __m512 o = _mm512_set1_ps(ray.origin[axis]);
+        __m512 inverseDirection = _mm512_set1_ps(ray.inverseDirection[axis]);
+        __m512 t0 = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(boxes + axis * N), o), inverseDirection);
+        __m512 t1 = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(boxes + (axis + 3) * N), o), inverseDirection);
+        tNear = _mm512_max_ps(tNear, _mm512_min_ps(t0, t1));
+        tFar = _mm512_min_ps(tFar, _mm512_max_ps(t0, t1));
+    }
+    return _mm512_cmp_ps_mask(tNear, tFar, _CMP_LE_OQ);
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+bool supportsInstructionSet(RayKernels::InstructionSet instructionSet)
+{
+    int info[4];
+    __cpuid(info, 0);
+    int maximumLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (instructionSet == RayKernels::SSE)
+    {
+        return sse2;
+    }
+    if (!osxsave || !avx || maximumLeaf < 7)
+    {
+        return false;
+    }
+
+    // 操作系统需要保存YMM/ZMM寄存器
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (instructionSet == RayKernels::AVX2)
+    {
+        return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    }
+    if (instructionSet == RayKernels::AVX512)
+    {
+        return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+    }
+    return false;
+}
+
+#else
+
+bool supportsInstructionSet(RayKernels::InstructionSet instructionSet)
+{
+    __builtin_cpu_init();
+    switch (instructionSet)
+    {
+    case RayKernels::SSE:
+        return __builtin_cpu_supports("sse2");
+    case RayKernels::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case RayKernels::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return false;
+    }
+}
+
+#endif
+
+#endif
+
+const RayKernels *getKernelTable()
+{
+    static const RayKernels s_kernels[] = {
+        {RayKernels::SCALAR, intersectTrianglesScalar, intersectBoxesScalar},
+#ifdef OPEVIEWER_RAY_KERNELS_X86
+        {RayKernels::SSE, intersectTrianglesSSE, intersectBoxesSSE},
+        {RayKernels::AVX2, intersectTrianglesAVX2, intersectBoxesAVX2},
+        {RayKernels::AVX512, intersectTrianglesAVX512, intersectBoxesAVX512},
+#else
+        {RayKernels::SCALAR, intersectTrianglesScalar, intersectBoxesScalar},
+        {RayKernels::SCALAR, intersectTrianglesScalar, intersectBoxesScalar},
+        {RayKernels::SCALAR, intersectTrianglesScalar, intersectBoxesScalar},
+#endif
+    };
+    return s_kernels;
+}
+
+} // namespace
+
+RayKernels::Ray::Ray(const float *origin, const float *direction, float tMin, float tMax) : tMin(tMin), tMax(tMax)
+{
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        this->origin[axis] = origin[axis];
+        this->direction[axis] = direction[axis];
+        inverseDirection[axis] = std::fabs(direction[axis]) > 1.0f / LARGE_INVERSE ? 1.0f / direction[axis] : std::copysign(LARGE_INVERSE, direction[axis]);
+    }
+}
+
+RayKernels::InstructionSet RayKernels::getSupportedInstructionSet()
+{
+#ifdef OPEVIEWER_RAY_KERNELS_X86
+    static const InstructionSet s_instructionSet = [] {
+        for (InstructionSet instructionSet : {AVX512, AVX2, SSE})
+        {
+            if (supportsInstructionSet(instructionSet))
+            {
+                return instructionSet;
+            }
+        }
+        return SCALAR;
+    }();
+    return s_instructionSet;
+#else
+    return SCALAR;
+#endif
+}
+
+const RayKernels &RayKernels::get(RayKernels::InstructionSet instructionSet)
+{
+    return getKernelTable()[std::min(instructionSet, getSupportedInstructionSet())];
+}
+
+const RayKernels &RayKernels::get()
+{
+    return get(getSupportedInstructionSet());
+}
+
+const char *RayKernels::getInstructionSetName(RayKernels::InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case SCALAR:
+        return "Scalar";
+    case SSE:
+        return "SSE";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "Unknown";
+    }
+}
+
+} // namespace opeViewer
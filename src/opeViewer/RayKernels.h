@@ -0,0 +1,76 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_CE0792D17FF14F22A6EE9E804D3D95F4_H_
+#define INC_2026_10_18_CE0792D17FF14F22A6EE9E804D3D95F4_H_
+
+#include <cstddef>
+
+namespace opeViewer
+{
+
+/// 射线与三角形、包围盒的批量求交核心
+///
+/// 三角形和包围盒按NUM_LANES个一组以SoA方式存放，一次调用测试一组，根据CPU在运行时选择SSE、AVX2或AVX-512实现
+///
+/// 使用单精度计算，结果只用于筛选，边界附近会多报而不会漏报，命中需要用双精度再次确认
+struct RayKernels
+{
+    enum InstructionSet
+    {
+        SCALAR,
+        SSE,
+        AVX2,
+        AVX512,
+    };
+
+    /// 每组的数量
+    static const unsigned int NUM_LANES = 16;
+
+    /// 一组三角形的浮点数数量，依次为v0、v1 - v0、v2 - v0的x、y、z分量，每个分量NUM_LANES个
+    static const unsigned int TRIANGLE_BLOCK_SIZE = 9 * NUM_LANES;
+
+    /// 一组包围盒的浮点数数量，依次为最小点和最大点的x、y、z分量，每个分量NUM_LANES个
+    static const unsigned int BOX_BLOCK_SIZE = 6 * NUM_LANES;
+
+    /// 射线为origin + direction * t，t在[tMin, tMax]内
+    struct Ray
+    {
+        float origin[3]{};
+        float direction[3]{};
+        /// 方向分量为0时为一个很大的有限值，避免0 * inf
+        float inverseDirection[3]{};
+        float tMin{};
+        float tMax{};
+
+        Ray() = default;
+
+        Ray(const float *origin, const float *direction, float tMin, float tMax);
+    };
+
+    /// 返回命中的三角形掩码，第i位对应第i个三角形，命中的参数写入t
+    using TriangleKernel = unsigned int (*)(const Ray &ray, const float *triangles, float *t);
+
+    /// 返回命中的包围盒掩码，第i位对应第i个包围盒
+    using BoxKernel = unsigned int (*)(const Ray &ray, const float *boxes);
+
+    InstructionSet instructionSet{SCALAR};
+    TriangleKernel intersectTriangles{};
+    BoxKernel intersectBoxes{};
+
+    /// CPU和操作系统支持的最高指令集
+    static InstructionSet getSupportedInstructionSet();
+
+    /// 指令集不受支持时使用支持的最高指令集
+    static const RayKernels &get(InstructionSet instructionSet);
+
+    /// 支持的最高指令集
+    static const RayKernels &get();
+
+    static const char *getInstructionSetName(InstructionSet instructionSet);
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_CE0792D17FF14F22A6EE9E804D3D95F4_H_
@@ -4,15 +4,23 @@
 
 #include "Renderer.h"
 
+#include <algorithm>
+
 #include <osg/GraphicsContext>
 #include <osgDB/DatabasePager>
 #include <osgDB/ImagePager>
 #include <osgUtil/GLObjectsVisitor>
+#include <osgUtil/RenderStage>
 #include <osgUtil/SceneView>
 #include <osgUtil/Statistics>
 
+#include "AllocationCounters.h"
+#include "GLDebugGroups.h"
+#include "Instrumentation.h"
 #include "OpenGLQuerySupport.h"
+#include "PerfCounters.h"
 #include "Scene.h"
+#include "SubgraphProfiler.h"
 #include "Viewport.h"
 #include "Window.h"
 
@@ -22,6 +30,99 @@
 namespace opeViewer
 {
 
+/// 渲染阶段和渲染箱的绘制回调，按本帧的设置记录GPU时间、输出调试组、统计绘制次数和状态切换
+struct Renderer::PassDrawCallback : osgUtil::RenderBin::DrawCallback
+{
+    /// 预渲染阶段缓存在RTT相机中，可能比Renderer存在得久
+    osg::observer_ptr<Renderer> renderer;
+
+    explicit PassDrawCallback(Renderer *renderer) : renderer(renderer)
+    {
+    }
+
+    void drawImplementation(osgUtil::RenderBin *bin, osg::RenderInfo &renderInfo, osgUtil::RenderLeaf *&previous) override
+    {
+        osg::ref_ptr<Renderer> renderer;
+        if (this->renderer.lock(renderer) && renderer->_countDraws)
+        {
+            countDraws(bin, renderer->_numDraws, renderer->_numStateChanges);
+        }
+
+        if (!renderer || !(renderer->_recordGPUPasses || renderer->_debugGroups))
+        {
+            bin->drawImplementation(renderInfo, previous);
+            return;
+        }
+
+        std::string name;
+        if (auto stage = dynamic_cast<osgUtil::RenderStage *>(bin))
+        {
+            const osg::Camera *camera = stage->getCamera();
+            name = camera && !camera->getName().empty() ? "RenderStage " + camera->getName() : std::string("RenderStage");
+        }
+        else
+        {
+            name = "RenderBin " + std::to_string(bin->getBinNum());
+        }
+
+        if (renderer->_debugGroups)
+        {
+            renderer->_debugGroups->push(name);
+        }
+        int pass = renderer->_recordGPUPasses ? renderer->_querySupport->beginPass(name, renderInfo.getState()) : -1;
+
+        bin->drawImplementation(renderInfo, previous);
+
+        if (renderer->_recordGPUPasses)
+        {
+            renderer->_querySupport->endPass(pass, renderInfo.getState());
+        }
+        if (renderer->_debugGroups)
+        {
+            renderer->_debugGroups->pop();
+        }
+    }
+
+    /// 与RenderBin::drawImplementation的顺序相同：每个叶子一次绘制，StateGraph改变时切换状态，不包含子渲染箱
+    static void countDraws(osgUtil::RenderBin *bin, unsigned int &numDraws, unsigned int &numStateChanges)
+    {
+        const osgUtil::StateGraph *previousStateGraph = nullptr;
+        for (const osgUtil::RenderLeaf *leaf : bin->getRenderLeafList())
+        {
+            ++numDraws;
+            if (leaf->_parent != previousStateGraph)
+            {
+                ++numStateChanges;
+                previousStateGraph = leaf->_parent;
+            }
+        }
+
+        for (const osgUtil::StateGraph *stateGraph : bin->getStateGraphList())
+        {
+            numDraws += static_cast<unsigned int>(stateGraph->_leaves.size());
+            ++numStateChanges;
+        }
+    }
+};
+
+namespace
+{
+
+void attachPassDrawCallback(osgUtil::RenderBin *bin, osgUtil::RenderBin::DrawCallback *callback)
+{
+    if (!bin->getDrawCallback())
+    {
+        bin->setDrawCallback(callback);
+    }
+
+    for (auto &child : bin->getRenderBinList())
+    {
+        attachPassDrawCallback(child.second.get(), callback);
+    }
+}
+
+} // namespace
+
 Renderer::Renderer(osg::Camera *camera) : /*osg::Referenced(true),*/ osg::GraphicsOperation("Renderer", true), _camera(camera)
 {
 }
@@ -41,6 +142,8 @@ void Renderer::operator()(osg::Object *object)
 
 void Renderer::operator()(osg::GraphicsContext *context)
 {
+#if OPEVIEWER_INSTRUMENTATION
+    // 编译去除统计时只剩剔除和绘制
     struct CollectStats
     {
         Renderer *thiz;
@@ -48,10 +151,35 @@ void Renderer::operator()(osg::GraphicsContext *context)
         OpenGLQuerySupport *querySupport{};
 
         osg::Stats *stats{};
+        /// 不收集gpu时为空
+        osg::Stats *gpuStats{};
+        /// 不收集pipeline时为空，收集时同时统计绘制次数和状态切换
+        osg::Stats *pipelineStats{};
+        /// 窗口不输出调试组时为空
+        GLDebugGroups *debugGroups{};
+        /// 不收集perf或计数器不可用时为空
+        PerfCounters *perfCounters{};
+        PerfCounters::Sample beforeCullPerf;
+        PerfCounters::Sample afterCullPerf;
+        PerfCounters::Sample beforeDrawPerf;
+        PerfCounters::Sample afterDrawPerf;
+        /// 收集allocations且编译了分配计数时为true
+        bool countAllocations{};
+        AllocationCounters beforeCullAllocations;
+        AllocationCounters afterCullAllocations;
+        AllocationCounters beforeDrawAllocations;
+        AllocationCounters afterDrawAllocations;
+        /// 窗口不收集帧时间分布时为空
+        FrameTimeHistograms *histograms{};
+        Histogram *gpuTimeHistogram{};
         osg::State *state{};
         osg::Timer_t startTick{};
         unsigned int frameNumber{};
+        /// 级别低于BASIC时不读取时间、不查询GPU时间
+        bool enabled{};
         bool acquireGPUStats{};
+        /// 记录各渲染阶段和渲染箱的GPU时间
+        bool recordPasses{};
 
         osg::Timer_t beforeCullTick{};
         osg::Timer_t afterCullTick{};
@@ -60,6 +188,9 @@ void Renderer::operator()(osg::GraphicsContext *context)
 
         void init(Renderer *thiz, osgUtil::SceneView *sceneView, OpenGLQuerySupport *querySupport)
         {
+            // 统计自身的分配不计入各阶段
+            AllocationCounters::ExcludeScope excludeAllocations;
+
             auto camera = sceneView->getCamera();
             auto viewport = dynamic_cast<Viewport *>(camera->getView());
             auto window = viewport ? viewport->getWindow() : nullptr;
@@ -71,53 +202,155 @@ void Renderer::operator()(osg::GraphicsContext *context)
             this->state = sceneView->getState();
             this->stats = camera->getStats();
             this->frameNumber = fs ? fs->getFrameNumber() : 0;
-            this->acquireGPUStats = stats && querySupport && stats->collectStats("gpu");
+            this->enabled = OPEVIEWER_INSTRUMENTED(BASIC);
+            this->gpuStats = OPEVIEWER_COLLECT_STATS(stats, BASIC, GPU) ? stats : nullptr;
+            this->pipelineStats = OPEVIEWER_COLLECT_STATS(stats, FULL, PIPELINE) ? stats : nullptr;
+            this->debugGroups = window && window->getEmitGLDebugGroups() && OPEVIEWER_INSTRUMENTED(FULL) ? state->get<GLDebugGroups>() : nullptr;
+            this->histograms = enabled && window && window->getCollectFrameTimeHistograms() ? &thiz->_frameTimeHistograms : nullptr;
+            // GPU的分布依附于"gpu"的计时查询
+            this->gpuTimeHistogram = histograms && gpuStats ? &(*histograms)[FrameTimeHistograms::GPU] : nullptr;
+            this->perfCounters = OPEVIEWER_COLLECT_STATS(stats, FULL, PERF) ? PerfCounters::getThreadInstance() : nullptr;
+            if (perfCounters && !perfCounters->isValid())
+            {
+                perfCounters = nullptr;
+            }
+            this->countAllocations = AllocationCounters::isAvailable() && OPEVIEWER_COLLECT_STATS(stats, FULL, ALLOCATIONS);
+            this->recordPasses = querySupport && enabled && OPEVIEWER_COLLECT_STATS(stats, FULL, GPU_PASSES);
+            this->acquireGPUStats = querySupport && (gpuStats || recordPasses);
             this->startTick = window ? window->getStartTick() : 0;
         }
 
         void beforeCull()
         {
+            AllocationCounters::ExcludeScope excludeAllocations;
+
             if (acquireGPUStats)
             {
-                querySupport->checkQuery(stats, state, startTick);
+                querySupport->checkQuery(gpuStats, state, startTick, gpuTimeHistogram);
             }
 
-            beforeCullTick = osg::Timer::instance()->tick();
+            if (enabled)
+            {
+                beforeCullTick = osg::Timer::instance()->tick();
+            }
+            if (perfCounters)
+            {
+                perfCounters->read(beforeCullPerf);
+            }
+            if (countAllocations)
+            {
+                beforeCullAllocations = AllocationCounters::getThreadCounters();
+            }
         }
 
         void afterCull()
         {
-            afterCullTick = osg::Timer::instance()->tick();
+            AllocationCounters::ExcludeScope excludeAllocations;
+
+            if (countAllocations)
+            {
+                afterCullAllocations = AllocationCounters::getThreadCounters();
+            }
+            if (perfCounters)
+            {
+                perfCounters->read(afterCullPerf);
+            }
+
+            thiz->_recordGPUPasses = recordPasses;
+            thiz->_debugGroups = debugGroups;
+            thiz->_countDraws = pipelineStats != nullptr;
+            thiz->_numDraws = 0;
+            thiz->_numStateChanges = 0;
+            if (recordPasses || debugGroups || pipelineStats)
+            {
+                thiz->attachPassDrawCallbacks(sceneView->getRenderStage());
+            }
+
+            if (enabled)
+            {
+                afterCullTick = osg::Timer::instance()->tick();
+            }
         }
 
         void beforeDraw()
         {
+            AllocationCounters::ExcludeScope excludeAllocations;
+
             // do draw traversal
+            if (debugGroups)
+            {
+                const std::string &name = sceneView->getCamera()->getName();
+                debugGroups->push(name.empty() ? std::string("Camera") : "Camera " + name);
+            }
             if (acquireGPUStats)
             {
-                querySupport->checkQuery(stats, state, startTick);
+                querySupport->checkQuery(gpuStats, state, startTick, gpuTimeHistogram);
                 querySupport->beginQuery(frameNumber, state);
             }
+            if (pipelineStats && thiz->_pipelineStatisticsQuerySupport)
+            {
+                thiz->_pipelineStatisticsQuerySupport->checkQuery(pipelineStats, state);
+                thiz->_pipelineStatisticsQuerySupport->beginQuery(frameNumber, state);
+            }
 
-            beforeDrawTick = osg::Timer::instance()->tick();
+            if (enabled)
+            {
+                beforeDrawTick = osg::Timer::instance()->tick();
+            }
+            if (perfCounters)
+            {
+                perfCounters->read(beforeDrawPerf);
+            }
+            if (countAllocations)
+            {
+                beforeDrawAllocations = AllocationCounters::getThreadCounters();
+            }
         }
 
         void afterDraw()
         {
+            AllocationCounters::ExcludeScope excludeAllocations;
+
+            if (countAllocations)
+            {
+                afterDrawAllocations = AllocationCounters::getThreadCounters();
+            }
+            if (perfCounters)
+            {
+                perfCounters->read(afterDrawPerf);
+            }
+
             if (acquireGPUStats)
             {
                 querySupport->endQuery(state);
-                querySupport->checkQuery(stats, state, startTick);
+                querySupport->checkQuery(gpuStats, state, startTick, gpuTimeHistogram);
+            }
+            if (pipelineStats && thiz->_pipelineStatisticsQuerySupport)
+            {
+                thiz->_pipelineStatisticsQuerySupport->endQuery(state);
             }
+            if (debugGroups)
+            {
+                debugGroups->pop();
+            }
+
+            thiz->_recordGPUPasses = false;
+            thiz->_debugGroups = nullptr;
+            thiz->_countDraws = false;
 
-            afterDrawTick = osg::Timer::instance()->tick();
+            if (enabled)
+            {
+                afterDrawTick = osg::Timer::instance()->tick();
+            }
         }
 
         void collect()
         {
+            AllocationCounters::ExcludeScope excludeAllocations;
+
             thiz->stats();
 
-            if (stats && stats->collectStats("rendering"))
+            if (OPEVIEWER_COLLECT_STATS(stats, BASIC, RENDERING))
             {
                 DEBUG_MESSAGE << "Collecting rendering stats" << std::endl;
 
@@ -129,8 +362,39 @@ void Renderer::operator()(osg::GraphicsContext *context)
                 stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(startTick, afterDrawTick));
                 stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
             }
+
+            if (perfCounters)
+            {
+                static const PerfCounters::AttributeNames cullNames("Cull");
+                static const PerfCounters::AttributeNames drawNames("Draw");
+                PerfCounters::setAttributes(stats, frameNumber, cullNames, beforeCullPerf, afterCullPerf);
+                PerfCounters::setAttributes(stats, frameNumber, drawNames, beforeDrawPerf, afterDrawPerf);
+            }
+
+            if (countAllocations)
+            {
+                static const AllocationCounters::AttributeNames cullNames("Cull");
+                static const AllocationCounters::AttributeNames drawNames("Draw");
+                AllocationCounters::setAttributes(stats, frameNumber, cullNames, beforeCullAllocations, afterCullAllocations);
+                AllocationCounters::setAttributes(stats, frameNumber, drawNames, beforeDrawAllocations, afterDrawAllocations);
+            }
+
+            if (pipelineStats)
+            {
+                pipelineStats->setAttribute(frameNumber, "Draw calls", static_cast<double>(thiz->_numDraws));
+                pipelineStats->setAttribute(frameNumber, "State changes", static_cast<double>(thiz->_numStateChanges));
+            }
+
+            if (histograms)
+            {
+                (*histograms)[FrameTimeHistograms::CULL].record(osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+                (*histograms)[FrameTimeHistograms::DRAW].record(osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+            }
         }
-    } stats;
+    };
+
+    CollectStats stats;
+#endif
 
     DEBUG_MESSAGE << "Renderer() " << this << std::endl;
 
@@ -146,14 +410,24 @@ void Renderer::operator()(osg::GraphicsContext *context)
         compile();
     }
 
+#if OPEVIEWER_INSTRUMENTATION
     stats.init(this, _sceneView, _querySupport);
 
+    bool profileSubgraphs = _subgraphProfiler && OPEVIEWER_INSTRUMENTED(FULL);
+    if (profileSubgraphs)
+    {
+        _subgraphProfiler->beginFrame(stats.frameNumber);
+    }
+
     stats.beforeCull();
+#endif
 
     _sceneView->inheritCullSettings(*(_sceneView->getCamera()));
     _sceneView->cull();
 
+#if OPEVIEWER_INSTRUMENTATION
     stats.afterCull();
+#endif
 
 #if 0
     if (state->getDynamicObjectCount()==0 && state->getDynamicObjectRenderingCompletedCallback())
@@ -162,13 +436,30 @@ void Renderer::operator()(osg::GraphicsContext *context)
     }
 #endif
 
+#if OPEVIEWER_INSTRUMENTATION
     stats.beforeDraw();
+#endif
 
     _sceneView->draw();
 
+    for (auto &callback : _postDrawCallbacks)
+    {
+        callback->drawImplementation(this, context->getState());
+    }
+
+#if OPEVIEWER_INSTRUMENTATION
     stats.afterDraw();
 
+    if (profileSubgraphs)
+    {
+        _subgraphProfiler->endFrame(context->getState());
+    }
+
     stats.collect();
+#else
+    // 用户的统计回调不受编译选项影响
+    stats();
+#endif
 
     DEBUG_MESSAGE << "end Renderer() " << this << std::endl;
 }
@@ -191,6 +482,16 @@ void Renderer::releaseGLObjects(osg::State *state) const
     {
         _sceneView->releaseGLObjects(state);
     }
+
+    if (_subgraphProfiler)
+    {
+        _subgraphProfiler->releaseGLObjects(state);
+    }
+
+    for (auto &callback : _postDrawCallbacks)
+    {
+        callback->releaseGLObjects(state);
+    }
 }
 
 osg::Camera *Renderer::getCamera()
@@ -213,12 +514,85 @@ Renderer::StatsCallback *Renderer::getStatsCallback() const
     return _statsCallback.get();
 }
 
+void Renderer::setCullVisitor(osgUtil::CullVisitor *cullVisitor)
+{
+    _cullVisitor = cullVisitor;
+}
+
+osgUtil::CullVisitor *Renderer::getCullVisitor() const
+{
+    return _cullVisitor.get();
+}
+
+void Renderer::addPostDrawCallback(DrawCallback *callback)
+{
+    if (callback && std::find(_postDrawCallbacks.begin(), _postDrawCallbacks.end(), callback) == _postDrawCallbacks.end())
+    {
+        _postDrawCallbacks.push_back(callback);
+    }
+}
+
+void Renderer::removePostDrawCallback(DrawCallback *callback)
+{
+    auto itr = std::find(_postDrawCallbacks.begin(), _postDrawCallbacks.end(), callback);
+    if (itr != _postDrawCallbacks.end())
+    {
+        _postDrawCallbacks.erase(itr);
+    }
+}
+
+FrameTimeHistograms &Renderer::getFrameTimeHistograms()
+{
+    return _frameTimeHistograms;
+}
+
+const FrameTimeHistograms &Renderer::getFrameTimeHistograms() const
+{
+    return _frameTimeHistograms;
+}
+
+void Renderer::setSubgraphProfiler(SubgraphProfiler *profiler)
+{
+    _subgraphProfiler = profiler;
+}
+
+SubgraphProfiler *Renderer::getSubgraphProfiler() const
+{
+    return _subgraphProfiler.get();
+}
+
+void Renderer::attachPassDrawCallbacks(osgUtil::RenderStage *stage)
+{
+    if (!_passDrawCallback)
+    {
+        _passDrawCallback = new PassDrawCallback(this);
+    }
+
+    for (auto &preRenderStage : stage->getPreRenderList())
+    {
+        attachPassDrawCallbacks(preRenderStage.second.get());
+    }
+
+    attachPassDrawCallback(stage, _passDrawCallback.get());
+
+    for (auto &postRenderStage : stage->getPostRenderList())
+    {
+        attachPassDrawCallbacks(postRenderStage.second.get());
+    }
+}
+
+const std::vector<GPUPass> &Renderer::getGPUPasses() const
+{
+    static const std::vector<GPUPass> noPasses;
+    return _querySupport ? _querySupport->getPasses() : noPasses;
+}
+
 void Renderer::statsImplementation(osgUtil::SceneView *sceneView)
 {
     auto stats = getCamera()->getStats();
     auto frameNumber = sceneView->getFrameStamp()->getFrameNumber();
 
-    if (stats && stats->collectStats("scene"))
+    if (OPEVIEWER_COLLECT_STATS(stats, FULL, SCENE))
     {
         osgUtil::Statistics sceneStats;
         sceneView->getStats(sceneStats);
@@ -303,6 +677,11 @@ void Renderer::setupSceneView(osgUtil::SceneView *sceneView)
 
     sceneView->setDefaults(sceneViewOptions);
 
+    if (_cullVisitor.valid())
+    {
+        sceneView->setCullVisitor(_cullVisitor->clone());
+    }
+
     if (ds && ds->getUseSceneViewForStereoHint())
     {
         sceneView->setDisplaySettings(ds);
@@ -354,6 +733,12 @@ void Renderer::initialize(osg::State *state)
             _querySupport = new EXTQuerySupport();
         if (_querySupport.valid())
             _querySupport->initialize(state, startTick);
+
+        if (PipelineStatisticsQuerySupport::isSupported(state))
+        {
+            _pipelineStatisticsQuerySupport = new PipelineStatisticsQuerySupport();
+            _pipelineStatisticsQuerySupport->initialize(state);
+        }
     }
 }
 
@@ -373,7 +758,7 @@ void Renderer::compile()
         // collect stats if required
         osg::View *view = _camera.valid() ? _camera->getView() : 0;
         osg::Stats *stats = view ? view->getStats() : 0;
-        if (stats && stats->collectStats("compile"))
+        if (OPEVIEWER_COLLECT_STATS(stats, BASIC, COMPILE))
         {
             osg::ElapsedTime elapsedTime;
 
@@ -472,7 +857,7 @@ void Renderer::stats()
     {
         return _statsCallback->statsImplementation(this, _sceneView);
     }
-    else
+    else if (OPEVIEWER_INSTRUMENTED(FULL))
     {
         statsImplementation(_sceneView);
     }
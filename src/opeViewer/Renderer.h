@@ -5,17 +5,27 @@
 #ifndef INC_2023_12_18_CCB2436FDA1949C3AE24DA8FBB690A67_H_
 #define INC_2023_12_18_CCB2436FDA1949C3AE24DA8FBB690A67_H_
 
+#include <vector>
+
 #include <osg/GraphicsThread>
 
+#include "Histogram.h"
+
 namespace osgUtil
 {
+class CullVisitor;
+class RenderStage;
 class SceneView;
-}
+} // namespace osgUtil
 
 namespace opeViewer
 {
 
+class GLDebugGroups;
 class OpenGLQuerySupport;
+struct GPUPass;
+class PipelineStatisticsQuerySupport;
+class SubgraphProfiler;
 
 /// 绘制器，属于相机
 class Renderer : public osg::GraphicsOperation
@@ -27,6 +37,17 @@ class Renderer : public osg::GraphicsOperation
         virtual void statsImplementation(Renderer *renderer, osgUtil::SceneView *sceneView) = 0;
     };
 
+    /// 每帧绘制后在图形线程中调用，帧缓冲还未交换，可以读回
+    struct DrawCallback : osg::Referenced
+    {
+        virtual void drawImplementation(Renderer *renderer, osg::State *state) = 0;
+
+        /// 随Renderer::releaseGLObjects调用
+        virtual void releaseGLObjects(osg::State *state) const
+        {
+        }
+    };
+
   protected:
     bool _initialized{};
 
@@ -34,10 +55,30 @@ class Renderer : public osg::GraphicsOperation
     osg::observer_ptr<osg::Camera> _camera;
     osg::ref_ptr<osgUtil::SceneView> _sceneView;
     osg::ref_ptr<OpenGLQuerySupport> _querySupport;
+    /// 上下文不支持时为空，相机的Stats收集"pipeline"时使用
+    osg::ref_ptr<PipelineStatisticsQuerySupport> _pipelineStatisticsQuerySupport;
     bool _compileOnNextDraw{true};
 
     osg::ref_ptr<StatsCallback> _statsCallback;
 
+    osg::ref_ptr<osgUtil::CullVisitor> _cullVisitor;
+
+    std::vector<osg::ref_ptr<DrawCallback>> _postDrawCallbacks;
+
+    /// 只记录CULL、DRAW和GPU
+    FrameTimeHistograms _frameTimeHistograms;
+
+    osg::ref_ptr<SubgraphProfiler> _subgraphProfiler;
+
+    struct PassDrawCallback;
+    osg::ref_ptr<PassDrawCallback> _passDrawCallback;
+    /// 本帧剔除后到绘制结束前的设置，由PassDrawCallback使用
+    bool _recordGPUPasses{};
+    GLDebugGroups *_debugGroups{};
+    bool _countDraws{};
+    unsigned int _numDraws{};
+    unsigned int _numStateChanges{};
+
   public:
     explicit Renderer(osg::Camera *camera);
 
@@ -55,12 +96,39 @@ class Renderer : public osg::GraphicsOperation
 
     void setCompileOnNextDraw(bool compileOnNextDraw);
 
+    /// 设置后每帧调用，与统计级别和OPEVIEWER_INSTRUMENTATION无关
     void setStatsCallback(StatsCallback *statsCallback);
 
     StatsCallback *getStatsCallback() const;
 
+    /// 没有StatsCallback时调用，统计级别低于Instrumentation::FULL时不调用
     virtual void statsImplementation(osgUtil::SceneView *sceneView);
 
+    /// 剔除遍历器原型，创建SceneView时克隆，为空时使用osgUtil::CullVisitor::create()
+    void setCullVisitor(osgUtil::CullVisitor *cullVisitor);
+
+    osgUtil::CullVisitor *getCullVisitor() const;
+
+    /// 绘制时间包含回调的时间
+    void addPostDrawCallback(DrawCallback *callback);
+
+    void removePostDrawCallback(DrawCallback *callback);
+
+    /// 在图形线程中写入，在其他线程读取时需要在两帧之间，见Window::getFrameTimeHistograms
+    FrameTimeHistograms &getFrameTimeHistograms();
+
+    const FrameTimeHistograms &getFrameTimeHistograms() const;
+
+    /// 子图剖析，为空时不剖析
+    void setSubgraphProfiler(SubgraphProfiler *profiler);
+
+    SubgraphProfiler *getSubgraphProfiler() const;
+
+    /// 最近一次读取完成的帧中各渲染阶段（包含RTT相机）和渲染箱的GPU时间，相机的Stats收集"gpu_passes"时记录
+    ///
+    /// 需要GL_ARB_timer_query，在图形线程中写入，需要在两帧之间读取
+    const std::vector<GPUPass> &getGPUPasses() const;
+
   protected:
     void setupSceneView(osgUtil::SceneView *sceneView);
 
@@ -73,6 +141,9 @@ class Renderer : public osg::GraphicsOperation
     void updateSceneView(osgUtil::SceneView *sceneView, osg::State *state);
 
     void stats();
+
+    /// 在剔除后为stage、其中的预渲染和后渲染阶段以及各渲染箱设置PassDrawCallback，已有其它绘制回调的不设置
+    void attachPassDrawCallbacks(osgUtil::RenderStage *stage);
 };
 
 } // namespace opeViewer
@@ -4,9 +4,14 @@
 
 #include "Scene.h"
 
-#include <osgDB/DatabasePager>
+#include <osg/Stats>
 #include <osgDB/ImagePager>
 
+#include "DatabasePager.h"
+#include "Instrumentation.h"
+#include "KdTreeBuilder.h"
+#include "Stats.h"
+
 namespace opeViewer
 {
 
@@ -63,9 +68,12 @@ OSG_INIT_SINGLETON_PROXY(SceneSingletonProxy, getSceneSingleton())
 
 Scene::Scene() : osg::Object(true)
 {
-    setDatabasePager(osgDB::DatabasePager::create());
+    _kdTreeBuilder = new KdTreeBuilder;
+    setDatabasePager(new DatabasePager);
     setImagePager(new osgDB::ImagePager);
-    setStats(new osg::Stats("Scene"));
+    setStats(new Stats("Scene"));
+    // 在构造时创建，使addUpdateOperation可以在其他线程中调用
+    _updateOperations = new osg::OperationQueue;
     getSceneSingleton().add(this);
 }
 
@@ -82,6 +90,7 @@ Scene::~Scene()
 void Scene::setSceneData(osg::Node *node)
 {
     _sceneData = node;
+    dirtySceneData();
 }
 
 osg::Node *Scene::getSceneData()
@@ -97,6 +106,11 @@ const osg::Node *Scene::getSceneData() const
 void Scene::setDatabasePager(osgDB::DatabasePager *dp)
 {
     _databasePager = dp;
+
+    if (auto pager = dynamic_cast<DatabasePager *>(_databasePager.get()))
+    {
+        pager->setKdTreeBuilder(_buildKdTrees ? _kdTreeBuilder.get() : nullptr);
+    }
 }
 
 osgDB::DatabasePager *Scene::getDatabasePager()
@@ -131,12 +145,44 @@ void Scene::addUpdateOperation(osg::Operation *operation)
         return;
     }
 
-    if (!_updateOperations)
+    _updateOperations->add(operation);
+}
+
+void Scene::setBuildKdTrees(bool buildKdTrees)
+{
+    _buildKdTrees = buildKdTrees;
+
+    if (auto pager = dynamic_cast<DatabasePager *>(_databasePager.get()))
     {
-        _updateOperations = new osg::OperationQueue;
+        pager->setKdTreeBuilder(_buildKdTrees ? _kdTreeBuilder.get() : nullptr);
     }
+}
 
-    _updateOperations->add(operation);
+bool Scene::getBuildKdTrees() const
+{
+    return _buildKdTrees;
+}
+
+KdTreeBuilder *Scene::getKdTreeBuilder()
+{
+    return _kdTreeBuilder.get();
+}
+
+const KdTreeBuilder *Scene::getKdTreeBuilder() const
+{
+    return _kdTreeBuilder.get();
+}
+
+void Scene::buildKdTrees(osg::Node *node)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    // 每个线程使用单独的副本，统计共享
+    osg::ref_ptr<osg::KdTreeBuilder> builder = _kdTreeBuilder->clone();
+    node->accept(*builder);
 }
 
 void Scene::removeUpdateOperation(osg::Operation *operation)
@@ -152,6 +198,16 @@ void Scene::removeUpdateOperation(osg::Operation *operation)
     }
 }
 
+unsigned int Scene::getModifiedCount() const
+{
+    return _modifiedCount;
+}
+
+void Scene::dirtySceneData()
+{
+    ++_modifiedCount;
+}
+
 void Scene::setStats(osg::Stats *stats)
 {
     _stats = stats;
@@ -192,10 +248,42 @@ void Scene::updateSceneGraph(osg::NodeVisitor &updateVisitor)
     if (!_sceneData)
         return;
 
+    // 分页器合并和更新操作视为修改；更新回调每帧都会执行，不视为修改
+    if ((_databasePager && _databasePager->requiresUpdateSceneGraph()) || (_updateOperations && _updateOperations->getNumOperationsInQueue() > 0))
+    {
+        dirtySceneData();
+    }
+
     if (_databasePager && _databasePager->requiresUpdateSceneGraph())
     {
+        osg::ElapsedTime elapsedTime;
+
         // synchronize changes required by the DatabasePager thread to the scene graph
         _databasePager->updateSceneGraph((*updateVisitor.getFrameStamp()));
+
+        if (OPEVIEWER_COLLECT_STATS(_stats, FULL, PAGER))
+        {
+            unsigned int frameNumber = updateVisitor.getFrameStamp()->getFrameNumber();
+            _stats->setAttribute(frameNumber, "DatabasePager merge time taken", elapsedTime.elapsedTime());
+
+            if (auto dp = dynamic_cast<DatabasePager *>(_databasePager.get()))
+            {
+                _stats->setAttribute(frameNumber, "DatabasePager merged", static_cast<double>(dp->getNumMergedLastFrame()));
+                _stats->setAttribute(frameNumber, "DatabasePager merged bytes", static_cast<double>(dp->getMergedBytesLastFrame()));
+                _stats->setAttribute(frameNumber, "DatabasePager merge backlog", static_cast<double>(dp->getMergeBacklogSize()));
+                _stats->setAttribute(frameNumber, "DatabasePager merge backlog bytes", static_cast<double>(dp->getMergeBacklogBytes()));
+            }
+        }
+    }
+
+    if (_buildKdTrees && OPEVIEWER_COLLECT_STATS(_stats, FULL, PAGER))
+    {
+        unsigned int frameNumber = updateVisitor.getFrameStamp()->getFrameNumber();
+        const KdTreeBuilder::Statistics *statistics = _kdTreeBuilder->getStatistics();
+        _stats->setAttribute(frameNumber, "KdTree built", static_cast<double>(statistics->numKdTrees));
+        _stats->setAttribute(frameNumber, "KdTree primitives", static_cast<double>(statistics->numPrimitives));
+        _stats->setAttribute(frameNumber, "KdTree memory", static_cast<double>(statistics->memory));
+        _stats->setAttribute(frameNumber, "KdTree build time", static_cast<double>(statistics->buildTime) / 1000000.0);
     }
 
     if (_imagePager && _imagePager->requiresUpdateSceneGraph())
@@ -26,19 +26,32 @@ class ImagePager;
 namespace opeViewer
 {
 
+class KdTreeBuilder;
+
 /// 场景
 ///
 /// 主要包含场景和分页器
+///
+/// 默认使用opeViewer::DatabasePager，可通过它设置每帧合并预算，合并积压记录在Stats的"pager"中
+///
+/// 开启setBuildKdTrees后，加载和分页读入的几何体在工作线程中构建KdTree，求交时自动使用，构建统计同样记录在"pager"中
+///
+/// 修改计数在场景可能被修改时递增，用于PickCache等缓存判断场景是否变化
 class Scene : public osg::Object
 {
     friend class Viewport;
 
+    bool _buildKdTrees{};
+    osg::ref_ptr<KdTreeBuilder> _kdTreeBuilder;
+
     osg::ref_ptr<osg::Node> _sceneData;
     osg::ref_ptr<osgDB::DatabasePager> _databasePager;
     osg::ref_ptr<osgDB::ImagePager> _imagePager;
     osg::ref_ptr<osg::OperationQueue> _updateOperations;
     osg::ref_ptr<osg::Stats> _stats;
 
+    unsigned int _modifiedCount{};
+
   public:
     META_Object(opeViewer, Scene);
 
@@ -60,10 +73,31 @@ class Scene : public osg::Object
 
     const osgDB::ImagePager *getImagePager() const;
 
+    /// 添加在更新遍历中执行的操作，可以在其他线程中调用
     void addUpdateOperation(osg::Operation *operation);
 
+    /// 自动构建KdTree，默认关闭
+    void setBuildKdTrees(bool buildKdTrees);
+
+    bool getBuildKdTrees() const;
+
+    KdTreeBuilder *getKdTreeBuilder();
+
+    const KdTreeBuilder *getKdTreeBuilder() const;
+
+    /// 为节点构建KdTree，可以在工作线程中调用
+    void buildKdTrees(osg::Node *node);
+
     void removeUpdateOperation(osg::Operation *operation);
 
+    /// 设置场景数据、分页器合并或执行更新操作时自动递增，用于拾取缓存和异步拾取判断场景是否变化
+    ///
+    /// 更新回调不会使其递增，在更新回调或事件处理器中增删节点、修改几何体后需要调用dirtySceneData
+    unsigned int getModifiedCount() const;
+
+    /// 修改场景结构后调用，见getModifiedCount
+    void dirtySceneData();
+
     void setStats(osg::Stats *stats);
 
     osg::Stats *getStats();
@@ -0,0 +1,397 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "SceneCache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+#include <osg/Timer>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 只读内存映射文件
+class MappedFile
+{
+#ifdef _WIN32
+    HANDLE _file{INVALID_HANDLE_VALUE};
+    HANDLE _mapping{};
+#else
+    int _fd{-1};
+#endif
+    const char *_data{};
+    std::size_t _size{};
+
+  public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+        {
+            return;
+        }
+
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping)
+        {
+            return;
+        }
+
+        _data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (_data)
+        {
+            _size = static_cast<std::size_t>(size.QuadPart);
+        }
+#else
+        _fd = open(path.c_str(), O_RDONLY);
+        if (_fd < 0)
+        {
+            return;
+        }
+
+        struct stat st;
+        if (fstat(_fd, &st) != 0 || st.st_size == 0)
+        {
+            return;
+        }
+
+        void *data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (data == MAP_FAILED)
+        {
+            return;
+        }
+
+        // 按顺序解析，提示内核预读；建议值是枚举，不能按位或
+        madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+        madvise(data, static_cast<std::size_t>(st.st_size), MADV_WILLNEED);
+
+        _data = static_cast<const char *>(data);
+        _size = static_cast<std::size_t>(st.st_size);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (_data)
+        {
+            UnmapViewOfFile(_data);
+        }
+        if (_mapping)
+        {
+            CloseHandle(_mapping);
+        }
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+        }
+#else
+        if (_data)
+        {
+            munmap(const_cast<char *>(_data), _size);
+        }
+        if (_fd >= 0)
+        {
+            close(_fd);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const
+    {
+        return _data;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+};
+
+/// 直接读取映射内存的streambuf，不复制文件内容
+class MemoryStreamBuf : public std::streambuf
+{
+  public:
+    MemoryStreamBuf(const char *data, std::size_t size)
+    {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in))
+        {
+            return pos_type(off_type(-1));
+        }
+
+        char *target{};
+        switch (dir)
+        {
+        case std::ios_base::beg:
+            target = eback() + off;
+            break;
+        case std::ios_base::cur:
+            target = gptr() + off;
+            break;
+        case std::ios_base::end:
+            target = egptr() + off;
+            break;
+        default:
+            return pos_type(off_type(-1));
+        }
+
+        if (target < eback() || target > egptr())
+        {
+            return pos_type(off_type(-1));
+        }
+
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    std::streamsize showmanyc() override
+    {
+        return egptr() - gptr();
+    }
+};
+
+std::uint64_t hashString(const std::string &str, std::uint64_t hash = 14695981039346656037ull)
+{
+    // FNV-1a
+    for (unsigned char c : str)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+osgDB::ReaderWriter *getCacheReaderWriter()
+{
+    return osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+}
+
+} // namespace
+
+SceneCache::SceneCache(const std::string &directory) : _directory(directory)
+{
+    if (!osgDB::makeDirectory(_directory))
+    {
+        OSG_WARN << "SceneCache::SceneCache() Failed to create cache directory " << _directory << std::endl;
+    }
+}
+
+SceneCache::~SceneCache()
+{
+}
+
+const std::string &SceneCache::getDirectory() const
+{
+    return _directory;
+}
+
+osg::ref_ptr<osg::Node> SceneCache::readNodeFile(const std::string &file, const osgDB::Options *options)
+{
+    std::string cacheFile = getCacheFile(file, options);
+    if (cacheFile.empty())
+    {
+        // 找不到源文件（如伪加载器），不使用缓存
+        return osgDB::readRefNodeFile(file, options);
+    }
+
+    osg::ElapsedTime elapsedTime;
+
+    // 缓存中相对路径的外部引用（如PagedLOD的子节点）仍然相对于源文件解析
+    osg::ref_ptr<osgDB::Options> localOptions = options ? options->cloneOptions() : new osgDB::Options;
+    localOptions->getDatabasePathList().push_front(osgDB::getFilePath(osgDB::findDataFile(file, options)));
+
+    osg::ref_ptr<osg::Node> node = readCache(cacheFile, localOptions);
+    if (node)
+    {
+        ++_numHits;
+        OSG_INFO << "SceneCache::readNodeFile() " << file << " read from cache in " << elapsedTime.elapsedTime_m() << "ms" << std::endl;
+        return node;
+    }
+
+    ++_numMisses;
+
+    node = osgDB::readRefNodeFile(file, options);
+    if (!node)
+    {
+        return node;
+    }
+
+    double readTime = elapsedTime.elapsedTime_m();
+    if (writeCache(cacheFile, node, localOptions))
+    {
+        OSG_INFO << "SceneCache::readNodeFile() " << file << " read in " << readTime << "ms, cached in " << elapsedTime.elapsedTime_m() - readTime << "ms" << std::endl;
+    }
+
+    return node;
+}
+
+std::string SceneCache::getCacheFile(const std::string &file, const osgDB::Options *options) const
+{
+    std::string path = osgDB::findDataFile(file, options);
+    if (path.empty())
+    {
+        return {};
+    }
+    path = osgDB::getRealPath(path);
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return {};
+    }
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::uint64_t hash = hashString(path);
+    hash = hashString(std::to_string(size), hash);
+    hash = hashString(std::to_string(time.time_since_epoch().count()), hash);
+    if (options)
+    {
+        hash = hashString(options->getOptionString(), hash);
+    }
+
+    std::ostringstream name;
+    name << osgDB::getStrippedName(path) << '_' << std::hex << std::setw(16) << std::setfill('0') << hash << ".osgb";
+    return osgDB::concatPaths(_directory, name.str());
+}
+
+unsigned int SceneCache::getNumHits() const
+{
+    return _numHits;
+}
+
+unsigned int SceneCache::getNumMisses() const
+{
+    return _numMisses;
+}
+
+osg::ref_ptr<osg::Node> SceneCache::readCache(const std::string &cacheFile, const osgDB::Options *options)
+{
+    osgDB::ReaderWriter *rw = getCacheReaderWriter();
+    if (!rw || !osgDB::fileExists(cacheFile))
+    {
+        return nullptr;
+    }
+
+    MappedFile mappedFile(cacheFile);
+    if (!mappedFile.data())
+    {
+        return nullptr;
+    }
+
+    MemoryStreamBuf streamBuf(mappedFile.data(), mappedFile.size());
+    std::istream stream(&streamBuf);
+
+    osgDB::ReaderWriter::ReadResult result = rw->readNode(stream, options);
+    if (!result.validNode())
+    {
+        OSG_WARN << "SceneCache::readCache() Invalid cache " << cacheFile << std::endl;
+        return nullptr;
+    }
+
+    return result.getNode();
+}
+
+bool SceneCache::writeCache(const std::string &cacheFile, osg::Node *node, const osgDB::Options *options)
+{
+    osgDB::ReaderWriter *rw = getCacheReaderWriter();
+    if (!rw)
+    {
+        return false;
+    }
+
+    // 图片写入缓存文件，读取缓存时不再访问图片文件
+    osg::ref_ptr<osgDB::Options> writeOptions = options ? options->cloneOptions() : new osgDB::Options;
+    writeOptions->setOptionString(writeOptions->getOptionString() + " WriteImageHint=IncludeData");
+
+    // 先写入临时文件，避免其他线程或进程读到不完整的缓存
+    std::ostringstream tempFile;
+    tempFile << cacheFile << '.' << std::this_thread::get_id() << ".tmp";
+
+    {
+        std::ofstream stream(tempFile.str(), std::ios::out | std::ios::binary);
+        if (!stream)
+        {
+            OSG_WARN << "SceneCache::writeCache() Failed to open " << tempFile.str() << std::endl;
+            return false;
+        }
+
+        osgDB::ReaderWriter::WriteResult result = rw->writeNode(*node, stream, writeOptions);
+        if (!result.success() || !stream)
+        {
+            OSG_WARN << "SceneCache::writeCache() Failed to write " << cacheFile << std::endl;
+            stream.close();
+            std::error_code ec;
+            std::filesystem::remove(tempFile.str(), ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempFile.str(), cacheFile, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempFile.str(), ec);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace opeViewer
@@ -0,0 +1,60 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_8B186A4F93A84EA592C5ACF7E3C9C70D_H_
+#define INC_2026_10_18_8B186A4F93A84EA592C5ACF7E3C9C70D_H_
+
+#include <atomic>
+#include <string>
+
+#include <osg/Node>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+namespace osgDB
+{
+class Options;
+} // namespace osgDB
+
+namespace opeViewer
+{
+
+/// 场景缓存
+///
+/// 第一次读取文件时将结果以osgb格式（包含图片数据）写入缓存目录，之后通过内存映射读取缓存，跳过文本格式的解析
+///
+/// 缓存以文件的绝对路径、大小和修改时间为键，源文件变化后自动失效
+class SceneCache : public osg::Referenced
+{
+  public:
+    explicit SceneCache(const std::string &directory);
+
+    const std::string &getDirectory() const;
+
+    /// 读取文件，优先使用缓存，可以在多个线程中同时调用
+    osg::ref_ptr<osg::Node> readNodeFile(const std::string &file, const osgDB::Options *options = nullptr);
+
+    /// 缓存文件路径，源文件不存在时返回空
+    std::string getCacheFile(const std::string &file, const osgDB::Options *options = nullptr) const;
+
+    unsigned int getNumHits() const;
+
+    unsigned int getNumMisses() const;
+
+  protected:
+    ~SceneCache() override;
+
+    osg::ref_ptr<osg::Node> readCache(const std::string &cacheFile, const osgDB::Options *options);
+
+    bool writeCache(const std::string &cacheFile, osg::Node *node, const osgDB::Options *options);
+
+    std::string _directory;
+
+    std::atomic<unsigned int> _numHits{};
+    std::atomic<unsigned int> _numMisses{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_8B186A4F93A84EA592C5ACF7E3C9C70D_H_
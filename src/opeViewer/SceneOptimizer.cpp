@@ -0,0 +1,238 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "SceneOptimizer.h"
+
+#include <set>
+
+#include <osg/Geometry>
+#include <osg/Notify>
+#include <osg/Timer>
+#include <osgUtil/MeshOptimizers>
+#include <osgUtil/Optimizer>
+
+#include "GeometryInstancer.h"
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 统计绘制调用和顶点数量
+class CountGeometryVisitor : public osg::NodeVisitor
+{
+    std::set<osg::Geometry *> _visited;
+
+  public:
+    SceneOptimizer::GeometryCount _count;
+
+    CountGeometryVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    void apply(osg::Geometry &geometry) override
+    {
+        // 共享的几何体每次遍历到都会产生绘制调用
+        ++_count.drawables;
+        _count.drawCalls += geometry.getNumPrimitiveSets();
+
+        if (_visited.insert(&geometry).second && geometry.getVertexArray())
+        {
+            _count.vertices += geometry.getVertexArray()->getNumElements();
+        }
+    }
+};
+
+class UseVertexBufferObjectsVisitor : public osg::NodeVisitor
+{
+  public:
+    UseVertexBufferObjectsVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    void apply(osg::Geometry &geometry) override
+    {
+        geometry.setUseDisplayList(false);
+        geometry.setUseVertexBufferObjects(true);
+    }
+};
+
+} // namespace
+
+void SceneOptimizer::Report::print(std::ostream &out) const
+{
+    out << "SceneOptimizer: " << totalTime * 1000.0 << "ms"
+        << ", drawables " << before.drawables << " -> " << after.drawables << ", draw calls " << before.drawCalls << " -> " << after.drawCalls << ", vertices " << before.vertices << " -> " << after.vertices << std::endl;
+
+    if (instancingDrawCallsSaved > 0)
+    {
+        out << "    instancing saved " << instancingDrawCallsSaved << " draw calls" << std::endl;
+    }
+
+    for (auto &stageTime : stageTimes)
+    {
+        out << "    " << getStageName(stageTime.stage) << ": " << stageTime.time * 1000.0 << "ms" << std::endl;
+    }
+}
+
+SceneOptimizer::SceneOptimizer(unsigned int stages) : _stages(stages), _geometryInstancer(new GeometryInstancer)
+{
+}
+
+SceneOptimizer::~SceneOptimizer()
+{
+}
+
+void SceneOptimizer::setStages(unsigned int stages)
+{
+    _stages = stages;
+}
+
+unsigned int SceneOptimizer::getStages() const
+{
+    return _stages;
+}
+
+void SceneOptimizer::setReportCallback(SceneOptimizer::ReportCallback *callback)
+{
+    _reportCallback = callback;
+}
+
+SceneOptimizer::ReportCallback *SceneOptimizer::getReportCallback()
+{
+    return _reportCallback.get();
+}
+
+const SceneOptimizer::ReportCallback *SceneOptimizer::getReportCallback() const
+{
+    return _reportCallback.get();
+}
+
+void SceneOptimizer::reportImplementation(osg::Node *node, const SceneOptimizer::Report &report)
+{
+    if (osg::isNotifyEnabled(osg::INFO))
+    {
+        report.print(osg::notify(osg::INFO));
+    }
+}
+
+SceneOptimizer::Report SceneOptimizer::optimize(osg::Node *node)
+{
+    Report report;
+    if (!node || _stages == 0)
+    {
+        return report;
+    }
+
+    osg::ElapsedTime totalTime;
+
+    report.before = countGeometry(node);
+
+    // 先合并再生成索引和重排，重排的对象是合并后的大网格
+    // 实例化放在网格优化之后，网格优化不处理实例矩阵属性
+    for (Stage stage : {MERGE_GEOMETRY, INDEX_MESH, VERTEX_CACHE, VERTEX_ACCESS_ORDER, INSTANCING, USE_VERTEX_BUFFER_OBJECTS})
+    {
+        if (_stages & stage)
+        {
+            osg::ElapsedTime stageTime;
+            runStage(stage, node, report);
+            report.stageTimes.push_back({stage, stageTime.elapsedTime()});
+        }
+    }
+
+    report.after = countGeometry(node);
+    report.totalTime = totalTime.elapsedTime();
+
+    if (_reportCallback)
+    {
+        _reportCallback->reportImplementation(this, node, report);
+    }
+    else
+    {
+        reportImplementation(node, report);
+    }
+
+    return report;
+}
+
+const char *SceneOptimizer::getStageName(SceneOptimizer::Stage stage)
+{
+    switch (stage)
+    {
+    case MERGE_GEOMETRY:
+        return "MergeGeometry";
+    case INDEX_MESH:
+        return "IndexMesh";
+    case VERTEX_CACHE:
+        return "VertexCache";
+    case VERTEX_ACCESS_ORDER:
+        return "VertexAccessOrder";
+    case USE_VERTEX_BUFFER_OBJECTS:
+        return "UseVertexBufferObjects";
+    case INSTANCING:
+        return "Instancing";
+    default:
+        return "Unknown";
+    }
+}
+
+SceneOptimizer::GeometryCount SceneOptimizer::countGeometry(osg::Node *node)
+{
+    CountGeometryVisitor visitor;
+    if (node)
+    {
+        node->accept(visitor);
+    }
+    return visitor._count;
+}
+
+GeometryInstancer *SceneOptimizer::getGeometryInstancer()
+{
+    return _geometryInstancer.get();
+}
+
+void SceneOptimizer::runStage(SceneOptimizer::Stage stage, osg::Node *node, SceneOptimizer::Report &report)
+{
+    switch (stage)
+    {
+    case MERGE_GEOMETRY: {
+        // 只合并静态对象，依赖prepareSceneData中StaticObjectDetectionVisitor设置的DataVariance
+        osgUtil::Optimizer optimizer;
+        optimizer.optimize(node, osgUtil::Optimizer::SHARE_DUPLICATE_STATE | osgUtil::Optimizer::MERGE_GEODES | osgUtil::Optimizer::MERGE_GEOMETRY);
+        break;
+    }
+    case INDEX_MESH: {
+        osgUtil::IndexMeshVisitor visitor;
+        node->accept(visitor);
+        visitor.makeMesh();
+        break;
+    }
+    case VERTEX_CACHE: {
+        osgUtil::VertexCacheVisitor visitor;
+        node->accept(visitor);
+        visitor.optimizeVertices();
+        break;
+    }
+    case VERTEX_ACCESS_ORDER: {
+        osgUtil::VertexAccessOrderVisitor visitor;
+        node->accept(visitor);
+        visitor.optimizeOrder();
+        break;
+    }
+    case USE_VERTEX_BUFFER_OBJECTS: {
+        UseVertexBufferObjectsVisitor visitor;
+        node->accept(visitor);
+        break;
+    }
+    case INSTANCING: {
+        report.instancingDrawCallsSaved += _geometryInstancer->apply(node).drawCallsSaved;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,120 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_689A5297206B421B9258BE0CDD238114_H_
+#define INC_2026_10_18_689A5297206B421B9258BE0CDD238114_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+namespace osg
+{
+class Node;
+} // namespace osg
+
+namespace opeViewer
+{
+
+class GeometryInstancer;
+
+/// 加载时的几何优化
+///
+/// 在节点加入场景前执行，由Viewport::loadSceneData在工作线程中调用
+class SceneOptimizer : public osg::Referenced
+{
+  public:
+    enum Stage
+    {
+        /// 共享相同的状态并合并静态几何体
+        MERGE_GEOMETRY = 1 << 0,
+        /// 为未索引的三角形生成索引
+        INDEX_MESH = 1 << 1,
+        /// 按顶点缓存重新排列三角形
+        VERTEX_CACHE = 1 << 2,
+        /// 按访问顺序重新排列顶点
+        VERTEX_ACCESS_ORDER = 1 << 3,
+        /// 关闭显示列表，使用VBO
+        USE_VERTEX_BUFFER_OBJECTS = 1 << 4,
+        /// 将重复的静态子图替换为实例化绘制，见GeometryInstancer
+        INSTANCING = 1 << 5,
+        DEFAULT_STAGES = MERGE_GEOMETRY | INDEX_MESH | VERTEX_CACHE | VERTEX_ACCESS_ORDER | USE_VERTEX_BUFFER_OBJECTS,
+    };
+
+    /// 绘制对象和绘制调用按遍历到的次数统计，顶点数量中共享的几何体只统计一次
+    struct GeometryCount
+    {
+        unsigned int drawables{};
+        unsigned int drawCalls{};
+        unsigned int vertices{};
+    };
+
+    struct StageTime
+    {
+        Stage stage;
+        double time{};
+    };
+
+    /// 优化结果
+    struct Report
+    {
+        GeometryCount before;
+        GeometryCount after;
+        std::vector<StageTime> stageTimes;
+        double totalTime{};
+        /// 实例化节省的绘制调用
+        unsigned int instancingDrawCallsSaved{};
+
+        void print(std::ostream &out) const;
+    };
+
+    struct ReportCallback : osg::Referenced
+    {
+        /// 可能在工作线程中调用
+        virtual void reportImplementation(SceneOptimizer *optimizer, osg::Node *node, const Report &report) = 0;
+    };
+
+    explicit SceneOptimizer(unsigned int stages = DEFAULT_STAGES);
+
+    void setStages(unsigned int stages);
+
+    unsigned int getStages() const;
+
+    void setReportCallback(ReportCallback *callback);
+
+    ReportCallback *getReportCallback();
+
+    const ReportCallback *getReportCallback() const;
+
+    /// INSTANCING阶段使用的实例化参数
+    GeometryInstancer *getGeometryInstancer();
+
+    /// 没有设置ReportCallback时，结果通过OSG_INFO输出
+    virtual void reportImplementation(osg::Node *node, const Report &report);
+
+    /// 优化节点，节点不能正在被其他线程使用
+    Report optimize(osg::Node *node);
+
+    static const char *getStageName(Stage stage);
+
+    static GeometryCount countGeometry(osg::Node *node);
+
+  protected:
+    ~SceneOptimizer() override;
+
+    virtual void runStage(Stage stage, osg::Node *node, Report &report);
+
+    unsigned int _stages{};
+
+    osg::ref_ptr<ReportCallback> _reportCallback;
+
+    osg::ref_ptr<GeometryInstancer> _geometryInstancer;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_689A5297206B421B9258BE0CDD238114_H_
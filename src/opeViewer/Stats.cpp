@@ -0,0 +1,116 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "Stats.h"
+
+#include <utility>
+
+namespace opeViewer
+{
+
+namespace
+{
+
+const std::pair<Stats::Key, const char *> KEY_NAMES[] = {
+    {Stats::FRAME_RATE, "frame_rate"},
+    {Stats::EVENT, "event"},
+    {Stats::UPDATE, "update"},
+    {Stats::RENDERING, "rendering"},
+    {Stats::GPU, "gpu"},
+    {Stats::GPU_PASSES, "gpu_passes"},
+    {Stats::PIPELINE, "pipeline"},
+    {Stats::SCENE, "scene"},
+    {Stats::MEMORY, "memory"},
+    {Stats::PAGER, "pager"},
+    {Stats::PERF, "perf"},
+    {Stats::ALLOCATIONS, "allocations"},
+    {Stats::COMPILE, "compile"},
+};
+
+} // namespace
+
+Stats::Stats(const std::string &name) : osg::Stats(name)
+{
+}
+
+Stats::~Stats()
+{
+}
+
+const char *Stats::getKeyName(Key key)
+{
+    for (auto &keyName : KEY_NAMES)
+    {
+        if (keyName.first == key)
+        {
+            return keyName.second;
+        }
+    }
+    return "";
+}
+
+unsigned int Stats::getKey(const std::string &name)
+{
+    for (auto &keyName : KEY_NAMES)
+    {
+        if (name == keyName.second)
+        {
+            return keyName.first;
+        }
+    }
+    return 0;
+}
+
+void Stats::updateCollectFlags()
+{
+    _collectFlags = 0;
+    for (auto &keyName : KEY_NAMES)
+    {
+        if (collectStats(keyName.second))
+        {
+            _collectFlags |= keyName.first;
+        }
+    }
+}
+
+unsigned int Stats::getCollectFlags(const osg::Stats *stats)
+{
+    if (!stats)
+    {
+        return 0;
+    }
+
+    if (auto cached = dynamic_cast<const Stats *>(stats))
+    {
+        return cached->_collectFlags;
+    }
+
+    unsigned int flags{};
+    for (auto &keyName : KEY_NAMES)
+    {
+        if (stats->collectStats(keyName.second))
+        {
+            flags |= keyName.first;
+        }
+    }
+    return flags;
+}
+
+void Stats::setCollectStats(osg::Stats *stats, const std::string &name, bool flag)
+{
+    if (!stats)
+    {
+        return;
+    }
+
+    stats->collectStats(name, flag);
+
+    if (auto cached = dynamic_cast<Stats *>(stats))
+    {
+        unsigned int key = getKey(name);
+        cached->_collectFlags = flag ? cached->_collectFlags | key : cached->_collectFlags & ~key;
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,82 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_123301B0B75349148A7C3AAC071AE90A_H_
+#define INC_2026_10_18_123301B0B75349148A7C3AAC071AE90A_H_
+
+#include <string>
+
+#include <osg/Stats>
+
+namespace opeViewer
+{
+
+/// 统计
+///
+/// 将opeViewer使用的统计键缓存为位标志，热路径只测试位，不再按字符串查询osg::Stats的收集表
+///
+/// 窗口、视口和场景的Stats都是该类型；通过setCollectStats修改统计键时同时更新位标志，直接调用osg::Stats::collectStats修改后需要调用updateCollectFlags
+class Stats : public osg::Stats
+{
+  public:
+    /// 统计键
+    enum Key : unsigned int
+    {
+        FRAME_RATE = 1u << 0,
+        EVENT = 1u << 1,
+        UPDATE = 1u << 2,
+        RENDERING = 1u << 3,
+        GPU = 1u << 4,
+        GPU_PASSES = 1u << 5,
+        PIPELINE = 1u << 6,
+        SCENE = 1u << 7,
+        MEMORY = 1u << 8,
+        PAGER = 1u << 9,
+        PERF = 1u << 10,
+        ALLOCATIONS = 1u << 11,
+        COMPILE = 1u << 12,
+    };
+
+    explicit Stats(const std::string &name);
+
+    /// 键名，如"frame_rate"
+    static const char *getKeyName(Key key);
+
+    /// 键名对应的键，不是opeViewer的统计键时返回0
+    static unsigned int getKey(const std::string &name);
+
+    /// 打开或关闭的统计键
+    unsigned int getCollectFlags() const
+    {
+        return _collectFlags;
+    }
+
+    /// 从osg::Stats的收集表重新生成位标志
+    void updateCollectFlags();
+
+    /// stats为opeViewer::Stats时返回缓存的位标志，否则逐个查询统计键，每帧调用一次，不在热路径中调用
+    static unsigned int getCollectFlags(const osg::Stats *stats);
+
+    /// 同osg::Stats::collectStats(name, flag)，stats为opeViewer::Stats时同时更新位标志
+    static void setCollectStats(osg::Stats *stats, const std::string &name, bool flag);
+
+    static bool isCollected(const Stats *stats, Key key)
+    {
+        return stats && (stats->_collectFlags & key) != 0;
+    }
+
+    static bool isCollected(const osg::Stats *stats, Key key)
+    {
+        return (getCollectFlags(stats) & key) != 0;
+    }
+
+  protected:
+    ~Stats() override;
+
+    unsigned int _collectFlags{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_123301B0B75349148A7C3AAC071AE90A_H_
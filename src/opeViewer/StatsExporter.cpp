@@ -0,0 +1,581 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "StatsExporter.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include <osg/FrameStamp>
+#include <osg/Notify>
+#include <osg/Stats>
+#include <osg/Timer>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Scene.h"
+#include "Stats.h"
+#include "Viewport.h"
+#include "Window.h"
+
+namespace opeViewer
+{
+
+namespace
+{
+
+const char *UNIX_SOCKET_PREFIX = "unix:";
+
+/// 两次打开之间的最短间隔（秒），避免对端不存在时每帧重连
+const double REOPEN_INTERVAL = 1.0;
+
+std::string toColumnName(const std::string &prefix, const std::string &attribute)
+{
+    std::string name = prefix + '.';
+    for (char c : attribute)
+    {
+        name += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::tolower(static_cast<unsigned char>(c))) : '_';
+    }
+    return name;
+}
+
+void appendValue(std::string &line, double value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    line += text;
+}
+
+} // namespace
+
+StatsExporter::StatsExporter(const std::string &destination, Format format)
+    : _destination(destination), _format(format),
+      _windowAttributes{"Reference time",
+                        "Frame duration",
+                        "Frame rate",
+                        "Event traversal time taken",
+                        "Update traversal time taken",
+                        "Rendering traversals time taken",
+                        "Event cycles",
+                        "Event instructions",
+                        "Event LLC misses",
+                        "Event branch misses",
+                        "Event perf running ratio",
+                        "Update cycles",
+                        "Update instructions",
+                        "Update LLC misses",
+                        "Update branch misses",
+                        "Update perf running ratio",
+                        "Event allocations",
+                        "Update allocations",
+                        "Rendering allocations",
+                        "Rendering allocated bytes"},
+      _cameraAttributes{"Cull traversal time taken",
+                        "Draw traversal time taken",
+                        "GPU draw time taken",
+                        "Visible number of drawables",
+                        "Visible vertex count",
+                        "Cull cycles",
+                        "Cull instructions",
+                        "Cull LLC misses",
+                        "Cull branch misses",
+                        "Cull perf running ratio",
+                        "Draw cycles",
+                        "Draw instructions",
+                        "Draw LLC misses",
+                        "Draw branch misses",
+                        "Draw perf running ratio",
+                        "Cull allocations",
+                        "Draw allocations"},
+      _sceneAttributes{"DatabasePager merge time taken", "DatabasePager merged", "DatabasePager merge backlog"}
+{
+}
+
+StatsExporter::~StatsExporter()
+{
+    close();
+}
+
+const std::string &StatsExporter::getDestination() const
+{
+    return _destination;
+}
+
+StatsExporter::Format StatsExporter::getFormat() const
+{
+    return _format;
+}
+
+void StatsExporter::setInterval(double interval)
+{
+    _interval = interval;
+}
+
+double StatsExporter::getInterval() const
+{
+    return _interval;
+}
+
+void StatsExporter::setLatency(unsigned int latency)
+{
+    _latency = latency;
+}
+
+unsigned int StatsExporter::getLatency() const
+{
+    return _latency;
+}
+
+void StatsExporter::setWindowAttributes(const std::vector<std::string> &attributes)
+{
+    _windowAttributes = attributes;
+    _sources.clear();
+}
+
+const std::vector<std::string> &StatsExporter::getWindowAttributes() const
+{
+    return _windowAttributes;
+}
+
+void StatsExporter::setCameraAttributes(const std::vector<std::string> &attributes)
+{
+    _cameraAttributes = attributes;
+    _sources.clear();
+}
+
+const std::vector<std::string> &StatsExporter::getCameraAttributes() const
+{
+    return _cameraAttributes;
+}
+
+void StatsExporter::setSceneAttributes(const std::vector<std::string> &attributes)
+{
+    _sceneAttributes = attributes;
+    _sources.clear();
+}
+
+const std::vector<std::string> &StatsExporter::getSceneAttributes() const
+{
+    return _sceneAttributes;
+}
+
+void StatsExporter::sample(Window *window)
+{
+    if (_interval < 0.0)
+    {
+        return;
+    }
+
+    const osg::FrameStamp *frameStamp = window->getFrameStamp();
+    if (frameStamp->getFrameNumber() < _latency)
+    {
+        return;
+    }
+
+    double time = frameStamp->getReferenceTime();
+    if (_lastSampleTime >= 0.0 && time - _lastSampleTime < _interval)
+    {
+        return;
+    }
+    _lastSampleTime = time;
+
+    unsigned int frameNumber = frameStamp->getFrameNumber() - _latency;
+    if (_exported && frameNumber <= _lastExportedFrameNumber)
+    {
+        return;
+    }
+
+    updateSources(window);
+    writeRow(frameNumber);
+}
+
+void StatsExporter::exportHistory(Window *window)
+{
+    osg::Stats *stats = window->getStats();
+    if (!stats)
+    {
+        return;
+    }
+
+    updateSources(window);
+
+    // 最新一帧还未完成
+    for (unsigned int i = stats->getEarliestFrameNumber(); i < stats->getLatestFrameNumber(); ++i)
+    {
+        if (!_exported || i > _lastExportedFrameNumber)
+        {
+            writeRow(i);
+        }
+    }
+
+    // 手动导出，立即可见
+    if (_file.is_open())
+    {
+        _file.flush();
+    }
+}
+
+void StatsExporter::attach(Window *window)
+{
+    enableStats(window->getStats(), "frame_rate");
+    enableStats(window->getStats(), "event");
+    enableStats(window->getStats(), "update");
+
+    for (auto viewport : window->getViewports())
+    {
+        enableStats(viewport->getCamera()->getStats(), "rendering");
+        enableStats(viewport->getCamera()->getStats(), "gpu");
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+        {
+            enableStats(viewport->getSlave(i)._camera->getStats(), "rendering");
+            enableStats(viewport->getSlave(i)._camera->getStats(), "gpu");
+        }
+    }
+
+    for (auto scene : window->getScenes())
+    {
+        enableStats(scene->getStats(), "pager");
+    }
+}
+
+void StatsExporter::detach(Window *window)
+{
+    for (auto &enabled : _enabledStats)
+    {
+        osg::ref_ptr<osg::Stats> stats;
+        if (enabled.first.lock(stats))
+        {
+            Stats::setCollectStats(stats, enabled.second, false);
+        }
+    }
+    _enabledStats.clear();
+}
+
+void StatsExporter::enableStats(osg::Stats *stats, const char *name)
+{
+    if (stats && !stats->collectStats(name))
+    {
+        Stats::setCollectStats(stats, name, true);
+        _enabledStats.emplace_back(stats, name);
+    }
+}
+
+std::string StatsExporter::getFilePath() const
+{
+    if (_fileNumber == 0)
+    {
+        return _destination;
+    }
+
+    // stats.csv -> stats.1.csv
+    std::filesystem::path path(_destination);
+    std::filesystem::path fileName = path.stem();
+    fileName += '.' + std::to_string(_fileNumber);
+    fileName += path.extension();
+    return path.replace_filename(fileName).string();
+}
+
+void StatsExporter::updateSources(Window *window)
+{
+    std::vector<Source> sources;
+    sources.push_back({window->getStats(), &_windowAttributes, "window"});
+
+    unsigned int cameraNumber = 0;
+    for (auto viewport : window->getViewports())
+    {
+        sources.push_back({viewport->getCamera()->getStats(), &_cameraAttributes, "camera" + std::to_string(cameraNumber++)});
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+        {
+            sources.push_back({viewport->getSlave(i)._camera->getStats(), &_cameraAttributes, "camera" + std::to_string(cameraNumber++)});
+        }
+    }
+
+    unsigned int sceneNumber = 0;
+    for (auto scene : window->getScenes())
+    {
+        sources.push_back({scene->getStats(), &_sceneAttributes, "scene" + std::to_string(sceneNumber++)});
+    }
+
+    bool changed = sources.size() != _sources.size();
+    for (size_t i = 0; !changed && i < sources.size(); ++i)
+    {
+        changed = sources[i].stats != _sources[i].stats || sources[i].prefix != _sources[i].prefix;
+    }
+    if (!changed)
+    {
+        return;
+    }
+
+    _sources.swap(sources);
+    _columns.clear();
+    for (const Source &source : _sources)
+    {
+        for (const std::string &attribute : *source.attributes)
+        {
+            _columns.push_back(toColumnName(source.prefix, attribute));
+        }
+    }
+
+    // 已经写入旧的表头时，新的列写入新的文件或连接
+    if (_format == CSV && _headerWritten)
+    {
+        close();
+        _lastOpenTime = -1.0;
+    }
+    _headerWritten = false;
+}
+
+void StatsExporter::writeHeader()
+{
+    std::string header = "frame";
+    for (const std::string &column : _columns)
+    {
+        header += ',';
+        header += column;
+    }
+    header += '\n';
+    write(header);
+    _headerWritten = true;
+}
+
+void StatsExporter::writeRow(unsigned int frameNumber)
+{
+    if (!ensureOpen())
+    {
+        return;
+    }
+
+    // 新的文件或连接以及列变化时写入表头
+    if (_format == CSV && !_headerWritten)
+    {
+        writeHeader();
+    }
+
+    _line.clear();
+    if (_format == CSV)
+    {
+        _line += std::to_string(frameNumber);
+    }
+    else
+    {
+        _line += "{\"frame\":";
+        _line += std::to_string(frameNumber);
+    }
+
+    size_t column = 0;
+    for (const Source &source : _sources)
+    {
+        for (const std::string &attribute : *source.attributes)
+        {
+            // inf和nan不是合法的JSON数值
+            double value = 0.0;
+            bool valid = source.stats && source.stats->getAttribute(frameNumber, attribute, value) && std::isfinite(value);
+
+            if (_format == CSV)
+            {
+                _line += ',';
+                if (valid)
+                {
+                    appendValue(_line, value);
+                }
+            }
+            else
+            {
+                _line += ",\"";
+                _line += _columns[column];
+                _line += "\":";
+                if (valid)
+                {
+                    appendValue(_line, value);
+                }
+                else
+                {
+                    _line += "null";
+                }
+            }
+            ++column;
+        }
+    }
+
+    if (_format == JSON_LINES)
+    {
+        _line += '}';
+    }
+    _line += '\n';
+    if (!write(_line))
+    {
+        ++_numDroppedRows;
+    }
+
+    _lastExportedFrameNumber = frameNumber;
+    _exported = true;
+}
+
+bool StatsExporter::ensureOpen()
+{
+    if (_socket >= 0 || _file.is_open())
+    {
+        return true;
+    }
+    if (_lastOpenTime >= 0.0 && osg::Timer::instance()->time_s() - _lastOpenTime < REOPEN_INTERVAL)
+    {
+        return false;
+    }
+    return open();
+}
+
+bool StatsExporter::open()
+{
+    _lastOpenTime = osg::Timer::instance()->time_s();
+    _headerWritten = false;
+
+    if (_destination.compare(0, std::strlen(UNIX_SOCKET_PREFIX), UNIX_SOCKET_PREFIX) == 0)
+    {
+#ifndef _WIN32
+        std::string path = _destination.substr(std::strlen(UNIX_SOCKET_PREFIX));
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            OSG_WARN << "StatsExporter::open() Socket path too long " << path << std::endl;
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        // 非阻塞，对端的接收队列已满时connect和send都不等待
+        _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_socket < 0 || fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL) | O_NONBLOCK) != 0 || connect(_socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            OSG_INFO << "StatsExporter::open() Failed to connect to " << path << std::endl;
+            close();
+            return false;
+        }
+        return true;
+#else
+        OSG_WARN << "StatsExporter::open() UNIX domain sockets are not supported on this platform" << std::endl;
+        return false;
+#endif
+    }
+
+    // CSV的每个文件只有一个表头，跳过已有内容的文件
+    if (_format == CSV)
+    {
+        for (;;)
+        {
+            std::error_code ec;
+            uintmax_t size = std::filesystem::file_size(getFilePath(), ec);
+            if (ec || size == 0)
+            {
+                break;
+            }
+            ++_fileNumber;
+        }
+    }
+
+    _file.open(getFilePath(), std::ios::out | std::ios::app);
+    if (!_file)
+    {
+        OSG_WARN << "StatsExporter::open() Failed to open " << getFilePath() << std::endl;
+        _file.close();
+        return false;
+    }
+    return true;
+}
+
+bool StatsExporter::write(const std::string &text)
+{
+#ifndef _WIN32
+    if (_socket >= 0)
+    {
+        // 上一行还没有发送完，丢弃这一行，保证不发送半行
+        if (!sendPendingOutput())
+        {
+            return false;
+        }
+        _pendingOutput = text;
+        sendPendingOutput();
+        return true;
+    }
+#endif
+
+    if (!_file.is_open())
+    {
+        return true;
+    }
+
+    _file << text;
+    if (!_file)
+    {
+        OSG_WARN << "StatsExporter::write() Failed to write " << getFilePath() << std::endl;
+        close();
+    }
+    return true;
+}
+
+bool StatsExporter::sendPendingOutput()
+{
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+    const int flags = MSG_DONTWAIT;
+#endif
+    size_t offset = 0;
+    while (_socket >= 0 && offset < _pendingOutput.size())
+    {
+        ssize_t sent = send(_socket, _pendingOutput.data() + offset, _pendingOutput.size() - offset, flags);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            OSG_INFO << "StatsExporter::write() Connection to " << _destination << " closed" << std::endl;
+            close();
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    _pendingOutput.erase(0, offset);
+#endif
+    return _pendingOutput.empty();
+}
+
+unsigned int StatsExporter::getNumDroppedRows() const
+{
+    return _numDroppedRows;
+}
+
+void StatsExporter::close()
+{
+#ifndef _WIN32
+    if (_socket >= 0)
+    {
+        ::close(_socket);
+        _socket = -1;
+    }
+#endif
+    _pendingOutput.clear();
+    if (_file.is_open())
+    {
+        _file.close();
+    }
+    _file.clear();
+}
+
+} // namespace opeViewer
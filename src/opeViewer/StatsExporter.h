@@ -0,0 +1,158 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_F4099264676042F385C725C644947412_H_
+#define INC_2026_10_18_F4099264676042F385C725C644947412_H_
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osg/Stats>
+#include <osg/observer_ptr>
+
+namespace opeViewer
+{
+
+class Window;
+
+/// 统计导出
+///
+/// 将窗口、各相机和各场景的Stats按帧导出为CSV或JSON Lines，每帧一行，每个统计项一列，写入文件或UNIX域套接字（destination为"unix:<path>"）
+///
+/// 列名为"window.<属性>"、"camera<i>.<属性>"和"scene<i>.<属性>"，属性名转为小写并以'_'代替空格，相机按视口顺序编号（主相机在前，之后是从相机）；
+/// 只导出setWindowAttributes等指定的属性，没有值或值不是有限数时CSV为空，JSON为null；
+/// 每个CSV文件或连接只有一个表头，相机或场景增减后写入新的文件（"stats.csv"之后为"stats.1.csv"、"stats.2.csv"...）或重新连接，已存在的非空文件不追加
+///
+/// 设置到窗口时打开窗口的"frame_rate"、"event"、"update"、各相机的"rendering"、"gpu"和各场景的"pager"收集，移除时恢复由它打开的收集，
+/// 之后新增的视口和场景需要重新设置
+///
+/// 套接字为非阻塞的，对端来不及接收时丢弃整行，见getNumDroppedRows；文件不逐行刷新，关闭时刷新
+///
+/// 由Window::advance按间隔连续采样，GPU时间晚几帧得到，所以采样的是latency帧之前的一帧；StatsHandler的输出统计键导出Stats中的全部历史
+class StatsExporter : public osg::Referenced
+{
+  public:
+    enum Format
+    {
+        CSV,
+        JSON_LINES,
+    };
+
+    StatsExporter(const std::string &destination, Format format = CSV);
+
+    const std::string &getDestination() const;
+
+    Format getFormat() const;
+
+    /// 连续采样的间隔（秒），0表示每帧，小于0表示不连续采样
+    void setInterval(double interval);
+
+    double getInterval() const;
+
+    /// 采样的帧与当前帧的距离，不能超过Stats的历史长度
+    void setLatency(unsigned int latency);
+
+    unsigned int getLatency() const;
+
+    void setWindowAttributes(const std::vector<std::string> &attributes);
+
+    const std::vector<std::string> &getWindowAttributes() const;
+
+    void setCameraAttributes(const std::vector<std::string> &attributes);
+
+    const std::vector<std::string> &getCameraAttributes() const;
+
+    void setSceneAttributes(const std::vector<std::string> &attributes);
+
+    const std::vector<std::string> &getSceneAttributes() const;
+
+    /// 由Window::advance在帧号递增前调用
+    virtual void sample(Window *window);
+
+    /// 导出窗口Stats历史中的所有帧
+    virtual void exportHistory(Window *window);
+
+    /// 套接字来不及发送而丢弃的行数
+    unsigned int getNumDroppedRows() const;
+
+    /// 当前写入的文件，相机或场景增减后变化
+    std::string getFilePath() const;
+
+    /// 由Window::setStatsExporter调用，打开需要的Stats收集
+    virtual void attach(Window *window);
+
+    /// 由Window::setStatsExporter调用，恢复attach打开的收集
+    virtual void detach(Window *window);
+
+  protected:
+    ~StatsExporter() override;
+
+    struct Source
+    {
+        osg::Stats *stats{};
+        const std::vector<std::string> *attributes{};
+        std::string prefix;
+    };
+
+    /// 打开一个Stats收集，原来没有打开时记录下来，detach时关闭
+    void enableStats(osg::Stats *stats, const char *name);
+
+    /// 收集导出的Stats，与上次不同时重新生成列名，CSV开始新的文件或连接
+    void updateSources(Window *window);
+
+    void writeHeader();
+
+    void writeRow(unsigned int frameNumber);
+
+    /// 未打开时打开，失败后1秒内不再尝试
+    bool ensureOpen();
+
+    bool open();
+
+    /// 套接字有未发送完的数据时返回false
+    bool write(const std::string &text);
+
+    /// 发送_pendingOutput，全部发送完时返回true
+    bool sendPendingOutput();
+
+    void close();
+
+    std::string _destination;
+    Format _format{};
+    double _interval{1.0};
+    unsigned int _latency{3};
+
+    std::vector<std::string> _windowAttributes;
+    std::vector<std::string> _cameraAttributes;
+    std::vector<std::string> _sceneAttributes;
+
+    std::vector<Source> _sources;
+    /// 与_sources中的属性一一对应
+    std::vector<std::string> _columns;
+    bool _headerWritten{};
+    /// CSV的文件序号，0为destination本身
+    unsigned int _fileNumber{};
+
+    /// attach打开的收集
+    std::vector<std::pair<osg::observer_ptr<osg::Stats>, const char *>> _enabledStats;
+
+    double _lastSampleTime{-1.0};
+    unsigned int _lastExportedFrameNumber{};
+    bool _exported{};
+
+    std::ofstream _file;
+    int _socket{-1};
+    double _lastOpenTime{-1.0};
+    /// 各帧复用
+    std::string _line;
+    /// 上一行没有发送完的部分，发送完之前不发送新的行
+    std::string _pendingOutput;
+    unsigned int _numDroppedRows{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_F4099264676042F385C725C644947412_H_
@@ -4,92 +4,71 @@
 
 #include "StatsHandler.h"
 
+#include <algorithm>
 #include <bitset>
+#include <cstdio>
 #include <iomanip>
 #include <sstream>
 
 #include <osg/io_utils>
 
-#include <osg/MatrixTransform>
-
-#include <osg/Geometry>
+#include <osg/Geode>
 #include <osg/PolygonMode>
-#include <osg/Switch>
-#include <osgDB/DatabasePager>
 
+#include "DatabasePager.h"
 #include "GraphicsWindow.h"
+#include "Instrumentation.h"
+#include "OpenGLQuerySupport.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "Stats.h"
+#include "StatsExporter.h"
+#include "SubgraphProfiler.h"
 #include "Viewport.h"
 
 namespace opeViewer
 {
 
-#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
-#define GLSL_VERSION_STR "330 core"
-#else
-#define GLSL_VERSION_STR "300 es"
-#endif
+namespace
+{
+
+std::string formatValue(const char *format, double value)
+{
+    char text[128];
+    snprintf(text, sizeof(text), format, value);
+    return text;
+}
+
+/// 距上次更新超过interval毫秒
+bool needsUpdate(osg::Timer_t &tickLastUpdated, osg::Timer_t tick, double interval)
+{
+    if (tickLastUpdated && osg::Timer::instance()->delta_m(tickLastUpdated, tick) <= interval)
+    {
+        return false;
+    }
+    tickLastUpdated = tick;
+    return true;
+}
+
+/// 百分位数（毫秒），没有记录时为"."
+void formatPercentiles(const Histogram &histogram, std::string texts[4])
+{
+    static const double percentiles[] = {50.0, 95.0, 99.0, 100.0};
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        texts[i] = histogram.getTotalCount() ? formatValue("%.2f", histogram.getValueAtPercentile(percentiles[i]) * 1000.0) : ".";
+    }
+}
 
-static const char *gl3_StatsVertexShader = {"#version " GLSL_VERSION_STR "\n"
-                                            "// gl3_StatsVertexShader\n"
-                                            "#ifdef GL_ES\n"
-                                            "    precision highp float;\n"
-                                            "#endif\n"
-                                            "in vec4 osg_Vertex;\n"
-                                            "in vec4 osg_Color;\n"
-                                            "uniform mat4 osg_ModelViewProjectionMatrix;\n"
-                                            "out vec4 vertexColor;\n"
-                                            "void main(void)\n"
-                                            "{\n"
-                                            "    gl_Position = osg_ModelViewProjectionMatrix * osg_Vertex;\n"
-                                            "    vertexColor = osg_Color; \n"
-                                            "}\n"};
-
-static const char *gl3_StatsFragmentShader = {"#version " GLSL_VERSION_STR "\n"
-                                              "// gl3_StatsFragmentShader\n"
-                                              "#ifdef GL_ES\n"
-                                              "    precision highp float;\n"
-                                              "#endif\n"
-                                              "in vec4 vertexColor;\n"
-                                              "out vec4 color;\n"
-                                              "void main(void)\n"
-                                              "{\n"
-                                              "    color = vertexColor;\n"
-                                              "}\n"};
-
-static const char *gl2_StatsVertexShader = {"// gl2_StatsVertexShader\n"
-                                            "#ifdef GL_ES\n"
-                                            "    precision highp float;\n"
-                                            "#endif\n"
-                                            "varying vec4 vertexColor;\n"
-                                            "void main(void)\n"
-                                            "{\n"
-                                            "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
-                                            "    vertexColor = gl_Color;\n"
-                                            "}\n"};
-
-static const char *gl2_StatsFragmentShader = {"// gl2_StatsFragmentShader\n"
-                                              "#ifdef GL_ES\n"
-                                              "    precision highp float;\n"
-                                              "#endif\n"
-                                              "varying vec4 vertexColor;\n"
-                                              "void main(void)\n"
-                                              "{\n"
-                                              "    gl_FragColor = vertexColor;\n"
-                                              "}\n"};
+} // namespace
 
 StatsHandler::StatsHandler()
     : _keyEventTogglesOnScreenStats('s'),      //
       _keyEventPrintsOutStats('S'),            //
       _statsTypeMask(0),                       //
-      _statsTypeSize(4),                       //
+      _statsTypeSize(8),                       //
       _initialized(false),                     //
       _threadingModel(Window::SingleThreaded), //
-      _frameRateChildNum(0),                   //
-      _windowChildNum(0),                      //
-      _viewportChildNum(0),                    //
-      _sceneChildNum(0),                       //
       _numBlocks(8),                           //
       _blockMultiplier(10000.0),               //
       _statsWidth(1280.0f),                    //
@@ -108,32 +87,6 @@ StatsHandler::StatsHandler()
     _camera = _viewport->getCamera();
     _camera->getOrCreateStateSet()->setGlobalDefaults();
     _camera->setProjectionResizePolicy(osg::Camera::FIXED);
-
-    osg::DisplaySettings::ShaderHint shaderHint = osg::DisplaySettings::instance()->getShaderHint();
-    if (shaderHint == osg::DisplaySettings::SHADER_GL3 || shaderHint == osg::DisplaySettings::SHADER_GLES3)
-    {
-
-        OSG_INFO << "StatsHandler::StatsHandler() Setting up GL3 compatible shaders" << std::endl;
-
-        osg::ref_ptr<osg::Program> program = new osg::Program;
-        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl3_StatsVertexShader));
-        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl3_StatsFragmentShader));
-        _camera->getOrCreateStateSet()->setAttributeAndModes(program.get());
-    }
-    else if (shaderHint == osg::DisplaySettings::SHADER_GL2 || shaderHint == osg::DisplaySettings::SHADER_GLES2)
-    {
-
-        OSG_INFO << "StatsHandler::StatsHandler() Setting up GL2 compatible shaders" << std::endl;
-
-        osg::ref_ptr<osg::Program> program = new osg::Program;
-        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl2_StatsVertexShader));
-        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl2_StatsFragmentShader));
-        _camera->getOrCreateStateSet()->setAttributeAndModes(program.get());
-    }
-    else
-    {
-        OSG_INFO << "StatsHandler::StatsHandler() Fixed pipeline" << std::endl;
-    }
 }
 
 void StatsHandler::collectWhichCamerasToRenderStatsFor(Window *window, std::vector<osg::Camera *> &cameras)
@@ -145,7 +98,7 @@ void StatsHandler::collectWhichCamerasToRenderStatsFor(Window *window, std::vect
             continue;
         }
         cameras.push_back(viewport->getCamera());
-        for (auto i = 0; viewport->getNumSlaves(); ++i)
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
         {
             cameras.push_back(viewport->getSlave(i)._camera);
         }
@@ -155,49 +108,67 @@ void StatsHandler::collectWhichCamerasToRenderStatsFor(Window *window, std::vect
 void StatsHandler::setEnabled(size_t statsTypeMask)
 {
     _statsTypeMask = statsTypeMask;
-    if (!_viewport || !_viewport->getWindow() || !_camera || !_switch)
+    if (!_viewport || !_viewport->getWindow() || !_camera || !_overlay)
     {
         return;
     }
 
     if (!statsTypeMask)
     {
+        raiseInstrumentationLevel(Instrumentation::OFF);
         _camera->setNodeMask(0);
         return;
     }
 
+    constexpr size_t FULL_STATS = VIEWPORT_STATS | SCENE_STATS | MEMORY_STATS | SUBGRAPH_STATS | PIPELINE_STATS;
+    raiseInstrumentationLevel(statsTypeMask & FULL_STATS ? Instrumentation::FULL : Instrumentation::BASIC);
+
     auto window = _viewport->getWindow();
     std::vector<osg::Camera *> cameras;
     collectWhichCamerasToRenderStatsFor(window, cameras);
 
     // disable all first
     {
-        window->getStats()->collectStats("frame_rate", false);
-        window->getStats()->collectStats("event", false);
-        window->getStats()->collectStats("update", false);
-        window->getStats()->collectStats("scene", false);
+        Stats::setCollectStats(window->getStats(), "frame_rate", false);
+        Stats::setCollectStats(window->getStats(), "event", false);
+        Stats::setCollectStats(window->getStats(), "update", false);
+        Stats::setCollectStats(window->getStats(), "scene", false);
+        Stats::setCollectStats(window->getStats(), "memory", false);
+        Stats::setCollectStats(window->getStats(), "perf", false);
+        Stats::setCollectStats(window->getStats(), "allocations", false);
+        window->setCollectFrameTimeHistograms(false);
+
+        for (auto scene : window->getScenes())
+        {
+            if (scene->getStats())
+            {
+                Stats::setCollectStats(scene->getStats(), "pager", false);
+            }
+        }
 
         for (std::vector<osg::Camera *>::iterator itr = cameras.begin(); itr != cameras.end(); ++itr)
         {
             osg::Stats *stats = (*itr)->getStats();
             if (stats)
             {
-                stats->collectStats("rendering", false);
-                stats->collectStats("gpu", false);
-                stats->collectStats("scene", false);
+                Stats::setCollectStats(stats, "rendering", false);
+                Stats::setCollectStats(stats, "gpu", false);
+                Stats::setCollectStats(stats, "scene", false);
+                Stats::setCollectStats(stats, "pipeline", false);
+                Stats::setCollectStats(stats, "gpu_passes", false);
+                Stats::setCollectStats(stats, "perf", false);
+                Stats::setCollectStats(stats, "allocations", false);
             }
         }
 
         _camera->setNodeMask(0);
-        _switch->setAllChildrenOff();
     }
 
     if (statsTypeMask & FRAME_RATE)
     {
-        window->getStats()->collectStats("frame_rate", true);
+        Stats::setCollectStats(window->getStats(), "frame_rate", true);
 
         _camera->setNodeMask(0xffffffff);
-        _switch->setValue(_frameRateChildNum, true);
     }
 
     if (statsTypeMask & WINDOW_STATS)
@@ -211,21 +182,24 @@ void StatsHandler::setEnabled(size_t statsTypeMask)
             {
                 dp->resetStats();
             }
+            if (scene->getStats())
+            {
+                Stats::setCollectStats(scene->getStats(), "pager", true);
+            }
         }
 
-        window->getStats()->collectStats("event", true);
-        window->getStats()->collectStats("update", true);
+        Stats::setCollectStats(window->getStats(), "event", true);
+        Stats::setCollectStats(window->getStats(), "update", true);
 
         for (std::vector<osg::Camera *>::iterator itr = cameras.begin(); itr != cameras.end(); ++itr)
         {
             if ((*itr)->getStats())
-                (*itr)->getStats()->collectStats("rendering", true);
+                Stats::setCollectStats((*itr)->getStats(), "rendering", true);
             if ((*itr)->getStats())
-                (*itr)->getStats()->collectStats("gpu", true);
+                Stats::setCollectStats((*itr)->getStats(), "gpu", true);
         }
 
         _camera->setNodeMask(0xffffffff);
-        _switch->setValue(_windowChildNum, true);
     }
 
     if (statsTypeMask & VIEWPORT_STATS)
@@ -235,20 +209,89 @@ void StatsHandler::setEnabled(size_t statsTypeMask)
             osg::Stats *stats = (*itr)->getStats();
             if (stats)
             {
-                stats->collectStats("scene", true);
+                Stats::setCollectStats(stats, "scene", true);
             }
         }
 
         _camera->setNodeMask(0xffffffff);
-        _switch->setValue(_viewportChildNum, true);
     }
 
     if (statsTypeMask & SCENE_STATS)
     {
-        window->getStats()->collectStats("scene", true);
+        Stats::setCollectStats(window->getStats(), "scene", true);
+
+        _camera->setNodeMask(0xffffffff);
+    }
+
+    // 直方图由Window::setCollectFrameTimeHistograms控制，GPU的分布需要"gpu"
+    if (statsTypeMask & FRAME_TIME_STATS)
+    {
+        window->setCollectFrameTimeHistograms(true);
+
+        for (auto camera : cameras)
+        {
+            if (camera->getStats())
+            {
+                Stats::setCollectStats(camera->getStats(), "gpu", true);
+            }
+        }
 
         _camera->setNodeMask(0xffffffff);
-        _switch->setValue(_sceneChildNum, true);
+    }
+
+    if (statsTypeMask & MEMORY_STATS)
+    {
+        Stats::setCollectStats(window->getStats(), "memory", true);
+
+        _camera->setNodeMask(0xffffffff);
+    }
+
+    // 各绘制过程的GPU时间、硬件计数器和分配计数只在输出统计时报告
+    if (statsTypeMask & SUBGRAPH_STATS)
+    {
+        Stats::setCollectStats(window->getStats(), "perf", true);
+        Stats::setCollectStats(window->getStats(), "allocations", true);
+
+        for (auto camera : cameras)
+        {
+            if (camera->getStats())
+            {
+                Stats::setCollectStats(camera->getStats(), "gpu_passes", true);
+                Stats::setCollectStats(camera->getStats(), "perf", true);
+                Stats::setCollectStats(camera->getStats(), "allocations", true);
+            }
+        }
+
+        _camera->setNodeMask(0xffffffff);
+    }
+
+    if (statsTypeMask & PIPELINE_STATS)
+    {
+        for (auto camera : cameras)
+        {
+            if (camera->getStats())
+            {
+                Stats::setCollectStats(camera->getStats(), "pipeline", true);
+            }
+        }
+
+        _camera->setNodeMask(0xffffffff);
+    }
+}
+
+void StatsHandler::raiseInstrumentationLevel(Instrumentation::Level level)
+{
+    if (_raisedInstrumentationLevel)
+    {
+        Instrumentation::setLevel(_previousInstrumentationLevel);
+        _raisedInstrumentationLevel = false;
+    }
+
+    if (Instrumentation::getLevel() < level)
+    {
+        _previousInstrumentationLevel = Instrumentation::getLevel();
+        _raisedInstrumentationLevel = true;
+        Instrumentation::setLevel(level);
     }
 }
 
@@ -352,6 +395,53 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter &ea, osgGA::GUIActionAdap
                     }
                     OSG_NOTICE << std::endl;
                 }
+
+                OSG_NOTICE << "Frame time percentiles (ms): p50 p95 p99 max" << std::endl;
+                auto reportPercentiles = [](const std::string &label, const Histogram &histogram) {
+                    std::string texts[4];
+                    formatPercentiles(histogram, texts);
+                    OSG_NOTICE << "    " << label << " " << texts[0] << " " << texts[1] << " " << texts[2] << " " << texts[3] << " (" << histogram.getTotalCount() << " frames)" << std::endl;
+                };
+                const FrameTimeHistograms &windowHistograms = window->getFrameTimeHistograms();
+                for (auto stage : {FrameTimeHistograms::FRAME, FrameTimeHistograms::EVENT, FrameTimeHistograms::UPDATE})
+                {
+                    reportPercentiles(FrameTimeHistograms::getStageName(stage), windowHistograms[stage]);
+                }
+                for (unsigned int i = 0; i < cameras.size(); ++i)
+                {
+                    const FrameTimeHistograms *cameraHistograms = window->getFrameTimeHistograms(cameras[i]);
+                    if (!cameraHistograms)
+                    {
+                        continue;
+                    }
+                    for (auto stage : {FrameTimeHistograms::CULL, FrameTimeHistograms::DRAW, FrameTimeHistograms::GPU})
+                    {
+                        reportPercentiles(std::string(FrameTimeHistograms::getStageName(stage)) + " #" + std::to_string(i), (*cameraHistograms)[stage]);
+                    }
+                }
+
+                for (unsigned int i = 0; i < cameras.size(); ++i)
+                {
+                    Renderer *renderer = dynamic_cast<Renderer *>(cameras[i]->getRenderer());
+                    if (renderer && renderer->getSubgraphProfiler())
+                    {
+                        OSG_NOTICE << "Camera #" << i << " ";
+                        renderer->getSubgraphProfiler()->report(osg::notify(osg::NOTICE));
+                    }
+                    if (renderer && !renderer->getGPUPasses().empty())
+                    {
+                        OSG_NOTICE << "Camera #" << i << " GPU passes (ms): begin end time taken" << std::endl;
+                        for (const GPUPass &pass : renderer->getGPUPasses())
+                        {
+                            OSG_NOTICE << "    " << std::string(2 * pass.depth, ' ') << pass.name << " " << pass.beginTime * 1000.0 << " " << pass.endTime * 1000.0 << " " << (pass.endTime - pass.beginTime) * 1000.0 << std::endl;
+                        }
+                    }
+                }
+
+                if (window->getStatsExporter())
+                {
+                    window->getStatsExporter()->exportHistory(window);
+                }
             }
             return true;
         }
@@ -372,10 +462,10 @@ void StatsHandler::updateThreadingModelText()
     switch (_threadingModel)
     {
     case (Window::SingleThreaded):
-        _threadingModelText->setText("ThreadingModel: SingleThreaded");
+        _threadingModelText->text = "ThreadingModel: SingleThreaded";
         break;
     default:
-        _threadingModelText->setText("ThreadingModel: unknown");
+        _threadingModelText->text = "ThreadingModel: unknown";
         break;
     }
 }
@@ -389,8 +479,9 @@ void StatsHandler::reset()
         _viewport->getWindow()->removeViewport(_viewport);
     }
     _viewport = nullptr;
-    _switch = nullptr;
     _statsGeode = nullptr;
+    _overlay = nullptr;
+    _items.clear();
     _threadingModelText = nullptr;
 }
 
@@ -462,703 +553,819 @@ void StatsHandler::setWindowSize(int width, int height)
     }
 }
 
-// Drawcallback to draw averaged attribute
-struct AveragedValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
+void StatsHandler::Snapshot::reset(unsigned int frameNumber, osg::Timer_t tick)
+{
+    _frameNumber = frameNumber;
+    _tick = tick;
+    _numHistories = 0;
+}
+
+unsigned int StatsHandler::Snapshot::getFrameNumber() const
+{
+    return _frameNumber;
+}
+
+osg::Timer_t StatsHandler::Snapshot::getTick() const
 {
-    AveragedValueTextDrawCallback(osg::Stats *stats, const std::string &name, int frameDelta, bool averageInInverseSpace, double multiplier)
-        : _stats(stats), _attributeName(name), _frameDelta(frameDelta), _averageInInverseSpace(averageInInverseSpace), _multiplier(multiplier), _tickLastUpdated(0)
+    return _tick;
+}
+
+bool StatsHandler::Snapshot::getAttribute(osg::Stats *stats, unsigned int frameNumber, const std::string &attributeName, double &value) const
+{
+    const History *history = getHistory(stats);
+    if (!history || frameNumber < history->earliestFrameNumber || frameNumber - history->earliestFrameNumber >= history->attributeMaps.size())
     {
+        return false;
     }
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    const osg::Stats::AttributeMap &attributeMap = *history->attributeMaps[frameNumber - history->earliestFrameNumber];
+    auto itr = attributeMap.find(attributeName);
+    if (itr == attributeMap.end())
     {
-        osgText::Text *text = (osgText::Text *)drawable;
+        return false;
+    }
+    value = itr->second;
+    return true;
+}
 
-        osg::Timer_t tick = osg::Timer::instance()->tick();
-        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+bool StatsHandler::Snapshot::getAveragedAttribute(osg::Stats *stats, const std::string &attributeName, double &value, bool averageInInverseSpace) const
+{
+    const History *history = getHistory(stats);
+    if (!history)
+    {
+        return false;
+    }
 
-        if (delta > 50) // update every 50ms
+    double total = 0.0;
+    double numValidSamples = 0.0;
+    for (const osg::Stats::AttributeMap *attributeMap : history->attributeMaps)
+    {
+        auto itr = attributeMap->find(attributeName);
+        if (itr != attributeMap->end())
         {
-            _tickLastUpdated = tick;
-            double value;
-            if (_stats->getAveragedAttribute(_attributeName, value, _averageInInverseSpace))
-            {
-                char tmpText[128];
-                sprintf(tmpText, "%4.2f", value * _multiplier);
-                text->setText(tmpText);
-            }
-            else
-            {
-                text->setText("");
-            }
+            total += averageInInverseSpace ? 1.0 / itr->second : itr->second;
+            numValidSamples += 1.0;
         }
-        text->drawImplementation(renderInfo);
     }
 
-    osg::ref_ptr<osg::Stats> _stats;
-    std::string _attributeName;
-    int _frameDelta;
-    bool _averageInInverseSpace;
-    double _multiplier;
-    mutable osg::Timer_t _tickLastUpdated;
-};
+    if (numValidSamples == 0.0)
+    {
+        return false;
+    }
+    value = averageInInverseSpace ? numValidSamples / total : total / numValidSamples;
+    return true;
+}
 
-// Drawcallback to draw raw attribute
-struct RawValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
+const StatsHandler::Snapshot::History *StatsHandler::Snapshot::getHistory(osg::Stats *stats) const
 {
-    RawValueTextDrawCallback(osg::Stats *stats, const std::string &name, int frameDelta, double multiplier) : _stats(stats), _attributeName(name), _frameDelta(frameDelta), _multiplier(multiplier), _tickLastUpdated(0)
+    if (!stats)
     {
+        return nullptr;
     }
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    for (unsigned int i = 0; i < _numHistories; ++i)
     {
-        osgText::Text *text = (osgText::Text *)drawable;
+        if (_histories[i].stats == stats)
+        {
+            return &_histories[i];
+        }
+    }
 
-        osg::Timer_t tick = osg::Timer::instance()->tick();
-        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+    if (_numHistories == _histories.size())
+    {
+        _histories.emplace_back();
+    }
+    History &history = _histories[_numHistories++];
+    history.stats = stats;
+    history.earliestFrameNumber = stats->getEarliestFrameNumber();
+    history.attributeMaps.clear();
+    for (unsigned int i = history.earliestFrameNumber; i <= stats->getLatestFrameNumber(); ++i)
+    {
+        history.attributeMaps.push_back(&stats->getAttributeMap(i));
+    }
+    return &history;
+}
 
-        if (delta > 50) // update every 50ms
-        {
-            _tickLastUpdated = tick;
+StatsHandler::TextItem::TextItem(const osg::Vec3 &position, const std::string &text, const osg::Vec4 &color) : position(position), text(text), color(color)
+{
+}
 
-            unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
+void StatsHandler::TextItem::update(const Snapshot &snapshot, StatsOverlay &overlay)
+{
+    overlay.addText(position, text, color);
+}
+
+/// 统计值，每50ms更新一次
+struct StatsHandler::ValueTextItem : StatsHandler::Item
+{
+    osg::Vec3 position;
+    osg::Vec4 color;
+    osg::ref_ptr<osg::Stats> stats;
+    std::string attributeName;
+    bool average{};
+    bool averageInInverseSpace{};
+    double multiplier{};
+
+    osg::Timer_t tickLastUpdated{};
+    std::string text;
+
+    ValueTextItem(const osg::Vec3 &position, const osg::Vec4 &color, osg::Stats *stats, const std::string &attributeName, bool average, bool averageInInverseSpace, double multiplier)
+        : position(position), color(color), stats(stats), attributeName(attributeName), average(average), averageInInverseSpace(averageInInverseSpace), multiplier(multiplier)
+    {
+    }
+
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 50))
+        {
             double value;
-            if (_stats->getAttribute(frameNumber, _attributeName, value))
-            {
-                char tmpText[128];
-                sprintf(tmpText, "%4.2f", value * _multiplier);
-                text->setText(tmpText);
-            }
-            else
-            {
-                text->setText("");
-            }
+            bool valid = average ? snapshot.getAveragedAttribute(stats.get(), attributeName, value, averageInInverseSpace) : snapshot.getAttribute(stats.get(), snapshot.getFrameNumber(), attributeName, value);
+            text = valid ? formatValue("%4.2f", value * multiplier) : std::string();
         }
-        text->drawImplementation(renderInfo);
+        overlay.addText(position, text, color);
     }
-
-    osg::ref_ptr<osg::Stats> _stats;
-    std::string _attributeName;
-    int _frameDelta;
-    double _multiplier;
-    mutable osg::Timer_t _tickLastUpdated;
 };
 
-struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCallback
+/// 背景矩形
+struct StatsHandler::RectangleItem : StatsHandler::Item
 {
-    CameraSceneStatsTextDrawCallback(osg::Camera *camera, int cameraNumber) : _camera(camera), _tickLastUpdated(0), _cameraNumber(cameraNumber)
+    osg::Vec3 leftTop;
+    float width{};
+    float height{};
+    osg::Vec4 color;
+
+    RectangleItem(const osg::Vec3 &leftTop, float width, float height, const osg::Vec4 &color) : leftTop(leftTop), width(width), height(height), color(color)
     {
     }
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
     {
-        if (!_camera)
-            return;
+        overlay.addRectangle(leftTop, width, height, color);
+    }
+};
 
-        osgText::Text *text = (osgText::Text *)drawable;
+/// 固定的线段，每两个顶点一条
+struct StatsHandler::LinesItem : StatsHandler::Item
+{
+    std::vector<osg::Vec3> vertices;
+    osg::Vec4 color;
 
-        osg::Timer_t tick = osg::Timer::instance()->tick();
-        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+    explicit LinesItem(const osg::Vec4 &color) : color(color)
+    {
+    }
 
-        if (delta > 100) // update every 100ms
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        for (size_t i = 0; i + 1 < vertices.size(); i += 2)
         {
-            _tickLastUpdated = tick;
-            std::ostringstream viewStr;
-            viewStr.clear();
-
-            osg::Stats *stats = _camera->getStats();
-            Renderer *renderer = dynamic_cast<Renderer *>(_camera->getRenderer());
-
-            if (stats && renderer)
-            {
-                viewStr.setf(std::ios::left, std::ios::adjustfield);
-                viewStr.width(14);
-                // Used fixed formatting, as scientific will switch to "...e+.." notation for
-                // large numbers of vertices/drawables/etc.
-                viewStr.setf(std::ios::fixed);
-                viewStr.precision(0);
-
-                viewStr << std::setw(1) << "#" << _cameraNumber << std::endl;
-
-                // Camera name
-                if (!_camera->getName().empty())
-                    viewStr << _camera->getName();
-                viewStr << std::endl;
+            overlay.addLine(vertices[i], vertices[i + 1], color);
+        }
+    }
+};
 
-                unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
-                // if (!(renderer->getGraphicsThreadDoesCull()))
-                {
-                    --frameNumber;
-                }
+/// 最近numBlocks帧中各帧开始和结束时间之间的色块，以最早一帧的参考时间为起点
+struct StatsHandler::BlocksItem : StatsHandler::Item
+{
+    osg::Vec3 position;
+    float height{};
+    osg::Vec4 color;
+    osg::ref_ptr<osg::Stats> viewerStats;
+    osg::ref_ptr<osg::Stats> stats;
+    std::string beginName;
+    std::string endName;
+    unsigned int numBlocks{};
+    double blockMultiplier{};
+
+    BlocksItem(const osg::Vec3 &position, float height, const osg::Vec4 &color, osg::Stats *viewerStats, osg::Stats *stats, const std::string &beginName, const std::string &endName, unsigned int numBlocks, double blockMultiplier)
+        : position(position), height(height), color(color), viewerStats(viewerStats), stats(stats), beginName(beginName), endName(endName), numBlocks(numBlocks), blockMultiplier(blockMultiplier)
+    {
+    }
 
-#define STATS_ATTRIBUTE(str)                                                                                                                                                                                                                   \
-    if (stats->getAttribute(frameNumber, str, value))                                                                                                                                                                                          \
-        viewStr << std::setw(8) << value << std::endl;                                                                                                                                                                                         \
-    else                                                                                                                                                                                                                                       \
-        viewStr << std::setw(8) << "." << std::endl;
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        if (snapshot.getFrameNumber() < numBlocks)
+        {
+            return;
+        }
 
-                double value = 0.0;
+        unsigned int endFrame = snapshot.getFrameNumber() - 1;
+        unsigned int startFrame = endFrame + 1 - numBlocks;
+        double referenceTime;
+        if (!snapshot.getAttribute(viewerStats.get(), startFrame, "Reference time", referenceTime))
+        {
+            return;
+        }
 
-                STATS_ATTRIBUTE("Visible number of lights")
-                STATS_ATTRIBUTE("Visible number of render bins")
-                STATS_ATTRIBUTE("Visible depth")
-                STATS_ATTRIBUTE("Number of StateGraphs")
-                STATS_ATTRIBUTE("Visible number of impostors")
-                STATS_ATTRIBUTE("Visible number of drawables")
-                STATS_ATTRIBUTE("Number of ordered leaves")
-                STATS_ATTRIBUTE("Visible number of fast drawables")
-                STATS_ATTRIBUTE("Visible vertex count")
-
-                STATS_ATTRIBUTE("Visible number of PrimitiveSets")
-                STATS_ATTRIBUTE("Visible number of GL_POINTS")
-                STATS_ATTRIBUTE("Visible number of GL_LINES")
-                STATS_ATTRIBUTE("Visible number of GL_LINE_STRIP")
-                STATS_ATTRIBUTE("Visible number of GL_LINE_LOOP")
-                STATS_ATTRIBUTE("Visible number of GL_TRIANGLES")
-                STATS_ATTRIBUTE("Visible number of GL_TRIANGLE_STRIP")
-                STATS_ATTRIBUTE("Visible number of GL_TRIANGLE_FAN")
-                STATS_ATTRIBUTE("Visible number of GL_QUADS")
-                STATS_ATTRIBUTE("Visible number of GL_QUAD_STRIP")
-                STATS_ATTRIBUTE("Visible number of GL_POLYGON")
-
-                text->setText(viewStr.str());
+        double beginValue, endValue;
+        double minWidth = .0002;
+        for (unsigned int i = startFrame; i <= endFrame; ++i)
+        {
+            if (snapshot.getAttribute(stats.get(), i, beginName, beginValue) && snapshot.getAttribute(stats.get(), i, endName, endValue))
+            {
+                endValue = std::max(endValue, beginValue + minWidth);
+                float begin = position.x() + (beginValue - referenceTime) * blockMultiplier;
+                float end = position.x() + (endValue - referenceTime) * blockMultiplier;
+                overlay.addRectangle(osg::Vec3(begin, position.y() + height, position.z()), end - begin, height, color);
             }
         }
-        text->drawImplementation(renderInfo);
     }
-
-    osg::observer_ptr<osg::Camera> _camera;
-    mutable osg::Timer_t _tickLastUpdated;
-    int _cameraNumber;
 };
 
-struct ViewSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCallback
+/// 最近numFrames帧的参考时间
+struct StatsHandler::FrameMarkersItem : StatsHandler::Item
 {
-    ViewSceneStatsTextDrawCallback(Scene *scene, int viewNumber) : _scene(scene), _tickLastUpdated(0), _viewNumber(viewNumber)
+    osg::Vec3 position;
+    float height{};
+    osg::Vec4 color;
+    osg::ref_ptr<osg::Stats> viewerStats;
+    unsigned int numFrames{};
+    double blockMultiplier{};
+
+    FrameMarkersItem(const osg::Vec3 &position, float height, const osg::Vec4 &color, osg::Stats *viewerStats, unsigned int numFrames, double blockMultiplier)
+        : position(position), height(height), color(color), viewerStats(viewerStats), numFrames(numFrames), blockMultiplier(blockMultiplier)
     {
     }
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
     {
-        if (!_scene)
+        if (snapshot.getFrameNumber() + 1 < numFrames)
+        {
             return;
+        }
 
-        osgText::Text *text = (osgText::Text *)drawable;
-
-        osg::Timer_t tick = osg::Timer::instance()->tick();
-        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+        unsigned int endFrame = snapshot.getFrameNumber();
+        unsigned int startFrame = endFrame + 1 - numFrames;
+        double referenceTime;
+        if (!snapshot.getAttribute(viewerStats.get(), startFrame, "Reference time", referenceTime))
+        {
+            return;
+        }
 
-        if (delta > 200) // update every 100ms
+        double currentReferenceTime;
+        for (unsigned int i = startFrame; i <= endFrame; ++i)
         {
-            _tickLastUpdated = tick;
-            osg::Stats *stats = _scene->getStats();
-            if (stats)
+            if (snapshot.getAttribute(viewerStats.get(), i, "Reference time", currentReferenceTime))
             {
-                std::ostringstream viewStr;
-                viewStr.clear();
-                viewStr.setf(std::ios::left, std::ios::adjustfield);
-                viewStr.width(20);
-                viewStr.setf(std::ios::fixed);
-                viewStr.precision(0);
-
-                viewStr << std::setw(1) << "#" << _viewNumber;
-
-                // View name
-                if (!_scene->getName().empty())
-                    viewStr << ": " << _scene->getName();
-                viewStr << std::endl;
-
-                unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
-                // if (!(renderer->getGraphicsThreadDoesCull()))
-                {
-                    --frameNumber;
-                }
+                float x = position.x() + (currentReferenceTime - referenceTime) * blockMultiplier;
+                overlay.addLine(osg::Vec3(x, position.y() + height, position.z()), osg::Vec3(x, position.y(), position.z()), color);
+            }
+        }
+    }
+};
 
-#define STATS_ATTRIBUTE_PAIR(str1, str2)                                                                                                                                                                                                       \
-    if (stats->getAttribute(frameNumber, str1, value))                                                                                                                                                                                         \
-        viewStr << std::setw(9) << value;                                                                                                                                                                                                      \
-    else                                                                                                                                                                                                                                       \
-        viewStr << std::setw(9) << ".";                                                                                                                                                                                                        \
-    if (stats->getAttribute(frameNumber, str2, value))                                                                                                                                                                                         \
-        viewStr << std::setw(9) << value << std::endl;                                                                                                                                                                                         \
-    else                                                                                                                                                                                                                                       \
-        viewStr << std::setw(9) << "." << std::endl;
+/// 折线图，每帧取一次平均值，每个单位宽度一个值
+struct StatsHandler::GraphItem : StatsHandler::Item
+{
+    /// 左下角
+    osg::Vec3 position;
+    float height{};
+    osg::ref_ptr<osg::Stats> stats;
+    std::string attributeName;
+    float max{};
+    osg::Vec4 color;
+
+    /// 环形缓冲，最旧的值在next
+    std::vector<float> values;
+    unsigned int capacity{};
+    unsigned int next{};
+    bool sampled{};
+    unsigned int frameNumber{};
+
+    GraphItem(const osg::Vec3 &position, float width, float height, osg::Stats *stats, const std::string &attributeName, float max, const osg::Vec4 &color)
+        : position(position), height(height), stats(stats), attributeName(attributeName), max(max), color(color), capacity(static_cast<unsigned int>(width))
+    {
+        values.reserve(capacity);
+    }
 
-                double value = 0.0;
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        if (!sampled || frameNumber != snapshot.getFrameNumber())
+        {
+            sampled = true;
+            frameNumber = snapshot.getFrameNumber();
 
-                // header
-                viewStr << std::setw(9) << "Unique" << std::setw(9) << "Instance" << std::endl;
+            double value;
+            if (!snapshot.getAveragedAttribute(stats.get(), attributeName, value, true))
+            {
+                value = 0.0;
+            }
+            float sample = static_cast<float>(osg::clampTo(value, 0.0, double(max)));
 
-                STATS_ATTRIBUTE_PAIR("Number of unique StateSet", "Number of instanced Stateset")
-                STATS_ATTRIBUTE_PAIR("Number of unique Group", "Number of instanced Group")
-                STATS_ATTRIBUTE_PAIR("Number of unique Transform", "Number of instanced Transform")
-                STATS_ATTRIBUTE_PAIR("Number of unique LOD", "Number of instanced LOD")
-                STATS_ATTRIBUTE_PAIR("Number of unique Switch", "Number of instanced Switch")
-                STATS_ATTRIBUTE_PAIR("Number of unique Geode", "Number of instanced Geode")
-                STATS_ATTRIBUTE_PAIR("Number of unique Drawable", "Number of instanced Drawable")
-                STATS_ATTRIBUTE_PAIR("Number of unique Geometry", "Number of instanced Geometry")
-                STATS_ATTRIBUTE_PAIR("Number of unique Vertices", "Number of instanced Vertices")
-                STATS_ATTRIBUTE_PAIR("Number of unique Primitives", "Number of instanced Primitives")
-
-                text->setText(viewStr.str());
+            if (values.size() < capacity)
+            {
+                values.push_back(sample);
             }
-            else
+            else if (capacity)
             {
-                OSG_WARN << std::endl << "No valid viewport to collect scene stats from" << std::endl;
-
-                text->setText("");
+                values[next] = sample;
+                next = (next + 1) % capacity;
             }
         }
-        text->drawImplementation(renderInfo);
-    }
 
-    osg::observer_ptr<Scene> _scene;
-    mutable osg::Timer_t _tickLastUpdated;
-    int _viewNumber;
+        overlay.addLineStrip(color);
+        unsigned int numValues = static_cast<unsigned int>(values.size());
+        for (unsigned int i = 0; i < numValues; ++i)
+        {
+            overlay.addLineStripVertex(position + osg::Vec3(float(i), height / max * values[(next + i) % numValues], 0.0f));
+        }
+    }
 };
 
-struct BlockDrawCallback : public virtual osg::Drawable::DrawCallback
+/// DatabasePager的合并时间和队列长度，每50ms更新一次
+struct StatsHandler::PagerItem : StatsHandler::Item
 {
-    BlockDrawCallback(StatsHandler *statsHandler, float xPos, osg::Stats *viewerStats, osg::Stats *stats, const std::string &beginName, const std::string &endName, int frameDelta, int numFrames)
-        : _statsHandler(statsHandler), _xPos(xPos), _viewerStats(viewerStats), _stats(stats), _beginName(beginName), _endName(endName), _frameDelta(frameDelta), _numFrames(numFrames)
+    enum Field
     {
-    }
+        AVERAGE,
+        MINIMUM,
+        MAXIMUM,
+        FILE_REQUEST_LIST,
+        DATA_TO_COMPILE_LIST,
+        MERGE_BACKLOG,
+        NUM_FIELDS,
+    };
+
+    osg::observer_ptr<osgDB::DatabasePager> databasePager;
+    osg::Vec3 positions[NUM_FIELDS];
+    osg::Vec4 color;
+    double multiplier{};
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    osg::Timer_t tickLastUpdated{};
+    std::string texts[NUM_FIELDS];
+
+    PagerItem(osgDB::DatabasePager *databasePager, const osg::Vec4 &color, double multiplier) : databasePager(databasePager), color(color), multiplier(multiplier)
     {
-        osg::Geometry *geom = (osg::Geometry *)drawable;
-        osg::Vec3Array *vertices = (osg::Vec3Array *)geom->getVertexArray();
+    }
 
-        int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
-        int startFrame = frameNumber + _frameDelta - _numFrames + 1;
-        int endFrame = frameNumber + _frameDelta;
-        double referenceTime;
-        if (!_viewerStats->getAttribute(startFrame, "Reference time", referenceTime))
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        osg::ref_ptr<osgDB::DatabasePager> dp;
+        if (!databasePager.lock(dp))
         {
             return;
         }
 
-        unsigned int vi = 0;
-        double beginValue, endValue;
-        double minWidth = .0002;
-        for (int i = startFrame; i <= endFrame; ++i)
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 50))
         {
-            if (_stats->getAttribute(i, _beginName, beginValue) && _stats->getAttribute(i, _endName, endValue))
+            auto formatTime = [this](double value) { return value >= 0.0 && value <= 1000 ? formatValue("%4.0f", value * multiplier) : std::string(); };
+            texts[AVERAGE] = formatTime(dp->getAverageTimeToMergeTiles());
+            texts[MINIMUM] = formatTime(dp->getMinimumTimeToMergeTile());
+            texts[MAXIMUM] = formatTime(dp->getMaximumTimeToMergeTile());
+            texts[FILE_REQUEST_LIST] = std::to_string(dp->getFileRequestListSize());
+            texts[DATA_TO_COMPILE_LIST] = std::to_string(dp->getDataToCompileListSize());
+            if (auto pager = dynamic_cast<DatabasePager *>(dp.get()))
             {
-                (*vertices)[vi++].x() = _xPos + (beginValue - referenceTime) * _statsHandler->getBlockMultiplier();
-                (*vertices)[vi++].x() = _xPos + (beginValue - referenceTime) * _statsHandler->getBlockMultiplier();
-                (*vertices)[vi++].x() = _xPos + (endValue - referenceTime) * _statsHandler->getBlockMultiplier();
-
-                if (endValue - beginValue < minWidth)
-                    endValue = beginValue + minWidth;
-                (*vertices)[vi++].x() = _xPos + (endValue - referenceTime) * _statsHandler->getBlockMultiplier();
+                texts[MERGE_BACKLOG] = std::to_string(pager->getMergeBacklogSize());
+            }
+            else
+            {
+                texts[MERGE_BACKLOG] = std::to_string(dp->getDataToMergeListSize());
             }
         }
 
-        vertices->dirty();
-
-        drawable->drawImplementation(renderInfo);
+        for (unsigned int i = 0; i < NUM_FIELDS; ++i)
+        {
+            overlay.addText(positions[i], texts[i], color);
+        }
     }
-
-    StatsHandler *_statsHandler;
-    float _xPos;
-    osg::ref_ptr<osg::Stats> _viewerStats;
-    osg::ref_ptr<osg::Stats> _stats;
-    std::string _beginName;
-    std::string _endName;
-    int _frameDelta;
-    int _numFrames;
 };
 
-osg::Geometry *StatsHandler::createBackgroundRectangle(const osg::Vec3 &pos, const float width, const float height, osg::Vec4 &color)
+/// 相机的剔除统计，每100ms更新一次
+struct StatsHandler::CameraSceneStatsItem : StatsHandler::Item
 {
-    osg::StateSet *ss = new osg::StateSet;
-
-    osg::Geometry *geometry = new osg::Geometry;
+    osg::observer_ptr<osg::Camera> camera;
+    int cameraNumber{};
+    osg::Vec3 position;
+    osg::Vec4 color;
 
-    geometry->setUseDisplayList(false);
-    geometry->setStateSet(ss);
+    osg::Timer_t tickLastUpdated{};
+    std::string text;
 
-    osg::Vec3Array *vertices = new osg::Vec3Array;
-    geometry->setVertexArray(vertices);
+    CameraSceneStatsItem(osg::Camera *camera, int cameraNumber, const osg::Vec3 &position, const osg::Vec4 &color) : camera(camera), cameraNumber(cameraNumber), position(position), color(color)
+    {
+    }
 
-    vertices->push_back(osg::Vec3(pos.x(), pos.y(), 0));
-    vertices->push_back(osg::Vec3(pos.x(), pos.y() - height, 0));
-    vertices->push_back(osg::Vec3(pos.x() + width, pos.y() - height, 0));
-    vertices->push_back(osg::Vec3(pos.x() + width, pos.y(), 0));
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        osg::ref_ptr<osg::Camera> camera;
+        if (!this->camera.lock(camera))
+        {
+            return;
+        }
 
-    osg::Vec4Array *colors = new osg::Vec4Array;
-    colors->push_back(color);
-    geometry->setColorArray(colors, osg::Array::BIND_OVERALL);
+        osg::Stats *stats = camera->getStats();
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 100) && stats && dynamic_cast<Renderer *>(camera->getRenderer()))
+        {
+            std::ostringstream viewStr;
+            viewStr.setf(std::ios::left, std::ios::adjustfield);
+            viewStr.width(14);
+            // Used fixed formatting, as scientific will switch to "...e+.." notation for
+            // large numbers of vertices/drawables/etc.
+            viewStr.setf(std::ios::fixed);
+            viewStr.precision(0);
+
+            viewStr << std::setw(1) << "#" << cameraNumber << std::endl;
+
+            // Camera name
+            if (!camera->getName().empty())
+                viewStr << camera->getName();
+            viewStr << std::endl;
+
+            unsigned int frameNumber = snapshot.getFrameNumber() - 1;
+            double value = 0.0;
+            for (const char *attributeName : {"Visible number of lights", "Visible number of render bins", "Visible depth", "Number of StateGraphs", "Visible number of impostors", "Visible number of drawables", "Number of ordered leaves",
+                                              "Visible number of fast drawables", "Visible vertex count", "Visible number of PrimitiveSets", "Visible number of GL_POINTS", "Visible number of GL_LINES", "Visible number of GL_LINE_STRIP",
+                                              "Visible number of GL_LINE_LOOP", "Visible number of GL_TRIANGLES", "Visible number of GL_TRIANGLE_STRIP", "Visible number of GL_TRIANGLE_FAN", "Visible number of GL_QUADS",
+                                              "Visible number of GL_QUAD_STRIP", "Visible number of GL_POLYGON"})
+            {
+                if (snapshot.getAttribute(stats, frameNumber, attributeName, value))
+                    viewStr << std::setw(8) << value << std::endl;
+                else
+                    viewStr << std::setw(8) << "." << std::endl;
+            }
 
-    osg::DrawElementsUShort *base = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLE_FAN, 0);
-    base->push_back(0);
-    base->push_back(1);
-    base->push_back(2);
-    base->push_back(3);
+            text = viewStr.str();
+        }
+        overlay.addText(position, text, color);
+    }
+};
 
-    geometry->addPrimitiveSet(base);
+/// 场景统计，每200ms更新一次
+struct StatsHandler::SceneStatsItem : StatsHandler::Item
+{
+    osg::observer_ptr<Scene> scene;
+    int viewNumber{};
+    osg::Vec3 position;
+    osg::Vec4 color;
 
-    return geometry;
-}
+    osg::Timer_t tickLastUpdated{};
+    std::string text;
 
-struct StatsGraph : public osg::MatrixTransform
-{
-    StatsGraph(osg::Vec3 pos, float width, float height) : _pos(pos), _width(width), _height(height), _statsGraphGeode(new osg::Geode)
+    SceneStatsItem(Scene *scene, int viewNumber, const osg::Vec3 &position, const osg::Vec4 &color) : scene(scene), viewNumber(viewNumber), position(position), color(color)
     {
-        _pos -= osg::Vec3(0, height, 0.1);
-        setMatrix(osg::Matrix::translate(_pos));
-        addChild(_statsGraphGeode.get());
     }
 
-    void addStatGraph(osg::Stats *viewerStats, osg::Stats *stats, const osg::Vec4 &color, float max, const std::string &nameBegin, const std::string &nameEnd = "")
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
     {
-        _statsGraphGeode->addDrawable(new Graph(_pos, _width, _height, viewerStats, stats, color, max, nameBegin, nameEnd));
-    }
-
-    osg::Vec3 _pos;
-    float _width;
-    float _height;
-
-    osg::ref_ptr<osg::Geode> _statsGraphGeode;
+        osg::ref_ptr<Scene> scene;
+        if (!this->scene.lock(scene))
+        {
+            return;
+        }
 
-  protected:
-    struct Graph : public osg::Geometry
-    {
-        Graph(const osg::Vec3 &pos, float width, float height, osg::Stats *viewerStats, osg::Stats *stats, const osg::Vec4 &color, float max, const std::string &nameBegin, const std::string &nameEnd = "")
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 200))
         {
-            setUseDisplayList(false);
-            setDataVariance(osg::Object::DYNAMIC);
+            osg::Stats *stats = scene->getStats();
+            if (stats)
+            {
+                std::ostringstream viewStr;
+                viewStr.setf(std::ios::left, std::ios::adjustfield);
+                viewStr.width(20);
+                viewStr.setf(std::ios::fixed);
+                viewStr.precision(0);
 
-            osg::ref_ptr<osg::BufferObject> vbo = new osg::VertexBufferObject;
-            vbo->setUsage(GL_DYNAMIC_DRAW);
-            vbo->getProfile()._size = (width) * 12;
+                viewStr << std::setw(1) << "#" << viewNumber;
 
-            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
-            vertices->setBufferObject(vbo.get());
-            vertices->reserve(width);
+                // View name
+                if (!scene->getName().empty())
+                    viewStr << ": " << scene->getName();
+                viewStr << std::endl;
 
-            setVertexArray(vertices.get());
+                // header
+                viewStr << std::setw(9) << "Unique" << std::setw(9) << "Instance" << std::endl;
 
-            osg::Vec4Array *colors = new osg::Vec4Array;
-            colors->push_back(color);
-            setColorArray(colors, osg::Array::BIND_OVERALL);
+                unsigned int frameNumber = snapshot.getFrameNumber() - 1;
+                double value = 0.0;
+                static const char *attributeNames[][2] = {{"Number of unique StateSet", "Number of instanced Stateset"},       {"Number of unique Group", "Number of instanced Group"},
+                                                          {"Number of unique Transform", "Number of instanced Transform"}, {"Number of unique LOD", "Number of instanced LOD"},
+                                                          {"Number of unique Switch", "Number of instanced Switch"},       {"Number of unique Geode", "Number of instanced Geode"},
+                                                          {"Number of unique Drawable", "Number of instanced Drawable"},   {"Number of unique Geometry", "Number of instanced Geometry"},
+                                                          {"Number of unique Vertices", "Number of instanced Vertices"},   {"Number of unique Primitives", "Number of instanced Primitives"}};
+                for (const auto &names : attributeNames)
+                {
+                    for (const char *attributeName : names)
+                    {
+                        if (snapshot.getAttribute(stats, frameNumber, attributeName, value))
+                            viewStr << std::setw(9) << value;
+                        else
+                            viewStr << std::setw(9) << ".";
+                    }
+                    viewStr << std::endl;
+                }
 
-            addPrimitiveSet(new osg::DrawArrays(GL_LINE_STRIP, 0, 0));
+                text = viewStr.str();
+            }
+            else
+            {
+                OSG_WARN << std::endl << "No valid viewport to collect scene stats from" << std::endl;
 
-            setDrawCallback(new GraphUpdateCallback(this, pos, width, height, viewerStats, stats, max, nameBegin, nameEnd));
+                text.clear();
+            }
         }
-    };
+        overlay.addText(position, text, color);
+    }
+};
+
+/// 帧时间的百分位数，每200ms更新一次
+///
+/// 每列一段多行文字，依次为窗口的FRAME、EVENT、UPDATE和每个相机的CULL、DRAW、GPU
+struct StatsHandler::FrameTimePercentilesItem : StatsHandler::Item
+{
+    static const unsigned int NUM_COLUMNS = 4;
+
+    osg::observer_ptr<Window> window;
+    std::vector<osg::observer_ptr<osg::Camera>> cameras;
+    osg::Vec3 position;
+    float columnWidth{};
+    osg::Vec4 color;
 
-    struct GraphUpdateCallback : public osg::Drawable::DrawCallback
+    osg::Timer_t tickLastUpdated{};
+    std::string columns[NUM_COLUMNS];
+
+    FrameTimePercentilesItem(Window *window, const std::vector<osg::Camera *> &cameras, const osg::Vec3 &position, float columnWidth, const osg::Vec4 &color)
+        : window(window), cameras(cameras.begin(), cameras.end()), position(position), columnWidth(columnWidth), color(color)
     {
-        GraphUpdateCallback(osg::Geometry *geometry, const osg::Vec3 &pos, float width, float height, osg::Stats *viewerStats, osg::Stats *stats, float max, const std::string &nameBegin, const std::string &nameEnd = "")
-            : _pos(pos), _width((unsigned int)width), _height((unsigned int)height), _curX(0), _viewerStats(viewerStats), _stats(stats), _max(max), _nameBegin(nameBegin), _nameEnd(nameEnd)
+    }
+
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
+    {
+        osg::ref_ptr<Window> window;
+        if (!this->window.lock(window))
         {
-            _vertices = dynamic_cast<osg::Vec3Array *>(geometry->getVertexArray());
-            _drawArrays = dynamic_cast<osg::DrawArrays *>(geometry->getPrimitiveSet(0));
+            return;
         }
 
-        virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 200))
         {
-            unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
-
-            // Get stats
-            double value;
-            if (_nameEnd.empty())
-            {
-                if (!_stats->getAveragedAttribute(_nameBegin, value, true))
-                {
-                    value = 0.0;
-                }
-            }
-            else
-            {
-                double beginValue, endValue;
-                if (_stats->getAttribute(frameNumber, _nameBegin, beginValue) && _stats->getAttribute(frameNumber, _nameEnd, endValue))
+            columns[0] = "p50\n";
+            columns[1] = "p95\n";
+            columns[2] = "p99\n";
+            columns[3] = "max\n";
+
+            std::string texts[NUM_COLUMNS];
+            auto addRow = [&](const Histogram *histogram) {
+                if (histogram)
                 {
-                    value = endValue - beginValue;
+                    formatPercentiles(*histogram, texts);
                 }
-                else
+                for (unsigned int i = 0; i < NUM_COLUMNS; ++i)
                 {
-                    value = 0.0;
+                    columns[i] += histogram ? texts[i] : ".";
+                    columns[i] += '\n';
                 }
-            }
+            };
 
-            // Add new vertex for this frame.
-            value = osg::clampTo(value, 0.0, double(_max));
-            _vertices->push_back(osg::Vec3(float(_curX), float(_height) / _max * value, 0));
+            const FrameTimeHistograms &windowHistograms = window->getFrameTimeHistograms();
+            addRow(&windowHistograms[FrameTimeHistograms::FRAME]);
+            addRow(&windowHistograms[FrameTimeHistograms::EVENT]);
+            addRow(&windowHistograms[FrameTimeHistograms::UPDATE]);
 
-            // One vertex per pixel in X.
-            int excedent = _vertices->size() - _width;
-            if (excedent > 0)
+            for (auto &cameraObserver : cameras)
             {
-                _vertices->erase(_vertices->begin(), _vertices->begin() + excedent);
+                osg::ref_ptr<osg::Camera> camera;
+                const FrameTimeHistograms *cameraHistograms = cameraObserver.lock(camera) ? window->getFrameTimeHistograms(camera.get()) : nullptr;
+                addRow(cameraHistograms ? &(*cameraHistograms)[FrameTimeHistograms::CULL] : nullptr);
+                addRow(cameraHistograms ? &(*cameraHistograms)[FrameTimeHistograms::DRAW] : nullptr);
+                addRow(cameraHistograms ? &(*cameraHistograms)[FrameTimeHistograms::GPU] : nullptr);
             }
-
-            // Update primitive set.
-            _drawArrays->setFirst(0);
-            _drawArrays->setCount(_vertices->size());
-
-            // Make the graph scroll when there is enough data.
-            // Note: We check the frame number so that even if we have
-            // many graphs, the transform is translated only once per
-            // frame.
-            // static const float increment = -1.0;
-            if (GraphUpdateCallback::_frameNumber != frameNumber)
-            {
-                // We know the exact layout of this part of the scene
-                // graph, so this is OK...
-                osg::MatrixTransform *transform = const_cast<osg::MatrixTransform *>(drawable->getParent(0)->getParent(0)->asTransform()->asMatrixTransform());
-                if (transform)
-                {
-                    // osg::Matrix matrix = transform->getMatrix();
-                    // matrix.setTrans(-(*vertices)[0].x(), matrix.getTrans().y(), matrix.getTrans().z());
-                    transform->setMatrix(osg::Matrix::translate(_pos + osg::Vec3(-(*_vertices)[0].x(), 0, 0)));
-                }
-            }
-
-            _vertices->dirty();
-
-            _curX++;
-            GraphUpdateCallback::_frameNumber = frameNumber;
-
-            drawable->drawImplementation(renderInfo);
         }
 
-        osg::ref_ptr<osg::Vec3Array> _vertices;
-        osg::ref_ptr<osg::DrawArrays> _drawArrays;
-        const osg::Vec3 _pos;
-        const unsigned int _width;
-        const unsigned int _height;
-        mutable unsigned int _curX;
-        osg::Stats *_viewerStats;
-        osg::Stats *_stats;
-        const float _max;
-        const std::string _nameBegin;
-        const std::string _nameEnd;
-        static unsigned int _frameNumber;
-    };
+        for (unsigned int i = 0; i < NUM_COLUMNS; ++i)
+        {
+            overlay.addText(position + osg::Vec3(i * columnWidth, 0, 0), columns[i], color);
+        }
+    }
 };
 
-unsigned int StatsGraph::GraphUpdateCallback::_frameNumber = 0;
-
-osg::Geometry *StatsHandler::createGeometry(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numBlocks)
+/// 属性表格，每列一个Stats，每行一个属性，每500ms更新一次，用于GL对象统计（上下文、各场景、各视口）和管线统计（各相机）
+struct StatsHandler::StatsTableItem : StatsHandler::Item
 {
-    osg::Geometry *geometry = new osg::Geometry;
-
-    geometry->setUseDisplayList(false);
-    geometry->setDataVariance(osg::Object::DYNAMIC);
-
-    osg::Vec3Array *vertices = new osg::Vec3Array;
-    geometry->setVertexArray(vertices);
-    vertices->reserve(numBlocks * 4);
-
-    osg::DrawElementsUShort *primitives = new osg::DrawElementsUShort(GL_TRIANGLES);
-    for (unsigned int i = 0; i < numBlocks; ++i)
+    struct Row
     {
-        unsigned int vi = vertices->size();
-        vertices->push_back(pos + osg::Vec3(i * 20, height, 0.0));
-        vertices->push_back(pos + osg::Vec3(i * 20, 0.0, 0.0));
-        vertices->push_back(pos + osg::Vec3(i * 20 + 10.0, 0.0, 0.0));
-        vertices->push_back(pos + osg::Vec3(i * 20 + 10.0, height, 0.0));
+        const char *attributeName;
+        /// 显示值 = 属性值 * multiplier
+        double multiplier;
+    };
 
-        primitives->push_back(vi);
-        primitives->push_back(vi + 1);
-        primitives->push_back(vi + 2);
-        primitives->push_back(vi);
-        primitives->push_back(vi + 2);
-        primitives->push_back(vi + 3);
+    static const std::vector<Row> &getGLMemoryRows()
+    {
+        static const std::vector<Row> rows = {{"GL textures", 1.0},
+                                              {"GL texture memory", 1.0 / (1024.0 * 1024.0)},
+                                              {"GL vertex buffers", 1.0},
+                                              {"GL vertex buffer memory", 1.0 / (1024.0 * 1024.0)},
+                                              {"GL element buffers", 1.0},
+                                              {"GL element buffer memory", 1.0 / (1024.0 * 1024.0)},
+                                              {"GL programs", 1.0},
+                                              {"GL framebuffers", 1.0},
+                                              {"GL texture pool memory", 1.0 / (1024.0 * 1024.0)},
+                                              {"GL buffer object pool memory", 1.0 / (1024.0 * 1024.0)}};
+        return rows;
     }
 
-    osg::Vec4Array *colours = new osg::Vec4Array;
-    colours->push_back(colour);
-    geometry->setColorArray(colours, osg::Array::BIND_OVERALL);
+    /// 查询结果以千为单位
+    static const std::vector<Row> &getPipelineStatisticsRows()
+    {
+        static const std::vector<Row> rows = {{"Vertices submitted", 1e-3},
+                                              {"Primitives submitted", 1e-3},
+                                              {"Clipping input primitives", 1e-3},
+                                              {"Clipping output primitives", 1e-3},
+                                              {"Fragment shader invocations", 1e-3},
+                                              {"Draw calls", 1.0},
+                                              {"State changes", 1.0}};
+        return rows;
+    }
 
-    geometry->addPrimitiveSet(primitives);
+    std::vector<osg::observer_ptr<osg::Stats>> stats;
+    const std::vector<Row> &rows;
+    osg::Vec3 position;
+    float columnWidth{};
+    osg::Vec4 color;
 
-    return geometry;
-}
+    osg::Timer_t tickLastUpdated{};
+    std::vector<std::string> columns;
 
-struct FrameMarkerDrawCallback : public virtual osg::Drawable::DrawCallback
-{
-    FrameMarkerDrawCallback(StatsHandler *statsHandler, float xPos, osg::Stats *viewerStats, int frameDelta, int numFrames)
-        : _statsHandler(statsHandler), _xPos(xPos), _viewerStats(viewerStats), _frameDelta(frameDelta), _numFrames(numFrames)
+    StatsTableItem(const std::vector<osg::Stats *> &stats, const std::vector<Row> &rows, const osg::Vec3 &position, float columnWidth, const osg::Vec4 &color)
+        : stats(stats.begin(), stats.end()), rows(rows), position(position), columnWidth(columnWidth), color(color), columns(stats.size())
     {
     }
 
-    /** do customized draw code.*/
-    virtual void drawImplementation(osg::RenderInfo &renderInfo, const osg::Drawable *drawable) const
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
     {
-        osg::Geometry *geom = (osg::Geometry *)drawable;
-        osg::Vec3Array *vertices = (osg::Vec3Array *)geom->getVertexArray();
-
-        int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
-
-        int startFrame = frameNumber + _frameDelta - _numFrames + 1;
-        int endFrame = frameNumber + _frameDelta;
-        double referenceTime;
-        if (!_viewerStats->getAttribute(startFrame, "Reference time", referenceTime))
-        {
-            return;
-        }
-
-        unsigned int vi = 0;
-        double currentReferenceTime;
-        for (int i = startFrame; i <= endFrame; ++i)
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 500))
         {
-            if (_viewerStats->getAttribute(i, "Reference time", currentReferenceTime))
+            unsigned int frameNumber = snapshot.getFrameNumber() - 1;
+            for (size_t i = 0; i < stats.size(); ++i)
             {
-                (*vertices)[vi++].x() = _xPos + (currentReferenceTime - referenceTime) * _statsHandler->getBlockMultiplier();
-                (*vertices)[vi++].x() = _xPos + (currentReferenceTime - referenceTime) * _statsHandler->getBlockMultiplier();
+                osg::ref_ptr<osg::Stats> stats;
+                this->stats[i].lock(stats);
+
+                columns[i].clear();
+                for (const Row &row : rows)
+                {
+                    double value = 0.0;
+                    if (stats && snapshot.getAttribute(stats.get(), frameNumber, row.attributeName, value))
+                    {
+                        columns[i] += formatValue(row.multiplier == 1.0 ? "%.0f" : "%.1f", value * row.multiplier);
+                    }
+                    else
+                    {
+                        columns[i] += '.';
+                    }
+                    columns[i] += '\n';
+                }
             }
         }
 
-        vertices->dirty();
-
-        drawable->drawImplementation(renderInfo);
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            overlay.addText(position + osg::Vec3(i * columnWidth, 0, 0), columns[i], color);
+        }
     }
-
-    StatsHandler *_statsHandler;
-    float _xPos;
-    osg::ref_ptr<osg::Stats> _viewerStats;
-    std::string _endName;
-    int _frameDelta;
-    int _numFrames;
 };
 
-struct PagerCallback : public virtual osg::NodeCallback
+/// 开销最大的子图，合并所有相机的SubgraphProfiler，每500ms更新一次
+///
+/// 每行为名字、剔除、绘制和GPU时间（毫秒），以及按开销比例的条形
+struct StatsHandler::SubgraphProfileItem : StatsHandler::Item
 {
+    static const unsigned int NUM_COLUMNS = 4;
 
-    PagerCallback(osgDB::DatabasePager *dp, osgText::Text *minValue, osgText::Text *maxValue, osgText::Text *averageValue, osgText::Text *filerequestlist, osgText::Text *compilelist, double multiplier)
-        : _dp(dp), _minValue(minValue), _maxValue(maxValue), _averageValue(averageValue), _filerequestlist(filerequestlist), _compilelist(compilelist), _multiplier(multiplier)
+    struct Row
+    {
+        SubgraphProfiler::Result result;
+        int cameraNumber{};
+    };
+
+    std::vector<osg::observer_ptr<osg::Camera>> cameras;
+    osg::Vec3 position;
+    unsigned int maxNumRows{};
+    float nameWidth{};
+    float columnWidth{};
+    float barWidth{};
+    osg::Vec4 color;
+    osg::Vec4 barColor;
+
+    osg::Timer_t tickLastUpdated{};
+    std::vector<Row> rows;
+    std::string columns[NUM_COLUMNS];
+
+    SubgraphProfileItem(const std::vector<osg::Camera *> &cameras, const osg::Vec3 &position, unsigned int maxNumRows, float nameWidth, float columnWidth, float barWidth, const osg::Vec4 &color, const osg::Vec4 &barColor)
+        : cameras(cameras.begin(), cameras.end()), position(position), maxNumRows(maxNumRows), nameWidth(nameWidth), columnWidth(columnWidth), barWidth(barWidth), color(color), barColor(barColor)
     {
     }
 
-    virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
+    void update(const Snapshot &snapshot, StatsOverlay &overlay) override
     {
-        if (_dp.valid())
+        if (needsUpdate(tickLastUpdated, snapshot.getTick(), 500))
         {
-            char tmpText[128];
-
-            double value = _dp->getAverageTimeToMergeTiles();
-            if (value >= 0.0 && value <= 1000)
+            rows.clear();
+            for (size_t i = 0; i < cameras.size(); ++i)
             {
-                sprintf(tmpText, "%4.0f", value * _multiplier);
-                _averageValue->setText(tmpText);
-            }
-            else
-            {
-                _averageValue->setText("");
+                osg::ref_ptr<osg::Camera> camera;
+                Renderer *renderer = cameras[i].lock(camera) ? dynamic_cast<Renderer *>(camera->getRenderer()) : nullptr;
+                if (renderer && renderer->getSubgraphProfiler())
+                {
+                    for (auto &result : renderer->getSubgraphProfiler()->getResults())
+                    {
+                        rows.push_back({result, static_cast<int>(i)});
+                    }
+                }
             }
 
-            value = _dp->getMinimumTimeToMergeTile();
-            if (value >= 0.0 && value <= 1000)
-            {
-                sprintf(tmpText, "%4.0f", value * _multiplier);
-                _minValue->setText(tmpText);
-            }
-            else
+            std::stable_sort(rows.begin(), rows.end(), [](const Row &lhs, const Row &rhs) { return lhs.result.getCost() > rhs.result.getCost(); });
+            if (rows.size() > maxNumRows)
             {
-                _minValue->setText("");
+                rows.resize(maxNumRows);
             }
 
-            value = _dp->getMaximumTimeToMergeTile();
-            if (value >= 0.0 && value <= 1000)
+            for (auto &column : columns)
             {
-                sprintf(tmpText, "%4.0f", value * _multiplier);
-                _maxValue->setText(tmpText);
+                column.clear();
             }
-            else
+            for (const Row &row : rows)
             {
-                _maxValue->setText("");
+                columns[0] += row.result.name + " #" + std::to_string(row.cameraNumber) + '\n';
+                columns[1] += formatValue("%.2f", row.result.cullTime * 1000.0) + '\n';
+                columns[2] += (row.result.drawMeasured ? formatValue("%.2f", row.result.drawTime * 1000.0) : ".") + '\n';
+                columns[3] += (row.result.numGPUSamples ? formatValue("%.2f", row.result.gpuTime * 1000.0) : ".") + '\n';
             }
+        }
 
-            sprintf(tmpText, "%4d", _dp->getFileRequestListSize());
-            _filerequestlist->setText(tmpText);
-
-            sprintf(tmpText, "%4d", _dp->getDataToCompileListSize());
-            _compilelist->setText(tmpText);
+        overlay.addText(position, columns[0], color);
+        for (unsigned int i = 1; i < NUM_COLUMNS; ++i)
+        {
+            overlay.addText(position + osg::Vec3(nameWidth + (i - 1) * columnWidth, 0, 0), columns[i], color);
         }
 
-        traverse(node, nv);
+        double maxCost = rows.empty() ? 0.0 : rows.front().result.getCost();
+        float characterSize = overlay.getCharacterSize();
+        for (size_t i = 0; i < rows.size() && maxCost > 0.0; ++i)
+        {
+            float width = static_cast<float>(barWidth * rows[i].result.getCost() / maxCost);
+            overlay.addRectangle(position + osg::Vec3(nameWidth + (NUM_COLUMNS - 1) * columnWidth, characterSize * (0.8f - i), 0), width, characterSize * 0.8f, barColor);
+        }
     }
-
-    osg::observer_ptr<osgDB::DatabasePager> _dp;
-
-    osg::ref_ptr<osgText::Text> _minValue;
-    osg::ref_ptr<osgText::Text> _maxValue;
-    osg::ref_ptr<osgText::Text> _averageValue;
-    osg::ref_ptr<osgText::Text> _filerequestlist;
-    osg::ref_ptr<osgText::Text> _compilelist;
-    double _multiplier;
 };
 
-osg::Geometry *StatsHandler::createFrameMarkers(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numBlocks)
+struct StatsHandler::OverlayCullCallback : osg::NodeCallback
 {
-    osg::Geometry *geometry = new osg::Geometry;
-
-    geometry->setUseDisplayList(false);
-    geometry->setDataVariance(osg::Object::DYNAMIC);
+    osg::observer_ptr<StatsHandler> statsHandler;
 
-    osg::Vec3Array *vertices = new osg::Vec3Array;
-    geometry->setVertexArray(vertices);
-    vertices->reserve(numBlocks * 2);
-
-    for (unsigned int i = 0; i < numBlocks; ++i)
+    explicit OverlayCullCallback(StatsHandler *statsHandler) : statsHandler(statsHandler)
     {
-        vertices->push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.01, height, 0.0));
-        vertices->push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.01, 0.0, 0.0));
     }
 
-    osg::Vec4Array *colours = new osg::Vec4Array;
-    colours->push_back(colour);
-    geometry->setColorArray(colours, osg::Array::BIND_OVERALL);
-
-    geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, numBlocks * 2));
+    void operator()(osg::Node *node, osg::NodeVisitor *nv) override
+    {
+        osg::ref_ptr<StatsHandler> statsHandler;
+        if (this->statsHandler.lock(statsHandler) && nv->getFrameStamp())
+        {
+            statsHandler->updateOverlay(*nv->getFrameStamp());
+        }
+        traverse(node, nv);
+    }
+};
 
-    return geometry;
+void StatsHandler::addItem(StatsType statsType, Item *item)
+{
+    item->statsType = statsType;
+    _items.push_back(item);
 }
 
-osg::Geometry *StatsHandler::createTick(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numTicks)
+void StatsHandler::updateOverlay(const osg::FrameStamp &frameStamp)
 {
-    osg::Geometry *geometry = new osg::Geometry;
-
-    geometry->setUseDisplayList(false);
-    geometry->setDataVariance(osg::Object::DYNAMIC);
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
 
-    osg::Vec3Array *vertices = new osg::Vec3Array;
-    geometry->setVertexArray(vertices);
-    vertices->reserve(numTicks * 2);
-
-    for (unsigned int i = 0; i < numTicks; ++i)
+    _snapshot.reset(frameStamp.getFrameNumber(), startTick);
+    _overlay->clear();
+    for (auto &item : _items)
     {
-        float tickHeight = (i % 10) ? height : height * 2.0;
-        vertices->push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.001, tickHeight, 0.0));
-        vertices->push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.001, 0.0, 0.0));
+        if (item->statsType & _statsTypeMask)
+        {
+            item->update(_snapshot, *_overlay);
+        }
     }
+    _overlay->commit();
 
-    osg::Vec4Array *colours = new osg::Vec4Array;
-    colours->push_back(colour);
-    geometry->setColorArray(colours, osg::Array::BIND_OVERALL);
-
-    geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, numTicks * 2));
-
-    return geometry;
+    Window *window = _viewport ? _viewport->getWindow() : nullptr;
+    osg::Stats *stats = window ? window->getStats() : nullptr;
+    if (OPEVIEWER_COLLECT_STATS(stats, BASIC, FRAME_RATE))
+    {
+        stats->setAttribute(frameStamp.getFrameNumber(), "Stats overlay time taken", osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick()));
+    }
 }
 
 void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 {
-    _switch = new osg::Switch;
+    _overlay = new StatsOverlay(_font, _characterSize);
 
-    _camera->addChild(_switch.get());
+    _statsGeode = new osg::Geode;
+    _statsGeode->setCullingActive(false);
+    _statsGeode->addDrawable(_overlay.get());
+    _statsGeode->setCullCallback(new OverlayCullCallback(this));
+    _camera->addChild(_statsGeode.get());
 
-    osg::StateSet *stateset = _switch->getOrCreateStateSet();
+    osg::StateSet *stateset = _statsGeode->getOrCreateStateSet();
     stateset->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
     stateset->setMode(GL_BLEND, osg::StateAttribute::ON);
     stateset->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF);
@@ -1213,38 +1420,17 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
     // frame rate stats
     {
-        osg::Geode *geode = new osg::Geode();
-        _frameRateChildNum = _switch->getNumChildren();
-        _switch->addChild(geode, false);
-
-        osg::ref_ptr<osgText::Text> frameRateLabel = new osgText::Text;
-        geode->addDrawable(frameRateLabel.get());
-
-        frameRateLabel->setColor(colorFR);
-        frameRateLabel->setFont(_font);
-        frameRateLabel->setCharacterSize(_characterSize);
-        frameRateLabel->setPosition(pos);
 #ifdef _DEBUG
         osg::Vec4 colorDFR(1.0f, 0.0f, 0.0f, 1.0f);
-        frameRateLabel->setColor(colorDFR);
-        frameRateLabel->setText("DEBUG Frame Rate: ");
+        std::string frameRateLabel = "DEBUG Frame Rate: ";
+        addItem(FRAME_RATE, new TextItem(pos, frameRateLabel, colorDFR));
 #else
-        frameRateLabel->setColor(colorFR);
-        frameRateLabel->setText("Frame Rate: ");
+        std::string frameRateLabel = "Frame Rate: ";
+        addItem(FRAME_RATE, new TextItem(pos, frameRateLabel, colorFR));
 #endif
-        pos.x() = frameRateLabel->getBoundingBox().xMax();
+        pos.x() += _overlay->getTextWidth(frameRateLabel);
 
-        osg::ref_ptr<osgText::Text> frameRateValue = new osgText::Text;
-        geode->addDrawable(frameRateValue.get());
-
-        frameRateValue->setColor(colorFR);
-        frameRateValue->setFont(_font);
-        frameRateValue->setCharacterSize(_characterSize);
-        frameRateValue->setPosition(pos);
-        frameRateValue->setText("0.0");
-        frameRateValue->setDataVariance(osg::Object::DYNAMIC);
-
-        frameRateValue->setDrawCallback(new AveragedValueTextDrawCallback(window->getStats(), "Frame rate", -1, true, 1.0));
+        addItem(FRAME_RATE, new ValueTextItem(pos, colorFR, window->getStats(), "Frame rate", true, true, 1.0));
 
         pos.y() -= _characterSize * _lineHeight;
     }
@@ -1257,23 +1443,11 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
     // window stats
     {
-        osg::Group *group = new osg::Group;
-        _windowChildNum = _switch->getNumChildren();
-        _switch->addChild(group, false);
-
-        _statsGeode = new osg::Geode();
-        group->addChild(_statsGeode.get());
-
         {
             pos.x() = _leftTopPos.x();
 
-            _threadingModelText = new osgText::Text;
-            _statsGeode->addDrawable(_threadingModelText.get());
-
-            _threadingModelText->setColor(colorFR);
-            _threadingModelText->setFont(_font);
-            _threadingModelText->setCharacterSize(_characterSize);
-            _threadingModelText->setPosition(pos);
+            _threadingModelText = new TextItem(pos, "", colorFR);
+            addItem(WINDOW_STATS, _threadingModelText.get());
 
             updateThreadingModelText();
 
@@ -1290,8 +1464,8 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
         double userStatsLinesSize = _lineHeight * _userStatsLines.size();
 
-        _statsGeode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), _statsWidth - 2 * backgroundMargin,
-                                                           (3 + cameraSize + userStatsLinesSize) * _characterSize + 2 * backgroundMargin, backgroundColor));
+        addItem(WINDOW_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), _statsWidth - 2 * backgroundMargin, (3 + cameraSize + userStatsLinesSize) * _characterSize + 2 * backgroundMargin,
+                                                backgroundColor));
 
         // Add user stats lines before the normal window and per-camera stats.
         for (unsigned int i = 0; i < _userStatsLines.size(); ++i)
@@ -1330,21 +1504,22 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
         // add frame ticks
         {
-            osg::Geode *geode = new osg::Geode;
-            group->addChild(geode);
-
             osg::Vec4 colourTicks(1.0f, 1.0f, 1.0f, 0.5f);
 
             pos.x() = _startBlocks;
             pos.y() += _characterSize;
             float height = topOfViewerStats - pos.y();
 
-            osg::Geometry *ticks = createTick(pos, 5.0f, colourTicks, 100);
-            geode->addDrawable(ticks);
+            osg::ref_ptr<LinesItem> ticks = new LinesItem(colourTicks);
+            for (unsigned int i = 0; i < 100; ++i)
+            {
+                float tickHeight = (i % 10) ? 5.0f : 10.0f;
+                ticks->vertices.push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.001, tickHeight, 0.0));
+                ticks->vertices.push_back(pos + osg::Vec3(double(i) * _blockMultiplier * 0.001, 0.0, 0.0));
+            }
+            addItem(WINDOW_STATS, ticks.get());
 
-            osg::Geometry *frameMarkers = createFrameMarkers(pos, height, colourTicks, _numBlocks + 1);
-            frameMarkers->setDrawCallback(new FrameMarkerDrawCallback(this, _startBlocks, window->getStats(), 0, _numBlocks + 1));
-            geode->addDrawable(frameMarkers);
+            addItem(WINDOW_STATS, new FrameMarkersItem(pos, height, colourTicks, window->getStats(), _numBlocks + 1, _blockMultiplier));
 
             pos.x() = _leftTopPos.x();
         }
@@ -1355,35 +1530,35 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
             float width = _statsWidth - 4 * backgroundMargin;
             float height = 5 * _characterSize;
 
-            // Create a stats graph and add any stats we want to track with it.
-            StatsGraph *statsGraph = new StatsGraph(pos, width, height);
-            group->addChild(statsGraph);
+            addItem(WINDOW_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, backgroundMargin, 0), width + 2 * backgroundMargin, height + 2 * backgroundMargin, backgroundColor));
 
-            statsGraph->addStatGraph(window->getStats(), window->getStats(), colorFR, 100, "Frame rate");
-            statsGraph->addStatGraph(window->getStats(), window->getStats(), colorEvent, 0.016, "Event traversal time taken");
-            statsGraph->addStatGraph(window->getStats(), window->getStats(), colorUpdate, 0.016, "Update traversal time taken");
+            // Add any stats we want to track with the graph.
+            osg::Vec3 graphPos = pos - osg::Vec3(0, height, 0);
+            auto addStatGraph = [&](osg::Stats *stats, const osg::Vec4 &color, float max, const std::string &name) { addItem(WINDOW_STATS, new GraphItem(graphPos, width, height, stats, name, max, color)); };
+
+            addStatGraph(window->getStats(), colorFR, 100, "Frame rate");
+            addStatGraph(window->getStats(), colorEvent, 0.016, "Event traversal time taken");
+            addStatGraph(window->getStats(), colorUpdate, 0.016, "Update traversal time taken");
 
             for (unsigned int i = 0; i < _userStatsLines.size(); ++i)
             {
                 UserStatsLine &line = _userStatsLines[i];
                 if (!line.timeTakenName.empty() && line.average)
                 {
-                    statsGraph->addStatGraph(window->getStats(), window->getStats(), line.textColor, line.maxValue, line.timeTakenName);
+                    addStatGraph(window->getStats(), line.textColor, line.maxValue, line.timeTakenName);
                 }
             }
 
             for (auto citr = cameras.begin(); citr != cameras.end(); ++citr)
             {
-                statsGraph->addStatGraph(window->getStats(), (*citr)->getStats(), colorCull, 0.016, "Cull traversal time taken");
-                statsGraph->addStatGraph(window->getStats(), (*citr)->getStats(), colorDraw, 0.016, "Draw traversal time taken");
+                addStatGraph((*citr)->getStats(), colorCull, 0.016, "Cull traversal time taken");
+                addStatGraph((*citr)->getStats(), colorDraw, 0.016, "Draw traversal time taken");
                 if (acquireGPUStats)
                 {
-                    statsGraph->addStatGraph(window->getStats(), (*citr)->getStats(), colorGPU, 0.016, "GPU draw time taken");
+                    addStatGraph((*citr)->getStats(), colorGPU, 0.016, "GPU draw time taken");
                 }
             }
 
-            _statsGeode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, backgroundMargin, 0), width + 2 * backgroundMargin, height + 2 * backgroundMargin, backgroundColor));
-
             pos.x() = _leftTopPos.x();
             pos.y() -= height + 2 * backgroundMargin;
         }
@@ -1398,125 +1573,25 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
             {
                 pos.y() -= (_characterSize + backgroundSpacing);
 
-                _statsGeode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), _statsWidth - 2 * backgroundMargin, _characterSize + 2 * backgroundMargin, backgroundColor));
-
-                osg::ref_ptr<osgText::Text> averageLabel = new osgText::Text;
-                _statsGeode->addDrawable(averageLabel.get());
-
-                averageLabel->setColor(colorDP);
-                averageLabel->setFont(_font);
-                averageLabel->setCharacterSize(_characterSize);
-                averageLabel->setPosition(pos);
-                averageLabel->setText("DatabasePager time to merge new tiles - average: ");
-
-                pos.x() = averageLabel->getBoundingBox().xMax();
-
-                osg::ref_ptr<osgText::Text> averageValue = new osgText::Text;
-                _statsGeode->addDrawable(averageValue.get());
-
-                averageValue->setColor(colorDP);
-                averageValue->setFont(_font);
-                averageValue->setCharacterSize(_characterSize);
-                averageValue->setPosition(pos);
-                averageValue->setText("1000");
-                averageValue->setDataVariance(osg::Object::DYNAMIC);
-
-                pos.x() = averageValue->getBoundingBox().xMax() + 2.0f * _characterSize;
-
-                osg::ref_ptr<osgText::Text> minLabel = new osgText::Text;
-                _statsGeode->addDrawable(minLabel.get());
-
-                minLabel->setColor(colorDP);
-                minLabel->setFont(_font);
-                minLabel->setCharacterSize(_characterSize);
-                minLabel->setPosition(pos);
-                minLabel->setText("min: ");
-
-                pos.x() = minLabel->getBoundingBox().xMax();
-
-                osg::ref_ptr<osgText::Text> minValue = new osgText::Text;
-                _statsGeode->addDrawable(minValue.get());
-
-                minValue->setColor(colorDP);
-                minValue->setFont(_font);
-                minValue->setCharacterSize(_characterSize);
-                minValue->setPosition(pos);
-                minValue->setText("1000");
-                minValue->setDataVariance(osg::Object::DYNAMIC);
-
-                pos.x() = minValue->getBoundingBox().xMax() + 2.0f * _characterSize;
-
-                osg::ref_ptr<osgText::Text> maxLabel = new osgText::Text;
-                _statsGeode->addDrawable(maxLabel.get());
-
-                maxLabel->setColor(colorDP);
-                maxLabel->setFont(_font);
-                maxLabel->setCharacterSize(_characterSize);
-                maxLabel->setPosition(pos);
-                maxLabel->setText("max: ");
-
-                pos.x() = maxLabel->getBoundingBox().xMax();
-
-                osg::ref_ptr<osgText::Text> maxValue = new osgText::Text;
-                _statsGeode->addDrawable(maxValue.get());
-
-                maxValue->setColor(colorDP);
-                maxValue->setFont(_font);
-                maxValue->setCharacterSize(_characterSize);
-                maxValue->setPosition(pos);
-                maxValue->setText("1000");
-                maxValue->setDataVariance(osg::Object::DYNAMIC);
+                addItem(WINDOW_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), _statsWidth - 2 * backgroundMargin, _characterSize + 2 * backgroundMargin, backgroundColor));
 
-                pos.x() = maxValue->getBoundingBox().xMax();
+                osg::ref_ptr<PagerItem> pagerItem = new PagerItem(dp, colorDP, 1000.0);
 
-                osg::ref_ptr<osgText::Text> requestsLabel = new osgText::Text;
-                _statsGeode->addDrawable(requestsLabel.get());
+                auto addField = [&](const std::string &label, PagerItem::Field field, const std::string &placeholder) {
+                    addItem(WINDOW_STATS, new TextItem(pos, label, colorDP));
+                    pos.x() += _overlay->getTextWidth(label);
+                    pagerItem->positions[field] = pos;
+                    pos.x() += _overlay->getTextWidth(placeholder) + 2.0f * _characterSize;
+                };
 
-                requestsLabel->setColor(colorDP);
-                requestsLabel->setFont(_font);
-                requestsLabel->setCharacterSize(_characterSize);
-                requestsLabel->setPosition(pos);
-                requestsLabel->setText("requests: ");
+                addField("DatabasePager time to merge new tiles - average: ", PagerItem::AVERAGE, "1000");
+                addField("min: ", PagerItem::MINIMUM, "1000");
+                addField("max: ", PagerItem::MAXIMUM, "1000");
+                addField("requests: ", PagerItem::FILE_REQUEST_LIST, "0");
+                addField("tocompile: ", PagerItem::DATA_TO_COMPILE_LIST, "0");
+                addField("tomerge: ", PagerItem::MERGE_BACKLOG, "0");
 
-                pos.x() = requestsLabel->getBoundingBox().xMax();
-
-                osg::ref_ptr<osgText::Text> requestList = new osgText::Text;
-                _statsGeode->addDrawable(requestList.get());
-
-                requestList->setColor(colorDP);
-                requestList->setFont(_font);
-                requestList->setCharacterSize(_characterSize);
-                requestList->setPosition(pos);
-                requestList->setText("0");
-                requestList->setDataVariance(osg::Object::DYNAMIC);
-
-                pos.x() = requestList->getBoundingBox().xMax() + 2.0f * _characterSize;
-                ;
-
-                osg::ref_ptr<osgText::Text> compileLabel = new osgText::Text;
-                _statsGeode->addDrawable(compileLabel.get());
-
-                compileLabel->setColor(colorDP);
-                compileLabel->setFont(_font);
-                compileLabel->setCharacterSize(_characterSize);
-                compileLabel->setPosition(pos);
-                compileLabel->setText("tocompile: ");
-
-                pos.x() = compileLabel->getBoundingBox().xMax();
-
-                osg::ref_ptr<osgText::Text> compileList = new osgText::Text;
-                _statsGeode->addDrawable(compileList.get());
-
-                compileList->setColor(colorDP);
-                compileList->setFont(_font);
-                compileList->setCharacterSize(_characterSize);
-                compileList->setPosition(pos);
-                compileList->setText("0");
-                compileList->setDataVariance(osg::Object::DYNAMIC);
-
-                pos.x() = maxLabel->getBoundingBox().xMax();
-
-                _statsGeode->setCullCallback(new PagerCallback(dp, minValue.get(), maxValue.get(), averageValue.get(), requestList.get(), compileList.get(), 1000.0));
+                addItem(WINDOW_STATS, pagerItem.get());
             }
 
             pos.x() = _leftTopPos.x();
@@ -1528,24 +1603,9 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
     // viewport stats
     {
-
-        osg::Group *group = new osg::Group;
-        _viewportChildNum = _switch->getNumChildren();
-        _switch->addChild(group, false);
-
-        osg::Geode *geode = new osg::Geode();
-        geode->setCullingActive(false);
-        group->addChild(geode);
-        geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 10 * _characterSize + 2 * backgroundMargin, 22 * _characterSize + 2 * backgroundMargin, backgroundColor));
+        addItem(VIEWPORT_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 10 * _characterSize + 2 * backgroundMargin, 22 * _characterSize + 2 * backgroundMargin, backgroundColor));
 
         // Camera scene & primitive stats static text
-        osg::ref_ptr<osgText::Text> camStaticText = new osgText::Text;
-        geode->addDrawable(camStaticText.get());
-        camStaticText->setColor(staticTextColor);
-        camStaticText->setFont(_font);
-        camStaticText->setCharacterSize(_characterSize);
-        camStaticText->setPosition(pos);
-
         std::ostringstream viewStr;
         viewStr.clear();
         viewStr.setf(std::ios::left, std::ios::adjustfield);
@@ -1572,8 +1632,7 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
         viewStr << "Quads" << std::endl;
         viewStr << "Quad strips" << std::endl;
         viewStr << "Polygons" << std::endl;
-        viewStr.setf(std::ios::right, std::ios::adjustfield);
-        camStaticText->setText(viewStr.str());
+        addItem(VIEWPORT_STATS, new TextItem(pos, viewStr.str(), staticTextColor));
 
         // Move camera block to the right
         pos.x() += 10 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
@@ -1582,19 +1641,10 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
         int cameraCounter = 0;
         for (auto citr = cameras.begin(); citr != cameras.end(); ++citr)
         {
-            geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 5 * _characterSize + 2 * backgroundMargin, 22 * _characterSize + 2 * backgroundMargin, backgroundColor));
+            addItem(VIEWPORT_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 5 * _characterSize + 2 * backgroundMargin, 22 * _characterSize + 2 * backgroundMargin, backgroundColor));
 
             // Camera scene stats
-            osg::ref_ptr<osgText::Text> camStatsText = new osgText::Text;
-            geode->addDrawable(camStatsText.get());
-
-            camStatsText->setColor(dynamicTextColor);
-            camStatsText->setFont(_font);
-            camStatsText->setCharacterSize(_characterSize);
-            camStatsText->setPosition(pos);
-            camStatsText->setText("");
-            camStatsText->setDataVariance(osg::Object::DYNAMIC);
-            camStatsText->setDrawCallback(new CameraSceneStatsTextDrawCallback(*citr, cameraCounter));
+            addItem(VIEWPORT_STATS, new CameraSceneStatsItem(*citr, cameraCounter, pos, dynamicTextColor));
 
             // Move camera block to the right
             pos.x() += 5 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
@@ -1604,24 +1654,9 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
 
     // scene stats
     {
-        osg::Group *group = new osg::Group;
-        _sceneChildNum = _switch->getNumChildren();
-        _switch->addChild(group, false);
-
-        osg::Geode *geode = new osg::Geode();
-        geode->setCullingActive(false);
-        group->addChild(geode);
-
-        geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 6 * _characterSize + 2 * backgroundMargin, 12 * _characterSize + 2 * backgroundMargin, backgroundColor));
+        addItem(SCENE_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 6 * _characterSize + 2 * backgroundMargin, 12 * _characterSize + 2 * backgroundMargin, backgroundColor));
 
         // View scene stats static text
-        osg::ref_ptr<osgText::Text> camStaticText = new osgText::Text;
-        geode->addDrawable(camStaticText.get());
-        camStaticText->setColor(staticTextColor);
-        camStaticText->setFont(_font);
-        camStaticText->setCharacterSize(_characterSize);
-        camStaticText->setPosition(pos);
-
         std::ostringstream sceneStr;
         sceneStr.clear();
         sceneStr.setf(std::ios::left, std::ios::adjustfield);
@@ -1638,8 +1673,7 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
         sceneStr << "Geometry" << std::endl;
         sceneStr << "Vertices" << std::endl;
         sceneStr << "Primitives" << std::endl;
-        sceneStr.setf(std::ios::right, std::ios::adjustfield);
-        camStaticText->setText(sceneStr.str());
+        addItem(SCENE_STATS, new TextItem(pos, sceneStr.str(), staticTextColor));
 
         // Move window block to the right
         pos.x() += 6 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
@@ -1649,71 +1683,171 @@ void StatsHandler::setUpScene(Window *window, osg::Vec3 &pos)
         int viewCounter = 0;
         for (auto it = scenes.begin(); it != scenes.end(); ++it)
         {
-            geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 10 * _characterSize + 2 * backgroundMargin, 12 * _characterSize + 2 * backgroundMargin, backgroundColor));
+            addItem(SCENE_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), 10 * _characterSize + 2 * backgroundMargin, 12 * _characterSize + 2 * backgroundMargin, backgroundColor));
 
             // Text for scene statistics
-            osgText::Text *text = new osgText::Text;
-            geode->addDrawable(text);
-
-            text->setColor(dynamicTextColor);
-            text->setFont(_font);
-            text->setCharacterSize(_characterSize);
-            text->setPosition(pos);
-            text->setDataVariance(osg::Object::DYNAMIC);
-            text->setDrawCallback(new ViewSceneStatsTextDrawCallback(*it, viewCounter));
+            addItem(SCENE_STATS, new SceneStatsItem(*it, viewCounter, pos, dynamicTextColor));
 
             pos.x() += 10 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
             viewCounter++;
         }
+    }
 
-        // move to next block
-        pos.x() = _leftTopPos.x();
-        pos.y() -= (22 * _characterSize + 2 * backgroundMargin + backgroundSpacing);
+    // frame time percentiles, to the right of the scene stats
+    {
+        unsigned int numRows = 1 + 3 + 3 * static_cast<unsigned int>(cameras.size());
+        float labelWidth = 7 * _characterSize;
+        float columnWidth = 4 * _characterSize;
+
+        addItem(FRAME_TIME_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), labelWidth + 4 * columnWidth + 2 * backgroundMargin, numRows * _characterSize + 2 * backgroundMargin,
+                                                    backgroundColor));
+
+        std::ostringstream labelStr;
+        labelStr << "Time (ms)" << std::endl;
+        labelStr << "Frame" << std::endl;
+        labelStr << "Event" << std::endl;
+        labelStr << "Update" << std::endl;
+        for (unsigned int i = 0; i < cameras.size(); ++i)
+        {
+            labelStr << "Cull #" << i << std::endl;
+            labelStr << "Draw #" << i << std::endl;
+            labelStr << "GPU #" << i << std::endl;
+        }
+        addItem(FRAME_TIME_STATS, new TextItem(pos, labelStr.str(), staticTextColor));
+
+        addItem(FRAME_TIME_STATS, new FrameTimePercentilesItem(window, cameras, pos + osg::Vec3(labelWidth, 0, 0), columnWidth, dynamicTextColor));
+
+        pos.x() += labelWidth + 4 * columnWidth + 2 * backgroundMargin + backgroundSpacing;
     }
-}
 
-void StatsHandler::createTimeStatsLine(const std::string &lineLabel, osg::Vec3 pos, const osg::Vec4 &textColor, const osg::Vec4 &barColor, osg::Stats *viewerStats, osg::Stats *stats, const std::string &timeTakenName, float multiplier,
-                                       bool average, bool averageInInverseSpace, const std::string &beginTimeName, const std::string &endTimeName)
-{
-    osg::ref_ptr<osgText::Text> label = new osgText::Text;
-    _statsGeode->addDrawable(label.get());
+    // GL memory, to the right of the frame time percentiles
+    {
+        // 列依次为上下文、各场景和各视口
+        std::vector<osg::Stats *> columnStats{window->getStats()};
+        std::vector<std::string> columnHeaders{"Ctx"};
 
-    label->setColor(textColor);
-    label->setFont(_font);
-    label->setCharacterSize(_characterSize);
-    label->setPosition(pos);
-    label->setText(lineLabel + ": ");
+        auto scenes = window->getScenes();
+        for (unsigned int i = 0; i < scenes.size(); ++i)
+        {
+            columnStats.push_back(scenes[i]->getStats());
+            columnHeaders.push_back("S#" + std::to_string(i));
+        }
+
+        unsigned int viewportCounter = 0;
+        for (auto viewport : window->getViewports())
+        {
+            if (viewport != _viewport)
+            {
+                columnStats.push_back(viewport->getStats());
+                columnHeaders.push_back("V#" + std::to_string(viewportCounter++));
+            }
+        }
 
-    pos.x() = label->getBoundingBox().xMax();
+        float labelWidth = 8 * _characterSize;
+        float columnWidth = 4 * _characterSize;
+        unsigned int numRows = 1 + static_cast<unsigned int>(StatsTableItem::getGLMemoryRows().size());
+
+        addItem(MEMORY_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), labelWidth + columnStats.size() * columnWidth + 2 * backgroundMargin,
+                                                numRows * _characterSize + 2 * backgroundMargin, backgroundColor));
+
+        std::ostringstream labelStr;
+        labelStr << "GL memory" << std::endl;
+        labelStr << "Textures" << std::endl;
+        labelStr << "Texture MB" << std::endl;
+        labelStr << "VBOs" << std::endl;
+        labelStr << "VBO MB" << std::endl;
+        labelStr << "EBOs" << std::endl;
+        labelStr << "EBO MB" << std::endl;
+        labelStr << "Programs" << std::endl;
+        labelStr << "FBOs" << std::endl;
+        labelStr << "Tex pool MB" << std::endl;
+        labelStr << "Buf pool MB" << std::endl;
+        addItem(MEMORY_STATS, new TextItem(pos, labelStr.str(), staticTextColor));
+
+        for (unsigned int i = 0; i < columnHeaders.size(); ++i)
+        {
+            addItem(MEMORY_STATS, new TextItem(pos + osg::Vec3(labelWidth + i * columnWidth, 0, 0), columnHeaders[i], staticTextColor));
+        }
 
-    osg::ref_ptr<osgText::Text> value = new osgText::Text;
-    _statsGeode->addDrawable(value.get());
+        addItem(MEMORY_STATS, new StatsTableItem(columnStats, StatsTableItem::getGLMemoryRows(), pos + osg::Vec3(labelWidth, -_characterSize, 0), columnWidth, dynamicTextColor));
+    }
 
-    value->setColor(textColor);
-    value->setFont(_font);
-    value->setCharacterSize(_characterSize);
-    value->setPosition(pos);
-    value->setText("0.0");
-    value->setDataVariance(osg::Object::DYNAMIC);
+    // move to next block
+    pos.x() = _leftTopPos.x();
+    pos.y() -= (22 * _characterSize + 2 * backgroundMargin + backgroundSpacing);
 
-    if (!timeTakenName.empty())
+    // subgraph profile
     {
-        if (average)
+        unsigned int maxNumRows = 10;
+        float nameWidth = 12 * _characterSize;
+        float columnWidth = 4 * _characterSize;
+        float barWidth = 10 * _characterSize;
+
+        addItem(SUBGRAPH_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), nameWidth + 3 * columnWidth + barWidth + 2 * backgroundMargin,
+                                                  (1 + maxNumRows) * _characterSize + 2 * backgroundMargin, backgroundColor));
+
+        addItem(SUBGRAPH_STATS, new TextItem(pos, "Subgraph (ms)", staticTextColor));
+        addItem(SUBGRAPH_STATS, new TextItem(pos + osg::Vec3(nameWidth, 0, 0), "Cull", staticTextColor));
+        addItem(SUBGRAPH_STATS, new TextItem(pos + osg::Vec3(nameWidth + columnWidth, 0, 0), "Draw", staticTextColor));
+        addItem(SUBGRAPH_STATS, new TextItem(pos + osg::Vec3(nameWidth + 2 * columnWidth, 0, 0), "GPU", staticTextColor));
+
+        addItem(SUBGRAPH_STATS, new SubgraphProfileItem(cameras, pos + osg::Vec3(0, -_characterSize, 0), maxNumRows, nameWidth, columnWidth, barWidth, dynamicTextColor, osg::Vec4(0.0f, 1.0f, 0.5f, 0.7f)));
+
+        pos.x() += nameWidth + 3 * columnWidth + barWidth + 2 * backgroundMargin + backgroundSpacing;
+    }
+
+    // pipeline statistics, to the right of the subgraph profile
+    {
+        std::vector<osg::Stats *> columnStats;
+        for (auto camera : cameras)
         {
-            value->setDrawCallback(new AveragedValueTextDrawCallback(stats, timeTakenName, -1, averageInInverseSpace, multiplier));
+            columnStats.push_back(camera->getStats());
         }
-        else
+
+        float labelWidth = 13 * _characterSize;
+        float columnWidth = 5 * _characterSize;
+        unsigned int numRows = 1 + static_cast<unsigned int>(StatsTableItem::getPipelineStatisticsRows().size());
+
+        addItem(PIPELINE_STATS, new RectangleItem(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0), labelWidth + columnStats.size() * columnWidth + 2 * backgroundMargin,
+                                                  numRows * _characterSize + 2 * backgroundMargin, backgroundColor));
+
+        std::ostringstream labelStr;
+        labelStr << "Pipeline" << std::endl;
+        labelStr << "Vertices K" << std::endl;
+        labelStr << "Primitives K" << std::endl;
+        labelStr << "Clip in K" << std::endl;
+        labelStr << "Clip out K" << std::endl;
+        labelStr << "Fragments K" << std::endl;
+        labelStr << "Draw calls" << std::endl;
+        labelStr << "State changes" << std::endl;
+        addItem(PIPELINE_STATS, new TextItem(pos, labelStr.str(), staticTextColor));
+
+        for (unsigned int i = 0; i < columnStats.size(); ++i)
         {
-            value->setDrawCallback(new RawValueTextDrawCallback(stats, timeTakenName, -1, multiplier));
+            addItem(PIPELINE_STATS, new TextItem(pos + osg::Vec3(labelWidth + i * columnWidth, 0, 0), "#" + std::to_string(i), staticTextColor));
         }
+
+        addItem(PIPELINE_STATS, new StatsTableItem(columnStats, StatsTableItem::getPipelineStatisticsRows(), pos + osg::Vec3(labelWidth, -_characterSize, 0), columnWidth, dynamicTextColor));
+    }
+}
+
+void StatsHandler::createTimeStatsLine(const std::string &lineLabel, osg::Vec3 pos, const osg::Vec4 &textColor, const osg::Vec4 &barColor, osg::Stats *viewerStats, osg::Stats *stats, const std::string &timeTakenName, float multiplier,
+                                       bool average, bool averageInInverseSpace, const std::string &beginTimeName, const std::string &endTimeName)
+{
+    std::string label = lineLabel + ": ";
+    addItem(WINDOW_STATS, new TextItem(pos, label, textColor));
+
+    pos.x() += _overlay->getTextWidth(label);
+
+    if (!timeTakenName.empty())
+    {
+        addItem(WINDOW_STATS, new ValueTextItem(pos, textColor, stats, timeTakenName, average, averageInInverseSpace, multiplier));
     }
 
     if (!beginTimeName.empty() && !endTimeName.empty())
     {
         pos.x() = _startBlocks;
-        osg::Geometry *geometry = createGeometry(pos, _characterSize * 0.8, barColor, _numBlocks);
-        geometry->setDrawCallback(new BlockDrawCallback(this, _startBlocks, viewerStats, stats, beginTimeName, endTimeName, -1, _numBlocks));
-        _statsGeode->addDrawable(geometry);
+        addItem(WINDOW_STATS, new BlocksItem(pos, _characterSize * 0.8, barColor, viewerStats, stats, beginTimeName, endTimeName, _numBlocks, _blockMultiplier));
     }
 }
 
@@ -1759,7 +1893,7 @@ void StatsHandler::createCameraTimeStats(osg::Vec3 &pos, bool acquireGPUStats, o
 void StatsHandler::getUsage(osg::ApplicationUsage &usage) const
 {
     usage.addKeyboardMouseBinding(_keyEventTogglesOnScreenStats, "On screen stats.");
-    usage.addKeyboardMouseBinding(_keyEventPrintsOutStats, "Output stats to console.");
+    usage.addKeyboardMouseBinding(_keyEventPrintsOutStats, "Output stats to console and the window stats exporter.");
 }
 
 } // namespace opeViewer
@@ -5,9 +5,15 @@
 #ifndef INC_2023_12_21_EA8AFC0C6616411AAF3414F8CCE2587F_H_
 #define INC_2023_12_21_EA8AFC0C6616411AAF3414F8CCE2587F_H_
 
+#include <vector>
+
+#include <osg/Geode>
+#include <osg/Stats>
+#include <osg/Timer>
 #include <osgGA/GUIEventHandler>
-#include <osgText/Text>
 
+#include "Instrumentation.h"
+#include "StatsOverlay.h"
 #include "Window.h"
 
 namespace opeViewer
@@ -15,6 +21,11 @@ namespace opeViewer
 
 /**
  * Event handler for adding on screen stats reporting to Window.
+ *
+ * The overlay is a single StatsOverlay geometry rebuilt once per frame, in
+ * the cull traversal of the stats camera, from a snapshot of the stats.
+ * The time this takes is recorded as "Stats overlay time taken" in the
+ * window stats.
  */
 class StatsHandler : public osgGA::GUIEventHandler
 {
@@ -28,6 +39,14 @@ class StatsHandler : public osgGA::GUIEventHandler
         WINDOW_STATS = 1 << 1,
         VIEWPORT_STATS = 1 << 2,
         SCENE_STATS = 1 << 3,
+        /// 帧各阶段耗时的百分位数，见Window::getFrameTimeHistograms
+        FRAME_TIME_STATS = 1 << 4,
+        /// 各场景、各视口和上下文的GL对象，见Window::glMemoryStats
+        MEMORY_STATS = 1 << 5,
+        /// 相机的SubgraphProfiler中开销最大的子图，见Renderer::setSubgraphProfiler；同时记录各绘制过程的GPU时间（见Renderer::getGPUPasses）和硬件计数器（见PerfCounters）
+        SUBGRAPH_STATS = 1 << 6,
+        /// 各相机绘制的顶点、图元和片元着色器调用次数，见PipelineStatisticsQuerySupport，以及绘制次数和状态切换
+        PIPELINE_STATS = 1 << 7,
     };
 
     void setKeyEventTogglesOnScreenStats(int key)
@@ -67,6 +86,7 @@ class StatsHandler : public osgGA::GUIEventHandler
 
     virtual void collectWhichCamerasToRenderStatsFor(Window *window, std::vector<osg::Camera *> &cameras);
 
+    /// 统计级别低于显示需要的级别时临时提高（场景、显存、子图和管线统计需要FULL，其他需要BASIC），关闭显示后恢复
     virtual void setEnabled(size_t statsTypeMask);
 
     virtual bool handle(const osgGA::GUIEventAdapter &ea, osgGA::GUIActionAdapter &aa);
@@ -112,6 +132,75 @@ class StatsHandler : public osgGA::GUIEventHandler
     void removeUserStatsLine(const std::string &label);
 
   protected:
+    /// 一帧的统计快照
+    ///
+    /// 每个统计对象在一帧中只读取一次历史，之后各项都从快照中取值
+    class Snapshot
+    {
+      public:
+        void reset(unsigned int frameNumber, osg::Timer_t tick);
+
+        unsigned int getFrameNumber() const;
+
+        osg::Timer_t getTick() const;
+
+        bool getAttribute(osg::Stats *stats, unsigned int frameNumber, const std::string &attributeName, double &value) const;
+
+        /// 同osg::Stats::getAveragedAttribute，在历史中的所有帧上平均
+        bool getAveragedAttribute(osg::Stats *stats, const std::string &attributeName, double &value, bool averageInInverseSpace) const;
+
+      protected:
+        struct History
+        {
+            osg::Stats *stats{};
+            unsigned int earliestFrameNumber{};
+            std::vector<const osg::Stats::AttributeMap *> attributeMaps;
+        };
+
+        const History *getHistory(osg::Stats *stats) const;
+
+        unsigned int _frameNumber{};
+        osg::Timer_t _tick{};
+        /// 前_numHistories个为本帧读取的，各帧复用
+        mutable std::vector<History> _histories;
+        mutable unsigned int _numHistories{};
+    };
+
+    /// 统计显示中的一项，每帧从快照写入StatsOverlay
+    struct Item : osg::Referenced
+    {
+        /// 所属的StatsType，未启用时不显示
+        size_t statsType{};
+
+        virtual void update(const Snapshot &snapshot, StatsOverlay &overlay) = 0;
+    };
+
+    /// 文字
+    struct TextItem : Item
+    {
+        osg::Vec3 position;
+        std::string text;
+        osg::Vec4 color;
+
+        TextItem(const osg::Vec3 &position, const std::string &text, const osg::Vec4 &color);
+
+        void update(const Snapshot &snapshot, StatsOverlay &overlay) override;
+    };
+
+    struct ValueTextItem;
+    struct RectangleItem;
+    struct LinesItem;
+    struct BlocksItem;
+    struct FrameMarkersItem;
+    struct GraphItem;
+    struct PagerItem;
+    struct CameraSceneStatsItem;
+    struct SceneStatsItem;
+    struct FrameTimePercentilesItem;
+    struct StatsTableItem;
+    struct SubgraphProfileItem;
+    struct OverlayCullCallback;
+
     void initialize(Window *window);
 
     void initialize(Window *window, osg::Vec3 &pos);
@@ -120,13 +209,7 @@ class StatsHandler : public osgGA::GUIEventHandler
 
     void setWindowSize(int width, int height);
 
-    osg::Geometry *createBackgroundRectangle(const osg::Vec3 &pos, const float width, const float height, osg::Vec4 &color);
-
-    osg::Geometry *createGeometry(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numBlocks);
-
-    osg::Geometry *createFrameMarkers(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numBlocks);
-
-    osg::Geometry *createTick(const osg::Vec3 &pos, float height, const osg::Vec4 &colour, unsigned int numTicks);
+    void addItem(StatsType statsType, Item *item);
 
     void createTimeStatsLine(const std::string &lineLabel, osg::Vec3 pos, const osg::Vec4 &textColor, const osg::Vec4 &barColor, osg::Stats *viewerStats, osg::Stats *stats, const std::string &timeTakenName, float multiplier, bool average,
                              bool averageInInverseSpace, const std::string &beginTimeName, const std::string &endTimeName);
@@ -135,29 +218,36 @@ class StatsHandler : public osgGA::GUIEventHandler
 
     virtual void setUpScene(Window *window, osg::Vec3 &pos);
 
+    /// 在统计相机的剔除遍历中调用，重新生成StatsOverlay的内容
+    void updateOverlay(const osg::FrameStamp &frameStamp);
+
     void updateThreadingModelText();
 
+    /// 级别低于level时提高，恢复之前提高的级别
+    void raiseInstrumentationLevel(Instrumentation::Level level);
+
     int _keyEventTogglesOnScreenStats;
     int _keyEventPrintsOutStats;
 
     size_t _statsTypeMask;
     int _statsTypeSize;
 
+    /// setEnabled提高了统计级别时，提高前的级别
+    bool _raisedInstrumentationLevel{};
+    Instrumentation::Level _previousInstrumentationLevel{Instrumentation::OFF};
+
     bool _initialized;
     osg::ref_ptr<Viewport> _viewport;
     osg::ref_ptr<osg::Camera> _camera;
 
-    osg::ref_ptr<osg::Switch> _switch;
-
     osg::ref_ptr<osg::Geode> _statsGeode;
+    osg::ref_ptr<StatsOverlay> _overlay;
+    std::vector<osg::ref_ptr<Item>> _items;
+    Snapshot _snapshot;
 
     Window::ThreadingModel _threadingModel;
-    osg::ref_ptr<osgText::Text> _threadingModelText;
+    osg::ref_ptr<TextItem> _threadingModelText;
 
-    unsigned int _frameRateChildNum;
-    unsigned int _windowChildNum;
-    unsigned int _viewportChildNum;
-    unsigned int _sceneChildNum;
     unsigned int _numBlocks;
     double _blockMultiplier;
 
@@ -0,0 +1,435 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "StatsOverlay.h"
+
+#include <algorithm>
+
+#include <osg/Texture2D>
+#include <osgText/Font>
+
+namespace opeViewer
+{
+
+#if (!defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE))
+#define GLSL_VERSION_STR "330 core"
+#else
+#define GLSL_VERSION_STR "300 es"
+#endif
+
+static const char *gl3_StatsOverlayVertexShader = {"#version " GLSL_VERSION_STR "\n"
+                                                   "// gl3_StatsOverlayVertexShader\n"
+                                                   "#ifdef GL_ES\n"
+                                                   "    precision highp float;\n"
+                                                   "#endif\n"
+                                                   "in vec4 osg_Vertex;\n"
+                                                   "in vec4 osg_Color;\n"
+                                                   "in vec4 osg_MultiTexCoord0;\n"
+                                                   "uniform mat4 osg_ModelViewProjectionMatrix;\n"
+                                                   "out vec4 vertexColor;\n"
+                                                   "out vec2 texCoord;\n"
+                                                   "void main(void)\n"
+                                                   "{\n"
+                                                   "    gl_Position = osg_ModelViewProjectionMatrix * osg_Vertex;\n"
+                                                   "    vertexColor = osg_Color;\n"
+                                                   "    texCoord = osg_MultiTexCoord0.xy;\n"
+                                                   "}\n"};
+
+static const char *gl3_StatsOverlayFragmentShader = {"#version " GLSL_VERSION_STR "\n"
+                                                     "// gl3_StatsOverlayFragmentShader\n"
+                                                     "#ifdef GL_ES\n"
+                                                     "    precision highp float;\n"
+                                                     "#endif\n"
+                                                     "uniform sampler2D opeViewer_GlyphTexture;\n"
+                                                     "in vec4 vertexColor;\n"
+                                                     "in vec2 texCoord;\n"
+                                                     "out vec4 color;\n"
+                                                     "void main(void)\n"
+                                                     "{\n"
+                                                     "    color = vertexColor * texture(opeViewer_GlyphTexture, texCoord);\n"
+                                                     "}\n"};
+
+static const char *gl2_StatsOverlayVertexShader = {"// gl2_StatsOverlayVertexShader\n"
+                                                   "#ifdef GL_ES\n"
+                                                   "    precision highp float;\n"
+                                                   "#endif\n"
+                                                   "varying vec4 vertexColor;\n"
+                                                   "varying vec2 texCoord;\n"
+                                                   "void main(void)\n"
+                                                   "{\n"
+                                                   "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+                                                   "    vertexColor = gl_Color;\n"
+                                                   "    texCoord = gl_MultiTexCoord0.xy;\n"
+                                                   "}\n"};
+
+static const char *gl2_StatsOverlayFragmentShader = {"// gl2_StatsOverlayFragmentShader\n"
+                                                     "#ifdef GL_ES\n"
+                                                     "    precision highp float;\n"
+                                                     "#endif\n"
+                                                     "uniform sampler2D opeViewer_GlyphTexture;\n"
+                                                     "varying vec4 vertexColor;\n"
+                                                     "varying vec2 texCoord;\n"
+                                                     "void main(void)\n"
+                                                     "{\n"
+                                                     "    gl_FragColor = vertexColor * texture2D(opeViewer_GlyphTexture, texCoord);\n"
+                                                     "}\n"};
+
+namespace
+{
+
+/// 光栅化字形的分辨率，与osgText::Text的默认值相同
+const unsigned int GLYPH_RESOLUTION = 32;
+
+const int ATLAS_WIDTH = 512;
+
+/// 图集左下角实心区域的大小
+const int SOLID_SIZE = 4;
+
+/// 字形之间的间隔，避免线性过滤时采样到相邻字形
+const int GLYPH_PADDING = 2;
+
+osg::Vec4ub toColor(const osg::Vec4 &color)
+{
+    auto component = [](float value) { return static_cast<unsigned char>(osg::clampBetween(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return osg::Vec4ub(component(color.r()), component(color.g()), component(color.b()), component(color.a()));
+}
+
+} // namespace
+
+StatsOverlay::StatsOverlay(const std::string &fontFile, float characterSize) : _characterSize(characterSize)
+{
+    setUseDisplayList(false);
+    setUseVertexBufferObjects(true);
+    setDataVariance(osg::Object::DYNAMIC);
+    // 顶点每帧变化，包围盒不可靠
+    setCullingActive(false);
+
+    // 所有数组共用一个顶点缓冲
+    osg::ref_ptr<osg::BufferObject> vbo = new osg::VertexBufferObject;
+    vbo->setUsage(GL_DYNAMIC_DRAW);
+
+    _vertices = new osg::Vec3Array;
+    _vertices->setBufferObject(vbo.get());
+    setVertexArray(_vertices.get());
+
+    _colors = new osg::Vec4ubArray;
+    _colors->setNormalize(true);
+    _colors->setBufferObject(vbo.get());
+    setColorArray(_colors.get(), osg::Array::BIND_PER_VERTEX);
+
+    _texCoords = new osg::Vec2Array;
+    _texCoords->setBufferObject(vbo.get());
+    setTexCoordArray(0, _texCoords.get());
+
+    _triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    addPrimitiveSet(_triangles.get());
+
+    _lines = new osg::DrawArrays(GL_LINES, 0, 0);
+    addPrimitiveSet(_lines.get());
+
+    createGlyphAtlas(fontFile);
+
+    osg::StateSet *stateset = getOrCreateStateSet();
+    osg::DisplaySettings::ShaderHint shaderHint = osg::DisplaySettings::instance()->getShaderHint();
+    if (shaderHint == osg::DisplaySettings::SHADER_GL3 || shaderHint == osg::DisplaySettings::SHADER_GLES3)
+    {
+        osg::ref_ptr<osg::Program> program = new osg::Program;
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl3_StatsOverlayVertexShader));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl3_StatsOverlayFragmentShader));
+        stateset->setAttributeAndModes(program.get());
+        stateset->addUniform(new osg::Uniform("opeViewer_GlyphTexture", 0));
+    }
+    else if (shaderHint == osg::DisplaySettings::SHADER_GL2 || shaderHint == osg::DisplaySettings::SHADER_GLES2)
+    {
+        osg::ref_ptr<osg::Program> program = new osg::Program;
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, gl2_StatsOverlayVertexShader));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gl2_StatsOverlayFragmentShader));
+        stateset->setAttributeAndModes(program.get());
+        stateset->addUniform(new osg::Uniform("opeViewer_GlyphTexture", 0));
+    }
+}
+
+StatsOverlay::~StatsOverlay() = default;
+
+float StatsOverlay::getCharacterSize() const
+{
+    return _characterSize;
+}
+
+float StatsOverlay::getTextWidth(const std::string &text) const
+{
+    float width = 0.0f;
+    float lineWidth = 0.0f;
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            lineWidth = 0.0f;
+            continue;
+        }
+        lineWidth += getGlyph(c).advance * _characterSize;
+        width = std::max(width, lineWidth);
+    }
+    return width;
+}
+
+float StatsOverlay::addText(const osg::Vec3 &position, const std::string &text, const osg::Vec4 &color)
+{
+    osg::Vec4ub textColor = toColor(color);
+    osg::Vec3 origin = position;
+    float xMax = position.x();
+    for (char c : text)
+    {
+        if (c == '\n')
+        {
+            origin.x() = position.x();
+            origin.y() -= _characterSize;
+            continue;
+        }
+
+        const Glyph &glyph = getGlyph(c);
+        if (glyph.valid)
+        {
+            addQuad(origin + osg::Vec3(glyph.min * _characterSize, 0.0f), origin + osg::Vec3(glyph.max * _characterSize, 0.0f), glyph.texCoordMin, glyph.texCoordMax, textColor);
+        }
+        origin.x() += glyph.advance * _characterSize;
+        xMax = std::max(xMax, origin.x());
+    }
+    return xMax;
+}
+
+void StatsOverlay::addRectangle(const osg::Vec3 &leftTop, float width, float height, const osg::Vec4 &color)
+{
+    addQuad(leftTop - osg::Vec3(0.0f, height, 0.0f), leftTop + osg::Vec3(width, 0.0f, 0.0f), _solidTexCoord, _solidTexCoord, toColor(color));
+}
+
+void StatsOverlay::addLine(const osg::Vec3 &from, const osg::Vec3 &to, const osg::Vec4 &color)
+{
+    osg::Vec4ub lineColor = toColor(color);
+    _lineVertices.push_back({from, lineColor, _solidTexCoord});
+    _lineVertices.push_back({to, lineColor, _solidTexCoord});
+}
+
+void StatsOverlay::addLineStrip(const osg::Vec4 &color)
+{
+    _lineStripFirsts.push_back(static_cast<unsigned int>(_lineStripVertices.size()));
+    _lineStripColor = toColor(color);
+}
+
+void StatsOverlay::addLineStripVertex(const osg::Vec3 &vertex)
+{
+    _lineStripVertices.push_back({vertex, _lineStripColor, _solidTexCoord});
+}
+
+void StatsOverlay::clear()
+{
+    _triangleVertices.clear();
+    _lineVertices.clear();
+    _lineStripVertices.clear();
+    _lineStripFirsts.clear();
+}
+
+void StatsOverlay::commit()
+{
+    unsigned int numTriangleVertices = static_cast<unsigned int>(_triangleVertices.size());
+    unsigned int numLineVertices = static_cast<unsigned int>(_lineVertices.size());
+    unsigned int numVertices = numTriangleVertices + numLineVertices + static_cast<unsigned int>(_lineStripVertices.size());
+
+    _vertices->resize(numVertices);
+    _colors->resize(numVertices);
+    _texCoords->resize(numVertices);
+
+    unsigned int vi = 0;
+    for (const std::vector<Vertex> *vertices : {&_triangleVertices, &_lineVertices, &_lineStripVertices})
+    {
+        for (const Vertex &vertex : *vertices)
+        {
+            (*_vertices)[vi] = vertex.position;
+            (*_colors)[vi] = vertex.color;
+            (*_texCoords)[vi] = vertex.texCoord;
+            ++vi;
+        }
+    }
+
+    _vertices->dirty();
+    _colors->dirty();
+    _texCoords->dirty();
+
+    // 每个四边形的索引只取决于它的序号，只在数量变化时更新
+    unsigned int numQuads = numTriangleVertices / 4;
+    unsigned int numIndexedQuads = static_cast<unsigned int>(_triangles->size() / 6);
+    if (numQuads != numIndexedQuads)
+    {
+        _triangles->resize(numQuads * 6);
+        for (unsigned int i = numIndexedQuads; i < numQuads; ++i)
+        {
+            unsigned int index = i * 6;
+            unsigned int first = i * 4;
+            (*_triangles)[index + 0] = first;
+            (*_triangles)[index + 1] = first + 1;
+            (*_triangles)[index + 2] = first + 2;
+            (*_triangles)[index + 3] = first;
+            (*_triangles)[index + 4] = first + 2;
+            (*_triangles)[index + 5] = first + 3;
+        }
+        _triangles->dirty();
+    }
+
+    _lines->setFirst(numTriangleVertices);
+    _lines->setCount(numLineVertices);
+
+    // 折线数量只在统计项变化时改变
+    unsigned int numLineStrips = static_cast<unsigned int>(_lineStripFirsts.size());
+    if (numLineStrips != _lineStrips.size())
+    {
+        if (getNumPrimitiveSets() > 2)
+        {
+            removePrimitiveSet(2, getNumPrimitiveSets() - 2);
+        }
+        _lineStrips.resize(numLineStrips);
+        for (osg::ref_ptr<osg::DrawArrays> &lineStrip : _lineStrips)
+        {
+            if (!lineStrip)
+            {
+                lineStrip = new osg::DrawArrays(GL_LINE_STRIP, 0, 0);
+            }
+            addPrimitiveSet(lineStrip.get());
+        }
+    }
+
+    unsigned int lineStripBase = numTriangleVertices + numLineVertices;
+    for (unsigned int i = 0; i < numLineStrips; ++i)
+    {
+        unsigned int first = _lineStripFirsts[i];
+        unsigned int last = i + 1 < numLineStrips ? _lineStripFirsts[i + 1] : static_cast<unsigned int>(_lineStripVertices.size());
+        _lineStrips[i]->setFirst(lineStripBase + first);
+        _lineStrips[i]->setCount(last - first);
+    }
+
+    dirtyBound();
+}
+
+void StatsOverlay::createGlyphAtlas(const std::string &fontFile)
+{
+    osg::ref_ptr<osgText::Font> font = osgText::readRefFontFile(fontFile);
+    if (!font)
+    {
+        OSG_INFO << "StatsOverlay::createGlyphAtlas() Cannot read font " << fontFile << ", using the default font" << std::endl;
+        font = osgText::Font::getDefaultFont();
+    }
+
+    osgText::FontResolution resolution(GLYPH_RESOLUTION, GLYPH_RESOLUTION);
+
+    // 按行排列，第一行的开头为实心区域
+    osg::ref_ptr<osgText::Glyph> glyphs[NUM_GLYPHS];
+    int origins[NUM_GLYPHS][2]{};
+    int x = SOLID_SIZE + GLYPH_PADDING;
+    int y = 0;
+    int rowHeight = SOLID_SIZE;
+    for (unsigned int i = 0; i < NUM_GLYPHS; ++i)
+    {
+        osgText::Glyph *glyph = font->getGlyph(resolution, FIRST_GLYPH + i);
+        if (!glyph)
+        {
+            continue;
+        }
+
+        glyphs[i] = glyph;
+        _glyphs[i].advance = glyph->getHorizontalAdvance();
+        if (glyph->s() <= 0 || glyph->t() <= 0 || glyph->getDataType() != GL_UNSIGNED_BYTE)
+        {
+            continue;
+        }
+
+        if (x + glyph->s() > ATLAS_WIDTH)
+        {
+            x = 0;
+            y += rowHeight + GLYPH_PADDING;
+            rowHeight = 0;
+        }
+        origins[i][0] = x;
+        origins[i][1] = y;
+        x += glyph->s() + GLYPH_PADDING;
+        rowHeight = std::max(rowHeight, glyph->t());
+    }
+
+    int atlasHeight = 1;
+    while (atlasHeight < y + rowHeight)
+    {
+        atlasHeight *= 2;
+    }
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(ATLAS_WIDTH, atlasHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    for (int row = 0; row < atlasHeight; ++row)
+    {
+        unsigned char *pixel = image->data(0, row);
+        for (int column = 0; column < ATLAS_WIDTH; ++column, pixel += 4)
+        {
+            pixel[0] = pixel[1] = pixel[2] = 255;
+            pixel[3] = (row < SOLID_SIZE && column < SOLID_SIZE) ? 255 : 0;
+        }
+    }
+    _solidTexCoord.set(0.5f * SOLID_SIZE / ATLAS_WIDTH, 0.5f * SOLID_SIZE / atlasHeight);
+
+    for (unsigned int i = 0; i < NUM_GLYPHS; ++i)
+    {
+        osgText::Glyph *glyph = glyphs[i].get();
+        if (!glyph || glyph->s() <= 0 || glyph->t() <= 0 || glyph->getDataType() != GL_UNSIGNED_BYTE)
+        {
+            continue;
+        }
+
+        // 字形图像为单通道或亮度透明度，取最后一个分量作为覆盖率
+        unsigned int numComponents = osg::Image::computeNumComponents(glyph->getPixelFormat());
+        for (int row = 0; row < glyph->t(); ++row)
+        {
+            const unsigned char *source = glyph->data(0, row);
+            unsigned char *target = image->data(origins[i][0], origins[i][1] + row);
+            for (int column = 0; column < glyph->s(); ++column)
+            {
+                target[column * 4 + 3] = source[column * numComponents + numComponents - 1];
+            }
+        }
+
+        // 字形图像在字形范围外带有边距，按中心对齐，一个像素为1 / GLYPH_RESOLUTION个字符高度
+        osg::Vec2 center = glyph->getHorizontalBearing() + osg::Vec2(glyph->getWidth(), glyph->getHeight()) * 0.5f;
+        osg::Vec2 halfSize(0.5f * glyph->s() / GLYPH_RESOLUTION, 0.5f * glyph->t() / GLYPH_RESOLUTION);
+
+        Glyph &atlasGlyph = _glyphs[i];
+        atlasGlyph.valid = true;
+        atlasGlyph.min = center - halfSize;
+        atlasGlyph.max = center + halfSize;
+        atlasGlyph.texCoordMin.set(float(origins[i][0]) / ATLAS_WIDTH, float(origins[i][1]) / atlasHeight);
+        atlasGlyph.texCoordMax.set(float(origins[i][0] + glyph->s()) / ATLAS_WIDTH, float(origins[i][1] + glyph->t()) / atlasHeight);
+    }
+
+    osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D(image.get());
+    texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    texture->setResizeNonPowerOfTwoHint(false);
+    getOrCreateStateSet()->setTextureAttributeAndModes(0, texture.get());
+}
+
+const StatsOverlay::Glyph &StatsOverlay::getGlyph(char c) const
+{
+    unsigned int code = static_cast<unsigned char>(c);
+    if (code < FIRST_GLYPH || code >= FIRST_GLYPH + NUM_GLYPHS)
+    {
+        code = '?';
+    }
+    return _glyphs[code - FIRST_GLYPH];
+}
+
+void StatsOverlay::addQuad(const osg::Vec3 &leftBottom, const osg::Vec3 &rightTop, const osg::Vec2 &texCoordMin, const osg::Vec2 &texCoordMax, const osg::Vec4ub &color)
+{
+    _triangleVertices.push_back({leftBottom, color, texCoordMin});
+    _triangleVertices.push_back({osg::Vec3(rightTop.x(), leftBottom.y(), leftBottom.z()), color, osg::Vec2(texCoordMax.x(), texCoordMin.y())});
+    _triangleVertices.push_back({rightTop, color, texCoordMax});
+    _triangleVertices.push_back({osg::Vec3(leftBottom.x(), rightTop.y(), leftBottom.z()), color, osg::Vec2(texCoordMin.x(), texCoordMax.y())});
+}
+
+} // namespace opeViewer
@@ -0,0 +1,109 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_BC121C463D944866A170CBB3C3009AE0_H_
+#define INC_2026_10_18_BC121C463D944866A170CBB3C3009AE0_H_
+
+#include <string>
+#include <vector>
+
+#include <osg/Geometry>
+
+namespace opeViewer
+{
+
+/// 统计信息的批量绘制
+///
+/// 文字、矩形和线段写入同一个动态顶点缓冲，矩形和文字用一次三角形绘制，线段和每条折线各一次绘制
+///
+/// 创建时将字体的ASCII字形光栅化到一张图集中（RGB为白色，透明度为覆盖率），图集左下角为实心像素，矩形和线段使用该处的纹理坐标
+///
+/// 每帧先clear，再按从后到前的顺序加入内容，最后commit上传，线段总是绘制在三角形之上
+class StatsOverlay : public osg::Geometry
+{
+  public:
+    StatsOverlay(const std::string &fontFile, float characterSize);
+
+    float getCharacterSize() const;
+
+    /// 最宽一行的宽度
+    float getTextWidth(const std::string &text) const;
+
+    /// 加入文字，position为第一行基线的左端，之后每行下移一个字符高度，ASCII以外的字符绘制为'?'
+    ///
+    /// \return 最宽一行的右端
+    float addText(const osg::Vec3 &position, const std::string &text, const osg::Vec4 &color);
+
+    /// 加入矩形，leftTop为左上角
+    void addRectangle(const osg::Vec3 &leftTop, float width, float height, const osg::Vec4 &color);
+
+    void addLine(const osg::Vec3 &from, const osg::Vec3 &to, const osg::Vec4 &color);
+
+    /// 开始一条折线，之后用addLineStripVertex加入顶点
+    void addLineStrip(const osg::Vec4 &color);
+
+    void addLineStripVertex(const osg::Vec3 &vertex);
+
+    /// 清空本帧内容
+    void clear();
+
+    /// 将本帧内容写入顶点缓冲
+    void commit();
+
+  protected:
+    struct Vertex
+    {
+        osg::Vec3 position;
+        osg::Vec4ub color;
+        osg::Vec2 texCoord;
+    };
+
+    /// 字形在图集中的位置，大小以字符高度为单位
+    struct Glyph
+    {
+        bool valid{};
+        float advance{};
+        /// 相对基线起点的范围
+        osg::Vec2 min;
+        osg::Vec2 max;
+        osg::Vec2 texCoordMin;
+        osg::Vec2 texCoordMax;
+    };
+
+    static const unsigned int FIRST_GLYPH = 32;
+    static const unsigned int NUM_GLYPHS = 127 - FIRST_GLYPH;
+
+    ~StatsOverlay() override;
+
+    void createGlyphAtlas(const std::string &fontFile);
+
+    const Glyph &getGlyph(char c) const;
+
+    void addQuad(const osg::Vec3 &leftBottom, const osg::Vec3 &rightTop, const osg::Vec2 &texCoordMin, const osg::Vec2 &texCoordMax, const osg::Vec4ub &color);
+
+    float _characterSize{};
+
+    Glyph _glyphs[NUM_GLYPHS];
+    osg::Vec2 _solidTexCoord;
+
+    /// 本帧的内容，commit时依次写入顶点数组：三角形、线段、折线
+    std::vector<Vertex> _triangleVertices;
+    std::vector<Vertex> _lineVertices;
+    std::vector<Vertex> _lineStripVertices;
+    /// 每条折线在_lineStripVertices中的起点
+    std::vector<unsigned int> _lineStripFirsts;
+    osg::Vec4ub _lineStripColor;
+
+    osg::ref_ptr<osg::Vec3Array> _vertices;
+    osg::ref_ptr<osg::Vec4ubArray> _colors;
+    osg::ref_ptr<osg::Vec2Array> _texCoords;
+    osg::ref_ptr<osg::DrawElementsUInt> _triangles;
+    osg::ref_ptr<osg::DrawArrays> _lines;
+    /// 各条折线，各帧复用
+    std::vector<osg::ref_ptr<osg::DrawArrays>> _lineStrips;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_BC121C463D944866A170CBB3C3009AE0_H_
@@ -0,0 +1,527 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "SubgraphProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include <osg/Camera>
+#include <osg/NodeVisitor>
+#include <osg/State>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderBin>
+
+#include "Renderer.h"
+
+namespace opeViewer
+{
+
+namespace
+{
+
+const char *PROFILE_RENDER_BIN_NAME = "opeViewerSubgraphProfileBin";
+
+/// 子图的渲染箱都嵌套在原渲染箱中编号为0的渲染箱里，在原渲染箱中未标记的内容之后、编号为正的渲染箱（如透明渲染箱）之前绘制，渲染箱之间的顺序不变
+const int CONTAINER_BIN_NUMBER = 0;
+
+const int FIRST_BIN_NUMBER = 1;
+
+/// 查找设置了渲染箱的状态（TRANSPARENT_BIN也会设置），这样的内容放入子图的渲染箱后，与子图外同一渲染箱中内容的顺序会改变
+class RenderBinFinder : public osg::NodeVisitor
+{
+  public:
+    RenderBinFinder() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+    {
+    }
+
+    void apply(osg::Node &node) override
+    {
+        check(node.getStateSet());
+        if (!found)
+        {
+            traverse(node);
+        }
+    }
+
+    void apply(osg::Drawable &drawable) override
+    {
+        check(drawable.getStateSet());
+    }
+
+    bool found{};
+
+  private:
+    void check(const osg::StateSet *stateSet)
+    {
+        if (stateSet && stateSet->getRenderBinMode() != osg::StateSet::INHERIT_RENDERBIN_DETAILS)
+        {
+            found = true;
+        }
+    }
+};
+
+/// 子图的渲染箱，绘制前后通知相机Renderer的SubgraphProfiler
+class ProfileRenderBin : public osgUtil::RenderBin
+{
+  public:
+    ProfileRenderBin() = default;
+
+    ProfileRenderBin(const ProfileRenderBin &rhs, const osg::CopyOp &copyop = osg::CopyOp::SHALLOW_COPY) : osgUtil::RenderBin(rhs, copyop)
+    {
+    }
+
+    osg::Object *cloneType() const override
+    {
+        return new ProfileRenderBin();
+    }
+
+    osg::Object *clone(const osg::CopyOp &copyop) const override
+    {
+        return new ProfileRenderBin(*this, copyop);
+    }
+
+    bool isSameKindAs(const osg::Object *obj) const override
+    {
+        return dynamic_cast<const ProfileRenderBin *>(obj) != nullptr;
+    }
+
+    const char *libraryName() const override
+    {
+        return "opeViewer";
+    }
+
+    const char *className() const override
+    {
+        return "ProfileRenderBin";
+    }
+
+    void drawImplementation(osg::RenderInfo &renderInfo, osgUtil::RenderLeaf *&previous) override
+    {
+        osg::Camera *camera = renderInfo.getCurrentCamera();
+        Renderer *renderer = camera ? dynamic_cast<Renderer *>(camera->getRenderer()) : nullptr;
+        SubgraphProfiler *profiler = renderer ? renderer->getSubgraphProfiler() : nullptr;
+        if (!profiler || !profiler->isSampling())
+        {
+            osgUtil::RenderBin::drawImplementation(renderInfo, previous);
+            return;
+        }
+
+        profiler->beginDraw(getBinNum(), *renderInfo.getState());
+        osgUtil::RenderBin::drawImplementation(renderInfo, previous);
+        profiler->endDraw(getBinNum(), *renderInfo.getState());
+    }
+};
+
+void registerProfileRenderBin()
+{
+    static bool registered = false;
+    if (!registered)
+    {
+        osgUtil::RenderBin::addRenderBinPrototype(PROFILE_RENDER_BIN_NAME, new ProfileRenderBin);
+        registered = true;
+    }
+}
+
+bool isTimerQuerySupported(osg::State &state)
+{
+    const osg::GLExtensions *ext = state.get<osg::GLExtensions>();
+    return ext->isARBTimerQuerySupported && state.getTimestampBits() > 0;
+}
+
+} // namespace
+
+struct SubgraphProfiler::Subgraph : osg::Referenced
+{
+    std::string name;
+    osg::observer_ptr<osg::Node> node;
+    osg::observer_ptr<CullCallback> callback;
+    /// 采样帧中将子图放入专用的渲染箱，子图中有设置了渲染箱的状态时为空，只统计剔除时间
+    osg::ref_ptr<osg::StateSet> stateSet;
+    int binNumber{};
+
+    /// 当前采样帧
+    double frameCullTime{};
+    double frameDrawTime{};
+
+    unsigned int numSamples{};
+    double cullTime{};
+    double drawTime{};
+    double gpuTime{};
+    unsigned int numGPUSamples{};
+    /// 最近一个计入numGPUSamples的帧，同一帧有多个渲染阶段时只计一次
+    unsigned int lastGPUFrameNumber{};
+    bool hasGPUFrame{};
+};
+
+/// 记录遍历子图的时间，采样帧中切换到子图的渲染箱
+struct SubgraphProfiler::CullCallback : osg::NodeCallback
+{
+    osg::observer_ptr<SubgraphProfiler> profiler;
+    osg::ref_ptr<Subgraph> subgraph;
+
+    CullCallback(SubgraphProfiler *profiler, Subgraph *subgraph) : profiler(profiler), subgraph(subgraph)
+    {
+    }
+
+    void operator()(osg::Node *node, osg::NodeVisitor *nv) override
+    {
+        osgUtil::CullVisitor *cv = nv->asCullVisitor();
+        osg::ref_ptr<SubgraphProfiler> profiler;
+        if (!cv || !this->profiler.lock(profiler) || !profiler->isSampling())
+        {
+            traverse(node, nv);
+            return;
+        }
+
+        osg::Timer_t beginTick = osg::Timer::instance()->tick();
+
+        if (subgraph->stateSet)
+        {
+            cv->pushStateSet(profiler->_containerStateSet.get());
+            cv->pushStateSet(subgraph->stateSet.get());
+            traverse(node, nv);
+            cv->popStateSet();
+            cv->popStateSet();
+        }
+        else
+        {
+            traverse(node, nv);
+        }
+
+        subgraph->frameCullTime += osg::Timer::instance()->delta_s(beginTick, osg::Timer::instance()->tick());
+    }
+};
+
+double SubgraphProfiler::Result::getCost() const
+{
+    return cullTime + (numGPUSamples ? gpuTime : drawTime);
+}
+
+SubgraphProfiler::SubgraphProfiler() : _nextBinNumber(FIRST_BIN_NUMBER)
+{
+    registerProfileRenderBin();
+
+    _containerStateSet = new osg::StateSet;
+    _containerStateSet->setRenderBinDetails(CONTAINER_BIN_NUMBER, "RenderBin");
+}
+
+SubgraphProfiler::~SubgraphProfiler()
+{
+    removeAllSubgraphs();
+}
+
+void SubgraphProfiler::setSampleInterval(unsigned int interval)
+{
+    _sampleInterval = std::max(interval, 1u);
+}
+
+unsigned int SubgraphProfiler::getSampleInterval() const
+{
+    return _sampleInterval;
+}
+
+void SubgraphProfiler::addSubgraph(osg::Node *node, const std::string &name)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    for (auto &subgraph : _subgraphs)
+    {
+        if (subgraph->node == node)
+        {
+            return;
+        }
+    }
+
+    osg::ref_ptr<Subgraph> subgraph = new Subgraph;
+    subgraph->name = name.empty() ? node->getName() : name;
+    subgraph->node = node;
+    subgraph->binNumber = _nextBinNumber++;
+
+    RenderBinFinder finder;
+    node->accept(finder);
+    if (finder.found)
+    {
+        OSG_INFO << "SubgraphProfiler::addSubgraph() " << subgraph->name << " uses its own render bins, draw time is not measured" << std::endl;
+    }
+    else
+    {
+        subgraph->stateSet = new osg::StateSet;
+        subgraph->stateSet->setRenderBinDetails(subgraph->binNumber, PROFILE_RENDER_BIN_NAME);
+    }
+
+    osg::ref_ptr<CullCallback> callback = new CullCallback(this, subgraph.get());
+    subgraph->callback = callback.get();
+    node->addCullCallback(callback.get());
+
+    _subgraphs.push_back(subgraph);
+}
+
+void SubgraphProfiler::addTopLevelSubgraphs(osg::Group *root)
+{
+    if (!root)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i)
+    {
+        osg::Node *child = root->getChild(i);
+        addSubgraph(child, child->getName().empty() ? "#" + std::to_string(i) : child->getName());
+    }
+}
+
+void SubgraphProfiler::removeSubgraph(osg::Node *node)
+{
+    for (auto itr = _subgraphs.begin(); itr != _subgraphs.end(); ++itr)
+    {
+        if ((*itr)->node == node)
+        {
+            osg::ref_ptr<CullCallback> callback;
+            if ((*itr)->callback.lock(callback))
+            {
+                node->removeCullCallback(callback.get());
+            }
+            _subgraphs.erase(itr);
+            return;
+        }
+    }
+}
+
+void SubgraphProfiler::removeAllSubgraphs()
+{
+    for (auto &subgraph : _subgraphs)
+    {
+        osg::ref_ptr<osg::Node> node;
+        osg::ref_ptr<CullCallback> callback;
+        if (subgraph->node.lock(node) && subgraph->callback.lock(callback))
+        {
+            node->removeCullCallback(callback.get());
+        }
+    }
+    _subgraphs.clear();
+}
+
+void SubgraphProfiler::reset()
+{
+    for (auto &subgraph : _subgraphs)
+    {
+        subgraph->numSamples = 0;
+        subgraph->cullTime = 0.0;
+        subgraph->drawTime = 0.0;
+        subgraph->gpuTime = 0.0;
+        subgraph->numGPUSamples = 0;
+        subgraph->hasGPUFrame = false;
+    }
+}
+
+std::vector<SubgraphProfiler::Result> SubgraphProfiler::getResults() const
+{
+    std::vector<Result> results;
+    for (auto &subgraph : _subgraphs)
+    {
+        Result result;
+        result.name = subgraph->name;
+        result.numSamples = subgraph->numSamples;
+        result.drawMeasured = subgraph->stateSet.valid();
+        if (subgraph->numSamples)
+        {
+            result.cullTime = subgraph->cullTime / subgraph->numSamples;
+            result.drawTime = subgraph->drawTime / subgraph->numSamples;
+        }
+        result.numGPUSamples = subgraph->numGPUSamples;
+        if (subgraph->numGPUSamples)
+        {
+            result.gpuTime = subgraph->gpuTime / subgraph->numGPUSamples;
+        }
+        results.push_back(result);
+    }
+
+    std::stable_sort(results.begin(), results.end(), [](const Result &lhs, const Result &rhs) { return lhs.getCost() > rhs.getCost(); });
+    return results;
+}
+
+void SubgraphProfiler::report(std::ostream &out) const
+{
+    out << "Subgraph profile (ms per sampled frame)" << std::endl;
+    out << std::left << std::setw(32) << "Subgraph" << std::right << std::setw(10) << "Cull" << std::setw(10) << "Draw" << std::setw(10) << "GPU" << std::setw(10) << "Samples" << std::endl;
+
+    out << std::fixed << std::setprecision(3);
+    for (const Result &result : getResults())
+    {
+        out << std::left << std::setw(32) << result.name << std::right << std::setw(10) << result.cullTime * 1000.0;
+        if (result.drawMeasured)
+        {
+            out << std::setw(10) << result.drawTime * 1000.0;
+        }
+        else
+        {
+            out << std::setw(10) << ".";
+        }
+        if (result.numGPUSamples)
+        {
+            out << std::setw(10) << result.gpuTime * 1000.0;
+        }
+        else
+        {
+            out << std::setw(10) << ".";
+        }
+        out << std::setw(10) << result.numSamples << std::endl;
+    }
+}
+
+void SubgraphProfiler::beginFrame(unsigned int frameNumber)
+{
+    _frameNumber = frameNumber;
+    _sampling = !_subgraphs.empty() && frameNumber % _sampleInterval == 0;
+
+    for (auto &subgraph : _subgraphs)
+    {
+        subgraph->frameCullTime = 0.0;
+        subgraph->frameDrawTime = 0.0;
+    }
+}
+
+void SubgraphProfiler::endFrame(osg::State *state)
+{
+    if (_sampling)
+    {
+        for (auto &subgraph : _subgraphs)
+        {
+            ++subgraph->numSamples;
+            subgraph->cullTime += subgraph->frameCullTime;
+            subgraph->drawTime += subgraph->frameDrawTime;
+        }
+        _sampling = false;
+    }
+
+    if (_pendingQueries.empty() || !state)
+    {
+        return;
+    }
+
+    // 按提交顺序读回，遇到未完成的停止
+    const osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+    size_t numResolved = 0;
+    for (Query &query : _pendingQueries)
+    {
+        GLint available = 0;
+        ext->glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        GLuint64 beginTimestamp = 0;
+        GLuint64 endTimestamp = 0;
+        ext->glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &beginTimestamp);
+        ext->glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &endTimestamp);
+
+        osg::ref_ptr<Subgraph> subgraph;
+        if (query.subgraph.lock(subgraph) && endTimestamp >= beginTimestamp)
+        {
+            subgraph->gpuTime += double(endTimestamp - beginTimestamp) * 1e-9;
+            if (!subgraph->hasGPUFrame || subgraph->lastGPUFrameNumber != query.frameNumber)
+            {
+                ++subgraph->numGPUSamples;
+                subgraph->lastGPUFrameNumber = query.frameNumber;
+                subgraph->hasGPUFrame = true;
+            }
+        }
+
+        query.subgraph = nullptr;
+        _availableQueries.push_back(query);
+        ++numResolved;
+    }
+    _pendingQueries.erase(_pendingQueries.begin(), _pendingQueries.begin() + numResolved);
+}
+
+bool SubgraphProfiler::isSampling() const
+{
+    return _sampling;
+}
+
+void SubgraphProfiler::beginDraw(int binNumber, osg::State &state)
+{
+    Drawing drawing;
+    drawing.subgraph = findSubgraph(binNumber);
+    if (!drawing.subgraph)
+    {
+        return;
+    }
+
+    if (isTimerQuerySupported(state))
+    {
+        const osg::GLExtensions *ext = state.get<osg::GLExtensions>();
+        if (_availableQueries.empty())
+        {
+            Query query;
+            ext->glGenQueries(1, &query.begin);
+            ext->glGenQueries(1, &query.end);
+            _availableQueries.push_back(query);
+        }
+        drawing.query = _availableQueries.back();
+        _availableQueries.pop_back();
+        drawing.query.subgraph = drawing.subgraph;
+        drawing.query.frameNumber = _frameNumber;
+        ext->glQueryCounter(drawing.query.begin, GL_TIMESTAMP);
+    }
+
+    drawing.beginTick = osg::Timer::instance()->tick();
+    _drawingStack.push_back(drawing);
+}
+
+void SubgraphProfiler::endDraw(int binNumber, osg::State &state)
+{
+    if (_drawingStack.empty() || _drawingStack.back().subgraph->binNumber != binNumber)
+    {
+        return;
+    }
+
+    Drawing &drawing = _drawingStack.back();
+    drawing.subgraph->frameDrawTime += osg::Timer::instance()->delta_s(drawing.beginTick, osg::Timer::instance()->tick());
+
+    if (drawing.query.begin)
+    {
+        state.get<osg::GLExtensions>()->glQueryCounter(drawing.query.end, GL_TIMESTAMP);
+        _pendingQueries.push_back(drawing.query);
+    }
+
+    _drawingStack.pop_back();
+}
+
+void SubgraphProfiler::releaseGLObjects(osg::State *state)
+{
+    if (state)
+    {
+        const osg::GLExtensions *ext = state->get<osg::GLExtensions>();
+        for (auto queries : {&_pendingQueries, &_availableQueries})
+        {
+            for (Query &query : *queries)
+            {
+                ext->glDeleteQueries(1, &query.begin);
+                ext->glDeleteQueries(1, &query.end);
+            }
+        }
+    }
+    _pendingQueries.clear();
+    _availableQueries.clear();
+}
+
+SubgraphProfiler::Subgraph *SubgraphProfiler::findSubgraph(int binNumber) const
+{
+    for (auto &subgraph : _subgraphs)
+    {
+        if (subgraph->binNumber == binNumber)
+        {
+            return subgraph.get();
+        }
+    }
+    return nullptr;
+}
+
+} // namespace opeViewer
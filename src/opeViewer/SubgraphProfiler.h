@@ -0,0 +1,134 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_639A2A1AB73B4DCB9FDD9658E7EF2850_H_
+#define INC_2026_10_18_639A2A1AB73B4DCB9FDD9658E7EF2850_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <osg/GLExtensions>
+#include <osg/Group>
+#include <osg/Timer>
+
+namespace opeViewer
+{
+
+/// 子图剖析
+///
+/// 设置到相机的Renderer后，每sampleInterval帧采样一次，把剔除时间、绘制时间和GPU绘制时间分摊到标记的子图上：
+/// - 剔除：标记的节点上加入剔除回调，记录遍历子图的CPU时间
+/// - 绘制：采样帧中子图的内容放入专用的渲染箱（每个子图一个），绘制渲染箱时记录CPU时间，支持ARB_timer_query时在前后写入时间戳，结果几帧后读回
+///
+/// 嵌套的标记子图的时间同时计入外层；采样帧中子图的渲染箱嵌套在原渲染箱中，在其中未标记的内容之后绘制，渲染箱之间的顺序不变；
+/// 子图中有设置了渲染箱的状态（如TRANSPARENT_BIN）时不放入专用的渲染箱，只统计剔除时间
+///
+/// 只能设置到一个Renderer
+class SubgraphProfiler : public osg::Referenced
+{
+  public:
+    /// 平均每个采样帧的时间（秒）
+    struct Result
+    {
+        std::string name;
+        unsigned int numSamples{};
+        double cullTime{};
+        /// drawMeasured为false时无效
+        double drawTime{};
+        /// numGPUSamples为0时无效
+        double gpuTime{};
+        unsigned int numGPUSamples{};
+        /// 子图中有设置了渲染箱的状态时为false
+        bool drawMeasured{};
+
+        /// 排序用：剔除时间加GPU时间（没有GPU时间时用绘制时间）
+        double getCost() const;
+    };
+
+    SubgraphProfiler();
+
+    /// 1表示每帧采样
+    void setSampleInterval(unsigned int interval);
+
+    unsigned int getSampleInterval() const;
+
+    /// 标记子图，name为空时使用节点名，同一节点只标记一次
+    void addSubgraph(osg::Node *node, const std::string &name = "");
+
+    /// 标记root的每个子节点，没有名字的用"#<序号>"
+    void addTopLevelSubgraphs(osg::Group *root);
+
+    void removeSubgraph(osg::Node *node);
+
+    void removeAllSubgraphs();
+
+    /// 清空已采样的结果
+    void reset();
+
+    /// 按getCost从大到小排序
+    std::vector<Result> getResults() const;
+
+    /// 排名报告，时间单位为毫秒
+    void report(std::ostream &out) const;
+
+    /// Renderer在剔除前调用
+    void beginFrame(unsigned int frameNumber);
+
+    /// Renderer在绘制后调用，读回已完成的计时查询
+    void endFrame(osg::State *state);
+
+    /// 当前帧是否采样
+    bool isSampling() const;
+
+    /// 由渲染箱在绘制前后调用
+    void beginDraw(int binNumber, osg::State &state);
+
+    void endDraw(int binNumber, osg::State &state);
+
+    void releaseGLObjects(osg::State *state);
+
+  protected:
+    ~SubgraphProfiler() override;
+
+    struct Subgraph;
+    struct CullCallback;
+
+    struct Query
+    {
+        GLuint begin{};
+        GLuint end{};
+        /// 所属的子图，子图移除后为空
+        osg::observer_ptr<Subgraph> subgraph;
+        unsigned int frameNumber{};
+    };
+
+    Subgraph *findSubgraph(int binNumber) const;
+
+    unsigned int _sampleInterval{10};
+    std::vector<osg::ref_ptr<Subgraph>> _subgraphs;
+    int _nextBinNumber{};
+    /// 采样帧中子图的渲染箱所在的渲染箱
+    osg::ref_ptr<osg::StateSet> _containerStateSet;
+
+    bool _sampling{};
+    unsigned int _frameNumber{};
+
+    /// 绘制中的子图，嵌套的子图的渲染箱在外层的渲染箱中绘制
+    struct Drawing
+    {
+        Subgraph *subgraph{};
+        osg::Timer_t beginTick{};
+        Query query;
+    };
+
+    std::vector<Drawing> _drawingStack;
+
+    std::vector<Query> _pendingQueries;
+    std::vector<Query> _availableQueries;
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_639A2A1AB73B4DCB9FDD9658E7EF2850_H_
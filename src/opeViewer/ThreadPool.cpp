@@ -0,0 +1,163 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace opeViewer
+{
+
+namespace
+{
+
+/// 当前工作线程所属的线程池，非工作线程为空
+thread_local const ThreadPool *currentPool{};
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+    {
+        // 给渲染线程留一个核心
+        unsigned int numCores = std::thread::hardware_concurrency();
+        numThreads = numCores > 1 ? numCores - 1 : 1;
+    }
+
+    _threads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        _threads.emplace_back([this] { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+        _tasks.clear();
+    }
+    _taskCondition.notify_all();
+
+    for (auto &thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+unsigned int ThreadPool::getNumThreads() const
+{
+    return static_cast<unsigned int>(_threads.size());
+}
+
+void ThreadPool::add(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _taskCondition.notify_one();
+}
+
+void ThreadPool::parallelFor(std::size_t count, const RangeTask &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // 在本线程池的工作线程中调用时，辅助任务排在调用者之后，等待它们会死锁
+    if (currentPool == this)
+    {
+        task(0, count);
+        return;
+    }
+
+    // 分块数量多于线程数，避免个别分块耗时较长时其他线程空闲
+    const std::size_t numChunks = std::min<std::size_t>(count, (_threads.size() + 1) * 4);
+    const std::size_t chunkSize = (count + numChunks - 1) / numChunks;
+
+    struct Shared
+    {
+        std::atomic<std::size_t> nextChunk{0};
+        std::size_t numHelpers{};
+        std::size_t numHelpersFinished{};
+        std::mutex mutex;
+        std::condition_variable condition;
+    } shared;
+
+    auto runChunks = [&shared, &task, count, numChunks, chunkSize] {
+        for (std::size_t chunk = shared.nextChunk++; chunk < numChunks; chunk = shared.nextChunk++)
+        {
+            std::size_t begin = chunk * chunkSize;
+            std::size_t end = std::min(count, begin + chunkSize);
+            if (begin < end)
+            {
+                task(begin, end);
+            }
+        }
+    };
+
+    shared.numHelpers = std::min<std::size_t>(_threads.size(), numChunks - 1);
+    for (std::size_t i = 0; i < shared.numHelpers; ++i)
+    {
+        add([&shared, runChunks] {
+            runChunks();
+
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            ++shared.numHelpersFinished;
+            shared.condition.notify_one();
+        });
+    }
+
+    runChunks();
+
+    // 辅助任务引用了栈上的数据，必须等它们全部退出
+    std::unique_lock<std::mutex> lock(shared.mutex);
+    shared.condition.wait(lock, [&shared] { return shared.numHelpersFinished == shared.numHelpers; });
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this] { return _tasks.empty() && _numRunningTasks == 0; });
+}
+
+void ThreadPool::run()
+{
+    currentPool = this;
+
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _taskCondition.wait(lock, [this] { return _quit || !_tasks.empty(); });
+            if (_quit)
+            {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+            ++_numRunningTasks;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_numRunningTasks;
+            if (_tasks.empty() && _numRunningTasks == 0)
+            {
+                _idleCondition.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace opeViewer
@@ -0,0 +1,63 @@
+//
+// Created by chudonghao on 2026/10/18.
+//
+
+#ifndef INC_2026_10_18_6DEC37D47E4641279CF979417139E05D_H_
+#define INC_2026_10_18_6DEC37D47E4641279CF979417139E05D_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <osg/Referenced>
+
+namespace opeViewer
+{
+
+/// 线程池
+///
+/// 用于加载、预处理、求交等可以离开渲染线程执行的工作
+class ThreadPool : public osg::Referenced
+{
+  public:
+    using Task = std::function<void()>;
+
+    using RangeTask = std::function<void(std::size_t begin, std::size_t end)>;
+
+    /// \param numThreads 工作线程数量，0表示根据CPU核心数决定
+    explicit ThreadPool(unsigned int numThreads = 0);
+
+    unsigned int getNumThreads() const;
+
+    /// 添加任务，任务在工作线程中执行
+    void add(Task task);
+
+    /// 将[0, count)分块交给工作线程执行，调用线程也参与执行，返回时全部完成
+    ///
+    /// 在本线程池的工作线程中调用时，在调用线程中直接执行全部范围
+    void parallelFor(std::size_t count, const RangeTask &task);
+
+    /// 等待已添加的任务全部完成
+    void wait();
+
+  protected:
+    ~ThreadPool() override;
+
+    void run();
+
+    std::vector<std::thread> _threads;
+    std::deque<Task> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _taskCondition;
+    std::condition_variable _idleCondition;
+    unsigned int _numRunningTasks{};
+    bool _quit{};
+};
+
+} // namespace opeViewer
+
+#endif // INC_2026_10_18_6DEC37D47E4641279CF979417139E05D_H_
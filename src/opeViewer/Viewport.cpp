@@ -4,21 +4,114 @@
 
 #include "Viewport.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <osgDB/DatabasePager>
 #include <osgDB/ImagePager>
+#include <osgDB/ReadFile>
 #include <osgGA/CameraManipulator>
 #include <osgUtil/Optimizer>
 
 #include "ComputeIntersection.h"
+#include "DepthPicker.h"
+#include "ObjectIdPicker.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "SceneCache.h"
+#include "SceneOptimizer.h"
+#include "Stats.h"
+#include "ThreadPool.h"
 #include "Window.h"
 
 namespace opeViewer
 {
 
+namespace
+{
+
+/// 加载线程池，读取文件主要受限于IO，不占用全部核心
+ThreadPool *getLoadThreadPool()
+{
+    static osg::ref_ptr<ThreadPool> s_threadPool = new ThreadPool(std::max(1u, std::thread::hardware_concurrency() / 2));
+    return s_threadPool.get();
+}
+
+/// 一次loadSceneData的状态，除observer外只在更新遍历中修改
+struct LoadSceneDataState : osg::Referenced
+{
+    osg::observer_ptr<Viewport> viewport;
+    osg::ref_ptr<osg::Group> root;
+    osg::ref_ptr<osg::Node> placeholder;
+    osg::ref_ptr<Viewport::LoadSceneDataCallback> callback;
+    unsigned int numMerged{};
+    unsigned int numRemaining{};
+};
+
+/// 在更新遍历中将加载完成的节点合并到场景
+class MergeLoadedNodeOperation : public osg::Operation
+{
+    osg::ref_ptr<LoadSceneDataState> _state;
+    std::string _file;
+    osg::ref_ptr<osg::Node> _node;
+
+  public:
+    MergeLoadedNodeOperation(LoadSceneDataState *state, const std::string &file, osg::Node *node) : osg::Operation("MergeLoadedNode", false), _state(state), _file(file), _node(node)
+    {
+    }
+
+    void operator()(osg::Object *) override
+    {
+        osg::ref_ptr<Viewport> viewport;
+        _state->viewport.lock(viewport);
+
+        if (_node)
+        {
+            if (_state->placeholder)
+            {
+                _state->root->removeChild(_state->placeholder);
+                _state->placeholder = nullptr;
+            }
+
+            _state->root->addChild(_node);
+
+            if (viewport)
+            {
+                if (auto manipulator = viewport->getCameraManipulator())
+                {
+                    // 重新计算包围球，只在第一次合并时复位相机，避免打断用户操作
+                    manipulator->setNode(_state->root);
+                    if (_state->numMerged == 0)
+                    {
+                        osg::ref_ptr<osgGA::GUIEventAdapter> dummyEvent = new osgGA::GUIEventAdapter;
+                        manipulator->home(*dummyEvent, *viewport);
+                    }
+                }
+                viewport->requestRedraw();
+            }
+
+            ++_state->numMerged;
+        }
+        else
+        {
+            OSG_WARN << "Viewport::loadSceneData() Failed to load " << _file << std::endl;
+        }
+
+        --_state->numRemaining;
+
+        if (viewport && _state->callback)
+        {
+            _state->callback->loadedImplementation(viewport, _file, _node);
+            if (_state->numRemaining == 0)
+            {
+                _state->callback->completedImplementation(viewport, _state->root);
+            }
+        }
+    }
+};
+
+} // namespace
+
 Viewport::Viewport()
 {
     _frameStamp = new osg::FrameStamp;
@@ -28,7 +121,7 @@ Viewport::Viewport()
 
     _scene = new Scene;
 
-    _stats = new osg::Stats("Viewport");
+    _stats = new Stats("Viewport");
 
     // need to attach a Renderer to the master camera which has been default constructed
     _camera->setStats(_stats);
@@ -78,6 +171,10 @@ void Viewport::requestWarpPointer(float x, float y)
 
 bool Viewport::computeIntersections(const osgGA::GUIEventAdapter &ea, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask mask)
 {
+    if (auto window = getWindow())
+    {
+        return window->computeIntersections(ea, intersections, mask);
+    }
     return opeViewer::computeIntersections(ea, intersections, mask);
 }
 
@@ -86,6 +183,78 @@ bool Viewport::computeIntersections(const osgGA::GUIEventAdapter &ea, const osg:
     return opeViewer::computeIntersections(ea, path, intersections, mask);
 }
 
+unsigned int Viewport::computeSelection(const osgGA::GUIEventAdapter &ea0, const osgGA::GUIEventAdapter &ea1, Selection &selection, osg::Node::NodeMask mask)
+{
+    return opeViewer::computeSelection(ea0, ea1, selection, mask);
+}
+
+void Viewport::setObjectIdPicking(bool enabled)
+{
+    if (enabled == _objectIdPicker.valid())
+    {
+        return;
+    }
+
+    // ObjectIdPicker创建时加入从相机，析构时移除
+    _objectIdPicker = enabled ? new ObjectIdPicker(this) : nullptr;
+}
+
+bool Viewport::getObjectIdPicking() const
+{
+    return _objectIdPicker.valid();
+}
+
+ObjectIdPicker *Viewport::getObjectIdPicker() const
+{
+    return _objectIdPicker.get();
+}
+
+void Viewport::setDepthPicking(bool enabled)
+{
+    if (enabled == _depthPicker.valid())
+    {
+        return;
+    }
+
+    // DepthPicker创建时加入到主相机的Renderer，析构时移除
+    _depthPicker = enabled ? new DepthPicker(this) : nullptr;
+}
+
+bool Viewport::getDepthPicking() const
+{
+    return _depthPicker.valid();
+}
+
+DepthPicker *Viewport::getDepthPicker() const
+{
+    return _depthPicker.get();
+}
+
+bool Viewport::computeSurfacePoint(const osgGA::GUIEventAdapter &ea, osg::Vec3d &point, osg::Node::NodeMask mask)
+{
+    if (_depthPicker.valid())
+    {
+        switch (_depthPicker->pick(ea, point))
+        {
+        case DepthPicker::SURFACE:
+            return true;
+        case DepthPicker::BACKGROUND:
+            return false;
+        case DepthPicker::UNAVAILABLE:
+            break;
+        }
+    }
+
+    osgUtil::LineSegmentIntersector::Intersections intersections;
+    if (computeIntersections(ea, intersections, mask))
+    {
+        point = intersections.begin()->getWorldIntersectPoint();
+        return true;
+    }
+
+    return false;
+}
+
 bool Viewport::requiresUpdateSceneGraph() const
 {
     // check if there are camera update callbacks
@@ -197,12 +366,110 @@ void Viewport::setSceneDataImplementation(osg::Node *node)
 
     prepareSceneData();
 
+    if (_scene->getBuildKdTrees())
+    {
+        _scene->buildKdTrees(getSceneData());
+    }
+
     // TODO
     // computeActiveCoordinateSystemNodePath();
 
     assignSceneDataToCameras();
 }
 
+void Viewport::setSceneOptimizer(SceneOptimizer *optimizer)
+{
+    _sceneOptimizer = optimizer;
+}
+
+SceneOptimizer *Viewport::getSceneOptimizer()
+{
+    return _sceneOptimizer.get();
+}
+
+const SceneOptimizer *Viewport::getSceneOptimizer() const
+{
+    return _sceneOptimizer.get();
+}
+
+void Viewport::setSceneCache(SceneCache *cache)
+{
+    _sceneCache = cache;
+}
+
+SceneCache *Viewport::getSceneCache()
+{
+    return _sceneCache.get();
+}
+
+const SceneCache *Viewport::getSceneCache() const
+{
+    return _sceneCache.get();
+}
+
+osg::Group *Viewport::loadSceneData(const std::vector<std::string> &files, const osgDB::Options *options, LoadSceneDataCallback *callback, osg::Node *placeholder)
+{
+    osg::ref_ptr<LoadSceneDataState> state = new LoadSceneDataState;
+    state->viewport = this;
+    state->root = new osg::Group;
+    state->placeholder = placeholder;
+    state->callback = callback;
+    state->numRemaining = static_cast<unsigned int>(files.size());
+
+    if (placeholder)
+    {
+        state->root->addChild(placeholder);
+    }
+
+    setSceneData(state->root);
+
+    if (files.empty())
+    {
+        if (callback)
+        {
+            callback->completedImplementation(this, state->root);
+        }
+        return state->root;
+    }
+
+    osg::observer_ptr<Scene> scene = _scene.get();
+    osg::ref_ptr<const osgDB::Options> readOptions = options;
+    osg::ref_ptr<SceneOptimizer> optimizer = _sceneOptimizer;
+    osg::ref_ptr<SceneCache> cache = _sceneCache;
+    bool threadSafeRefUnref = _window && _window->getThreadingModel() != Window::SingleThreaded;
+
+    for (auto &file : files)
+    {
+        getLoadThreadPool()->add([state, scene, readOptions, optimizer, cache, threadSafeRefUnref, file] {
+            // 场景已经销毁，不再需要加载；加载期间不持有场景，窗口释放场景后可以立即销毁
+            if (!scene.valid())
+            {
+                return;
+            }
+
+            osg::ref_ptr<osg::Node> node = cache ? cache->readNodeFile(file, readOptions.get()) : osgDB::readRefNodeFile(file, readOptions.get());
+            if (node)
+            {
+                prepareSceneData(node, threadSafeRefUnref, optimizer);
+
+                osg::ref_ptr<Scene> lockedScene;
+                if (scene.lock(lockedScene) && lockedScene->getBuildKdTrees())
+                {
+                    lockedScene->buildKdTrees(node);
+                }
+            }
+
+            osg::ref_ptr<Scene> lockedScene;
+            if (scene.lock(lockedScene))
+            {
+                lockedScene->addUpdateOperation(new MergeLoadedNodeOperation(state, file, node));
+            }
+        });
+    }
+
+    return state->root;
+}
+
 void Viewport::setDisplaySettings(osg::DisplaySettings *ds)
 {
     _displaySettings = ds;
@@ -343,6 +610,11 @@ void Viewport::initImplementation(int width, int height)
         _camera->setRenderer(createRenderer(getCamera()));
     }
 
+    if (_depthPicker.valid())
+    {
+        _depthPicker->attach();
+    }
+
     // 和Viewport使用相同的Stats
     if (!_camera->getStats())
     {
@@ -470,27 +742,39 @@ void Viewport::resizedImplementation(int oldWidth, int oldHeight, int width, int
 
 void Viewport::prepareSceneData()
 {
-    if (getSceneData())
+    // 优化只在loadSceneData的工作线程中执行，不阻塞调用setSceneData的线程
+    prepareSceneData(getSceneData(), _window && _window->getThreadingModel() != Window::SingleThreaded);
+}
+
+void Viewport::prepareSceneData(osg::Node *node, bool threadSafeRefUnref, SceneOptimizer *optimizer)
+{
+    if (node)
     {
 #if defined(OSG_GLES2_AVAILABLE)
         osgUtil::ShaderGenVisitor sgv;
-        getSceneData()->getOrCreateStateSet();
-        getSceneData()->accept(sgv);
+        node->getOrCreateStateSet();
+        node->accept(sgv);
 #endif
 
         // now make sure the scene graph is set up with the correct DataVariance to protect the dynamic elements of
         // the scene graph from being run in parallel.
         osgUtil::Optimizer::StaticObjectDetectionVisitor sodv;
-        getSceneData()->accept(sodv);
+        node->accept(sodv);
+
+        // 优化会创建新的对象，需要在设置线程安全的引用计数之前执行
+        if (optimizer)
+        {
+            optimizer->optimize(node);
+        }
 
         // make sure that existing scene graph objects are allocated with thread safe ref/unref
-        if (_window && _window->getThreadingModel() != Window::SingleThreaded)
+        if (threadSafeRefUnref)
         {
-            getSceneData()->setThreadSafeRefUnref(true);
+            node->setThreadSafeRefUnref(true);
         }
 
         // update the scene graph so that it has enough GL object buffer memory for the graphics contexts that will be using it.
-        getSceneData()->resizeGLObjectBuffers(osg::DisplaySettings::instance()->getMaxNumberOfGraphicsContexts());
+        node->resizeGLObjectBuffers(osg::DisplaySettings::instance()->getMaxNumberOfGraphicsContexts());
     }
 }
 
@@ -5,6 +5,9 @@
 #ifndef INC_2023_12_18_D5047186FF2E481CA338576FCA276A91_H_
 #define INC_2023_12_18_D5047186FF2E481CA338576FCA276A91_H_
 
+#include <string>
+#include <vector>
+
 #include <osg/View>
 #include <osgGA/GUIActionAdapter>
 #include <osgUtil/SceneView>
@@ -13,6 +16,7 @@ namespace osgDB
 {
 class DatabasePager;
 class ImagePager;
+class Options;
 } // namespace osgDB
 
 namespace osgGA
@@ -23,8 +27,13 @@ class CameraManipulator;
 namespace opeViewer
 {
 
+class DepthPicker;
+class ObjectIdPicker;
 class Scene;
+class SceneCache;
+class SceneOptimizer;
 class Window;
+struct Selection;
 
 /// 视口
 class Viewport : public osg::View, public osgGA::GUIActionAdapter
@@ -45,12 +54,28 @@ class Viewport : public osg::View, public osgGA::GUIActionAdapter
         virtual void setSceneDataImplementation(Viewport *viewport, osg::Node *node) = 0;
     };
 
+    /// 异步加载回调，均在更新遍历中调用
+    struct LoadSceneDataCallback : public osg::Referenced
+    {
+        /// 单个文件加载完成并已合并到场景中，加载失败时node为空
+        virtual void loadedImplementation(Viewport *viewport, const std::string &file, osg::Node *node)
+        {
+        }
+
+        /// 全部文件处理完成
+        virtual void completedImplementation(Viewport *viewport, osg::Group *root) = 0;
+    };
+
     using EventHandlers = std::list<osg::ref_ptr<osgGA::EventHandler>>;
 
   protected:
     Window *_window{};
 
     osg::ref_ptr<Scene> _scene;
+    osg::ref_ptr<SceneOptimizer> _sceneOptimizer;
+    osg::ref_ptr<SceneCache> _sceneCache;
+    osg::ref_ptr<ObjectIdPicker> _objectIdPicker;
+    osg::ref_ptr<DepthPicker> _depthPicker;
 
     EventHandlers _eventHandlers;
     osg::ref_ptr<osgGA::CameraManipulator> _cameraManipulator;
@@ -82,6 +107,28 @@ class Viewport : public osg::View, public osgGA::GUIActionAdapter
 
     bool computeIntersections(const osgGA::GUIEventAdapter &ea, const osg::NodePath &path, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask mask) override;
 
+    /// 框选两个事件的鼠标位置之间的矩形，用于橡皮筋选择，见opeViewer::computeSelection
+    unsigned int computeSelection(const osgGA::GUIEventAdapter &ea0, const osgGA::GUIEventAdapter &ea1, Selection &selection, osg::Node::NodeMask mask);
+
+    /// 开启后每帧在鼠标周围绘制对象ID，悬停拾取通过getObjectIdPicker()->pick查表，见ObjectIdPicker，默认关闭
+    void setObjectIdPicking(bool enabled);
+
+    bool getObjectIdPicking() const;
+
+    ObjectIdPicker *getObjectIdPicker() const;
+
+    /// 开启后每帧读回鼠标周围的深度，computeSurfacePoint优先使用上一帧的深度，见DepthPicker，默认关闭
+    void setDepthPicking(bool enabled);
+
+    bool getDepthPicking() const;
+
+    DepthPicker *getDepthPicker() const;
+
+    /// 鼠标下的表面点（世界坐标），用于以鼠标为中心缩放、旋转
+    ///
+    /// 开启深度拾取并且有该位置的深度时直接反投影（不考虑mask），否则使用computeIntersections，见opeViewer::computeSurfacePoint
+    bool computeSurfacePoint(const osgGA::GUIEventAdapter &ea, osg::Vec3d &point, osg::Node::NodeMask mask);
+
     virtual bool requiresUpdateSceneGraph() const;
 
     virtual bool requiresRedraw() const;
@@ -90,6 +137,7 @@ class Viewport : public osg::View, public osgGA::GUIActionAdapter
 
     Scene *getScene() const;
 
+    /// 在调用线程中预处理场景数据，不使用SceneOptimizer；Scene开启构建KdTree时同样在调用线程中构建，大场景使用loadSceneData
     void setSceneData(osg::Node *node);
 
     osg::Node *getSceneData();
@@ -104,6 +152,27 @@ class Viewport : public osg::View, public osgGA::GUIActionAdapter
 
     virtual void setSceneDataImplementation(osg::Node *node);
 
+    /// 设置后loadSceneData在工作线程中优化读入的场景数据，setSceneData不优化，默认不优化
+    void setSceneOptimizer(SceneOptimizer *optimizer);
+
+    SceneOptimizer *getSceneOptimizer();
+
+    const SceneOptimizer *getSceneOptimizer() const;
+
+    /// 设置后loadSceneData通过缓存读取文件，默认不使用缓存
+    void setSceneCache(SceneCache *cache);
+
+    SceneCache *getSceneCache();
+
+    const SceneCache *getSceneCache() const;
+
+    /// 异步加载场景
+    ///
+    /// 立即将返回的根节点设置为场景数据，文件在工作线程中读取并预处理，完成后通过Scene::addUpdateOperation逐个合并到根节点下
+    ///
+    /// \param placeholder 加载期间显示的占位节点，第一个文件合并时移除
+    osg::Group *loadSceneData(const std::vector<std::string> &files, const osgDB::Options *options = nullptr, LoadSceneDataCallback *callback = nullptr, osg::Node *placeholder = nullptr);
+
     void setDisplaySettings(osg::DisplaySettings *ds);
 
     osg::DisplaySettings *getDisplaySettings();
@@ -157,6 +226,9 @@ class Viewport : public osg::View, public osgGA::GUIActionAdapter
 
     void prepareSceneData();
 
+    /// 在节点加入场景前进行预处理，不访问Viewport，可以在工作线程中调用
+    static void prepareSceneData(osg::Node *node, bool threadSafeRefUnref, SceneOptimizer *optimizer = nullptr);
+
     void assignSceneDataToCameras();
 };
 
@@ -4,6 +4,8 @@
 
 #include "Window.h"
 
+#include <osg/BufferObject>
+#include <osg/ContextData>
 #include <osg/FrameStamp>
 #include <osg/Stats>
 #include <osg/TextureCubeMap>
@@ -17,9 +19,20 @@
 #include <osgUtil/Statistics>
 #include <osgUtil/UpdateVisitor>
 
+#include "AllocationCounters.h"
+#include "AsyncPicker.h"
 #include "ComputeIntersection.h"
+#include "DepthPicker.h"
+#include "GLDebugGroups.h"
 #include "GraphicsWindow.h"
+#include "HitchDetector.h"
+#include "Instrumentation.h"
+#include "ObjectIdPicker.h"
+#include "PerfCounters.h"
+#include "Renderer.h"
 #include "Scene.h"
+#include "Stats.h"
+#include "StatsExporter.h"
 #include "Viewport.h"
 
 namespace opeViewer
@@ -276,11 +289,15 @@ Window::Window(GraphicsWindow *graphicsContext) : _graphicsContext(graphicsConte
 
     _accumulateEventState = new osgGA::GUIEventAdapter;
 
-    _stats = new osg::Stats("Window");
+    _stats = new Stats("Window");
+
+    _asyncPicker = new AsyncPicker;
 }
 
 Window::~Window()
 {
+    _asyncPicker->wait();
+
     if (!_graphicsContext)
     {
         return;
@@ -325,6 +342,10 @@ void Window::requestWarpPointer(float x, float y)
 
 bool Window::computeIntersections(const osgGA::GUIEventAdapter &ea, osgUtil::LineSegmentIntersector::Intersections &intersections, osg::Node::NodeMask mask)
 {
+    if (_pickCache)
+    {
+        return _pickCache->computeIntersections(ea, intersections, mask);
+    }
     return opeViewer::computeIntersections(ea, intersections, mask);
 }
 
@@ -586,12 +607,172 @@ void Window::removeUpdateOperation(osg::Operation *operation)
     }
 }
 
+AsyncPicker *Window::getAsyncPicker() const
+{
+    return _asyncPicker.get();
+}
+
+void Window::setUsePickCache(bool use)
+{
+    if (use && !_pickCache)
+    {
+        _pickCache = new PickCache;
+        _lastPickCacheHits = 0;
+        _lastPickCacheMisses = 0;
+    }
+    else if (!use)
+    {
+        _pickCache = nullptr;
+    }
+}
+
+bool Window::getUsePickCache() const
+{
+    return _pickCache.valid();
+}
+
+PickCache *Window::getPickCache() const
+{
+    return _pickCache.get();
+}
+
+void Window::setCollectFrameTimeHistograms(bool collect)
+{
+    if (collect && !_collectFrameTimeHistograms)
+    {
+        resetFrameTimeHistograms();
+    }
+    _collectFrameTimeHistograms = collect;
+}
+
+bool Window::getCollectFrameTimeHistograms() const
+{
+    return _collectFrameTimeHistograms;
+}
+
+void Window::setFrameTimeHistogramsInterval(double interval)
+{
+    _frameTimeHistogramsInterval = interval;
+}
+
+double Window::getFrameTimeHistogramsInterval() const
+{
+    return _frameTimeHistogramsInterval;
+}
+
+const FrameTimeHistograms &Window::getFrameTimeHistograms() const
+{
+    return _frameTimeHistograms;
+}
+
+const FrameTimeHistograms *Window::getFrameTimeHistograms(const osg::Camera *camera) const
+{
+    const Renderer *renderer = camera ? dynamic_cast<const Renderer *>(camera->getRenderer()) : nullptr;
+    return renderer ? &renderer->getFrameTimeHistograms() : nullptr;
+}
+
+void Window::resetFrameTimeHistograms()
+{
+    _frameTimeHistograms.reset();
+    _frameTimeHistogramsResetTime = elapsedTime();
+
+    auto resetCamera = [](osg::Camera *camera) {
+        Renderer *renderer = camera ? dynamic_cast<Renderer *>(camera->getRenderer()) : nullptr;
+        if (renderer)
+        {
+            renderer->getFrameTimeHistograms().reset();
+        }
+    };
+
+    for (auto &viewport : _viewports)
+    {
+        resetCamera(viewport->getCamera());
+        for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+        {
+            resetCamera(viewport->getSlave(i)._camera.get());
+        }
+    }
+}
+
+double Window::getFrameTimeTaken() const
+{
+    return _frameTimeTaken;
+}
+
+void Window::setHitchDetector(HitchDetector *hitchDetector)
+{
+    if (_hitchDetector == hitchDetector)
+    {
+        return;
+    }
+
+    if (_hitchDetector)
+    {
+        _hitchDetector->detach(this);
+    }
+    _hitchDetector = hitchDetector;
+    if (_hitchDetector)
+    {
+        _hitchDetector->attach(this);
+    }
+}
+
+HitchDetector *Window::getHitchDetector() const
+{
+    return _hitchDetector.get();
+}
+
+void Window::setStatsExporter(StatsExporter *statsExporter)
+{
+    if (_statsExporter == statsExporter)
+    {
+        return;
+    }
+
+    if (_statsExporter)
+    {
+        _statsExporter->detach(this);
+    }
+    _statsExporter = statsExporter;
+    if (_statsExporter)
+    {
+        _statsExporter->attach(this);
+    }
+}
+
+StatsExporter *Window::getStatsExporter() const
+{
+    return _statsExporter.get();
+}
+
+void Window::setEmitGLDebugGroups(bool emit)
+{
+    _emitGLDebugGroups = emit;
+}
+
+bool Window::getEmitGLDebugGroups() const
+{
+    return _emitGLDebugGroups;
+}
+
+unsigned int Window::getNumPendingUpdateOperations() const
+{
+    return _updateOperations.valid() ? _updateOperations->getNumOperationsInQueue() : 0;
+}
+
 bool Window::event(osgGA::GUIEventAdapter &ea)
 {
     // 更新参考时间
     _frameStamp->setReferenceTime(elapsedTime());
 
-    double beginEvent = elapsedTime();
+    bool instrumented = OPEVIEWER_INSTRUMENTED(BASIC);
+    double beginEvent = instrumented ? _frameStamp->getReferenceTime() : 0.0;
+
+    PerfCounters::Sample beginEventPerf;
+    bool collectPerf = OPEVIEWER_COLLECT_STATS(_stats, FULL, PERF) && PerfCounters::getThreadInstance()->read(beginEventPerf);
+
+    bool countAllocations = AllocationCounters::isAvailable() && OPEVIEWER_COLLECT_STATS(_stats, FULL, ALLOCATIONS);
+    AllocationCounters beginEventAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
 
     bool focusMode = false;
     bool updateFocus = false;
@@ -648,6 +829,24 @@ bool Window::event(osgGA::GUIEventAdapter &ea)
         }
     }
 
+    // 对象ID缓冲和深度读回跟随鼠标，事件处理器中可以直接用上一帧的结果拾取，对象ID缓冲离开已读回的区域时重绘
+    if (ea.getEventType() & (osgGA::GUIEventAdapter::PUSH | osgGA::GUIEventAdapter::RELEASE | osgGA::GUIEventAdapter::DOUBLECLICK | osgGA::GUIEventAdapter::MOVE | osgGA::GUIEventAdapter::DRAG | osgGA::GUIEventAdapter::SCROLL))
+    {
+        for (auto &viewport : _viewports)
+        {
+            ObjectIdPicker *objectIdPicker = viewport->getObjectIdPicker();
+            if (objectIdPicker && objectIdPicker->setPointer(ea))
+            {
+                viewport->requestRedraw();
+            }
+
+            if (DepthPicker *depthPicker = viewport->getDepthPicker())
+            {
+                depthPicker->setPointer(ea);
+            }
+        }
+    }
+
     // 更新事件处理器
     _eventVisitor->setFrameStamp(getFrameStamp());
     _eventVisitor->setTraversalNumber(getFrameStamp()->getFrameNumber());
@@ -745,9 +944,33 @@ bool Window::event(osgGA::GUIEventAdapter &ea)
         }
     }
 
+    // 结束的计数在记录统计之前读取，不包含统计自身
+    AllocationCounters endEventAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
+    PerfCounters::Sample endEventPerf;
+    collectPerf = collectPerf && PerfCounters::getThreadInstance()->read(endEventPerf);
+
+    if (!instrumented)
+    {
+        return false;
+    }
+
     double endEvent = elapsedTime();
 
-    if (_stats && _stats->collectStats("event"))
+    _eventTimeTaken += endEvent - beginEvent;
+
+    // 累加本帧各事件的计数
+    if (collectPerf)
+    {
+        static const PerfCounters::AttributeNames names("Event");
+        PerfCounters::setAttributes(_stats, _frameStamp->getFrameNumber(), names, beginEventPerf, endEventPerf, true);
+    }
+    if (countAllocations)
+    {
+        static const AllocationCounters::AttributeNames names("Event");
+        AllocationCounters::setAttributes(_stats, _frameStamp->getFrameNumber(), names, beginEventAllocations, endEventAllocations, true);
+    }
+
+    if (OPEVIEWER_COLLECT_STATS(_stats, BASIC, EVENT))
     {
         double beginEventTraversal = beginEvent;
         double endEventTraversal = endEvent;
@@ -787,6 +1010,25 @@ bool Window::checkNeedToDoFrame()
         return true;
     }
 
+    // 需要一帧派发求交，一帧回调结果
+    if (_asyncPicker->hasPendingPicks())
+    {
+        return true;
+    }
+
+    for (auto viewport : _viewports)
+    {
+        // 需要一帧读取对象ID缓冲和深度的读回
+        if (viewport->getObjectIdPicker() && viewport->getObjectIdPicker()->hasPendingReadbacks())
+        {
+            return true;
+        }
+        if (viewport->getDepthPicker() && viewport->getDepthPicker()->hasPendingReadbacks())
+        {
+            return true;
+        }
+    }
+
     if (!_viewportsRequestContinuousUpdate.empty())
     {
         return true;
@@ -829,7 +1071,12 @@ void Window::requestWarpPointer(Viewport *viewport, float x, float y)
 void Window::statsImplementation()
 {
     auto stats = getStats();
-    if (!stats || !stats->collectStats("scene"))
+    if (OPEVIEWER_COLLECT_STATS(stats, FULL, MEMORY))
+    {
+        glMemoryStats();
+    }
+
+    if (!OPEVIEWER_COLLECT_STATS(stats, FULL, SCENE))
     {
         return;
     }
@@ -909,12 +1156,35 @@ void Window::init()
 
 void Window::frame()
 {
+    double beginFrame = elapsedTime();
+
     // 更新参考时间
-    _frameStamp->setReferenceTime(elapsedTime());
+    _frameStamp->setReferenceTime(beginFrame);
+
+    // 渲染遍历在本线程中进行，此时清空相机的直方图是安全的
+    if (_collectFrameTimeHistograms && _frameTimeHistogramsInterval > 0.0 && beginFrame - _frameTimeHistogramsResetTime >= _frameTimeHistogramsInterval)
+    {
+        resetFrameTimeHistograms();
+    }
 
     // 更新和绘制
     updateTraversal();
     renderingTraversals();
+
+    if (!OPEVIEWER_INSTRUMENTED(BASIC))
+    {
+        _eventTimeTaken = 0.0;
+        return;
+    }
+
+    _frameTimeTaken = elapsedTime() - beginFrame;
+
+    if (_collectFrameTimeHistograms)
+    {
+        _frameTimeHistograms[FrameTimeHistograms::EVENT].record(_eventTimeTaken);
+        _frameTimeHistograms[FrameTimeHistograms::FRAME].record(_frameTimeTaken);
+    }
+    _eventTimeTaken = 0.0;
 }
 
 void Window::updateSimulationTime(double simulationTime)
@@ -931,7 +1201,7 @@ void Window::updateSimulationTime(double simulationTime)
 
 void Window::advance()
 {
-    if (_stats && _stats->collectStats("frame_rate"))
+    if (OPEVIEWER_COLLECT_STATS(_stats, BASIC, FRAME_RATE))
     {
         double beginFrame{};
         // 获取上一帧的开始时间
@@ -949,12 +1219,47 @@ void Window::advance()
         _stats->setAttribute(_frameStamp->getFrameNumber() + 1, "Reference time", endFrame);
     }
 
+    if (_hitchDetector && OPEVIEWER_INSTRUMENTED(BASIC))
+    {
+        _hitchDetector->check(this);
+    }
+
+    if (_statsExporter && OPEVIEWER_INSTRUMENTED(BASIC))
+    {
+        _statsExporter->sample(this);
+    }
+
     _frameStamp->setFrameNumber(_frameStamp->getFrameNumber() + 1);
 }
 
 void Window::updateTraversal()
 {
-    double beginUpdateTraversal = elapsedTime();
+    bool instrumented = OPEVIEWER_INSTRUMENTED(BASIC);
+    double beginUpdateTraversal = instrumented ? elapsedTime() : 0.0;
+
+    PerfCounters::Sample beginUpdatePerf;
+    bool collectPerf = OPEVIEWER_COLLECT_STATS(_stats, FULL, PERF) && PerfCounters::getThreadInstance()->read(beginUpdatePerf);
+
+    bool countAllocations = AllocationCounters::isAvailable() && OPEVIEWER_COLLECT_STATS(_stats, FULL, ALLOCATIONS);
+    AllocationCounters beginUpdateAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
+
+    // 回调已经完成的求交，不等待；回调中可以修改场景
+    _asyncPicker->deliver(_stats.get(), _frameStamp->getFrameNumber());
+
+    if (_pickCache && OPEVIEWER_COLLECT_STATS(_stats, FULL, EVENT))
+    {
+        AllocationCounters::ExcludeScope excludeAllocations;
+
+        // 记录本帧的次数，不记录累计值
+        unsigned int numHits = _pickCache->getNumHits() - _lastPickCacheHits;
+        unsigned int numMisses = _pickCache->getNumMisses() - _lastPickCacheMisses;
+        _lastPickCacheHits = _pickCache->getNumHits();
+        _lastPickCacheMisses = _pickCache->getNumMisses();
+
+        _stats->setAttribute(_frameStamp->getFrameNumber(), "Pick cache hits", static_cast<double>(numHits));
+        _stats->setAttribute(_frameStamp->getFrameNumber(), "Pick cache misses", static_cast<double>(numMisses));
+        _stats->setAttribute(_frameStamp->getFrameNumber(), "Pick cache hit rate", numHits + numMisses > 0 ? static_cast<double>(numHits) / (numHits + numMisses) : 0.0);
+    }
 
     _updateVisitor->reset();
     _updateVisitor->setFrameStamp(getFrameStamp());
@@ -1029,9 +1334,36 @@ void Window::updateTraversal()
         viewport->updateSlaves();
     }
 
-    if (_stats && _stats->collectStats("update"))
+    // 结束的计数在记录统计之前读取，不包含统计自身
+    AllocationCounters endUpdateAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
+    PerfCounters::Sample endUpdatePerf;
+    collectPerf = collectPerf && PerfCounters::getThreadInstance()->read(endUpdatePerf);
+
+    if (!instrumented)
+    {
+        return;
+    }
+
+    double endUpdateTraversal = elapsedTime();
+
+    if (collectPerf)
+    {
+        static const PerfCounters::AttributeNames names("Update");
+        PerfCounters::setAttributes(_stats, _frameStamp->getFrameNumber(), names, beginUpdatePerf, endUpdatePerf);
+    }
+    if (countAllocations)
+    {
+        static const AllocationCounters::AttributeNames names("Update");
+        AllocationCounters::setAttributes(_stats, _frameStamp->getFrameNumber(), names, beginUpdateAllocations, endUpdateAllocations);
+    }
+
+    if (_collectFrameTimeHistograms)
+    {
+        _frameTimeHistograms[FrameTimeHistograms::UPDATE].record(endUpdateTraversal - beginUpdateTraversal);
+    }
+
+    if (OPEVIEWER_COLLECT_STATS(_stats, BASIC, UPDATE))
     {
-        double endUpdateTraversal = elapsedTime();
 
         // update current frames stats
         _stats->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
@@ -1042,7 +1374,12 @@ void Window::updateTraversal()
 
 void Window::renderingTraversals()
 {
-    double beginRenderingTraversals = elapsedTime();
+    bool instrumented = OPEVIEWER_INSTRUMENTED(BASIC);
+    double beginRenderingTraversals = instrumented ? elapsedTime() : 0.0;
+
+    // 包含各相机的剔除和绘制，它们另外写入"Cull allocations"等相机统计；Renderer的统计记录不计数
+    bool countAllocations = AllocationCounters::isAvailable() && OPEVIEWER_COLLECT_STATS(_stats, FULL, ALLOCATIONS);
+    AllocationCounters beginRenderingAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
 
     auto scenes = getScenes();
     for (auto scene : scenes)
@@ -1067,6 +1404,9 @@ void Window::renderingTraversals()
         }
     }
 
+    // 更新遍历已经结束，在此建立快照，求交与渲染并行
+    _asyncPicker->dispatch();
+
     _graphicsContext->makeCurrent();
     viewportsRenderingTraversals();
     _graphicsContext->runOperations();
@@ -1088,10 +1428,13 @@ void Window::renderingTraversals()
         }
     }
 
-    if (_stats && _stats->collectStats("update"))
+    // 结束的计数在记录统计之前读取，不包含统计自身
+    AllocationCounters endRenderingAllocations = countAllocations ? AllocationCounters::getThreadCounters() : AllocationCounters();
+    double endRenderingTraversals = instrumented ? elapsedTime() : 0.0;
+
+    if (OPEVIEWER_COLLECT_STATS(_stats, BASIC, UPDATE))
     {
         auto frameNumber = _frameStamp->getFrameNumber();
-        double endRenderingTraversals = elapsedTime();
 
         // update current frames stats
         _stats->setAttribute(frameNumber, "Rendering traversals begin time ", beginRenderingTraversals);
@@ -1099,6 +1442,12 @@ void Window::renderingTraversals()
         _stats->setAttribute(frameNumber, "Rendering traversals time taken", endRenderingTraversals - beginRenderingTraversals);
     }
 
+    if (countAllocations)
+    {
+        static const AllocationCounters::AttributeNames names("Rendering");
+        AllocationCounters::setAttributes(_stats, _frameStamp->getFrameNumber(), names, beginRenderingAllocations, endRenderingAllocations);
+    }
+
     if (_stats)
     {
         stats();
@@ -1116,9 +1465,20 @@ void Window::viewportsRenderingTraversals()
     std::transform(_viewports.begin(), _viewports.end(), mainCameras.begin(), [](Viewport *viewport) { return viewport->getCamera(); });
     std::sort(mainCameras.begin(), mainCameras.end(), osg::CameraRenderOrderSortOp());
 
+    GLDebugGroups *debugGroups = _emitGLDebugGroups && OPEVIEWER_INSTRUMENTED(FULL) ? _graphicsContext->getState()->get<GLDebugGroups>() : nullptr;
+    if (debugGroups)
+    {
+        debugGroups->push(getName().empty() ? std::string("Window") : "Window " + getName());
+    }
+
     for (auto mainCamera : mainCameras)
     {
         auto view = mainCamera->getView();
+        if (debugGroups)
+        {
+            debugGroups->push(view->getName().empty() ? std::string("Viewport") : "Viewport " + view->getName());
+        }
+
         if (view->getNumSlaves())
         {
             std::vector<osg::Camera *> cameras(view->getNumSlaves() + 1);
@@ -1144,6 +1504,78 @@ void Window::viewportsRenderingTraversals()
                 (*mainCamera->getRenderer())(_graphicsContext);
             }
         }
+
+        if (debugGroups)
+        {
+            debugGroups->pop();
+        }
+    }
+
+    if (debugGroups)
+    {
+        debugGroups->pop();
+    }
+}
+
+void Window::glMemoryStats()
+{
+    auto frameNumber = getFrameStamp()->getFrameNumber();
+    unsigned int contextID = _graphicsContext->getState()->getContextID();
+
+    osg::Timer_t tick = osg::Timer::instance()->tick();
+    if (_glMemoryStatistics.empty() || osg::Timer::instance()->delta_s(_tickLastGLMemoryStats, tick) >= 1.0)
+    {
+        _tickLastGLMemoryStats = tick;
+        _glMemoryStatistics.clear();
+
+        GLMemoryVisitor total(contextID);
+        GLMemoryVisitor visitor(contextID);
+
+        for (auto scene : getScenes())
+        {
+            visitor.reset();
+            if (osg::Node *sceneData = scene->getSceneData())
+            {
+                sceneData->accept(visitor);
+                sceneData->accept(total);
+            }
+            _glMemoryStatistics.emplace_back(scene->getStats(), visitor.getStatistics());
+        }
+
+        for (auto &viewport : _viewports)
+        {
+            const osg::Node *sceneData = viewport->getSceneData();
+
+            visitor.reset();
+            visitor.applyCamera(*viewport->getCamera(), sceneData);
+            total.applyCamera(*viewport->getCamera(), sceneData);
+            for (unsigned int i = 0; i < viewport->getNumSlaves(); ++i)
+            {
+                osg::View::Slave &slave = viewport->getSlave(i);
+                visitor.applyCamera(*slave._camera, slave._useMastersSceneData ? sceneData : nullptr);
+                total.applyCamera(*slave._camera, slave._useMastersSceneData ? sceneData : nullptr);
+            }
+            _glMemoryStatistics.emplace_back(viewport->getStats(), visitor.getStatistics());
+        }
+
+        _glMemoryStatistics.emplace_back(_stats, total.getStatistics());
+    }
+
+    for (auto &statistics : _glMemoryStatistics)
+    {
+        if (statistics.first)
+        {
+            statistics.second.setAttributes(statistics.first.get(), frameNumber);
+        }
+    }
+
+    if (auto textureObjectManager = osg::get<osg::TextureObjectManager>(contextID))
+    {
+        _stats->setAttribute(frameNumber, "GL texture pool memory", static_cast<double>(textureObjectManager->getCurrTexturePoolSize()));
+    }
+    if (auto bufferObjectManager = osg::get<osg::GLBufferObjectManager>(contextID))
+    {
+        _stats->setAttribute(frameNumber, "GL buffer object pool memory", static_cast<double>(bufferObjectManager->getCurrGLBufferObjectPoolSize()));
     }
 }
 
@@ -1153,7 +1585,7 @@ void Window::stats()
     {
         _statsCallback->statsImplementation(this);
     }
-    else
+    else if (OPEVIEWER_INSTRUMENTED(FULL))
     {
         statsImplementation();
     }
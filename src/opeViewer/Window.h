@@ -16,8 +16,12 @@
 #include <osg/ref_ptr>
 #include <osgGA/GUIActionAdapter>
 
+#include "GLMemoryVisitor.h"
+#include "Histogram.h"
+
 namespace osg
 {
+class Camera;
 class FrameStamp;
 class GraphicsContext;
 class Operation;
@@ -41,9 +45,14 @@ class IncrementalCompileOperation;
 namespace opeViewer
 {
 
+class AsyncPicker;
 class GraphicsWindow;
+class HitchDetector;
+class PickCache;
 class Viewport;
 class Scene;
+class Stats;
+class StatsExporter;
 
 constexpr double USE_ELAPSED_TIME = std::numeric_limits<double>::infinity();
 
@@ -102,7 +111,7 @@ class Window : public osg::Object, public osgGA::GUIActionAdapter
 
     FrameScheme _runFrameScheme{CONTINUOUS};
 
-    osg::ref_ptr<osg::Stats> _stats;
+    osg::ref_ptr<Stats> _stats;
     osg::ref_ptr<StatsCallback> _statsCallback;
     osg::ref_ptr<AddViewportCallback> _addViewportCallback;
     osg::ref_ptr<RemoveViewportCallback> _removeViewportCallback;
@@ -111,9 +120,36 @@ class Window : public osg::Object, public osgGA::GUIActionAdapter
     EventHandlers _eventHandlers;
     // 做一些窗口级别的更新
     osg::ref_ptr<osg::OperationQueue> _updateOperations;
+    // 异步拾取，在渲染遍历时求交
+    osg::ref_ptr<AsyncPicker> _asyncPicker;
+    // computeIntersections使用的拾取缓存，默认不使用
+    osg::ref_ptr<PickCache> _pickCache;
+    // 上一帧写入Stats时的命中和未命中次数
+    unsigned int _lastPickCacheHits{};
+    unsigned int _lastPickCacheMisses{};
 
     bool _requestContinuousUpdate{false};
 
+    bool _collectFrameTimeHistograms{false};
+    double _frameTimeHistogramsInterval{60.0};
+    /// 上一次清空直方图的时间
+    double _frameTimeHistogramsResetTime{};
+    /// 只记录FRAME、EVENT和UPDATE
+    FrameTimeHistograms _frameTimeHistograms;
+    /// 本帧已处理的事件的时间之和
+    double _eventTimeTaken{};
+    /// 上一次frame()的耗时
+    double _frameTimeTaken{};
+
+    bool _emitGLDebugGroups{};
+
+    osg::ref_ptr<HitchDetector> _hitchDetector;
+    osg::ref_ptr<StatsExporter> _statsExporter;
+
+    /// GL对象统计的结果，每秒重新统计一次，其间的帧沿用
+    std::vector<std::pair<osg::ref_ptr<osg::Stats>, GLMemoryStatistics>> _glMemoryStatistics;
+    osg::Timer_t _tickLastGLMemoryStats{};
+
   public:
     Object *cloneType() const override;
 
@@ -176,8 +212,10 @@ class Window : public osg::Object, public osgGA::GUIActionAdapter
 
     FrameScheme getRunFrameScheme() const;
 
+    /// 类型为opeViewer::Stats，通过Stats::setCollectStats打开或关闭统计键
     osg::Stats *getStats() const;
 
+    /// 设置后每帧调用，与统计级别和OPEVIEWER_INSTRUMENTATION无关；没有设置时statsImplementation只在Instrumentation::FULL级别调用
     void setStatsCallback(StatsCallback *statsCallback);
 
     StatsCallback *getStatsCallback();
@@ -194,6 +232,67 @@ class Window : public osg::Object, public osgGA::GUIActionAdapter
 
     void removeUpdateOperation(osg::Operation *operation);
 
+    /// 异步拾取，结果在更新遍历中回调
+    AsyncPicker *getAsyncPicker() const;
+
+    /// 窗口和视口的computeIntersections(ea, intersections, mask)是否使用拾取缓存，默认不使用
+    ///
+    /// 相机和指针不动、场景没有修改（见Scene::getModifiedCount）时跨事件和帧复用，事件处理器修改场景后需要调用Scene::dirtySceneData。每帧的命中和未命中次数记录在Stats的"event"中
+    void setUsePickCache(bool use);
+
+    bool getUsePickCache() const;
+
+    /// 不使用拾取缓存时为空
+    PickCache *getPickCache() const;
+
+    /// 记录各阶段耗时的分布，默认关闭，与Stats是否收集无关，统计级别低于Instrumentation::BASIC时不记录
+    ///
+    /// GPU的分布只在相机的Stats收集"gpu"时记录，不为直方图单独发起计时查询
+    void setCollectFrameTimeHistograms(bool collect);
+
+    bool getCollectFrameTimeHistograms() const;
+
+    /// 每隔多少秒清空一次直方图，默认60秒，0表示不清空
+    void setFrameTimeHistogramsInterval(double interval);
+
+    double getFrameTimeHistogramsInterval() const;
+
+    /// 窗口的FRAME、EVENT和UPDATE
+    ///
+    /// FRAME是frame()的耗时，不包含按需绘制时两帧之间的空闲
+    const FrameTimeHistograms &getFrameTimeHistograms() const;
+
+    /// 相机的CULL、DRAW和GPU，相机没有Renderer时返回空
+    ///
+    /// Renderer在图形线程中写入，需要在两帧之间读取
+    const FrameTimeHistograms *getFrameTimeHistograms(const osg::Camera *camera) const;
+
+    /// 清空窗口和所有视口相机（包含从相机）的记录
+    void resetFrameTimeHistograms();
+
+    /// 上一次frame()的耗时（秒），不包含按需绘制时两帧之间的空闲
+    double getFrameTimeTaken() const;
+
+    /// 在advance中检查刚结束的一帧，为空或统计级别低于Instrumentation::BASIC时不检查，见HitchDetector::attach
+    void setHitchDetector(HitchDetector *hitchDetector);
+
+    HitchDetector *getHitchDetector() const;
+
+    /// 在advance中按间隔导出统计，StatsHandler的输出统计键也导出到这里，为空或统计级别低于Instrumentation::BASIC时不导出
+    void setStatsExporter(StatsExporter *statsExporter);
+
+    StatsExporter *getStatsExporter() const;
+
+    /// 渲染时输出KHR_debug调试组，按窗口、视口、相机、渲染阶段和渲染箱分组，默认关闭，统计级别低于Instrumentation::FULL时不输出
+    ///
+    /// 用于apitrace、RenderDoc等工具的帧捕获，见GLDebugGroups
+    void setEmitGLDebugGroups(bool emit);
+
+    bool getEmitGLDebugGroups() const;
+
+    /// 还未执行的更新操作数量
+    unsigned int getNumPendingUpdateOperations() const;
+
     // 分发来自窗口系统的事件
     virtual bool event(osgGA::GUIEventAdapter &ea);
 
@@ -237,6 +336,11 @@ class Window : public osg::Object, public osgGA::GUIActionAdapter
     void stats();
 
     virtual void statsImplementation();
+
+    /// 各场景、各视口和整个上下文的GL对象统计，写入Stats的"memory"
+    ///
+    /// 场景为其子图持有的对象，视口为相机的渲染目标和不属于场景的子图，窗口为两者的并集以及上下文中纹理和缓冲对象池的大小（包含已释放还未删除的）
+    void glMemoryStats();
 };
 
 } // namespace opeViewer